@@ -1,3 +1,12 @@
+-- Linux machines without X11 development headers (CI, containers) can
+-- still build and run zim-engine --headless, GLFW's null platform is
+-- always compiled in
+newoption
+{
+   trigger = "headless-only",
+   description = "Build GLFW without X11 support, only zim-engine --headless works",
+}
+
 workspace "zim-engine"
    configurations { "debug", "release" }
 
@@ -28,6 +37,8 @@ project "zim-engine"
 
   removefiles
   {
+    "src/bench/**",
+
     "vendor/imgui/backends/imgui_impl_win32.h",
     "vendor/imgui/backends/imgui_impl_win32.cpp",
 
@@ -38,6 +49,7 @@ project "zim-engine"
    
    includedirs
    {
+      "src",
       "vendor/glad/include",
       "vendor/glfw/include",
       "vendor/imgui/",
@@ -48,10 +60,96 @@ project "zim-engine"
    links
    {
        "glfw",
-	   "opengl32",
-		"gdi32",     -- Required for window management
    }
 
+   filter "system:windows"
+      links
+      {
+         "opengl32",
+         "gdi32",     -- Required for window management
+      }
+
+   -- GLFW loads libGL/libEGL/libOSMesa (and libX11) itself at runtime
+   filter "system:linux"
+      links { "dl", "pthread", "m" }
+
+   filter {}
+
+   -- noise kernels built per instruction set, picked at runtime
+   filter { "files:src/world/noise_sse41.cpp", "toolset:not msc*" }
+      buildoptions { "-msse4.1" }
+
+   filter { "files:src/world/noise_avx2.cpp", "toolset:not msc*" }
+      buildoptions { "-mavx2" }
+
+   filter { "files:src/world/noise_avx2.cpp", "toolset:msc*" }
+      buildoptions { "/arch:AVX2" }
+
+   filter "configurations:debug"
+      defines { "ZM_DEBUG" }
+      symbols "On"
+
+   filter "configurations:release"
+      defines { "ZM_NDEBUG" }
+      optimize "On"
+
+
+-- headless CPU benchmarks, no window or GL context needed
+project "zim-bench"
+   kind "ConsoleApp"
+
+   language "C++"
+   cppdialect "C++23"
+
+   targetdir "build/bin/%{cfg.buildcfg}"
+   objdir "build/obj-bench/%{cfg.buildcfg}"
+
+   files {
+      "src/core/**.h",
+      "src/core/**.cpp",
+      "src/world/**.h",
+      "src/world/**.cpp",
+      "src/mesh/**.h",
+      "src/mesh/**.cpp",
+      "src/assets/**.h",
+      "src/assets/**.cpp",
+      "src/physics/**.h",
+      "src/physics/**.cpp",
+      "src/sim/**.h",
+      "src/sim/**.cpp",
+      -- only the GL-free parts of the renderer
+      "src/render/camera.h",
+      "src/render/camera_path.*",
+      "src/render/culling.*",
+      "src/render/buffer_allocator.*",
+      "src/render/draw_commands.*",
+      "src/render/voxel_tree.*",
+      "src/bench/**.h",
+      "src/bench/**.cpp",
+   }
+
+   includedirs
+   {
+      "src",
+      "vendor/glm",
+      "vendor/stb_image",
+   }
+
+   filter "system:linux"
+      links { "pthread" }
+
+   filter {}
+
+   -- noise kernels built per instruction set, picked at runtime
+   filter { "files:src/world/noise_sse41.cpp", "toolset:not msc*" }
+      buildoptions { "-msse4.1" }
+
+   filter { "files:src/world/noise_avx2.cpp", "toolset:not msc*" }
+      buildoptions { "-mavx2" }
+
+   filter { "files:src/world/noise_avx2.cpp", "toolset:msc*" }
+      buildoptions { "/arch:AVX2" }
+
    filter "configurations:debug"
       defines { "ZM_DEBUG" }
       symbols "On"
@@ -72,12 +170,13 @@ project "glfw"
         "vendor/glfw/include",
     }
 
-    defines {
-        "_GLFW_WIN32"
-        -- "_GLFW_X11",
-    }
-
     files
     {
         "vendor/glfw/src/**.c",
     }
+
+    filter "system:windows"
+        defines { "_GLFW_WIN32" }
+
+    filter { "system:linux", "not options:headless-only" }
+        defines { "_GLFW_X11" }
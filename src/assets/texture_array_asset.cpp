@@ -0,0 +1,271 @@
+#include "assets/texture_array_asset.h"
+
+#include "core/hash.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr uint32_t cacheMagic = 0x41544D5A; // "ZMTA"
+    constexpr uint32_t cacheVersion = 1;
+    constexpr size_t cacheDataAlignment = 256;
+
+    struct CacheHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t contentHash;
+      uint32_t layerSize;
+      uint32_t layerCount;
+      uint32_t mipCount;
+      uint32_t reserved;
+      uint64_t mipOffsets[TextureArrayAsset::MAX_MIPS]; // from the start of the file
+      uint64_t fileSize;
+    };
+
+    uint32_t mipCountFor(uint32_t size)
+    {
+      uint32_t count = 1;
+      while ((size >> count) > 0)
+        count++;
+      return count;
+    }
+
+    // area average of the source footprint of every destination texel, the
+    // source is flipped so row 0 is the bottom like GL expects
+    void resample(const uint8_t* src, int srcWidth, int srcHeight, uint8_t* dst, uint32_t size)
+    {
+      for (uint32_t y = 0; y < size; y++)
+      {
+        const int y0 = int(uint64_t(y) * srcHeight / size);
+        const int y1 = std::max(y0 + 1, int(uint64_t(y + 1) * srcHeight / size));
+        for (uint32_t x = 0; x < size; x++)
+        {
+          const int x0 = int(uint64_t(x) * srcWidth / size);
+          const int x1 = std::max(x0 + 1, int(uint64_t(x + 1) * srcWidth / size));
+
+          uint32_t sum[4] = {};
+          for (int sy = y0; sy < y1; sy++)
+          {
+            const uint8_t* row = src + size_t(srcHeight - 1 - sy) * srcWidth * 4;
+            for (int sx = x0; sx < x1; sx++)
+              for (int c = 0; c < 4; c++)
+                sum[c] += row[sx * 4 + c];
+          }
+
+          const uint32_t count = uint32_t((y1 - y0) * (x1 - x0));
+          uint8_t* out = dst + (size_t(y) * size + x) * 4;
+          for (int c = 0; c < 4; c++)
+            out[c] = uint8_t((sum[c] + count / 2) / count);
+        }
+      }
+    }
+
+    // 2x2 box filter into the next mip
+    void downsample(const uint8_t* src, uint32_t srcSize, uint8_t* dst)
+    {
+      const uint32_t size = srcSize / 2;
+      for (uint32_t y = 0; y < size; y++)
+      {
+        const uint8_t* row0 = src + size_t(y * 2) * srcSize * 4;
+        const uint8_t* row1 = row0 + size_t(srcSize) * 4;
+        for (uint32_t x = 0; x < size; x++)
+        {
+          for (int c = 0; c < 4; c++)
+          {
+            const uint32_t sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+            dst[(size_t(y) * size + x) * 4 + c] = uint8_t((sum + 2) / 4);
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<std::filesystem::path> listTextureFiles(const std::filesystem::path& directory)
+  {
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+      if (!entry.is_regular_file(error))
+        continue;
+      std::string extension = entry.path().extension().string();
+      std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+      if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+        files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.filename() < b.filename(); });
+    return files;
+  }
+
+  uint64_t hashTextureSources(const std::vector<std::filesystem::path>& files, const TextureArraySettings& settings)
+  {
+    uint64_t hash = fnv1a(&cacheVersion, sizeof(cacheVersion));
+    hash = fnv1a(hash, &settings.layerSize, sizeof(settings.layerSize));
+
+    std::vector<char> contents;
+    for (const std::filesystem::path& file : files)
+    {
+      // names only, so moving the checkout doesn't throw the cache away
+      const std::string name = file.filename().string();
+      hash = fnv1a(hash, name.c_str(), name.size() + 1);
+
+      std::ifstream stream(file, std::ios::binary | std::ios::ate);
+      contents.resize(size_t(std::max<std::streamoff>(0, stream.tellg())));
+      stream.seekg(0);
+      stream.read(contents.data(), std::streamsize(contents.size()));
+      const uint64_t length = contents.size();
+      hash = fnv1a(hash, &length, sizeof(length));
+      hash = fnv1a(hash, contents.data(), contents.size());
+    }
+    return hash;
+  }
+
+  bool TextureArrayAsset::load(const std::filesystem::path& directory, const std::filesystem::path& cachePath, const TextureArraySettings& settings)
+  {
+    const std::vector<std::filesystem::path> files = listTextureFiles(directory);
+    hash = hashTextureSources(files, settings);
+
+    if (loadCache(cachePath, hash))
+      return true;
+
+    const uint32_t maxLayerSize = 1u << (MAX_MIPS - 1);
+    uint32_t layerSize = 1;
+    while (layerSize * 2 <= std::min(settings.layerSize, maxLayerSize))
+      layerSize *= 2;
+    if (!build(files, layerSize))
+      return false;
+
+    if (!writeCache(cachePath))
+      std::fprintf(stderr, "TextureArrayAsset: could not write cache %s\n", cachePath.string().c_str());
+    return true;
+  }
+
+  bool TextureArrayAsset::loadCache(const std::filesystem::path& cachePath, uint64_t expectedHash)
+  {
+    if (!mapped.open(cachePath.string()) || mapped.size() < sizeof(CacheHeader))
+      return false;
+
+    CacheHeader header;
+    std::memcpy(&header, mapped.data(), sizeof(header));
+    bool valid = header.magic == cacheMagic && header.version == cacheVersion && header.contentHash == expectedHash &&
+                 header.fileSize == mapped.size() && header.layerCount > 0 && header.layerSize > 0 &&
+                 (header.layerSize & (header.layerSize - 1)) == 0 && header.mipCount == mipCountFor(header.layerSize) &&
+                 header.mipCount <= MAX_MIPS;
+    for (uint32_t level = 0; valid && level < header.mipCount; level++)
+    {
+      const uint64_t levelSize = header.layerSize >> level;
+      valid = header.mipOffsets[level] + levelSize * levelSize * 4 * header.layerCount <= mapped.size();
+    }
+    if (!valid)
+    {
+      mapped.close();
+      return false;
+    }
+
+    size = header.layerSize;
+    layers = header.layerCount;
+    mips = header.mipCount;
+    base = mapped.data();
+    std::copy(header.mipOffsets, header.mipOffsets + MAX_MIPS, mipOffsets);
+    pixels.clear();
+    fromCache = true;
+    return true;
+  }
+
+  bool TextureArrayAsset::build(const std::vector<std::filesystem::path>& files, uint32_t layerSize)
+  {
+    mapped.close();
+    fromCache = false;
+    size = layerSize;
+    mips = mipCountFor(layerSize);
+
+    std::vector<std::vector<uint8_t>> images;
+    for (const std::filesystem::path& file : files)
+    {
+      int width, height, channels;
+      uint8_t* data = stbi_load(file.string().c_str(), &width, &height, &channels, 4);
+      if (!data)
+      {
+        std::fprintf(stderr, "TextureArrayAsset: failed to load %s: %s\n", file.string().c_str(), stbi_failure_reason());
+        continue;
+      }
+
+      images.emplace_back(size_t(size) * size * 4);
+      resample(data, width, height, images.back().data(), size);
+      stbi_image_free(data);
+    }
+
+    layers = uint32_t(images.size());
+    if (layers == 0)
+      return false;
+
+    size_t total = 0;
+    for (uint32_t level = 0; level < mips; level++)
+    {
+      mipOffsets[level] = total;
+      total += mipBytes(level);
+    }
+    pixels.assign(total, 0);
+    base = pixels.data();
+
+    for (uint32_t layer = 0; layer < layers; layer++)
+    {
+      std::memcpy(pixels.data() + mipOffsets[0] + size_t(layer) * mipBytes(0) / layers, images[layer].data(), images[layer].size());
+      for (uint32_t level = 1; level < mips; level++)
+      {
+        const uint8_t* src = pixels.data() + mipOffsets[level - 1] + size_t(layer) * (mipBytes(level - 1) / layers);
+        uint8_t* dst = pixels.data() + mipOffsets[level] + size_t(layer) * (mipBytes(level) / layers);
+        downsample(src, mipSize(level - 1), dst);
+      }
+    }
+    return true;
+  }
+
+  bool TextureArrayAsset::writeCache(const std::filesystem::path& cachePath) const
+  {
+    std::error_code error;
+    if (cachePath.has_parent_path())
+      std::filesystem::create_directories(cachePath.parent_path(), error);
+
+    const size_t dataStart = (sizeof(CacheHeader) + cacheDataAlignment - 1) / cacheDataAlignment * cacheDataAlignment;
+    CacheHeader header = {};
+    header.magic = cacheMagic;
+    header.version = cacheVersion;
+    header.contentHash = hash;
+    header.layerSize = size;
+    header.layerCount = layers;
+    header.mipCount = mips;
+    for (uint32_t level = 0; level < mips; level++)
+      header.mipOffsets[level] = dataStart + mipOffsets[level];
+    header.fileSize = dataStart + pixels.size();
+
+    // written next to the real file and renamed over it, a crash half way
+    // never leaves a truncated cache behind
+    std::filesystem::path temporary = cachePath;
+    temporary += ".tmp";
+    {
+      std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+      if (!stream)
+        return false;
+      std::vector<char> padding(dataStart - sizeof(header), 0);
+      stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      stream.write(padding.data(), std::streamsize(padding.size()));
+      stream.write(reinterpret_cast<const char*>(pixels.data()), std::streamsize(pixels.size()));
+      if (!stream)
+        return false;
+    }
+    std::filesystem::rename(temporary, cachePath, error);
+    return !error;
+  }
+}
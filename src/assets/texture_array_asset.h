@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace zm
+{
+  struct TextureArraySettings
+  {
+    uint32_t layerSize = 256; // rounded down to a power of two
+  };
+
+  // Every image in a directory, sorted by file name, resampled to one square
+  // RGBA8 layer each with the full mip chain worked out offline.
+  //
+  // The result is written to a cache file laid out exactly like the upload
+  // wants it (mip after mip, each holding every layer), so later runs map the
+  // file and hand the pages straight to the driver: no decoding, resampling
+  // or mip generation. The cache is keyed on a hash of the settings, file
+  // names and file contents, any change to textures/ rebuilds it
+  class TextureArrayAsset
+  {
+  public:
+    static constexpr uint32_t MAX_MIPS = 16;
+
+    // Loads from cachePath when it is current, otherwise builds from the
+    // images and rewrites the cache. False when no image could be loaded
+    bool load(const std::filesystem::path& directory, const std::filesystem::path& cachePath, const TextureArraySettings& settings = {});
+
+    uint32_t layerSize() const { return size; }
+    uint32_t layerCount() const { return layers; }
+    uint32_t mipCount() const { return mips; }
+    uint32_t mipSize(uint32_t level) const { return size >> level; }
+
+    // every layer of one mip level, layer after layer
+    const uint8_t* mipData(uint32_t level) const { return base + mipOffsets[level]; }
+    size_t mipBytes(uint32_t level) const { return size_t(mipSize(level)) * mipSize(level) * 4 * layers; }
+
+    bool loadedFromCache() const { return fromCache; }
+    uint64_t contentHash() const { return hash; }
+
+  private:
+    bool loadCache(const std::filesystem::path& cachePath, uint64_t expectedHash);
+    bool build(const std::vector<std::filesystem::path>& files, uint32_t layerSize);
+    bool writeCache(const std::filesystem::path& cachePath) const;
+
+    MappedFile mapped;
+    std::vector<uint8_t> pixels;
+    const uint8_t* base = nullptr;
+    size_t mipOffsets[MAX_MIPS] = {};
+    uint32_t size = 0;
+    uint32_t layers = 0;
+    uint32_t mips = 0;
+    uint64_t hash = 0;
+    bool fromCache = false;
+  };
+
+  // image files in directory that stb_image can read, sorted by name so the
+  // layer order is stable
+  std::vector<std::filesystem::path> listTextureFiles(const std::filesystem::path& directory);
+
+  // FNV-1a over the settings, the file names and the file bytes
+  uint64_t hashTextureSources(const std::vector<std::filesystem::path>& files, const TextureArraySettings& settings);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Headless CPU benchmarks. Every benchmark also checks its own results and
+// returns non-zero when something is wrong, so the bench binary doubles as a
+// regression check on machines without a GPU
+namespace zm::bench
+{
+  struct Timer
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    double seconds() const
+    {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+  // Nearest-rank percentile, p in [0, 1]. Reorders samples
+  inline double percentile(std::vector<double>& samples, double p)
+  {
+    if (samples.empty())
+      return 0.0;
+    const size_t i = std::min(samples.size() - 1, size_t(p * double(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+    return samples[i];
+  }
+
+  inline bool check(bool condition, const char* what)
+  {
+    if (!condition)
+      std::printf("  CHECK FAILED: %s\n", what);
+    return condition;
+  }
+
+  // Cheap deterministic random numbers for benchmark inputs
+  struct Rng
+  {
+    uint64_t state;
+
+    explicit Rng(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+
+    uint64_t next()
+    {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      return state;
+    }
+
+    int range(int lo, int hi) { return lo + int(next() % uint64_t(hi - lo)); }
+  };
+
+  // Unit vector, uniform over the sphere by rejection sampling in a cube
+  inline glm::vec3 randomDirection(Rng& rng)
+  {
+    for (;;)
+    {
+      const glm::vec3 v(float(rng.range(-1000, 1001)), float(rng.range(-1000, 1001)), float(rng.range(-1000, 1001)));
+      const float length = glm::length(v);
+      if (length > 100.0f && length <= 1000.0f)
+        return v / length;
+    }
+  }
+
+  int chunkStorage(int argc, char** argv);
+  int mesher(int argc, char** argv);
+  int jobs(int argc, char** argv);
+  int terrain(int argc, char** argv);
+  int culling(int argc, char** argv);
+  int renderBuffers(int argc, char** argv);
+  int textures(int argc, char** argv);
+  int profiler(int argc, char** argv);
+  int regions(int argc, char** argv);
+  int lod(int argc, char** argv);
+  int edits(int argc, char** argv);
+  int sim(int argc, char** argv);
+  int physics(int argc, char** argv);
+  int voxels(int argc, char** argv);
+  int allocators(int argc, char** argv);
+  int streaming(int argc, char** argv);
+  int shading(int argc, char** argv);
+}
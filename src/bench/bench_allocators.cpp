@@ -0,0 +1,248 @@
+#include "bench/bench.h"
+
+#include "core/allocators.h"
+#include "mesh/chunk_mesher.h"
+#include "world/chunk_storage.h"
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace zm::bench
+{
+  namespace
+  {
+    constexpr int RADIUS = 5;          // chunks kept around the camera on x and z
+    constexpr int LAYERS = 5;          // chunk layers from y = 0
+    constexpr int EDITS_PER_STEP = 300;
+    constexpr size_t MAX_QUEUED_MESHES = 64; // uploaded once this many are waiting
+    constexpr int CHURN_OPS = 400000;
+
+    constexpr int faceOffsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    struct FlyResult
+    {
+      double seconds = 0.0;
+      size_t loaded = 0;
+      size_t unloaded = 0;
+      size_t meshes = 0;
+      size_t faces = 0;
+    };
+
+    void meshChunk(ChunkStorage& world, ChunkCoord coord, std::vector<ChunkMesh>& uploads)
+    {
+      const Chunk* neighbours[FACE_COUNT];
+      for (int f = 0; f < FACE_COUNT; f++)
+        neighbours[f] = world.getChunk({ coord.x + faceOffsets[f][0], coord.y + faceOffsets[f][1], coord.z + faceOffsets[f][2] });
+      uploads.emplace_back();
+      ChunkMesher::forThisThread().mesh(*world.getChunk(coord), neighbours, uploads.back());
+    }
+
+    // what the render thread does with a finished mesh: copy it out, drop it
+    void upload(std::vector<ChunkMesh>& uploads, FlyResult& result)
+    {
+      for (const ChunkMesh& mesh : uploads)
+        result.faces += mesh.quadCount();
+      result.meshes += uploads.size();
+      uploads.clear();
+    }
+
+    // The camera flies along +x one chunk per step. Chunks entering the ring
+    // are generated and meshed, the ones falling out behind are dropped, and
+    // a few hundred random edits repack and remesh chunks near the camera.
+    // Meshes wait in a queue of up to MAX_QUEUED_MESHES and are thrown away
+    // once "uploaded"
+    FlyResult flyThrough(int steps)
+    {
+      FlyResult result;
+      ChunkStorage world;
+      TerrainGenerator generator;
+      std::vector<ChunkMesh> uploads;
+      std::vector<ChunkCoord> fresh;
+      Rng rng(3);
+
+      const Timer timer;
+      for (int step = 0; step < steps; step++)
+      {
+        const int cameraX = step;
+        fresh.clear();
+        for (int y = 0; y < LAYERS; y++)
+          for (int z = -RADIUS; z <= RADIUS; z++)
+            for (int x = cameraX - RADIUS; x <= cameraX + RADIUS; x++)
+              if (!world.getChunk({ x, y, z }))
+              {
+                generator.generate({ x, y, z }, world.getOrCreateChunk({ x, y, z }));
+                fresh.push_back({ x, y, z });
+              }
+        result.loaded += fresh.size();
+
+        for (int i = 0; i < EDITS_PER_STEP; i++)
+        {
+          const int x = rng.range((cameraX - 2) * CHUNK_SIZE, (cameraX + 3) * CHUNK_SIZE);
+          const int y = rng.range(30, 110);
+          const int z = rng.range(-2 * CHUNK_SIZE, 3 * CHUNK_SIZE);
+          world.setBlock(x, y, z, BlockId(rng.range(0, BLOCK_COUNT)));
+          fresh.push_back(worldToChunk(x, y, z));
+        }
+
+        for (const ChunkCoord& coord : fresh)
+        {
+          meshChunk(world, coord, uploads);
+          if (uploads.size() >= MAX_QUEUED_MESHES)
+            upload(uploads, result);
+        }
+        upload(uploads, result);
+
+        for (int y = 0; y < LAYERS; y++)
+          for (int z = -RADIUS; z <= RADIUS; z++)
+            result.unloaded += world.removeChunk({ cameraX - RADIUS - 1, y, z });
+      }
+      result.seconds = timer.seconds();
+      return result;
+    }
+
+    // Allocate/free with a working set of live buffers, in the sizes chunk
+    // words and meshes come in. Nanoseconds per allocate + free
+    double churn()
+    {
+      struct Live
+      {
+        void* pointer = nullptr;
+        size_t bytes = 0;
+        bool words = false;
+      };
+      std::vector<Live> live(1024);
+      Rng rng(9);
+
+      const Timer timer;
+      for (int i = 0; i < CHURN_OPS; i++)
+      {
+        Live& slot = live[size_t(rng.range(0, int(live.size())))];
+        if (slot.pointer)
+        {
+          if (slot.words)
+            ChunkWordPool::deallocate(slot.pointer, slot.bytes);
+          else
+            VertexStagingPool::deallocate(slot.pointer, slot.bytes);
+        }
+        slot.words = rng.range(0, 2) != 0;
+        slot.bytes = slot.words ? size_t(CHUNK_VOLUME / 8) << rng.range(0, 5) : size_t(rng.range(1, 10000)) * sizeof(PackedFace);
+        slot.pointer = slot.words ? ChunkWordPool::allocate(slot.bytes) : VertexStagingPool::allocate(slot.bytes);
+        // touch it like a real user would
+        std::memset(slot.pointer, 0, std::min<size_t>(slot.bytes, 64));
+      }
+      const double seconds = timer.seconds();
+
+      for (Live& slot : live)
+        if (slot.pointer)
+        {
+          if (slot.words)
+            ChunkWordPool::deallocate(slot.pointer, slot.bytes);
+          else
+            VertexStagingPool::deallocate(slot.pointer, slot.bytes);
+        }
+      return seconds * 1e9 / CHURN_OPS;
+    }
+
+    int runMode(bool pooled, int steps)
+    {
+      bool ok = check(setMemoryPooling(pooled), "allocation mode picked before anything was allocated (run the mode in its own process)");
+      if (!ok)
+        return 1;
+
+      const ProcessMemory before = processMemory();
+      const FlyResult fly = flyThrough(steps);
+      const ProcessMemory after = processMemory();
+
+      std::printf("  %s: %d steps, %zu chunks loaded, %zu dropped, %zu meshes (%.1f M faces) in %.2fs\n", pooled ? "pooled" : "heap", steps,
+        fly.loaded, fly.unloaded, fly.meshes, double(fly.faces) / 1e6, fly.seconds);
+      std::printf("  RSS %.1f MB at start, %.1f MB at the end, %.1f MB peak\n", before.residentBytes / 1048576.0, after.residentBytes / 1048576.0,
+        after.peakResidentBytes / 1048576.0);
+      for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++)
+      {
+        const MemoryStats stats = memoryStats(MemoryCategory(c));
+        std::printf("  %-15s live %7.2f MB, peak %7.2f MB, reserved %7.2f MB, high-water %7.2f MB, %8llu allocations, %7llu from the heap\n",
+          memoryCategoryName(MemoryCategory(c)), stats.liveBytes / 1048576.0, stats.peakLiveBytes / 1048576.0, stats.reservedBytes / 1048576.0,
+          stats.highWaterBytes / 1048576.0, (unsigned long long)stats.allocations, (unsigned long long)stats.heapAllocations);
+      }
+
+      const double nsPerOp = churn();
+      std::printf("  churn: %.1f ns per allocate + free\n", nsPerOp);
+
+      const MemoryStats words = memoryStats(MEMORY_CHUNK_BLOCKS);
+      const MemoryStats staging = memoryStats(MEMORY_VERTEX_STAGING);
+      ok &= check(words.liveBytes == 0 && staging.liveBytes == 0, "every chunk and mesh buffer was given back");
+      if (pooled)
+      {
+        ok &= check(words.heapAllocations * 8 < words.allocations, "chunk words mostly come from recycled slabs");
+        ok &= check(staging.heapAllocations * 4 < staging.allocations, "staging buffers are mostly recycled");
+      }
+      else
+        ok &= check(words.heapAllocations == words.allocations, "without pooling everything goes to the heap");
+
+      // for the parent process
+      std::printf("result %f %f %f\n", after.peakResidentBytes / 1048576.0, fly.seconds, nsPerOp);
+      return ok ? 0 : 1;
+    }
+
+    std::string executablePath()
+    {
+#if defined(_WIN32)
+      char path[MAX_PATH];
+      const DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+      return std::string(path, length);
+#else
+      std::error_code error;
+      return std::filesystem::read_symlink("/proc/self/exe", error).string();
+#endif
+    }
+
+    // Runs one mode in a fresh process, the allocation mode and peak RSS
+    // are per process. Echoes its output, false when it failed
+    bool runChild(const char* mode, int steps, double result[3])
+    {
+      const std::string command = "\"" + executablePath() + "\" allocators " + std::to_string(steps) + " " + mode;
+      std::FILE* pipe = popen(command.c_str(), "r");
+      if (!pipe)
+        return check(false, "bench process started");
+
+      bool found = false;
+      char line[512];
+      while (std::fgets(line, sizeof(line), pipe))
+      {
+        if (std::sscanf(line, "result %lf %lf %lf", &result[0], &result[1], &result[2]) == 3)
+          found = true;
+        else if (std::strncmp(line, "[allocators]", 12) != 0)
+          std::fputs(line, stdout);
+      }
+      return pclose(pipe) == 0 && found;
+    }
+  }
+
+  int allocators(int argc, char** argv)
+  {
+    const int steps = argc > 0 ? std::atoi(argv[0]) : 48;
+    if (argc > 1)
+      return runMode(std::strcmp(argv[1], "heap") != 0, steps);
+
+    double pooled[3] = {}, heap[3] = {};
+    bool ok = check(runChild("pooled", steps, pooled), "pooled run");
+    ok &= check(runChild("heap", steps, heap), "heap run");
+    if (ok)
+      std::printf("  pooled vs heap: peak RSS %.1f vs %.1f MB, fly-through %.2f vs %.2fs, churn %.1f vs %.1f ns (%.1fx)\n", pooled[0], heap[0],
+        pooled[1], heap[1], pooled[2], heap[2], heap[2] / pooled[2]);
+    return ok ? 0 : 1;
+  }
+}
@@ -0,0 +1,120 @@
+#include "bench/bench.h"
+
+#include "world/chunk_storage.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    // Rolling hills with a few layers and scattered ores, enough variety to
+    // exercise every palette width without needing the terrain generator
+    BlockId testBlock(int x, int y, int z)
+    {
+      const int height = 96 + int(24.0f * std::sin(x * 0.05f) * std::cos(z * 0.04f) + 8.0f * std::sin((x + z) * 0.11f));
+      if (y > height)
+        return y < 90 ? BLOCK_WATER : BLOCK_AIR; // water fills the valleys
+      if (y == height)
+        return BLOCK_GRASS;
+      if (y > height - 4)
+        return BLOCK_DIRT;
+
+      const uint32_t h = uint32_t(x * 73856093) ^ uint32_t(y * 19349663) ^ uint32_t(z * 83492791);
+      if ((h & 1023) == 0)
+        return BlockId(BLOCK_COAL_ORE + (h >> 10) % 4);
+      return BLOCK_STONE;
+    }
+  }
+
+  int chunkStorage(int argc, char** argv)
+  {
+    const int sizeX = argc > 0 ? std::atoi(argv[0]) : 512;
+    const int sizeY = argc > 1 ? std::atoi(argv[1]) : 256;
+    const int sizeZ = argc > 2 ? std::atoi(argv[2]) : 512;
+    const double voxels = double(sizeX) * sizeY * sizeZ;
+    bool ok = true;
+
+    std::printf("  world %dx%dx%d (%.1fM voxels)\n", sizeX, sizeY, sizeZ, voxels / 1e6);
+
+    ChunkStorage world;
+
+    Timer setTimer;
+    for (int y = 0; y < sizeY; y++)
+      for (int z = 0; z < sizeZ; z++)
+        for (int x = 0; x < sizeX; x++)
+          world.setBlock(x, y, z, testBlock(x, y, z));
+    const double setSeconds = setTimer.seconds();
+
+    const size_t looseBytes = world.memoryUsage();
+    world.forEachChunk([](const ChunkCoord&, Chunk& chunk) { chunk.compact(); });
+    const size_t bytes = world.memoryUsage();
+
+    size_t uniform = 0;
+    world.forEachChunk([&](const ChunkCoord&, const Chunk& chunk) { uniform += chunk.isUniform(); });
+
+    std::printf("  set: %.1f Mops/s (%.2fs)\n", voxels / setSeconds / 1e6, setSeconds);
+    std::printf("  chunks: %zu (%zu uniform)\n", world.chunkCount(), uniform);
+    std::printf("  memory: %.2f MB before compact, %.2f MB after\n", looseBytes / 1e6, bytes / 1e6);
+    std::printf("  bytes/voxel: %.4f (flat uint16 would be 2.0)\n", bytes / voxels);
+
+    // sequential scan in storage order
+    uint64_t mismatches = 0;
+    Timer getTimer;
+    for (int y = 0; y < sizeY; y++)
+      for (int z = 0; z < sizeZ; z++)
+        for (int x = 0; x < sizeX; x++)
+          mismatches += world.getBlock(x, y, z) != testBlock(x, y, z);
+    const double getSeconds = getTimer.seconds();
+    std::printf("  get (sequential, incl. reference): %.1f Mops/s\n", voxels / getSeconds / 1e6);
+    ok &= check(mismatches == 0, "sequential reads match what was written");
+
+    // random access, reference computed up front so only lookups are timed
+    constexpr int randomReads = 1 << 22;
+    Rng rng(1234);
+    std::vector<int> coords(randomReads * 3);
+    for (int i = 0; i < randomReads; i++)
+    {
+      coords[i * 3 + 0] = rng.range(0, sizeX);
+      coords[i * 3 + 1] = rng.range(0, sizeY);
+      coords[i * 3 + 2] = rng.range(0, sizeZ);
+    }
+
+    uint64_t checksum = 0;
+    Timer randomTimer;
+    for (int i = 0; i < randomReads; i++)
+      checksum += world.getBlock(coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]);
+    const double randomSeconds = randomTimer.seconds();
+
+    uint64_t expected = 0;
+    for (int i = 0; i < randomReads; i++)
+      expected += testBlock(coords[i * 3], coords[i * 3 + 1], coords[i * 3 + 2]);
+    std::printf("  get (random): %.1f Mops/s\n", randomReads / randomSeconds / 1e6);
+    ok &= check(checksum == expected, "random reads match what was written");
+
+    // outside the written area and at negative coords everything is air
+    ok &= check(world.getBlock(-1, 0, 0) == BLOCK_AIR && world.getBlock(0, -40, 0) == BLOCK_AIR, "unwritten space reads as air");
+    world.setBlock(-1, -1, -1, 7);
+    ok &= check(world.getBlock(-1, -1, -1) == 7 && world.getChunk({ -1, -1, -1 }) != nullptr, "negative coords map to chunk -1");
+
+    // palette widths grow and collapse correctly
+    Chunk chunk;
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+      chunk.setIndex(i, BlockId(i % 300));
+    ok &= check(chunk.bitsPerBlock() == 16, "more than 256 distinct ids switches to direct storage");
+    bool roundTrip = true;
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+      roundTrip &= chunk.getIndex(i) == BlockId(i % 300);
+    ok &= check(roundTrip, "direct storage round trips");
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+      chunk.setIndex(i, BlockId(i & 1));
+    chunk.compact();
+    ok &= check(chunk.bitsPerBlock() == 1, "compact shrinks back to 1 bit");
+    chunk.fill(4);
+    ok &= check(chunk.isUniform() && chunk.get(31, 31, 31) == 4, "fill collapses to a single value");
+
+    return ok ? 0 : 1;
+  }
+}
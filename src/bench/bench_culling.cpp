@@ -0,0 +1,163 @@
+#include "bench/bench.h"
+
+#include "mesh/chunk_mesher.h"
+#include "render/camera.h"
+#include "render/camera_path.h"
+#include "render/culling.h"
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    struct PathResult
+    {
+      double cullMicros = 0.0;
+      double tested = 0.0, frustumCulled = 0.0, occlusionCulled = 0.0, drawn = 0.0;
+      std::vector<std::vector<ChunkCoord>> visiblePerFrame;
+    };
+
+    PathResult replay(ChunkCuller& culler, const CameraPath& path, float fps, float farPlane)
+    {
+      PathResult result;
+      Camera camera;
+      camera.aspect = 1280.0f / 820.0f;
+      camera.farPlane = farPlane;
+
+      const int frames = std::max(1, int(path.duration() * fps));
+      std::vector<ChunkCoord> visible;
+      for (int f = 0; f < frames; f++)
+      {
+        const CameraKeyframe key = path.sample(float(f) / fps);
+        camera.position = key.position;
+        camera.setRotation(key.yaw, key.pitch);
+
+        Timer timer;
+        culler.cull(camera.viewProjection(), camera.position, visible);
+        result.cullMicros += timer.seconds() * 1e6;
+
+        const CullStats& stats = culler.stats();
+        result.tested += stats.tested;
+        result.frustumCulled += stats.frustumCulled;
+        result.occlusionCulled += stats.occlusionCulled;
+        result.drawn += stats.drawn;
+
+        std::sort(visible.begin(), visible.end(), [](const ChunkCoord& a, const ChunkCoord& b) {
+          return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+        });
+        result.visiblePerFrame.push_back(visible);
+      }
+
+      const double n = double(frames);
+      result.cullMicros /= n;
+      result.tested /= n;
+      result.frustumCulled /= n;
+      result.occlusionCulled /= n;
+      result.drawn /= n;
+      return result;
+    }
+
+    void printResult(const char* name, const PathResult& r)
+    {
+      std::printf("  %-22s %7.1f us/frame  tested %6.0f  frustum-culled %6.0f  occlusion-culled %6.0f  drawn %6.0f\n", name,
+        r.cullMicros, r.tested, r.frustumCulled, r.occlusionCulled, r.drawn);
+    }
+  }
+
+  // usage: culling [radius] [layers] [camera_path.txt]
+  int culling(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 10;
+    const int layers = argc > 1 ? std::atoi(argv[1]) : 5;
+    bool ok = true;
+
+    // frustum sanity
+    {
+      Camera camera;
+      camera.position = glm::vec3(0.0f);
+      camera.setRotation(-90.0f, 0.0f); // looking down -z
+      const Frustum frustum = Frustum::fromViewProjection(camera.viewProjection());
+      ok &= check(frustum.intersectsBox(glm::vec3(-1, -1, -12), glm::vec3(1, 1, -10)), "box in front is visible");
+      ok &= check(!frustum.intersectsBox(glm::vec3(-1, -1, 10), glm::vec3(1, 1, 12)), "box behind is culled");
+      ok &= check(!frustum.intersectsBox(glm::vec3(-1, -1, -300), glm::vec3(1, 1, -200)), "box past the far plane is culled");
+    }
+
+    // connectivity sanity: a solid wall with a tunnel only links the two tunnel ends
+    {
+      std::vector<BlockId> blocks(CHUNK_VOLUME, BLOCK_STONE);
+      for (int x = 0; x < CHUNK_SIZE; x++)
+        blocks[chunkIndex(x, 10, 10)] = BLOCK_AIR;
+      const FaceConnectivity c = computeFaceConnectivity(blocks.data());
+      ok &= check(facesConnected(c, FACE_NEG_X, FACE_POS_X) && !facesConnected(c, FACE_NEG_Y, FACE_POS_Y) && !facesConnected(c, FACE_NEG_X, FACE_POS_Y),
+        "tunnel connects only its two ends");
+    }
+
+    TerrainGenerator generator;
+    ChunkStorage world;
+    for (int y = 0; y < layers; y++)
+      for (int z = -radius; z < radius; z++)
+        for (int x = -radius; x < radius; x++)
+          generator.generate({ x, y, z }, world.getOrCreateChunk({ x, y, z }));
+
+    static constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    auto mesher = std::make_unique<ChunkMesher>();
+    ChunkMesh mesh;
+    ChunkCuller culler;
+    world.forEachChunk([&](const ChunkCoord& coord, const Chunk& chunk) {
+      const Chunk* neighbours[FACE_COUNT];
+      for (int f = 0; f < FACE_COUNT; f++)
+        neighbours[f] = world.getChunk({ coord.x + offsets[f][0], coord.y + offsets[f][1], coord.z + offsets[f][2] });
+      mesher->mesh(chunk, neighbours, mesh);
+      culler.setChunk(coord, mesh.faceConnectivity, !mesh.empty());
+    });
+    std::printf("  %zu chunks registered\n", culler.chunkCount());
+
+    CameraPath path;
+    if (argc > 2)
+    {
+      ok &= check(path.load(argv[2]), "camera path file loads");
+      std::printf("  replaying %s (%zu keyframes)\n", argv[2], path.keyframes().size());
+    }
+    if (path.empty())
+    {
+      // orbit that dives from above the hills down into the rock and back
+      const float ground = float(generator.heightAt(0, 0));
+      path = CameraPath::orbit(glm::vec3(0.0f, 0.0f, 0.0f), radius * CHUNK_SIZE * 0.4f, ground - 40.0f, ground + 40.0f, 20.0f, 64);
+    }
+
+    constexpr float fps = 60.0f;
+    constexpr float farPlane = 500.0f;
+
+    culler.setOcclusionEnabled(false);
+    culler.setSimdEnabled(false);
+    const PathResult scalar = replay(culler, path, fps, farPlane);
+    culler.setSimdEnabled(true);
+    const PathResult simd = replay(culler, path, fps, farPlane);
+    culler.setOcclusionEnabled(true);
+    const PathResult occlusion = replay(culler, path, fps, farPlane);
+
+    printResult("frustum (scalar)", scalar);
+    printResult("frustum (sse2)", simd);
+    printResult("frustum + cave culling", occlusion);
+
+    ok &= check(scalar.visiblePerFrame == simd.visiblePerFrame, "simd frustum test matches scalar");
+
+    bool subset = true;
+    for (size_t f = 0; f < simd.visiblePerFrame.size(); f++)
+    {
+      const auto& all = simd.visiblePerFrame[f];
+      for (const ChunkCoord& c : occlusion.visiblePerFrame[f])
+        subset &= std::binary_search(all.begin(), all.end(), c, [](const ChunkCoord& a, const ChunkCoord& b) {
+          return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+        });
+    }
+    ok &= check(subset, "occlusion only ever removes frustum-visible chunks");
+
+    return ok ? 0 : 1;
+  }
+}
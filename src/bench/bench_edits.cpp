@@ -0,0 +1,306 @@
+#include "bench/bench.h"
+
+#include "core/job_system.h"
+#include "world/chunk_builder.h"
+#include "world/world_editor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    constexpr int TOP_CHUNK_Y = 4;
+
+    // Chunks radius around the origin, every layer up to TOP_CHUNK_Y
+    struct Box
+    {
+      int radius;
+
+      int size() const { return (2 * radius + 1) * CHUNK_SIZE; }
+      int height() const { return (TOP_CHUNK_Y + 1) * CHUNK_SIZE; }
+      int minBlock() const { return -radius * CHUNK_SIZE; }
+      size_t index(int x, int y, int z) const
+      {
+        return (size_t(y) * size() + size_t(z - minBlock())) * size() + size_t(x - minBlock());
+      }
+    };
+
+    // Light of the whole box from scratch, one flood fill over everything
+    // with the outside as walls. What the incremental updates must match
+    std::vector<uint8_t> referenceLight(const ChunkStorage& world, const Box& box)
+    {
+      const int size = box.size(), height = box.height(), min = box.minBlock();
+      std::vector<BlockId> blocks(size_t(size) * size * height);
+      std::vector<uint8_t> light(blocks.size(), 0);
+      for (int y = 0; y < height; y++)
+        for (int z = min; z < min + size; z++)
+          for (int x = min; x < min + size; x++)
+            blocks[box.index(x, y, z)] = world.getBlock(x, y, z);
+
+      std::vector<uint32_t> queue;
+      for (int z = min; z < min + size; z++)
+        for (int x = min; x < min + size; x++)
+          for (int y = height - 1; y >= 0 && !isOpaque(blocks[box.index(x, y, z)]); y--)
+            light[box.index(x, y, z)] = LIGHT_FULL_SKY;
+      for (size_t i = 0; i < blocks.size(); i++)
+      {
+        if (const int emission = blockInfo(blocks[i]).lightEmission)
+          light[i] = packLight(skyLight(light[i]), emission);
+        if (light[i] != 0)
+          queue.push_back(uint32_t(i));
+      }
+
+      const int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+      for (size_t head = 0; head < queue.size(); head++)
+      {
+        const uint32_t i = queue[head];
+        const int x = int(i % uint32_t(size)) + min, z = int(i / uint32_t(size) % uint32_t(size)) + min, y = int(i / uint32_t(size * size));
+        const int sky = skyLight(light[i]), block = blockLight(light[i]);
+        for (int face = 0; face < FACE_COUNT; face++)
+        {
+          const int nx = x + offsets[face][0], ny = y + offsets[face][1], nz = z + offsets[face][2];
+          if (nx < min || nx >= min + size || nz < min || nz >= min + size || ny < 0 || ny >= height)
+            continue;
+          const size_t n = box.index(nx, ny, nz);
+          if (isOpaque(blocks[n]))
+            continue;
+          const int nextSky = face == FACE_NEG_Y && sky == MAX_LIGHT ? MAX_LIGHT : sky - 1;
+          const int newSky = std::max(skyLight(light[n]), nextSky), newBlock = std::max(blockLight(light[n]), block - 1);
+          if (newSky != skyLight(light[n]) || newBlock != blockLight(light[n]))
+          {
+            light[n] = packLight(newSky, newBlock);
+            queue.push_back(uint32_t(n));
+          }
+        }
+      }
+      return light;
+    }
+
+    void forEachBoxChunk(const Box& box, auto&& fn)
+    {
+      for (int y = 0; y <= TOP_CHUNK_Y; y++)
+        for (int z = -box.radius; z <= box.radius; z++)
+          for (int x = -box.radius; x <= box.radius; x++)
+            fn(ChunkCoord{ x, y, z });
+    }
+
+    size_t countMismatches(const LightStorage& light, const std::vector<uint8_t>& values, const Box& box)
+    {
+      size_t mismatches = 0;
+      forEachBoxChunk(box, [&](ChunkCoord coord) {
+        const ChunkLight* chunkLight = light.get(coord);
+        for (int y = 0; y < CHUNK_SIZE; y++)
+          for (int z = 0; z < CHUNK_SIZE; z++)
+            for (int x = 0; x < CHUNK_SIZE; x++)
+              mismatches += chunkLight->get(chunkIndex(x, y, z)) !=
+                            values[box.index(coord.x * CHUNK_SIZE + x, coord.y * CHUNK_SIZE + y, coord.z * CHUNK_SIZE + z)];
+      });
+      return mismatches;
+    }
+
+    uint8_t lightAt(const LightStorage& light, int wx, int wy, int wz)
+    {
+      return light.get(worldToChunk(wx, wy, wz))->get(chunkIndex(wx & CHUNK_MASK, wy & CHUNK_MASK, wz & CHUNK_MASK));
+    }
+
+    // a block near the surface somewhere in the box, keeping off its outer chunks
+    void randomEdit(Rng& rng, const TerrainGenerator& generator, const Box& box, WorldEditor& editor)
+    {
+      const int inner = (box.radius - 1) * CHUNK_SIZE;
+      const int x = rng.range(-inner, inner + CHUNK_SIZE), z = rng.range(-inner, inner + CHUNK_SIZE);
+      const int y = std::clamp(generator.heightAt(x, z) + rng.range(-4, 4), 1, box.height() - 2);
+      const int kind = rng.range(0, 10);
+      editor.setBlock(x, y, z, kind < 6 ? BLOCK_AIR : kind < 9 ? BLOCK_STONE : BLOCK_LAMP);
+    }
+
+    // frames whose edits a chunk's mesh doesn't show yet
+    struct PendingRemesh
+    {
+      std::deque<std::pair<uint32_t, double>> dirtied; // version, time
+      uint32_t requested = 0;
+      bool inFlight = false;
+    };
+  }
+
+  int edits(int argc, char** argv)
+  {
+    const int editsPerSecond = argc > 0 ? std::atoi(argv[0]) : 1000;
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 300;
+    const int editsPerFrame = std::max(1, editsPerSecond / 60);
+    bool ok = true;
+
+    JobSystem jobs;
+    ChunkStorage world;
+    TerrainGenerator generator;
+    LightStorage light(TOP_CHUNK_Y);
+    const Box box{ 2 };
+    ChunkBuilder builder(jobs, world, generator, nullptr, 256, &light);
+    WorldEditor editor(world, light, builder, nullptr);
+    std::vector<DirtyRegion> dirty;
+
+    Timer seedTimer;
+    forEachBoxChunk(box, [&](ChunkCoord coord) { builder.requestGenerate(coord, 0.0f); });
+    jobs.waitIdle();
+    // the terrain here is open above ground, lamps beside chunk borders
+    // give the seeding light that has to cross them
+    for (const auto& [x, z] : { std::pair{ CHUNK_SIZE - 1, -20 }, std::pair{ -20, -1 } })
+      world.setBlock(x, generator.heightAt(x, z) + 3, z, BLOCK_LAMP);
+    forEachBoxChunk(box, [&](ChunkCoord coord) { builder.requestLight(coord, 0.0f); });
+    jobs.waitIdle();
+    std::printf("  generated and lit %zu chunks in %.2fs\n", light.count(), seedTimer.seconds());
+
+    // chunks are seeded one by one and stitched together as their neighbours
+    // get lit, the borders must come out as if lit all at once
+    {
+      const size_t mismatches = countMismatches(light, referenceLight(world, box), box);
+      if (mismatches)
+        std::printf("  %zu freshly lit cells differ from a full relight\n", mismatches);
+      ok &= check(mismatches == 0, "freshly generated chunk borders match a full relight");
+    }
+
+    // a lamp in the open fades by one per block and goes away with it
+    {
+      const int x = 5, y = generator.heightAt(5, 5) + 12, z = 5;
+      editor.setBlock(x, y, z, BLOCK_LAMP);
+      editor.apply(dirty);
+      ok &= check(blockLight(lightAt(light, x, y, z)) == MAX_LIGHT && blockLight(lightAt(light, x, y + 5, z)) == MAX_LIGHT - 5,
+                  "lamp light fades by one per block");
+      ok &= check(!dirty.empty() && dirty.size() <= 8, "a lamp only dirties the chunks it lights");
+      editor.breakBlock(x, y, z);
+      editor.apply(dirty);
+      ok &= check(blockLight(lightAt(light, x, y + 5, z)) == 0, "a broken lamp takes its light with it");
+    }
+
+    // a roof shades the ground under it, a hole lets full sunlight down again
+    {
+      const int cx = -7, cz = 9, roof = generator.heightAt(cx, cz) + 20;
+      for (int z = -3; z <= 3; z++)
+        for (int x = -3; x <= 3; x++)
+          editor.setBlock(cx + x, roof, cz + z, BLOCK_STONE);
+      editor.apply(dirty);
+      const int shaded = skyLight(lightAt(light, cx, roof - 1, cz));
+      editor.breakBlock(cx, roof, cz);
+      editor.apply(dirty);
+      const int shaft = skyLight(lightAt(light, cx, roof - 10, cz));
+      ok &= check(shaded < MAX_LIGHT && shaft == MAX_LIGHT, "sunlight falls through a hole in a roof at full strength");
+      ok &= check(countMismatches(light, referenceLight(world, box), box) == 0, "lamp and roof edits match a full relight");
+    }
+
+    // random digging, building and lamps, frame by frame
+    {
+      Rng rng(1234);
+      for (int frame = 0; frame < 20; frame++)
+      {
+        for (int i = 0; i < editsPerFrame; i++)
+          randomEdit(rng, generator, box, editor);
+        editor.apply(dirty);
+      }
+      const size_t mismatches = countMismatches(light, referenceLight(world, box), box);
+      if (mismatches)
+        std::printf("  %zu cells differ from a full relight\n", mismatches);
+      ok &= check(mismatches == 0, "random edits match a full relight");
+    }
+
+    // the engine's loop at 60 frames a second: edits, then remesh what they
+    // dirtied, meshes arrive over the next frames. Latency is from the apply
+    // to the first mesh showing that frame's edits, and only means something
+    // while the meshes keep up: behind the edits it just grows with the run
+    std::unordered_map<ChunkCoord, PendingRemesh, ChunkCoordHash> pending;
+    std::vector<BuiltChunkMesh> done;
+    std::vector<double> latencies, applyMs;
+    size_t remeshes = 0, updates = 0, shownWhileEditing = 0;
+    Rng rng(99);
+    const EditStats before = editor.stats();
+    Timer total;
+    auto frameStart = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames || !pending.empty(); frame++)
+    {
+      std::this_thread::sleep_until(frameStart);
+      frameStart += std::chrono::microseconds(16667);
+      if (frame < frames)
+      {
+        for (int i = 0; i < editsPerFrame; i++)
+          randomEdit(rng, generator, box, editor);
+        Timer applyTimer;
+        editor.apply(dirty);
+        applyMs.push_back(applyTimer.seconds() * 1000.0);
+
+        const double now = total.seconds();
+        for (const DirtyRegion& region : dirty)
+          pending[region.coord].dirtied.emplace_back(uint32_t(frame + 1), now);
+        updates += dirty.size();
+      }
+      for (auto& [coord, remesh] : pending)
+      {
+        // one mesh per chunk at a time, later edits wait for it and go in the next one together
+        const uint32_t latest = remesh.dirtied.back().first;
+        if (!remesh.inFlight && remesh.requested < latest && builder.requestMesh(coord, 0.0f, 0, latest))
+        {
+          remesh.requested = latest;
+          remesh.inFlight = true;
+          remeshes++;
+        }
+      }
+
+      done.clear();
+      builder.drainMeshes(done, 64);
+      const double now = total.seconds();
+      for (const BuiltChunkMesh& built : done)
+      {
+        // a mesh shows the edits up to its version, even when there are newer ones
+        auto it = pending.find(built.coord);
+        if (it == pending.end())
+          continue;
+        it->second.inFlight = false;
+        auto& dirtied = it->second.dirtied;
+        while (!dirtied.empty() && dirtied.front().first <= built.version)
+        {
+          latencies.push_back((now - dirtied.front().second) * 1000.0);
+          dirtied.pop_front();
+        }
+        if (dirtied.empty())
+          pending.erase(it);
+      }
+      if (frame == frames - 1)
+        shownWhileEditing = latencies.size();
+    }
+    const double seconds = total.seconds();
+    jobs.waitIdle();
+
+    const EditStats& stats = editor.stats();
+    const uint64_t applied = stats.applied - before.applied;
+    double applyTotal = 0.0;
+    for (double ms : applyMs)
+      applyTotal += ms;
+    const size_t latencyCount = latencies.size();
+    const double p50 = percentile(latencies, 0.5), p99 = percentile(latencies, 0.99);
+    const double applyP99 = percentile(applyMs, 0.99);
+    // a steady state leaves the last few frames' updates for after the run
+    const double editSeconds = frames / 60.0;
+    const double offered = double(updates) / editSeconds, sustained = double(shownWhileEditing) / editSeconds;
+    const bool keptUp = sustained >= offered * 0.95;
+    ok &= check(latencyCount > 0, "edited chunks get remeshed");
+
+    std::printf("  %d frames of %d edits: %llu applied, %llu coalesced, %llu rejected, %.1f light cells and %.1f dirty chunks per frame\n", frames,
+      editsPerFrame, (unsigned long long)applied, (unsigned long long)(stats.coalesced - before.coalesced),
+      (unsigned long long)(stats.rejected - before.rejected), double(stats.lightCells - before.lightCells) / frames,
+      double(stats.dirtyChunks - before.dirtyChunks) / frames);
+    std::printf("  apply: %.3f ms/frame avg, %.3f ms p99, %.0f edits/s of apply time\n", applyTotal / frames, applyP99,
+      applyTotal > 0.0 ? double(applied) / (applyTotal / 1000.0) : 0.0);
+    std::printf("  remesh: %zu meshes, %.0f of %.0f chunk updates/s shown while editing (%.2fs on %u workers)\n", remeshes, sustained, offered,
+      seconds, jobs.workerCount());
+    if (keptUp)
+      std::printf("  latency edit -> mesh p50 %.2f ms, p99 %.2f ms\n", p50, p99);
+    ok &= check(keptUp, "remeshing keeps up with the offered edits, lower the rate to measure latency");
+
+    return ok ? 0 : 1;
+  }
+}
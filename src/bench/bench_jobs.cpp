@@ -0,0 +1,128 @@
+#include "bench/bench.h"
+
+#include "core/job_system.h"
+#include "world/chunk_builder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    struct PipelineResult
+    {
+      double seconds = 0.0;
+      size_t meshes = 0;
+      size_t quads = 0;
+      size_t generated = 0;
+    };
+
+    // Same loop the engine runs per frame: request what fits, drain a batch
+    PipelineResult runPipeline(unsigned workers, int radius, int layers)
+    {
+      JobSystem jobs(workers);
+      ChunkStorage world;
+      TerrainGenerator generator;
+      PipelineResult result;
+
+      std::vector<ChunkCoord> wanted;
+      for (int y = 0; y < layers; y++)
+        for (int z = -radius; z < radius; z++)
+          for (int x = -radius; x < radius; x++)
+            wanted.push_back({ x, y, z });
+
+      Timer timer;
+      {
+        ChunkBuilder builder(jobs, world, generator, nullptr, 256);
+        std::vector<BuiltChunkMesh> done;
+        size_t next = 0;
+        while (result.meshes < wanted.size())
+        {
+          while (next < wanted.size() && builder.requestMesh(wanted[next], float(next)))
+            next++;
+
+          done.clear();
+          if (builder.drainMeshes(done, 64) == 0)
+            std::this_thread::yield();
+          for (const BuiltChunkMesh& built : done)
+            result.quads += built.mesh.quadCount();
+          result.meshes += done.size();
+        }
+        result.generated = builder.generatedCount();
+      }
+      result.seconds = timer.seconds();
+      return result;
+    }
+  }
+
+  int jobs(int argc, char** argv)
+  {
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned maxWorkers = argc > 0 ? unsigned(std::atoi(argv[0])) : hardware;
+    const int radius = argc > 1 ? std::atoi(argv[1]) : 12;
+    const int layers = argc > 2 ? std::atoi(argv[2]) : 4;
+    bool ok = true;
+
+    // dependencies run in order, even with lots of them in flight
+    {
+      JobSystem jobs(maxWorkers);
+      std::atomic<int> violations{ 0 };
+      std::vector<std::unique_ptr<std::atomic<int>>> stage;
+      for (int i = 0; i < 2000; i++)
+        stage.push_back(std::make_unique<std::atomic<int>>(0));
+
+      for (int i = 0; i < 2000; i++)
+      {
+        std::atomic<int>* s = stage[i].get();
+        JobHandle a = jobs.submit([s] { s->store(1); }, float(i));
+        JobHandle b = jobs.submit([s, &violations] { if (s->load() != 1) violations++; s->store(2); }, 0.0f, { a });
+        jobs.submit([s, &violations] { if (s->load() != 2) violations++; s->store(3); }, 0.0f, { a, b });
+      }
+      jobs.waitIdle();
+
+      int complete = 0;
+      for (auto& s : stage)
+        complete += s->load() == 3;
+      ok &= check(violations == 0 && complete == 2000, "dependent jobs run after their dependencies");
+
+      // raw scheduling overhead
+      std::atomic<int> counter{ 0 };
+      constexpr int tiny = 200000;
+      Timer timer;
+      for (int i = 0; i < tiny; i++)
+        jobs.submit([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+      jobs.waitIdle();
+      const double seconds = timer.seconds();
+      ok &= check(counter == tiny, "every empty job ran");
+      std::printf("  empty jobs: %.2f M/s with %u workers\n", tiny / seconds / 1e6, jobs.workerCount());
+    }
+
+    std::printf("  generate+mesh pipeline, %d chunks requested per run:\n", (2 * radius) * (2 * radius) * layers);
+    std::vector<unsigned> workerCounts;
+    for (unsigned workers = 1; workers < maxWorkers; workers *= 2)
+      workerCounts.push_back(workers);
+    workerCounts.push_back(maxWorkers);
+
+    PipelineResult baseline;
+    for (unsigned workers : workerCounts)
+    {
+      const PipelineResult result = runPipeline(workers, radius, layers);
+      if (workers == 1)
+        baseline = result;
+
+      std::printf("    %2u workers: %.3fs, %.0f meshes/s, %zu generated, speedup %.2fx\n", workers, result.seconds,
+        result.meshes / result.seconds, result.generated, baseline.seconds / result.seconds);
+      ok &= check(result.quads == baseline.quads, "same output regardless of worker count");
+    }
+
+    if (hardware == 1)
+      std::printf("  (only one hardware thread here, scaling numbers are not meaningful)\n");
+
+    return ok ? 0 : 1;
+  }
+}
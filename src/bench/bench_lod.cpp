@@ -0,0 +1,272 @@
+#include "bench/bench.h"
+
+#include "core/job_system.h"
+#include "mesh/chunk_mesher.h"
+#include "world/lod.h"
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    // Downsampled chunks of every level, built on demand from the world
+    class LodCache
+    {
+    public:
+      LodCache(const ChunkStorage& world, const LodSettings& settings) : world(world), settings(settings) {}
+
+      const Chunk* get(const LodKey& key)
+      {
+        const int minY = key.origin().y;
+        if (minY + key.span() - 1 < settings.minChunkY || minY > settings.maxChunkY)
+          return nullptr;
+        if (key.level == 0)
+          return world.getChunk(key.origin());
+
+        auto it = chunks.find(key);
+        if (it != chunks.end())
+          return it->second.get();
+
+        const Chunk* children[8];
+        for (int octant = 0; octant < 8; octant++)
+          children[octant] = get(key.child(octant));
+        auto chunk = std::make_unique<Chunk>();
+        downsampleChunk(children, *chunk);
+        return chunks.emplace(key, std::move(chunk)).first->second.get();
+      }
+
+      size_t memoryUsage() const
+      {
+        size_t bytes = 0;
+        for (const auto& [key, chunk] : chunks)
+          bytes += chunk->memoryUsage();
+        return bytes;
+      }
+
+    private:
+      const ChunkStorage& world;
+      const LodSettings& settings;
+      std::unordered_map<LodKey, std::unique_ptr<Chunk>, LodKeyHash> chunks;
+    };
+
+    struct LevelTotals
+    {
+      size_t nodes = 0;
+      size_t quads = 0;
+      size_t bytes = 0;
+    };
+
+    void fillCell(Chunk& chunk, int x, int y, int z, int solid, BlockId top, BlockId bottom)
+    {
+      // bottom layer first, then the top, solid blocks in total
+      for (int i = 0; i < 8; i++)
+        chunk.set(x + (i & 1), y + (i >> 2), z + ((i >> 1) & 1), i < solid ? (i < 4 ? bottom : top) : BLOCK_AIR);
+    }
+  }
+
+  int lod(int argc, char** argv)
+  {
+    const float viewRadius = argc > 0 ? float(std::atof(argv[0])) : 24.0f;
+    bool ok = true;
+
+    // merge rules on hand built cells
+    {
+      Chunk cells;
+      fillCell(cells, 0, 0, 0, 3, BLOCK_GRASS, BLOCK_STONE);
+      fillCell(cells, 2, 0, 0, 4, BLOCK_GRASS, BLOCK_STONE);
+      fillCell(cells, 4, 0, 0, 8, BLOCK_GRASS, BLOCK_DIRT);
+      fillCell(cells, 6, 0, 0, 6, BLOCK_SAND, BLOCK_DIRT);
+      fillCell(cells, 8, 0, 0, 6, BLOCK_STONE, BLOCK_WATER);
+      // light of the open blocks of the first cell, everything else bright
+      // enough to show up if it were counted
+      uint8_t values[CHUNK_VOLUME];
+      std::fill_n(values, CHUNK_VOLUME, packLight(15, 15));
+      for (int i = 3; i < 8; i++)
+        values[chunkIndex(i & 1, i >> 2, (i >> 1) & 1)] = packLight(5, 10);
+      ChunkLight cellLight;
+      cellLight.assign(values);
+
+      const Chunk* children[8] = { &cells };
+      const ChunkLight* childLights[8] = { &cellLight };
+      Chunk merged;
+      ChunkLight mergedLight;
+      downsampleChunk(children, merged, childLights, &mergedLight);
+      ok &= check(merged.get(0, 0, 0) == BLOCK_AIR, "a cell less than half full merges to air");
+      ok &= check(merged.get(1, 0, 0) == BLOCK_STONE, "a half full cell stays solid");
+      ok &= check(merged.get(2, 0, 0) == BLOCK_GRASS, "the top layer wins, grass stays on top");
+      ok &= check(merged.get(3, 0, 0) == BLOCK_SAND, "a partial top layer still decides the block");
+      ok &= check(merged.get(4, 0, 0) == BLOCK_WATER, "water under a little stone stays water");
+      ok &= check(mergedLight.get(chunkIndex(0, 0, 0)) == packLight(5, 10), "a cell's light averages its open blocks");
+      ok &= check(mergedLight.get(chunkIndex(2, 0, 0)) == 0, "a full cell is dark");
+      ok &= check(mergedLight.get(chunkIndex(16, 0, 0)) == LIGHT_FULL_SKY, "children without light are full sky");
+
+      const Chunk stone(BLOCK_STONE);
+      const Chunk* allStone[8] = { &stone, &stone, &stone, &stone, &stone, &stone, &stone, &stone };
+      downsampleChunk(allStone, merged);
+      ok &= check(merged.isUniform() && merged.uniformBlock() == BLOCK_STONE, "solid children merge into a uniform chunk");
+      const Chunk* missing[8] = { &stone };
+      downsampleChunk(missing, merged);
+      ok &= check(merged.get(0, 0, 0) == BLOCK_STONE && merged.get(16, 0, 0) == BLOCK_AIR && merged.get(31, 31, 31) == BLOCK_AIR,
+                  "children land in their octant, missing ones are air");
+    }
+
+    // camera above the terrain at the origin, the same start as the engine
+    TerrainGenerator generator;
+    LodSettings settings;
+    settings.viewRadius = viewRadius;
+    const glm::vec3 cameraPos(0.0f, float(generator.heightAt(0, 3)) + 8.0f, 0.0f);
+
+    LodSelection selection;
+    Timer selectTimer;
+    selectLodNodes(cameraPos, settings, selection);
+    const double selectMs = selectTimer.seconds() * 1000.0;
+
+    // every chunk of the world under the selection, exactly once
+    std::vector<ChunkCoord> covered;
+    std::unordered_map<ChunkCoord, int, ChunkCoordHash> coverCount;
+    bool ringsOk = true;
+    const glm::vec3 cameraChunk = cameraPos / float(CHUNK_SIZE);
+    for (const LodKey& key : selection.nodes)
+    {
+      if (key.level > 0)
+        ringsOk &= lodDistance(cameraChunk, key) >= settings.ringRadius[key.level - 1];
+      if (key.level < LOD_LEVELS - 1)
+        ringsOk &= lodDistance(cameraChunk, key.parent()) < settings.ringRadius[key.level];
+
+      const ChunkCoord origin = key.origin();
+      for (int y = 0; y < key.span(); y++)
+        for (int z = 0; z < key.span(); z++)
+          for (int x = 0; x < key.span(); x++)
+          {
+            const ChunkCoord coord = { origin.x + x, origin.y + y, origin.z + z };
+            if (coord.y < settings.minChunkY || coord.y > settings.maxChunkY)
+              continue;
+            if (coverCount[coord]++ == 0)
+              covered.push_back(coord);
+          }
+    }
+    bool coverageOk = true;
+    for (const auto& [coord, count] : coverCount)
+      coverageOk &= count == 1;
+    for (int y = settings.minChunkY; y <= settings.maxChunkY; y++)
+      for (int z = -int(viewRadius); z <= int(viewRadius); z++)
+        for (int x = -int(viewRadius); x <= int(viewRadius); x++)
+          if (lodDistance(cameraChunk, { x, y, z, 0 }) <= viewRadius)
+            coverageOk &= coverCount.count({ x, y, z }) != 0;
+    ok &= check(coverageOk, "selected nodes cover every chunk in view exactly once");
+    ok &= check(ringsOk, "nodes are split exactly inside their rings");
+
+    // generate everything the selection covers, on every core
+    ChunkStorage world;
+    {
+      JobSystem jobs;
+      Timer genTimer;
+      for (const ChunkCoord& coord : covered)
+      {
+        Chunk* chunk = &world.getOrCreateChunk(coord);
+        jobs.submit([&generator, coord, chunk] { generator.generate(coord, *chunk); });
+      }
+      jobs.waitIdle();
+      std::printf("  generated %zu chunks in %.2fs on %u workers\n", world.chunkCount(), genTimer.seconds(), jobs.workerCount());
+    }
+
+    auto mesher = std::make_unique<ChunkMesher>();
+    ChunkMesh mesh;
+
+    // baseline: every chunk at full detail against its real neighbours
+    LevelTotals baseline;
+    Timer baselineTimer;
+    for (const ChunkCoord& coord : covered)
+    {
+      const Chunk* neighbours[FACE_COUNT];
+      for (int f = 0; f < FACE_COUNT; f++)
+        neighbours[f] = world.getChunk({ coord.x + offsets[f][0], coord.y + offsets[f][1], coord.z + offsets[f][2] });
+      mesher->mesh(*world.getChunk(coord), neighbours, mesh);
+      baseline.nodes++;
+      baseline.quads += mesh.quadCount();
+      baseline.bytes += mesh.byteSize();
+    }
+    const double baselineSeconds = baselineTimer.seconds();
+
+    // the selection, each node against same-level neighbours and closed at seams
+    LodCache cache(world, settings);
+    LevelTotals levels[LOD_LEVELS], total;
+    size_t transitionFaces = 0;
+    Timer lodTimer;
+    for (const LodKey& key : selection.nodes)
+    {
+      const uint8_t closed = key.level == 0 ? selection.transitionFaces(key) : uint8_t(0x3f & ~selection.sameLevelFaces(key));
+      transitionFaces += size_t(std::popcount(unsigned(selection.transitionFaces(key))));
+      const Chunk* neighbours[FACE_COUNT];
+      for (int f = 0; f < FACE_COUNT; f++)
+        neighbours[f] = closed & (1u << f) ? nullptr : cache.get(lodNeighbour(key, f));
+      mesher->mesh(*cache.get(key), neighbours, mesh);
+      levels[key.level].nodes++;
+      levels[key.level].quads += mesh.quadCount();
+      levels[key.level].bytes += mesh.byteSize();
+    }
+    const double lodSeconds = lodTimer.seconds();
+    for (const LevelTotals& level : levels)
+    {
+      total.nodes += level.nodes;
+      total.quads += level.quads;
+      total.bytes += level.bytes;
+    }
+    ok &= check(transitionFaces > 0, "rings meet at seams");
+    ok &= check(total.quads > 0 && total.quads < baseline.quads, "LOD needs fewer quads than full detail");
+
+    std::printf("  view radius %.0f chunks, rings at %.0f/%.0f/%.0f, %zu nodes selected in %.3f ms, %zu seam faces\n", viewRadius,
+      settings.ringRadius[0], settings.ringRadius[1], settings.ringRadius[2], selection.nodes.size(), selectMs, transitionFaces);
+    for (int level = 0; level < LOD_LEVELS; level++)
+      std::printf("  level %d (%dx): %5zu nodes, %8zu quads, %7.1f KB\n", level, 1 << level, levels[level].nodes, levels[level].quads,
+        levels[level].bytes / 1024.0);
+    std::printf("  full detail: %zu chunks, %zu quads, %.1f MB, meshed in %.2fs\n", baseline.nodes, baseline.quads,
+      baseline.bytes / 1048576.0, baselineSeconds);
+    std::printf("  lod:         %zu nodes, %zu quads, %.1f MB, downsampled+meshed in %.2fs\n", total.nodes, total.quads,
+      total.bytes / 1048576.0, lodSeconds);
+    std::printf("  reduction: %.1fx quads, %.1fx face memory, %.1fx draws; merged chunks add %.1f MB to %.1f MB of world\n",
+      double(baseline.quads) / double(total.quads), double(baseline.bytes) / double(total.bytes),
+      double(baseline.nodes) / double(total.nodes), cache.memoryUsage() / 1048576.0, world.memoryUsage() / 1048576.0);
+
+    // the same 16x16 chunk area at one level throughout, what each merge step buys
+    {
+      size_t uniformQuads[LOD_LEVELS] = {};
+      const int top = LOD_LEVELS - 1;
+      for (int level = 0; level < LOD_LEVELS; level++)
+      {
+        const int nodes = 2 << (top - level);
+        for (int y = settings.minChunkY >> level; y <= settings.maxChunkY >> level; y++)
+          for (int z = -nodes / 2; z < nodes / 2; z++)
+            for (int x = -nodes / 2; x < nodes / 2; x++)
+            {
+              const LodKey key = { x, y, z, level };
+              const Chunk* neighbours[FACE_COUNT];
+              for (int f = 0; f < FACE_COUNT; f++)
+                neighbours[f] = cache.get(lodNeighbour(key, f));
+              if (const Chunk* chunk = cache.get(key))
+              {
+                mesher->mesh(*chunk, neighbours, mesh);
+                uniformQuads[level] += mesh.quadCount();
+              }
+            }
+      }
+      bool shrinking = true;
+      for (int level = 1; level < LOD_LEVELS; level++)
+        shrinking &= uniformQuads[level] < uniformQuads[level - 1];
+      ok &= check(shrinking, "every merge step removes quads");
+      std::printf("  16x16 chunks at one level: %zu / %zu / %zu / %zu quads at 1x/2x/4x/8x\n", uniformQuads[0], uniformQuads[1],
+        uniformQuads[2], uniformQuads[3]);
+    }
+
+    return ok ? 0 : 1;
+  }
+}
@@ -0,0 +1,92 @@
+#include "bench/bench.h"
+
+#include "core/profiler.h"
+
+#include <cstring>
+
+namespace
+{
+  struct BenchEntry
+  {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* description;
+  };
+
+  const BenchEntry benchmarks[] = {
+    { "chunk_storage", zm::bench::chunkStorage, "palette chunk storage: bytes/voxel and get/set throughput" },
+    { "mesher", zm::bench::mesher, "greedy mesher: chunks/s and triangles per chunk on noise terrain" },
+    { "jobs", zm::bench::jobs, "job system: dependency ordering and generate+mesh scaling from 1 to N workers" },
+    { "terrain", zm::bench::terrain, "terrain generator: scalar vs SIMD noise throughput and equality" },
+    { "culling", zm::bench::culling, "frustum + cave culling over a replayed camera path" },
+    { "render_buffers", zm::bench::renderBuffers, "vertex buffer sub-allocator churn and indirect draw command building" },
+    { "textures", zm::bench::textures, "texture array cache: cold build vs warm mmap startup [dir] [cache]" },
+    { "profiler", zm::bench::profiler, "profiler: cost per scope, ring wrap-around and Chrome trace output" },
+    { "regions", zm::bench::regions, "region files: LZ4 chunk save/load chunks/s and bytes per chunk [radius] [layers]" },
+    { "lod", zm::bench::lod, "terrain LOD: quads and face memory of 1x-8x rings vs full detail [view radius]" },
+    { "edits", zm::bench::edits, "block edits: incremental light vs full relight, remesh latency p50/p99 [edits/s] [frames]" },
+    { "sim", zm::bench::sim, "fixed-timestep simulation thread: headless soak with input and spikes [seconds] [tick rate]" },
+    { "physics", zm::bench::physics, "voxel raycasts/s, swept AABB and broadphase entity steps/s [entities] [steps]" },
+    { "voxels", zm::bench::voxels, "64-tree: brick build/update time, bytes/block, traversal vs DDA rays/s [radius] [rays]" },
+    { "allocators", zm::bench::allocators, "chunk/mesh pools vs plain heap: peak RSS and alloc time over a fly-through [steps] [pooled|heap]" },
+    { "streaming", zm::bench::streaming, "chunk streaming: fast fly-through within a memory budget, holes in view [frames] [blocks/s] [hole frames] [budget MB]" },
+    { "shading", zm::bench::shading, "mesher ambient occlusion + smooth light: extra cost per chunk vs flat, reference check [radius] [budget %]" },
+  };
+
+  void printUsage()
+  {
+    std::printf("usage: zim-bench [--trace file.json] <name|all> [args...]\n\n");
+    for (const BenchEntry& entry : benchmarks)
+      std::printf("  %-20s %s\n", entry.name, entry.description);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  // --trace records every profiler scope of the run into a Chrome trace
+  const char* tracePath = nullptr;
+  if (argc > 2 && std::strcmp(argv[1], "--trace") == 0)
+  {
+    tracePath = argv[2];
+    argc -= 2;
+    argv += 2;
+    zm::Profiler::get().setThreadName("main");
+    zm::Profiler::get().setEnabled(true);
+  }
+
+  if (argc < 2)
+  {
+    printUsage();
+    return 1;
+  }
+
+  const bool all = std::strcmp(argv[1], "all") == 0;
+  int failures = 0;
+  bool found = false;
+
+  for (const BenchEntry& entry : benchmarks)
+  {
+    if (!all && std::strcmp(argv[1], entry.name) != 0)
+      continue;
+
+    found = true;
+    std::printf("[%s]\n", entry.name);
+    if (entry.run(argc - 2, argv + 2) != 0)
+    {
+      std::printf("[%s] FAILED\n", entry.name);
+      failures++;
+    }
+  }
+
+  if (!found)
+  {
+    std::printf("unknown benchmark: %s\n\n", argv[1]);
+    printUsage();
+    return 1;
+  }
+
+  if (tracePath && zm::Profiler::get().writeChromeTrace(tracePath))
+    std::printf("trace written to %s\n", tracePath);
+
+  return failures == 0 ? 0 : 1;
+}
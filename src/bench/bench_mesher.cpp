@@ -0,0 +1,205 @@
+#include "bench/bench.h"
+
+#include "mesh/chunk_mesher.h"
+#include "world/terrain_generator.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    const Chunk* const noNeighbours[FACE_COUNT] = {};
+
+    // Total face area covered by a mesh, greedy or not
+    size_t meshArea(const ChunkMesh& mesh)
+    {
+      size_t area = 0;
+      for (const PackedFace& packed : mesh.faces)
+      {
+        const UnpackedFace face = unpackFace(packed);
+        area += size_t(face.width) * size_t(face.height);
+      }
+      return area;
+    }
+
+    bool sameFace(const UnpackedFace& a, const UnpackedFace& b)
+    {
+      bool same = a.x == b.x && a.y == b.y && a.z == b.z && a.face == b.face && a.width == b.width && a.height == b.height && a.layer == b.layer &&
+                  a.flipped == b.flipped;
+      for (int i = 0; i < 4; i++)
+        same &= a.ao[i] == b.ao[i] && a.light[i] == b.light[i];
+      return same;
+    }
+
+    UnpackedFace repack(const UnpackedFace& face)
+    {
+      uint32_t cornerLight = 0, cornerAo = 0;
+      for (int i = 0; i < 4; i++)
+      {
+        cornerLight |= uint32_t(face.light[i]) << (8 * i);
+        cornerAo |= uint32_t(face.ao[i]) << (2 * i);
+      }
+      return unpackFace(packFace(face.x, face.y, face.z, face.face, face.width, face.height, face.layer, cornerLight, cornerAo, face.flipped));
+    }
+
+    // Corners the shader expands a face into stay in the chunk, lie in the
+    // face's plane, span width * height and wind counter-clockwise from outside
+    bool validCorners(const UnpackedFace& face)
+    {
+      FaceCorner corners[4];
+      expandFace(face, corners);
+      const int axis = face.face / 2;
+      int cross[3];
+      for (int i = 0; i < 4; i++)
+        for (int a = 0; a < 3; a++)
+          if (corners[i].position[a] < 0 || corners[i].position[a] > CHUNK_SIZE || corners[i].position[axis] != corners[0].position[axis])
+            return false;
+      const int* p0 = corners[0].position;
+      const int* p1 = corners[1].position;
+      const int* p2 = corners[2].position;
+      for (int a = 0; a < 3; a++)
+      {
+        const int b = (a + 1) % 3, c = (a + 2) % 3;
+        cross[a] = (p1[b] - p0[b]) * (p2[c] - p0[c]) - (p1[c] - p0[c]) * (p2[b] - p0[b]);
+      }
+      const int area = face.width * face.height;
+      const int normal = face.face & 1 ? 1 : -1;
+      const int textureArea = std::abs(corners[2].u - corners[0].u) * std::abs(corners[2].v - corners[0].v);
+      return cross[axis] * normal == area && textureArea == area;
+    }
+
+    // Reference count of visible faces, one by one
+    size_t naiveFaceCount(const ChunkStorage& world, ChunkCoord coord)
+    {
+      static constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+      size_t faces = 0;
+      for (int y = 0; y < CHUNK_SIZE; y++)
+        for (int z = 0; z < CHUNK_SIZE; z++)
+          for (int x = 0; x < CHUNK_SIZE; x++)
+          {
+            const int wx = coord.x * CHUNK_SIZE + x, wy = coord.y * CHUNK_SIZE + y, wz = coord.z * CHUNK_SIZE + z;
+            const BlockId block = world.getBlock(wx, wy, wz);
+            if (block == BLOCK_AIR)
+              continue;
+            for (const auto& o : offsets)
+            {
+              const BlockId n = world.getBlock(wx + o[0], wy + o[1], wz + o[2]);
+              faces += n != block && !isOpaque(n);
+            }
+          }
+      return faces;
+    }
+  }
+
+  int mesher(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 8;
+    const int layers = argc > 1 ? std::atoi(argv[1]) : 5;
+    bool ok = true;
+
+    // small sanity cases first
+    {
+      ChunkMesher mesher;
+      ChunkMesh mesh;
+      Chunk single;
+      single.set(5, 5, 5, BLOCK_STONE);
+      mesher.mesh(single, noNeighbours, mesh);
+      ok &= check(mesh.quadCount() == 6, "single block gives 6 quads");
+
+      Chunk solid(BLOCK_STONE);
+      mesher.mesh(solid, noNeighbours, mesh);
+      ok &= check(mesh.quadCount() == 6 && meshArea(mesh) == 6 * CHUNK_AREA, "solid chunk merges into 6 full quads");
+
+      const Chunk* const covered[FACE_COUNT] = { &solid, &solid, &solid, &solid, &solid, &solid };
+      mesher.mesh(solid, covered, mesh);
+      ok &= check(mesh.quadCount() == 0, "solid chunk surrounded by solid chunks is empty");
+    }
+
+    // face records survive packing exactly, at every field's limits and in between
+    {
+      bool lossless = true;
+      const UnpackedFace limits[] = {
+        { 0, 0, 0, 0, 1, 1, 0, { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, false },
+        { CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, FACE_COUNT - 1, CHUNK_SIZE, CHUNK_SIZE, 4095, { 3, 3, 3, 3 }, { 255, 255, 255, 255 }, true },
+        { CHUNK_SIZE, 0, CHUNK_SIZE, 3, 1, CHUNK_SIZE, 4095, { 0, 3, 0, 3 }, { 0xF0, 0x0F, 0xF0, 0x0F }, false },
+      };
+      for (const UnpackedFace& face : limits)
+        lossless &= sameFace(repack(face), face);
+      Rng rng(19);
+      for (int i = 0; i < 100000 && lossless; i++)
+      {
+        UnpackedFace face = { rng.range(0, CHUNK_SIZE + 1), rng.range(0, CHUNK_SIZE + 1), rng.range(0, CHUNK_SIZE + 1), rng.range(0, FACE_COUNT),
+          rng.range(1, CHUNK_SIZE + 1), rng.range(1, CHUNK_SIZE + 1), rng.range(0, 4096), {}, {}, rng.range(0, 2) == 1 };
+        for (int c = 0; c < 4; c++)
+        {
+          face.ao[c] = rng.range(0, 4);
+          face.light[c] = uint8_t(rng.range(0, 256));
+        }
+        lossless &= sameFace(repack(face), face);
+      }
+      ok &= check(lossless, "face records pack and unpack losslessly");
+    }
+
+    TerrainGenerator generator;
+    ChunkStorage world;
+    Timer genTimer;
+    for (int cy = 0; cy < layers; cy++)
+      for (int cz = -radius; cz < radius; cz++)
+        for (int cx = -radius; cx < radius; cx++)
+          generator.generate({ cx, cy, cz }, world.getOrCreateChunk({ cx, cy, cz }));
+    std::printf("  generated %zu chunks in %.2fs\n", world.chunkCount(), genTimer.seconds());
+
+    static constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    auto mesher = std::make_unique<ChunkMesher>();
+    ChunkMesh mesh;
+    size_t meshed = 0, nonEmpty = 0, quads = 0, bytes = 0, area = 0;
+    std::vector<ChunkCoord> coords;
+    world.forEachChunk([&](const ChunkCoord& coord, const Chunk&) { coords.push_back(coord); });
+
+    Timer meshTimer;
+    for (const ChunkCoord& coord : coords)
+    {
+      const Chunk* neighbours[FACE_COUNT];
+      for (int f = 0; f < FACE_COUNT; f++)
+        neighbours[f] = world.getChunk({ coord.x + offsets[f][0], coord.y + offsets[f][1], coord.z + offsets[f][2] });
+
+      mesher->mesh(*world.getChunk(coord), neighbours, mesh);
+      meshed++;
+      nonEmpty += !mesh.empty();
+      quads += mesh.quadCount();
+      bytes += mesh.byteSize();
+      area += meshArea(mesh);
+    }
+    const double meshSeconds = meshTimer.seconds();
+
+    // naive face count for a handful of chunks to make sure nothing is lost or added
+    size_t naiveArea = 0, greedyArea = 0;
+    bool cornersValid = true;
+    for (size_t i = 0; i < coords.size(); i += coords.size() / 8 + 1)
+    {
+      const Chunk* neighbours[FACE_COUNT];
+      for (int f = 0; f < FACE_COUNT; f++)
+        neighbours[f] = world.getChunk({ coords[i].x + offsets[f][0], coords[i].y + offsets[f][1], coords[i].z + offsets[f][2] });
+      mesher->mesh(*world.getChunk(coords[i]), neighbours, mesh);
+      greedyArea += meshArea(mesh);
+      naiveArea += naiveFaceCount(world, coords[i]);
+      for (const PackedFace& face : mesh.faces)
+        cornersValid &= validCorners(unpackFace(face));
+    }
+    ok &= check(naiveArea == greedyArea, "greedy quads cover exactly the visible faces");
+    ok &= check(cornersValid, "expanded faces are planar, in the chunk and face outwards");
+
+    const double perChunk = nonEmpty ? 1.0 / double(nonEmpty) : 0.0;
+    std::printf("  meshed %zu chunks (%zu non-empty) in %.3fs: %.0f chunks/s\n", meshed, nonEmpty, meshSeconds, meshed / meshSeconds);
+    std::printf("  triangles/chunk: %.0f greedy vs %.0f one quad per face\n", quads * 2 * perChunk, area * 2 * perChunk);
+    std::printf("  face bytes/chunk: %.0f packed (%zu B/face) vs %.0f as 20 B float vertices without merging\n",
+      bytes * perChunk, sizeof(PackedFace), area * 6 * 20.0 * perChunk);
+
+    return ok ? 0 : 1;
+  }
+}
@@ -0,0 +1,283 @@
+#include "bench/bench.h"
+
+#include "core/job_system.h"
+#include "physics/collision.h"
+#include "physics/raycast.h"
+#include "physics/spatial_hash.h"
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    constexpr int WORLD_RADIUS = 3; // chunks around the origin, every layer up to 4
+
+    // block queries against the storage, remembering the last chunk since
+    // rays and boxes stay in one chunk for many blocks in a row
+    struct SolidQuery
+    {
+      const ChunkStorage& world;
+      ChunkCoord lastCoord = { 1 << 30, 0, 0 };
+      const Chunk* lastChunk = nullptr;
+
+      bool operator()(int x, int y, int z)
+      {
+        const ChunkCoord coord = worldToChunk(x, y, z);
+        if (!(coord == lastCoord))
+        {
+          lastCoord = coord;
+          lastChunk = world.getChunk(coord);
+        }
+        return lastChunk && isOpaque(lastChunk->get(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK));
+      }
+    };
+
+    struct Entity
+    {
+      glm::vec3 position; // bottom centre
+      glm::vec3 velocity;
+    };
+
+    constexpr glm::vec3 ENTITY_HALF = glm::vec3(0.3f, 0.0f, 0.3f);
+    constexpr float ENTITY_HEIGHT = 1.8f;
+
+    Aabb entityBox(const Entity& entity)
+    {
+      return { entity.position - ENTITY_HALF, entity.position + glm::vec3(ENTITY_HALF.x, ENTITY_HEIGHT, ENTITY_HALF.z) };
+    }
+  }
+
+  int physics(int argc, char** argv)
+  {
+    const int entityCount = argc > 0 ? std::atoi(argv[0]) : 10000;
+    const int steps = argc > 1 ? std::atoi(argv[1]) : 200;
+    bool ok = true;
+
+    // hand built cases
+    {
+      ChunkStorage world;
+      world.setBlock(5, 0, 0, BLOCK_STONE);
+      world.setBlock(3, 3, 3, BLOCK_STONE);
+      for (int z = -2; z <= 2; z++)
+        for (int x = -2; x <= 2; x++)
+          world.setBlock(x + 20, 10, z, BLOCK_STONE);
+      for (int y = 0; y < 4; y++)
+        for (int z = -3; z <= 3; z++)
+          world.setBlock(30, y, z, BLOCK_STONE);
+      SolidQuery solid{ world };
+
+      RayHit hit;
+      ok &= check(raycastVoxels({ 0.5f, 0.5f, 0.5f }, { 1.0f, 0.0f, 0.0f }, 10.0f, solid, hit) && hit.block == glm::ivec3(5, 0, 0) &&
+                    hit.previous == glm::ivec3(4, 0, 0) && hit.face == FACE_NEG_X && std::abs(hit.distance - 4.5f) < 1e-5f,
+                  "a ray stops at the first block, entering its near face");
+      ok &= check(!raycastVoxels({ 0.5f, 0.5f, 0.5f }, { 1.0f, 0.0f, 0.0f }, 4.0f, solid, hit), "blocks past the maximum distance are missed");
+      ok &= check(raycastVoxels({ 0.5f, 0.5f, 0.5f }, glm::normalize(glm::vec3(1.0f)), 10.0f, solid, hit) && hit.block == glm::ivec3(3, 3, 3),
+                  "a diagonal ray finds the block on the diagonal");
+      ok &= check(raycastVoxels({ 3.5f, 3.5f, 3.5f }, { 0.0f, 1.0f, 0.0f }, 10.0f, solid, hit) && hit.face == -1 && hit.distance == 0.0f,
+                  "a ray starting inside a block hits it at once");
+
+      // a box falling onto the platform lands flush on it
+      const Aabb box = { { 19.7f, 14.0f, -0.3f }, { 20.3f, 15.8f, 0.3f } };
+      SweepResult sweep = sweepAabb(box, { 0.0f, -20.0f, 0.0f }, solid);
+      ok &= check(sweep.blocked[1] && box.min.y + sweep.moved.y == 11.0f, "a falling box lands flush on top, even from far above");
+      // sliding into the wall stops x but keeps z
+      const Aabb walker = { { 28.0f, 0.0f, -0.3f }, { 28.6f, 1.8f, 0.3f } };
+      sweep = sweepAabb(walker, { 3.0f, 0.0f, 1.0f }, solid);
+      ok &= check(sweep.blocked[0] && !sweep.blocked[2] && walker.max.x + sweep.moved.x == 30.0f && std::abs(sweep.moved.z - 1.0f) < 1e-5f,
+                  "a box slides along a wall");
+      sweep = sweepAabb(walker, { 50.0f, 0.0f, 0.0f }, solid);
+      ok &= check(sweep.blocked[0] && walker.max.x + sweep.moved.x == 30.0f, "fast boxes don't tunnel through thin walls");
+    }
+
+    // broadphase against every pair
+    {
+      Rng rng(5);
+      std::vector<Aabb> boxes;
+      SpatialHash hash(2.0f);
+      for (uint32_t i = 0; i < 2000; i++)
+      {
+        const glm::vec3 min(float(rng.range(-3000, 3000)) * 0.01f, float(rng.range(0, 1000)) * 0.01f, float(rng.range(-3000, 3000)) * 0.01f);
+        const glm::vec3 size(float(rng.range(10, 300)) * 0.01f, float(rng.range(10, 300)) * 0.01f, float(rng.range(10, 300)) * 0.01f);
+        boxes.push_back({ min, min + size });
+        hash.insert(i, boxes.back());
+      }
+      hash.build();
+      std::vector<std::pair<uint32_t, uint32_t>> pairs, expected;
+      hash.findPairs(pairs);
+      for (uint32_t i = 0; i < boxes.size(); i++)
+        for (uint32_t j = i + 1; j < boxes.size(); j++)
+          if (boxes[i].overlaps(boxes[j]))
+            expected.emplace_back(i, j);
+      std::sort(pairs.begin(), pairs.end());
+      ok &= check(pairs == expected, "broadphase finds every overlapping pair exactly once");
+
+      std::vector<uint32_t> found;
+      hash.query(boxes[7], found);
+      size_t expectedCount = 0;
+      for (const Aabb& other : boxes)
+        expectedCount += other.overlaps(boxes[7]);
+      ok &= check(found.size() == expectedCount && std::binary_search(found.begin(), found.end(), 7u), "queries find every overlapping box once");
+    }
+
+    // generated terrain for the throughput runs
+    TerrainGenerator generator;
+    ChunkStorage world;
+    {
+      JobSystem jobs;
+      for (int y = 0; y <= 4; y++)
+        for (int z = -WORLD_RADIUS; z < WORLD_RADIUS; z++)
+          for (int x = -WORLD_RADIUS; x < WORLD_RADIUS; x++)
+          {
+            const ChunkCoord coord = { x, y, z };
+            Chunk* chunk = &world.getOrCreateChunk(coord);
+            jobs.submit([&generator, coord, chunk] { generator.generate(coord, *chunk); });
+          }
+      jobs.waitIdle();
+    }
+    const float extent = float(WORLD_RADIUS * CHUNK_SIZE) - 4.0f;
+
+    // rays from a few blocks above the ground in every direction, against a
+    // brute force march for the first thousand
+    {
+      Rng rng(11);
+      constexpr int RAYS = 200000;
+      std::vector<glm::vec3> origins(RAYS), directions(RAYS);
+      for (int i = 0; i < RAYS; i++)
+      {
+        const float x = float(rng.range(-int(extent), int(extent))) + 0.37f, z = float(rng.range(-int(extent), int(extent))) + 0.61f;
+        origins[i] = glm::vec3(x, float(generator.heightAt(int(std::floor(x)), int(std::floor(z)))) + 2.5f, z);
+        directions[i] = randomDirection(rng);
+      }
+
+      SolidQuery solid{ world };
+      int mismatches = 0;
+      for (int i = 0; i < 1000; i++)
+      {
+        RayHit hit;
+        const bool dda = raycastVoxels(origins[i], directions[i], 64.0f, solid, hit);
+        glm::ivec3 marched(0);
+        bool found = false;
+        for (float t = 0.0f; t <= 64.0f && !found; t += 0.001f)
+        {
+          marched = glm::ivec3(glm::floor(origins[i] + directions[i] * t));
+          found = solid(marched.x, marched.y, marched.z);
+        }
+        mismatches += dda != found || (dda && hit.block != marched);
+      }
+      // a fixed step can cut a corner the exact traversal doesn't
+      ok &= check(mismatches <= 5, "DDA agrees with a fine march");
+
+      size_t hits = 0;
+      double distance = 0.0;
+      Timer timer;
+      for (int i = 0; i < RAYS; i++)
+      {
+        RayHit hit;
+        if (raycastVoxels(origins[i], directions[i], 64.0f, solid, hit))
+        {
+          hits++;
+          distance += hit.distance;
+        }
+      }
+      const double seconds = timer.seconds();
+      std::printf("  raycast: %.2f M rays/s up to 64 blocks, %.1f%% hit at %.1f blocks on average, %d/1000 differ from a 0.001 march\n",
+        RAYS / seconds / 1e6, 100.0 * double(hits) / RAYS, hits ? distance / double(hits) : 0.0, mismatches);
+    }
+
+    // entities: gravity, wandering, terrain collision and pushing apart
+    {
+      Rng rng(3);
+      std::vector<Entity> entities(static_cast<size_t>(entityCount));
+      for (Entity& entity : entities)
+      {
+        const float x = float(rng.range(-int(extent), int(extent))) + 0.5f, z = float(rng.range(-int(extent), int(extent))) + 0.5f;
+        entity.position = glm::vec3(x, float(generator.heightAt(int(std::floor(x)), int(std::floor(z))) + 1 + rng.range(0, 8)), z);
+        entity.velocity = glm::vec3(float(rng.range(-30, 31)) * 0.1f, 0.0f, float(rng.range(-30, 31)) * 0.1f);
+      }
+
+      const float dt = 1.0f / 60.0f;
+      SolidQuery solid{ world };
+      SpatialHash hash(2.0f);
+      std::vector<std::pair<uint32_t, uint32_t>> pairs;
+      size_t totalPairs = 0, grounded = 0;
+      double sweepSeconds = 0.0, broadSeconds = 0.0;
+      Timer timer;
+      for (int step = 0; step < steps; step++)
+      {
+        Timer sweepTimer;
+        grounded = 0;
+        for (Entity& entity : entities)
+        {
+          entity.velocity.y -= 20.0f * dt;
+          // pushes add up, cap the walking speed
+          const float speed = glm::length(glm::vec2(entity.velocity.x, entity.velocity.z));
+          if (speed > 4.0f)
+          {
+            entity.velocity.x *= 4.0f / speed;
+            entity.velocity.z *= 4.0f / speed;
+          }
+          const SweepResult sweep = sweepAabb(entityBox(entity), entity.velocity * dt, solid);
+          entity.position += sweep.moved;
+          for (int axis = 0; axis < 3; axis++)
+            if (sweep.blocked[axis])
+              entity.velocity[axis] = axis == 1 ? 0.0f : -entity.velocity[axis];
+          grounded += sweep.blocked[1];
+          // keep them on the generated patch
+          for (int axis : { 0, 2 })
+            if (std::abs(entity.position[axis]) > extent)
+              entity.velocity[axis] = -std::copysign(std::abs(entity.velocity[axis]), entity.position[axis]);
+        }
+        sweepSeconds += sweepTimer.seconds();
+
+        Timer broadTimer;
+        hash.clear();
+        for (uint32_t i = 0; i < entities.size(); i++)
+          hash.insert(i, entityBox(entities[i]));
+        hash.build();
+        pairs.clear();
+        hash.findPairs(pairs);
+        // overlapping entities push each other apart sideways
+        for (const auto& [a, b] : pairs)
+        {
+          glm::vec3 push = entities[a].position - entities[b].position;
+          push.y = 0.0f;
+          const float length = glm::length(push);
+          push = length > 1e-4f ? push / length : glm::vec3(1.0f, 0.0f, 0.0f);
+          entities[a].velocity += push * 0.5f;
+          entities[b].velocity -= push * 0.5f;
+        }
+        totalPairs += pairs.size();
+        broadSeconds += broadTimer.seconds();
+      }
+      const double seconds = timer.seconds();
+
+      // nobody may end up inside the terrain
+      bool outside = true;
+      for (const Entity& entity : entities)
+      {
+        const Aabb box = entityBox(entity);
+        const glm::ivec3 lo = glm::ivec3(glm::floor(box.min)), hi = glm::ivec3(glm::ceil(box.max)) - 1;
+        for (int y = lo.y; y <= hi.y; y++)
+          for (int z = lo.z; z <= hi.z; z++)
+            for (int x = lo.x; x <= hi.x; x++)
+              outside &= !solid(x, y, z);
+      }
+      ok &= check(outside, "no entity ends up inside a block");
+      ok &= check(grounded > entities.size() / 2, "gravity puts entities on the ground");
+
+      std::printf("  %d entities, %d steps: %.1f steps/s (%.2f ms/step: sweep %.2f, broadphase %.2f), %.1f M entity-steps/s\n", entityCount, steps,
+        steps / seconds, seconds * 1000.0 / steps, sweepSeconds * 1000.0 / steps, broadSeconds * 1000.0 / steps,
+        double(entityCount) * steps / seconds / 1e6);
+      std::printf("  %.0f overlapping pairs per step, %zu grid entries, %zu grounded at the end\n", double(totalPairs) / steps, hash.entryCount(),
+        grounded);
+    }
+
+    return ok ? 0 : 1;
+  }
+}
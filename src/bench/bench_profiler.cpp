@@ -0,0 +1,163 @@
+#include "bench/bench.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    const ScopeTiming* findScope(const std::vector<ScopeTiming>& scopes, const char* name)
+    {
+      for (const ScopeTiming& scope : scopes)
+        if (std::strcmp(scope.name, name) == 0)
+          return &scope;
+      return nullptr;
+    }
+
+    // keeps the loop from being optimised away
+    std::atomic<uint64_t> sink{ 0 };
+
+    double nanosecondsPerScope(int iterations)
+    {
+      uint64_t local = 0;
+      Timer timer;
+      for (int i = 0; i < iterations; i++)
+      {
+        ZM_PROFILE_SCOPE("bench scope");
+        local += uint64_t(i);
+      }
+      const double seconds = timer.seconds();
+      sink.fetch_add(local, std::memory_order_relaxed);
+      return seconds * 1e9 / iterations;
+    }
+  }
+
+  int profiler(int argc, char** argv)
+  {
+    const int iterations = argc > 0 ? std::atoi(argv[0]) : 2000000;
+    Profiler& profiler = Profiler::get();
+    const bool wasEnabled = profiler.enabled();
+    bool ok = true;
+
+    profiler.setEnabled(false);
+    const double disabledNs = nanosecondsPerScope(iterations);
+    profiler.setEnabled(true);
+    const double enabledNs = nanosecondsPerScope(iterations);
+
+    std::vector<ScopeTiming> scopes;
+    std::vector<CounterValue> counters;
+
+    // nesting, counters and a ring that wrapped several times, on a thread
+    // of its own so nothing else lands in the frame
+    {
+      profiler.beginFrame();
+      std::thread worker([] {
+        Profiler::get().setThreadName("bench wrap");
+        for (size_t i = 0; i < Profiler::RING_SIZE * 3 + 17; i++)
+        {
+          ZM_PROFILE_SCOPE("outer");
+          ZM_PROFILE_SCOPE("inner");
+        }
+        Profiler::get().counter("bench counter", 1.0);
+        Profiler::get().counter("bench counter", 42.0);
+      });
+      worker.join();
+      profiler.endFrame();
+
+      profiler.lastFrame(scopes, counters);
+      const ScopeTiming* outer = findScope(scopes, "outer");
+      const ScopeTiming* inner = findScope(scopes, "inner");
+      ok &= check(outer && inner && outer->depth == 0 && inner->depth == 1, "nested scopes get increasing depth");
+      // the ring gives back its newest RING_SIZE - 1 events: two counters and the rest scopes
+      ok &= check(outer && inner && outer->calls + inner->calls == Profiler::RING_SIZE - 3, "a full ring keeps exactly its newest events");
+      ok &= check(outer && inner && outer->milliseconds >= inner->milliseconds, "outer scopes contain inner ones");
+      const bool counterOk = std::any_of(counters.begin(), counters.end(), [](const CounterValue& c) {
+        return std::strcmp(c.name, "bench counter") == 0 && c.value == 42.0;
+      });
+      ok &= check(counterOk, "counters report their latest value");
+    }
+
+    // readers running while writers lap their rings
+    {
+      std::atomic<bool> stop{ false };
+      std::vector<std::thread> writers;
+      for (int t = 0; t < 3; t++)
+        writers.emplace_back([&stop] {
+          while (!stop.load(std::memory_order_relaxed))
+          {
+            ZM_PROFILE_SCOPE("contended");
+          }
+        });
+
+      bool sane = true;
+      for (int frame = 0; frame < 50; frame++)
+      {
+        profiler.beginFrame();
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        profiler.endFrame();
+        profiler.lastFrame(scopes, counters);
+        for (const ScopeTiming& scope : scopes)
+          sane &= scope.milliseconds >= 0.0 && scope.milliseconds < 1000.0 && scope.name != nullptr;
+      }
+      stop = true;
+      for (std::thread& writer : writers)
+        writer.join();
+      ok &= check(sane, "frame summaries stay sane while rings are overwritten");
+    }
+
+    // the trace is JSON with thread names and our events in it
+    std::error_code error;
+    const std::filesystem::path tracePath = std::filesystem::temp_directory_path() / "zim-bench-trace.json";
+    profiler.counter("bench counter", 7.0);
+    Timer traceTimer;
+    ok &= check(profiler.writeChromeTrace(tracePath), "trace written");
+    const double traceMs = traceTimer.seconds() * 1000.0;
+    {
+      std::ifstream file(tracePath, std::ios::binary);
+      std::stringstream stream;
+      stream << file.rdbuf();
+      const std::string json = stream.str();
+      int depth = 0;
+      bool balanced = true, inString = false;
+      for (size_t i = 0; i < json.size(); i++)
+      {
+        const char c = json[i];
+        if (inString)
+        {
+          if (c == '\\')
+            i++;
+          else if (c == '"')
+            inString = false;
+          continue;
+        }
+        if (c == '"')
+          inString = true;
+        else if (c == '{' || c == '[')
+          depth++;
+        else if (c == '}' || c == ']')
+          balanced &= --depth >= 0;
+      }
+      ok &= check(balanced && depth == 0 && !inString, "trace brackets balance");
+      ok &= check(json.find("\"traceEvents\"") != std::string::npos && json.find("\"thread_name\"") != std::string::npos &&
+                  json.find("\"ph\":\"X\"") != std::string::npos && json.find("\"ph\":\"C\"") != std::string::npos,
+                  "trace has thread names, scopes and counters");
+      std::printf("  trace: %.1f MB from %zu threads in %.1f ms\n", json.size() / 1048576.0, profiler.threadCount(), traceMs);
+    }
+    std::filesystem::remove(tracePath, error);
+
+    std::printf("  scope cost: %.1f ns disabled, %.1f ns recording\n", disabledNs, enabledNs);
+
+    profiler.setEnabled(wasEnabled);
+    return ok ? 0 : 1;
+  }
+}
@@ -0,0 +1,186 @@
+#include "bench/bench.h"
+
+#include "core/lz4.h"
+#include "world/terrain_generator.h"
+#include "world/world_save.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    bool lz4RoundTrip(const std::vector<uint8_t>& data, size_t& compressedSize)
+    {
+      std::vector<uint8_t> compressed(lz4CompressBound(data.size()));
+      compressedSize = lz4Compress(data.data(), data.size(), compressed.data(), compressed.size());
+      if (compressedSize == 0)
+        return false;
+      std::vector<uint8_t> decoded(data.size());
+      return lz4Decompress(compressed.data(), compressedSize, decoded.data(), decoded.size()) && decoded == data;
+    }
+
+    bool sameBlocks(const Chunk& a, const Chunk& b)
+    {
+      static BlockId blocksA[CHUNK_VOLUME], blocksB[CHUNK_VOLUME];
+      a.unpack(blocksA);
+      b.unpack(blocksB);
+      return std::memcmp(blocksA, blocksB, sizeof(blocksA)) == 0;
+    }
+
+    size_t directorySize(const std::filesystem::path& directory)
+    {
+      std::error_code error;
+      size_t bytes = 0;
+      for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+        bytes += size_t(entry.file_size(error));
+      return bytes;
+    }
+  }
+
+  int regions(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 16;
+    const int layers = argc > 1 ? std::atoi(argv[1]) : 4;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "zim-bench-regions";
+    bool ok = true;
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    // codec on inputs that don't look like chunks
+    {
+      Rng rng(7);
+      std::vector<uint8_t> noise(100000), runs(100000), tiny = { 1, 2, 3 };
+      for (uint8_t& byte : noise)
+        byte = uint8_t(rng.next());
+      for (size_t i = 0; i < runs.size(); i++)
+        runs[i] = uint8_t((i / 97) % 5);
+      size_t noiseSize, runsSize, tinySize, emptySize;
+      ok &= check(lz4RoundTrip(noise, noiseSize) && noiseSize <= lz4CompressBound(noise.size()), "lz4 round trip on random bytes");
+      ok &= check(lz4RoundTrip(runs, runsSize) && runsSize < runs.size() / 20, "lz4 round trip on runs");
+      ok &= check(lz4RoundTrip(tiny, tinySize), "lz4 round trip on 3 bytes");
+      ok &= check(lz4RoundTrip({}, emptySize), "lz4 round trip on nothing");
+
+      std::vector<uint8_t> compressed(lz4CompressBound(runs.size())), decoded(runs.size());
+      compressed.resize(lz4Compress(runs.data(), runs.size(), compressed.data(), compressed.size()));
+      bool rejected = true;
+      for (size_t cut = 1; cut < compressed.size(); cut += 7)
+        rejected &= !lz4Decompress(compressed.data(), cut, decoded.data(), decoded.size());
+      ok &= check(rejected, "lz4 rejects truncated input");
+    }
+
+    ChunkStorage world;
+    TerrainGenerator generator;
+    for (int y = 0; y < layers; y++)
+      for (int z = -radius; z < radius; z++)
+        for (int x = -radius; x < radius; x++)
+          generator.generate({ x, y, z }, world.getOrCreateChunk({ x, y, z }));
+    const size_t chunkCount = world.chunkCount();
+
+    // save: snapshot + compress + one write per region
+    double saveSeconds;
+    {
+      WorldSave save(directory);
+      world.forEachChunk([&](ChunkCoord coord, const Chunk&) { save.markDirty(coord); });
+      Timer timer;
+      ok &= check(save.flush(world) == chunkCount, "flush takes every dirty chunk");
+      save.waitIdle();
+      saveSeconds = timer.seconds();
+      const WorldSaveStats stats = save.stats();
+      ok &= check(stats.chunksSaved == chunkCount && stats.failedWrites == 0 && stats.dirtyChunks == 0, "every chunk saved");
+    }
+    const size_t diskBytes = directorySize(directory);
+    size_t regionFiles = 0;
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(directory, error))
+      regionFiles++;
+    std::printf("  %zu chunks in %zu region files\n", chunkCount, regionFiles);
+
+    // sync load from a fresh open, on one thread
+    double loadSeconds;
+    {
+      WorldSave save(directory);
+      std::vector<ChunkCoord> coords;
+      world.forEachChunk([&](ChunkCoord coord, const Chunk&) { coords.push_back(coord); });
+      std::vector<Chunk> chunks(coords.size());
+      bool allLoaded = true, allMatch = true;
+      Timer timer;
+      for (size_t i = 0; i < coords.size(); i++)
+        allLoaded &= save.loadChunk(coords[i], chunks[i]);
+      loadSeconds = timer.seconds();
+      for (size_t i = 0; i < coords.size(); i++)
+        allMatch &= sameBlocks(chunks[i], *world.getChunk(coords[i]));
+      ok &= check(allLoaded, "every saved chunk loads");
+      ok &= check(allMatch, "loaded chunks match the generated ones");
+      Chunk chunk;
+      ok &= check(!save.loadChunk({ radius + 1, 0, 0 }, chunk), "unsaved chunk does not load");
+    }
+
+    // async load through the I/O pool, the way a streamer would use it
+    double asyncSeconds;
+    const unsigned ioThreads = std::max(2u, std::thread::hardware_concurrency() / 2);
+    {
+      WorldSave save(directory, ioThreads);
+      std::vector<ChunkCoord> wanted;
+      world.forEachChunk([&](ChunkCoord coord, const Chunk&) { wanted.push_back(coord); });
+      std::vector<LoadedChunk> done;
+      size_t next = 0, received = 0, matched = 0;
+      Timer timer;
+      while (received < wanted.size())
+      {
+        while (next < wanted.size() && save.requestLoad(wanted[next]))
+          next++;
+        done.clear();
+        if (save.drainLoaded(done, 256) == 0)
+          std::this_thread::yield();
+        for (const LoadedChunk& loaded : done)
+          matched += loaded.chunk != nullptr;
+        received += done.size();
+      }
+      asyncSeconds = timer.seconds();
+      ok &= check(matched == wanted.size(), "every async load finds its chunk");
+    }
+
+    // rewriting changed chunks reuses freed sectors instead of growing forever
+    {
+      WorldSave save(directory);
+      Rng rng(11);
+      for (int pass = 0; pass < 4; pass++)
+      {
+        world.forEachChunk([&](ChunkCoord coord, Chunk& chunk) {
+          chunk.set(rng.range(0, CHUNK_SIZE), rng.range(0, CHUNK_SIZE), rng.range(0, CHUNK_SIZE), BlockId(rng.range(1, 8)));
+          save.markDirty(coord);
+        });
+        save.flush(world);
+        save.waitIdle();
+      }
+      Chunk chunk;
+      bool allMatch = true;
+      world.forEachChunk([&](ChunkCoord coord, const Chunk& original) { allMatch &= save.loadChunk(coord, chunk) && sameBlocks(chunk, original); });
+      ok &= check(allMatch, "rewritten chunks load back");
+      ok &= check(directorySize(directory) < diskBytes * 3, "rewrites stay within a bounded amount of extra space");
+    }
+
+    size_t rawBytes = 0;
+    world.forEachChunk([&](ChunkCoord, const Chunk& chunk) {
+      std::vector<uint8_t> raw;
+      chunk.serialize(raw);
+      rawBytes += raw.size();
+    });
+
+    std::printf("  save:        %8.0f chunks/s (%.1f ms)\n", chunkCount / saveSeconds, saveSeconds * 1000.0);
+    std::printf("  load sync:   %8.0f chunks/s (%.1f ms, 1 thread)\n", chunkCount / loadSeconds, loadSeconds * 1000.0);
+    std::printf("  load async:  %8.0f chunks/s (%.1f ms, %u I/O threads)\n", chunkCount / asyncSeconds, asyncSeconds * 1000.0, ioThreads);
+    std::printf("  on disk:     %8.0f bytes/chunk (serialized %.0f, raw 16-bit %d)\n", double(diskBytes) / chunkCount,
+      double(rawBytes) / chunkCount, int(CHUNK_VOLUME * sizeof(BlockId)));
+
+    std::filesystem::remove_all(directory, error);
+    return ok ? 0 : 1;
+  }
+}
@@ -0,0 +1,171 @@
+#include "bench/bench.h"
+
+#include "mesh/chunk_mesher.h"
+#include "render/buffer_allocator.h"
+#include "render/draw_commands.h"
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    // live ranges never overlap and add up to what the allocator reports
+    bool rangesConsistent(const BufferAllocator& allocator, std::vector<BufferRange> live)
+    {
+      std::sort(live.begin(), live.end(), [](BufferRange a, BufferRange b) { return a.offset < b.offset; });
+      uint64_t used = 0;
+      for (size_t i = 0; i < live.size(); i++)
+      {
+        if (live[i].offset % allocator.alignment() || live[i].offset + live[i].size > allocator.capacity())
+          return false;
+        if (i > 0 && live[i - 1].offset + live[i - 1].size > live[i].offset)
+          return false;
+        used += live[i].size;
+      }
+      return used == allocator.usedSize() && live.size() == allocator.allocationCount();
+    }
+  }
+
+  int renderBuffers(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 6;
+    bool ok = true;
+
+    // 1. allocator churn: chunks being remeshed and streamed in and out
+    {
+      constexpr uint32_t capacity = 1u << 22;
+      BufferAllocator allocator(capacity, 4);
+      std::vector<BufferRange> live;
+      Rng rng(7);
+
+      ok &= check(allocator.allocate(capacity + 4).valid() == false, "oversized allocation fails");
+      ok &= check(allocator.allocate(0).valid() == false, "empty allocation fails");
+
+      constexpr int operations = 400000;
+      int failed = 0;
+      Timer timer;
+      for (int i = 0; i < operations; i++)
+      {
+        // bias towards allocating until roughly 3/4 full, then churn
+        const bool allocate = live.empty() || (allocator.usedSize() < capacity / 4 * 3 ? rng.range(0, 3) != 0 : rng.range(0, 2) == 0);
+        if (allocate)
+        {
+          const BufferRange range = allocator.allocate(uint32_t(rng.range(1, 2500)) * 4);
+          if (range.valid())
+            live.push_back(range);
+          else
+            failed++;
+        }
+        else
+        {
+          const size_t index = size_t(rng.range(0, int(live.size())));
+          allocator.free(live[index]);
+          live[index] = live.back();
+          live.pop_back();
+        }
+
+        if (i % 50000 == 0)
+          ok &= check(rangesConsistent(allocator, live), "allocations stay disjoint and aligned");
+      }
+      const double seconds = timer.seconds();
+
+      const double fragmentation = 1.0 - double(allocator.largestFreeBlock()) / std::max(1u, allocator.freeSize());
+      std::printf("  allocator: %.1f Mops/s, %u live ranges, %.0f%% used, %u free blocks, fragmentation %.2f, %d failed\n",
+        operations / seconds / 1e6, allocator.allocationCount(), 100.0 * allocator.usedSize() / capacity,
+        allocator.freeBlockCount(), fragmentation, failed);
+      ok &= check(rangesConsistent(allocator, live), "allocations stay disjoint and aligned");
+
+      for (BufferRange range : live)
+        allocator.free(range);
+      ok &= check(allocator.usedSize() == 0 && allocator.freeBlockCount() == 1 && allocator.largestFreeBlock() == capacity,
+        "freeing everything merges back into one block");
+
+      // exact fit and best fit
+      allocator.reset(64, 4);
+      // layout: a[0,16) 8 c[24,40) 24, then a and c become holes
+      const BufferRange a = allocator.allocate(16);
+      allocator.allocate(8);
+      const BufferRange c = allocator.allocate(16);
+      allocator.allocate(24);
+      allocator.free(a);
+      allocator.free(c);
+      ok &= check(allocator.allocate(60).valid() == false, "no single free block of 60");
+      const BufferRange e = allocator.allocate(16);
+      ok &= check(e.offset == 0 && allocator.allocate(3).offset == 24, "best fit reuses the smallest hole first");
+    }
+
+    // 2. draw commands for a meshed world, checked by pulling the face
+    // records back out of a CPU copy of the face buffer the way the GPU would
+    {
+      TerrainGenerator generator;
+      ChunkStorage world;
+      for (int y = 0; y < 5; y++)
+        for (int z = -radius; z < radius; z++)
+          for (int x = -radius; x < radius; x++)
+            generator.generate({ x, y, z }, world.getOrCreateChunk({ x, y, z }));
+
+      static constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+      auto mesher = std::make_unique<ChunkMesher>();
+      ChunkMesh mesh;
+      BufferAllocator allocator(1u << 21);
+      std::vector<PackedFace> faceBuffer(allocator.capacity());
+      std::vector<std::pair<ChunkCoord, BufferRange>> chunks;
+      std::vector<StagingFaces> meshes;
+
+      world.forEachChunk([&](const ChunkCoord& coord, const Chunk& chunk) {
+        const Chunk* neighbours[FACE_COUNT];
+        for (int f = 0; f < FACE_COUNT; f++)
+          neighbours[f] = world.getChunk({ coord.x + offsets[f][0], coord.y + offsets[f][1], coord.z + offsets[f][2] });
+        mesher->mesh(chunk, neighbours, mesh);
+        if (mesh.empty())
+          return;
+
+        const BufferRange range = allocator.allocate(uint32_t(mesh.faces.size()));
+        ok &= check(range.valid(), "world fits in the face buffer");
+        std::memcpy(&faceBuffer[range.offset], mesh.faces.data(), mesh.byteSize());
+        chunks.push_back({ coord, range });
+        meshes.push_back(mesh.faces);
+      });
+
+      DrawCommandBuilder builder;
+      constexpr int frames = 1000;
+      Timer timer;
+      for (int f = 0; f < frames; f++)
+      {
+        builder.clear();
+        for (const auto& [coord, range] : chunks)
+          builder.add(coord, range);
+      }
+      const double micros = timer.seconds() * 1e6 / frames;
+      std::printf("  draw commands: %zu chunks -> 1 multi-draw, %.1f us/frame to build (%.1f ns/chunk), %.1f MB of faces\n",
+        builder.size(), micros, micros * 1000.0 / std::max<size_t>(1, builder.size()), allocator.usedSize() * sizeof(PackedFace) / 1048576.0);
+
+      bool commandsMatch = builder.size() == chunks.size();
+      for (size_t i = 0; i < builder.size() && commandsMatch; i++)
+      {
+        const DrawArraysIndirectCommand& command = builder.commands()[i];
+        const ChunkCoord coord = chunks[i].first;
+        commandsMatch &= command.instanceCount == 1 && command.baseInstance == i;
+        commandsMatch &= builder.chunkOffsets()[i] == glm::vec4(coord.x * CHUNK_SIZE, coord.y * CHUNK_SIZE, coord.z * CHUNK_SIZE, 1.0f);
+
+        // gl_VertexID runs from first, the shader pulls record gl_VertexID / 6
+        const StagingFaces& expected = meshes[i];
+        commandsMatch &= command.count == expected.size() * VERTICES_PER_FACE;
+        for (uint32_t vertex = command.first; vertex < command.first + command.count && commandsMatch; vertex++)
+        {
+          const PackedFace pulled = faceBuffer[vertex / VERTICES_PER_FACE];
+          commandsMatch &= std::memcmp(&pulled, &expected[(vertex - command.first) / VERTICES_PER_FACE], sizeof(PackedFace)) == 0;
+        }
+      }
+      ok &= check(commandsMatch, "indirect commands address exactly each chunk's faces");
+    }
+
+    return ok ? 0 : 1;
+  }
+}
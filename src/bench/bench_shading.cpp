@@ -0,0 +1,246 @@
+#include "bench/bench.h"
+
+#include "mesh/chunk_mesher.h"
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    const Chunk* const noNeighbours[FACE_COUNT] = {};
+
+    struct LitWorld
+    {
+      ChunkStorage blocks;
+      LightStorage light;
+      std::vector<ChunkCoord> coords;
+
+      explicit LitWorld(int layers) : light(layers - 1) {}
+
+      uint8_t lightAt(int wx, int wy, int wz) const
+      {
+        const ChunkLight* chunkLight = light.get(worldToChunk(wx, wy, wz));
+        return chunkLight ? chunkLight->get(chunkIndex(wx & CHUNK_MASK, wy & CHUNK_MASK, wz & CHUNK_MASK)) : LIGHT_FULL_SKY;
+      }
+
+      void mesh(ChunkMesher& mesher, ChunkCoord coord, ChunkMesh& out) const
+      {
+        const Chunk* neighbours[FACE_COUNT];
+        MeshLight meshLight;
+        meshLight.chunk = light.get(coord);
+        for (int f = 0; f < FACE_COUNT; f++)
+        {
+          const ChunkCoord n = { coord.x + offsets[f][0], coord.y + offsets[f][1], coord.z + offsets[f][2] };
+          neighbours[f] = blocks.getChunk(n);
+          meshLight.neighbours[f] = light.get(n);
+        }
+        mesher.mesh(*blocks.getChunk(coord), neighbours, out, &meshLight);
+      }
+    };
+
+    // Straightforward version of what the mesher works out for corner c of
+    // the face whose open cell in front is front (world coordinates)
+    void referenceCorner(const LitWorld& world, const int front[3], int axisU, int axisV, int c, int& ao, uint8_t& light)
+    {
+      auto cell = [&](int du, int dv, bool& opaque, int& sky, int& lamp) {
+        int p[3] = { front[0], front[1], front[2] };
+        p[axisU] += du;
+        p[axisV] += dv;
+        opaque = isOpaque(world.blocks.getBlock(p[0], p[1], p[2]));
+        const uint8_t value = world.lightAt(p[0], p[1], p[2]);
+        sky = skyLight(value);
+        lamp = blockLight(value);
+      };
+      const int du = c == 1 || c == 2 ? 1 : -1;
+      const int dv = c >= 2 ? 1 : -1;
+      bool sideU, sideV, diagonal, center;
+      int sky[4], lamp[4];
+      cell(0, 0, center, sky[0], lamp[0]);
+      cell(du, 0, sideU, sky[1], lamp[1]);
+      cell(0, dv, sideV, sky[2], lamp[2]);
+      cell(du, dv, diagonal, sky[3], lamp[3]);
+
+      if (sideU && sideV)
+        ao = 0;
+      else
+        ao = 3 - int(sideU) - int(sideV) - int(diagonal);
+
+      int count = 1, skySum = sky[0], lampSum = lamp[0];
+      const bool open[3] = { !sideU, !sideV, !diagonal && !(sideU && sideV) };
+      for (int i = 0; i < 3; i++)
+        if (open[i])
+        {
+          count++;
+          skySum += sky[i + 1];
+          lampSum += lamp[i + 1];
+        }
+      light = packLight(skySum / count, lampSum / count);
+    }
+
+    // the quad of mesh covering the face of block (x, y, z), chunk local
+    const PackedFace* quadAt(const ChunkMesh& mesh, int face, int x, int y, int z)
+    {
+      const int block[3] = { x, y, z };
+      const int axis = face / 2, axisU = (axis + 1) % 3, axisV = (axis + 2) % 3;
+      for (const PackedFace& packed : mesh.faces)
+      {
+        const UnpackedFace quad = unpackFace(packed);
+        const int p[3] = { quad.x, quad.y, quad.z };
+        if (quad.face == face && p[axis] == block[axis] + (face & 1) && block[axisU] >= p[axisU] && block[axisU] < p[axisU] + quad.width &&
+            block[axisV] >= p[axisV] && block[axisV] < p[axisV] + quad.height)
+          return &packed;
+      }
+      return nullptr;
+    }
+  }
+
+  int shading(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 6;
+    // extra meshing time allowed over flat shading
+    const double budgetPercent = argc > 1 ? std::atof(argv[1]) : 50.0;
+    const int layers = 5;
+    bool ok = true;
+
+    // a floor with two walls meeting over block (5, 0, 5): the top face
+    // of that block is occluded at the corner between the walls
+    {
+      ChunkMesher mesher;
+      ChunkMesh mesh;
+      Chunk chunk;
+      for (int z = 0; z < CHUNK_SIZE; z++)
+        for (int x = 0; x < CHUNK_SIZE; x++)
+          chunk.set(x, 0, z, BLOCK_STONE);
+      chunk.set(4, 1, 5, BLOCK_STONE);
+      chunk.set(5, 1, 4, BLOCK_STONE);
+      mesher.mesh(chunk, noNeighbours, mesh);
+
+      // the top face's u runs along z and v along x, corner 0 faces -z -x
+      const PackedFace* corner = quadAt(mesh, FACE_POS_Y, 5, 0, 5);
+      const PackedFace* open = quadAt(mesh, FACE_POS_Y, 20, 0, 20);
+      const UnpackedFace inCorner = corner ? unpackFace(*corner) : UnpackedFace{};
+      const UnpackedFace inOpen = open ? unpackFace(*open) : UnpackedFace{};
+      ok &= check(corner && inCorner.ao[0] == 0 && inCorner.ao[1] == 2 && inCorner.ao[2] == 3 && inCorner.ao[3] == 2,
+                  "a block between two walls is fully occluded in their corner");
+      ok &= check(corner && inCorner.flipped, "the occluded corner gets a triangle to itself");
+      ok &= check(open && inOpen.ao[0] == 3 && inOpen.ao[1] == 3 && inOpen.ao[2] == 3 && inOpen.ao[3] == 3 && !inOpen.flipped,
+                  "open floor is not occluded");
+
+      mesher.setSmoothShading(false);
+      ChunkMesh flat;
+      mesher.mesh(chunk, noNeighbours, flat);
+      const PackedFace* flatCorner = quadAt(flat, FACE_POS_Y, 5, 0, 5);
+      ok &= check(flatCorner && flatCorner->attributes >> 12 == CORNERS_OPEN && flatCorner->light == CORNERS_FULL_SKY, "flat shading leaves corners alone");
+      ok &= check(flat.quadCount() < mesh.quadCount(), "flat faces merge further");
+    }
+
+    LitWorld world(layers);
+    TerrainGenerator generator;
+    const Timer genTimer;
+    for (int cz = -radius; cz < radius; cz++)
+      for (int cx = -radius; cx < radius; cx++)
+        for (int cy = layers - 1; cy >= 0; cy--)
+        {
+          const ChunkCoord coord = { cx, cy, cz };
+          Chunk& chunk = world.blocks.getOrCreateChunk(coord);
+          generator.generate(coord, chunk);
+          seedChunkLight(chunk, cy + 1 < layers ? world.light.get({ cx, cy + 1, cz }) : nullptr, world.light.getOrCreate(coord));
+          world.coords.push_back(coord);
+        }
+    std::printf("  generated and lit %zu chunks in %.2fs\n", world.coords.size(), genTimer.seconds());
+
+    // every face away from the chunk's edges and corners (which the mesher
+    // doesn't read) against the reference
+    auto mesher = std::make_unique<ChunkMesher>();
+    ChunkMesh mesh;
+    size_t compared = 0, mismatches = 0, flipped = 0, quadsSeen = 0;
+    for (const ChunkCoord& coord : world.coords)
+    {
+      world.mesh(*mesher, coord, mesh);
+      for (const PackedFace& packed : mesh.faces)
+      {
+        const UnpackedFace quad = unpackFace(packed);
+        const int axis = quad.face / 2, axisU = (axis + 1) % 3, axisV = (axis + 2) % 3;
+        flipped += quad.flipped;
+        quadsSeen++;
+        for (int j = 0; j < quad.height; j++)
+          for (int i = 0; i < quad.width; i++)
+          {
+            int local[3] = { quad.x, quad.y, quad.z };
+            local[axis] -= quad.face & 1 ? 0 : 1;
+            local[axisU] += i;
+            local[axisV] += j;
+            bool inside = true;
+            for (int dv = -1; dv <= 1; dv++)
+              for (int du = -1; du <= 1; du++)
+              {
+                int p[3] = { local[0], local[1], local[2] };
+                p[axisU] += du;
+                p[axisV] += dv;
+                inside &= (p[0] < 0 || p[0] >= CHUNK_SIZE) + (p[1] < 0 || p[1] >= CHUNK_SIZE) + (p[2] < 0 || p[2] >= CHUNK_SIZE) < 2;
+              }
+            if (!inside)
+              continue;
+
+            const int front[3] = { coord.x * CHUNK_SIZE + local[0], coord.y * CHUNK_SIZE + local[1], coord.z * CHUNK_SIZE + local[2] };
+            for (int c = 0; c < 4; c++)
+            {
+              int ao;
+              uint8_t light;
+              referenceCorner(world, front, axisU, axisV, c, ao, light);
+              mismatches += ao != quad.ao[c] || light != quad.light[c];
+            }
+            compared++;
+          }
+      }
+    }
+    std::printf("  %zu faces checked against the reference, %.1f%% of %zu quads flipped\n", compared, 100.0 * double(flipped) / double(quadsSeen),
+                quadsSeen);
+    ok &= check(compared > 0 && mismatches == 0, "corner occlusion and light match the reference");
+
+    // best of a few passes over the world, flat and smooth interleaved
+    double best[2] = { 1e30, 1e30 };
+    size_t quads[2] = {}, bytes[2] = {}, area[2] = {}, nonEmpty = 0;
+    for (int pass = 0; pass < 3; pass++)
+      for (int smooth = 0; smooth < 2; smooth++)
+      {
+        mesher->setSmoothShading(smooth);
+        quads[smooth] = bytes[smooth] = area[smooth] = nonEmpty = 0;
+        double seconds = 0.0;
+        for (const ChunkCoord& coord : world.coords)
+        {
+          const Timer timer;
+          world.mesh(*mesher, coord, mesh);
+          seconds += timer.seconds();
+          nonEmpty += !mesh.empty();
+          quads[smooth] += mesh.quadCount();
+          bytes[smooth] += mesh.byteSize();
+          for (const PackedFace& packed : mesh.faces)
+          {
+            const UnpackedFace face = unpackFace(packed);
+            area[smooth] += size_t(face.width) * size_t(face.height);
+          }
+        }
+        best[smooth] = std::min(best[smooth], seconds);
+      }
+
+    const double perChunk[2] = { best[0] * 1e6 / double(world.coords.size()), best[1] * 1e6 / double(world.coords.size()) };
+    const double extra = perChunk[1] - perChunk[0];
+    const double extraPercent = 100.0 * extra / perChunk[0];
+    std::printf("  flat:   %7.1f us/chunk, %zu quads, %.2f MB\n", perChunk[0], quads[0], bytes[0] / 1048576.0);
+    std::printf("  smooth: %7.1f us/chunk, %zu quads (%.2fx), %.2f MB\n", perChunk[1], quads[1], double(quads[1]) / double(std::max<size_t>(quads[0], 1)),
+                bytes[1] / 1048576.0);
+    std::printf("  occlusion + smooth light: %+.1f us/chunk (%+.0f%%, budget %.0f%%) over %zu chunks (%zu non-empty)\n", extra, extraPercent,
+                budgetPercent, world.coords.size(), nonEmpty);
+
+    ok &= check(area[0] == area[1], "smooth shading covers the same faces");
+    ok &= check(extraPercent <= budgetPercent, "occlusion and smooth light stay within the meshing budget");
+    return ok ? 0 : 1;
+  }
+}
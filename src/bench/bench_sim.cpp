@@ -0,0 +1,158 @@
+#include "bench/bench.h"
+
+#include "core/spsc_queue.h"
+#include "sim/simulation.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    bool near(float a, float b) { return std::abs(a - b) < 1e-3f; }
+
+    void busyWait(double ms)
+    {
+      const Timer timer;
+      while (timer.seconds() * 1000.0 < ms)
+        ;
+    }
+  }
+
+  int sim(int argc, char** argv)
+  {
+    const double seconds = argc > 0 ? std::atof(argv[0]) : 5.0;
+    const float tickRate = argc > 1 ? float(std::atof(argv[1])) : 60.0f;
+    bool ok = true;
+
+    // the queue: rounding, refusing when full, order across two threads
+    {
+      SpscQueue<int> small(5);
+      int pushed = 0;
+      while (small.tryPush(pushed))
+        pushed++;
+      int first = -1;
+      ok &= check(small.capacity() == 8 && pushed == 8 && small.tryPop(first) && first == 0, "queue rounds up and refuses when full");
+
+      const uint64_t count = 2000000;
+      SpscQueue<uint64_t> queue(1024);
+      Timer timer;
+      std::thread producer([&] {
+        for (uint64_t i = 0; i < count; i++)
+          while (!queue.tryPush(i))
+            std::this_thread::yield();
+      });
+      bool ordered = true;
+      for (uint64_t expected = 0, value; expected < count;)
+        if (queue.tryPop(value))
+          ordered &= value == expected++;
+        else
+          std::this_thread::yield();
+      producer.join();
+      ok &= check(ordered, "events arrive once each and in order");
+      std::printf("  spsc queue: %.1f M events/s between two threads\n", double(count) / timer.seconds() / 1e6);
+    }
+
+    // ticks on the calling thread, no clock involved
+    {
+      Simulation stepped(PlayerState{}, SimSettings{ 60.0f });
+      stepped.pushInput({ InputType::Press, INPUT_FORWARD });
+      for (int i = 0; i < 60; i++)
+        stepped.step();
+      PlayerState player = stepped.latest();
+      ok &= check(near(player.position.z, -2.5f) && near(player.position.x, 0.0f), "a second of forward moves 2.5 blocks along yaw -90");
+
+      stepped.pushInput({ InputType::Release, INPUT_FORWARD });
+      stepped.pushInput({ InputType::Look, INPUT_FORWARD, 90.0f, 500.0f });
+      stepped.pushInput({ InputType::Look, INPUT_FORWARD, 0.0f, -500.0f });
+      stepped.pushInput({ InputType::Press, INPUT_RIGHT });
+      for (int i = 0; i < 30; i++)
+        stepped.step();
+      player = stepped.latest();
+      ok &= check(near(player.yaw, 0.0f) && near(player.pitch, -89.0f) && near(player.position.z, -1.25f),
+                  "looking turns movement with it and pitch stops at 89");
+
+      PlayerState from, to;
+      to.position = glm::vec3(2.0f, 4.0f, -6.0f);
+      to.yaw = 0.0f;
+      const PlayerState half = interpolate(from, to, 0.5f);
+      ok &= check(near(half.position.x, 1.0f) && near(half.position.z, -3.0f) && near(half.yaw, -45.0f), "interpolation blends every field");
+      const PlayerState later = stepped.interpolated(Simulation::Clock::now() + std::chrono::seconds(10));
+      ok &= check(near(later.position.z, player.position.z), "frames after the newest tick show the newest tick");
+    }
+
+    // soak: the thread at its tick rate with a spike every now and then,
+    // input arriving from another thread and frames reading state meanwhile
+    SimSettings settings;
+    settings.tickRate = tickRate;
+    Simulation simulation(PlayerState{}, settings);
+    const double tickMs = 1000.0 / tickRate;
+    std::vector<double> tickStarts;
+    tickStarts.reserve(size_t(seconds * tickRate * 2) + 16);
+    Timer clock;
+    simulation.setTickHook([&](uint64_t tick, float) {
+      tickStarts.push_back(clock.seconds() * 1000.0);
+      // world work of a few hundred microseconds, three ticks' worth now and then
+      busyWait(tick % 97 == 96 ? tickMs * 3.0 : 0.2);
+    });
+
+    std::atomic<bool> producing{ true };
+    uint64_t pushed = 0;
+    simulation.start();
+    std::thread producer([&] {
+      Rng rng(7);
+      while (producing.load(std::memory_order_relaxed))
+      {
+        InputEvent event;
+        event.type = InputType(rng.range(0, 3));
+        event.action = InputAction(rng.range(0, INPUT_ACTION_COUNT));
+        event.x = float(rng.range(-10, 11)) * 0.1f;
+        event.y = float(rng.range(-10, 11)) * 0.1f;
+        pushed += simulation.pushInput(event);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+      }
+    });
+
+    // frames as fast as they come, each reading the blended state once
+    std::vector<double> readUs;
+    bool finite = true;
+    while (clock.seconds() < seconds)
+    {
+      const Timer read;
+      const PlayerState player = simulation.interpolated();
+      readUs.push_back(read.seconds() * 1e6);
+      finite &= std::isfinite(player.position.x) && std::isfinite(player.position.y) && std::isfinite(player.position.z);
+      std::this_thread::sleep_for(std::chrono::milliseconds(7));
+    }
+    producing = false;
+    producer.join();
+    simulation.stop();
+    const double elapsed = clock.seconds();
+
+    const SimStats stats = simulation.stats();
+    std::vector<double> intervals;
+    for (size_t i = 1; i < tickStarts.size(); i++)
+      intervals.push_back(tickStarts[i] - tickStarts[i - 1]);
+    const double expected = elapsed * tickRate;
+    const double intervalP50 = percentile(intervals, 0.5), intervalP99 = percentile(intervals, 0.99);
+    const double readP50 = percentile(readUs, 0.5), readP99 = percentile(readUs, 0.99);
+    ok &= check(double(stats.ticks + stats.skippedTicks) > expected * 0.95 && double(stats.ticks) < expected + 3.0,
+                "the tick rate holds, spikes are caught up");
+    ok &= check(stats.droppedInputs == 0 && stats.inputEvents == pushed, "every input event reaches the simulation");
+    ok &= check(finite, "blended state stays finite");
+    ok &= check(readP99 < tickMs * 1000.0 * 0.1, "frames never wait on a tick");
+
+    std::printf("  %.1fs at %.0f Hz: %llu ticks (%.1f expected), %llu late, %llu skipped, %.3f ms/tick avg, %.3f ms max\n", elapsed, tickRate,
+      (unsigned long long)stats.ticks, expected, (unsigned long long)stats.lateTicks, (unsigned long long)stats.skippedTicks,
+      stats.ticks ? stats.totalTickMs / double(stats.ticks) : 0.0, stats.maxTickMs);
+    std::printf("  tick interval p50 %.2f ms, p99 %.2f ms; %llu input events (%.0f/s), %llu dropped\n", intervalP50, intervalP99,
+      (unsigned long long)stats.inputEvents, double(stats.inputEvents) / elapsed, (unsigned long long)stats.droppedInputs);
+    std::printf("  %zu frames, state read p50 %.2f us, p99 %.2f us\n", readUs.size(), readP50, readP99);
+
+    return ok ? 0 : 1;
+  }
+}
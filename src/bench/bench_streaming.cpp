@@ -0,0 +1,203 @@
+#include "bench/bench.h"
+
+#include "core/job_system.h"
+#include "render/culling.h"
+#include "world/chunk_streamer.h"
+#include "world/lod_terrain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    constexpr float CAMERA_Y = 100.0f;
+    // the flight circles, so it comes back over ground it dropped a while ago
+    constexpr float TURN_RATE = 0.35f; // radians per second
+    constexpr int CHECK_INTERVAL = 60; // frames between checks of real memory use
+    constexpr int MAX_WARMUP_FRAMES = 1200;
+
+    glm::vec3 heading(float seconds)
+    {
+      return { std::cos(seconds * TURN_RATE), 0.0f, std::sin(seconds * TURN_RATE) };
+    }
+
+    // what the accounting claims against what blocks and light really take
+    size_t measuredBytes(const ChunkStorage& world, LightStorage& light)
+    {
+      size_t bytes = 0;
+      world.forEachChunk([&](ChunkCoord coord, const Chunk& chunk) {
+        bytes += chunk.memoryUsage();
+        if (const ChunkLight* chunkLight = light.get(coord))
+          bytes += chunkLight->memoryUsage();
+      });
+      return bytes;
+    }
+  }
+
+  int streaming(int argc, char** argv)
+  {
+    const int frames = argc > 0 ? std::atoi(argv[0]) : 900;
+    const float speed = argc > 1 ? float(std::atof(argv[1])) : 160.0f;
+    const int holeFrames = argc > 2 ? std::atoi(argv[2]) : 90;
+    const size_t budget = (argc > 3 ? size_t(std::atoi(argv[3])) : 48) << 20;
+    bool ok = true;
+
+    JobSystem jobs;
+    ChunkStorage world;
+    TerrainGenerator generator;
+    LodSettings lodSettings;
+    LightStorage light(lodSettings.maxChunkY);
+    ChunkBuilder builder(jobs, world, generator, nullptr, 256, &light);
+    LodTerrain lodTerrain(jobs, world, builder, lodSettings);
+    StreamingSettings settings;
+    settings.loadRadius = lodSettings.ringRadius[0] + 3.0f;
+    settings.unloadRadius = settings.loadRadius + 2.0f;
+    settings.memoryBudget = budget;
+    settings.minChunkY = lodSettings.minChunkY;
+    settings.maxChunkY = lodSettings.maxChunkY;
+    ChunkStreamer streamer(world, &light, builder, settings);
+
+    // registered and dropped the way the engine does, so it must stay as
+    // small as the full detail ring however far the camera flies
+    ChunkCuller culler;
+    const int levelZeroSide = 2 * (int(std::ceil(lodSettings.ringRadius[0])) + 2) + 2;
+    const size_t maxCullerChunks = 2 * size_t(levelZeroSide * levelZeroSide) * size_t(lodSettings.maxChunkY - lodSettings.minChunkY + 1);
+    size_t peakCullerChunks = 0;
+    // full detail meshes drawn, possibly standing in for a coarser node,
+    // that the culler no longer knows and so would never show
+    size_t unculledDraws = 0;
+    std::vector<BuiltLodMesh> meshes;
+    std::vector<LodKey> nodes, unused;
+    // chunks that should be on screen, and the frame they were first missing
+    std::unordered_map<ChunkCoord, int, ChunkCoordHash> holes;
+    size_t peakCommitted = 0, peakMeasured = 0, meshesDrained = 0;
+    int maxHoleAge = 0, warmupFrames = 0;
+    StreamingStats warmup;
+    double pendingSum = 0.0, updateMs = 0.0;
+
+    // the whole ring loads around a still camera first, then the flight starts
+    glm::vec3 cameraPos(0.0f, CAMERA_Y, 0.0f);
+    float flightSeconds = 0.0f;
+    const Timer timer;
+    auto frameStart = std::chrono::steady_clock::now();
+    for (int frame = 0, flown = 0; flown < frames; frame++)
+    {
+      std::this_thread::sleep_until(frameStart);
+      frameStart += std::chrono::microseconds(16667);
+
+      const bool flying = warmupFrames > 0;
+      const glm::vec3 view = heading(flightSeconds);
+      if (flying)
+      {
+        cameraPos += view * speed / 60.0f;
+        flightSeconds += 1.0f / 60.0f;
+        flown++;
+      }
+
+      const Timer updateTimer;
+      streamer.update(cameraPos, view);
+      updateMs += updateTimer.seconds() * 1000.0;
+      const StreamingStats stats = streamer.stats();
+      peakCommitted = std::max(peakCommitted, streamer.committedBytes());
+      if (streamer.committedBytes() > budget)
+      {
+        std::printf("  frame %d: %.2f MB committed\n", frame, streamer.committedBytes() / 1048576.0);
+        ok &= check(false, "committed memory stays within the budget");
+        break;
+      }
+      if (flying && flown % CHECK_INTERVAL == 0)
+      {
+        // nothing may write a chunk while it is measured
+        jobs.waitIdle();
+        const size_t measured = measuredBytes(world, light);
+        peakMeasured = std::max(peakMeasured, measured);
+        ok &= check(measured <= streamer.committedBytes(), "chunks take no more than the streamer accounts for");
+        ok &= check(world.chunkCount() == stats.resident + stats.generating, "every chunk in the world is accounted for");
+      }
+
+      lodTerrain.update(cameraPos, streamer.chunkAllowance());
+      meshesDrained += lodTerrain.drainMeshes(meshes, 64);
+      for (const BuiltLodMesh& built : meshes)
+        if (built.key.level == 0)
+          culler.setChunk(built.key.origin(), built.mesh.faceConnectivity, !built.mesh.empty());
+      meshes.clear();
+      lodTerrain.drawNodes(nodes);
+      for (const LodKey& key : nodes)
+        if (key.level == 0 && !culler.hasChunk(key.origin()))
+          unculledDraws++;
+      unused.clear();
+      lodTerrain.collectUnused(unused);
+      for (const LodKey& key : unused)
+        if (key.level == 0)
+          culler.removeChunk(key.origin());
+      peakCullerChunks = std::max(peakCullerChunks, culler.chunkCount());
+
+      if (!flying)
+      {
+        if ((stats.pending == 0 && stats.generating == 0) || frame >= MAX_WARMUP_FRAMES)
+        {
+          ok &= check(stats.pending == 0 && stats.generating == 0, "the ring around a still camera loads completely");
+          warmupFrames = frame + 1;
+          warmup = stats;
+        }
+        continue;
+      }
+      pendingSum += double(stats.pending);
+
+      // columns in front of the camera, well inside the load radius, must
+      // show up within holeFrames
+      const glm::vec3 camera = cameraPos / float(CHUNK_SIZE);
+      const int reach = int(settings.loadRadius);
+      for (int dz = -reach; dz <= reach; dz++)
+        for (int dx = -reach; dx <= reach; dx++)
+        {
+          const int x = int(std::floor(camera.x)) + dx, z = int(std::floor(camera.z)) + dz;
+          const glm::vec2 toColumn(float(x) + 0.5f - camera.x, float(z) + 0.5f - camera.z);
+          const bool visible = glm::length(toColumn) <= settings.loadRadius - 2.0f && glm::dot(toColumn, glm::vec2(view.x, view.z)) > 0.0f;
+          for (int y = settings.minChunkY; y <= settings.maxChunkY; y++)
+          {
+            const ChunkCoord coord = { x, y, z };
+            if (!visible || streamer.isResident(coord))
+              holes.erase(coord);
+            else
+              holes.emplace(coord, frame);
+          }
+        }
+      for (auto it = holes.begin(); it != holes.end();)
+      {
+        // columns that dropped out of view without being erased above
+        const glm::vec2 toColumn(float(it->first.x) + 0.5f - camera.x, float(it->first.z) + 0.5f - camera.z);
+        if (glm::length(toColumn) > settings.loadRadius - 2.0f)
+        {
+          it = holes.erase(it);
+          continue;
+        }
+        maxHoleAge = std::max(maxHoleAge, frame - it->second);
+        ++it;
+      }
+    }
+    const double seconds = timer.seconds();
+    const StreamingStats stats = streamer.stats();
+    std::printf("  warm-up: %d frames for %zu chunks (%.1f MB)\n", warmupFrames, warmup.resident, warmup.residentBytes / 1048576.0);
+    std::printf("  flight: %d frames at %.0f blocks/s (%.0f chunks flown) in %.1fs, %.1f pending on average, streamer update %.3f ms/frame\n", frames,
+      speed, speed * float(frames) / 60.0f / float(CHUNK_SIZE), seconds, pendingSum / double(frames), updateMs / double(warmupFrames + frames));
+    std::printf("  %llu chunks loaded, %llu evicted, %zu resident, %zu meshes, budget %.1f MB, peak committed %.1f MB, peak measured %.1f MB\n",
+      (unsigned long long)stats.loaded, (unsigned long long)stats.evicted, stats.resident, meshesDrained, budget / 1048576.0,
+      peakCommitted / 1048576.0, peakMeasured / 1048576.0);
+    std::printf("  longest hole in view: %d frames (limit %d)\n", maxHoleAge, holeFrames);
+    std::printf("  culler: %zu chunks at the end, peak %zu (limit %zu), %zu draws without an entry\n", culler.chunkCount(), peakCullerChunks,
+      maxCullerChunks, unculledDraws);
+
+    ok &= check(stats.evicted > 0, "chunks left behind are evicted");
+    ok &= check(maxHoleAge <= holeFrames, "no chunk in view stays missing past the hole limit");
+    ok &= check(peakCullerChunks <= maxCullerChunks, "culler entries stay bounded by the full detail ring");
+    ok &= check(unculledDraws == 0, "every drawn full detail mesh keeps its culler entry");
+    return ok ? 0 : 1;
+  }
+}
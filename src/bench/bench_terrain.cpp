@@ -0,0 +1,114 @@
+#include "bench/bench.h"
+
+#include "world/terrain_generator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    std::vector<SimdLevel> availableLevels()
+    {
+      std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+      if (detectSimdLevel() >= SimdLevel::SSE41)
+        levels.push_back(SimdLevel::SSE41);
+      if (detectSimdLevel() >= SimdLevel::AVX2)
+        levels.push_back(SimdLevel::AVX2);
+      return levels;
+    }
+  }
+
+  int terrain(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 4;
+    const int layers = argc > 1 ? std::atoi(argv[1]) : 4;
+    bool ok = true;
+
+    std::printf("  best simd level: %s\n", simdLevelName(detectSimdLevel()));
+
+    // raw kernel throughput, 3D fbm along 32 sample columns like the generator uses
+    {
+      const NoiseOctaves octaves(42, 3, 1.0f / 37.0f);
+      constexpr int columns = 1 << 15;
+      std::vector<float> reference(size_t(columns) * CHUNK_SIZE);
+      std::vector<float> output(reference.size());
+
+      for (SimdLevel level : availableLevels())
+      {
+        std::vector<float>& out = level == SimdLevel::Scalar ? reference : output;
+        Timer timer;
+        for (int c = 0; c < columns; c++)
+          noiseLine3D(level, octaves, float(c & 255) - 100.5f, -40.0f, float(c >> 8), 0.0f, 1.0f, 0.0f, CHUNK_SIZE, &out[size_t(c) * CHUNK_SIZE]);
+        const double seconds = timer.seconds();
+
+        std::printf("  noise3D x3 octaves [%s]: %.1f Msamples/s\n", simdLevelName(level), reference.size() / seconds / 1e6);
+        if (level != SimdLevel::Scalar)
+          ok &= check(std::memcmp(reference.data(), output.data(), reference.size() * sizeof(float)) == 0, "simd noise is bit-identical to scalar");
+      }
+
+      // odd counts go through the tail path
+      float scalarTail[13], simdTail[13];
+      noiseLine2D(SimdLevel::Scalar, octaves, -3.25f, 7.5f, 0.7f, 0.3f, 13, scalarTail);
+      noiseLine2D(detectSimdLevel(), octaves, -3.25f, 7.5f, 0.7f, 0.3f, 13, simdTail);
+      ok &= check(std::memcmp(scalarTail, simdTail, sizeof(scalarTail)) == 0, "partial lines match too");
+    }
+
+    // whole chunks
+    std::vector<ChunkCoord> coords;
+    for (int y = 0; y < layers; y++)
+      for (int z = -radius; z < radius; z++)
+        for (int x = -radius; x < radius; x++)
+          coords.push_back({ x, y, z });
+    const double voxels = double(coords.size()) * CHUNK_VOLUME;
+
+    std::vector<BlockId> reference(coords.size() * CHUNK_VOLUME);
+    std::vector<BlockId> output(reference.size());
+    double scalarSeconds = 0.0;
+
+    for (SimdLevel level : availableLevels())
+    {
+      TerrainSettings settings;
+      settings.simd = level;
+      TerrainGenerator generator(settings);
+      std::vector<BlockId>& out = level == SimdLevel::Scalar ? reference : output;
+
+      Chunk chunk;
+      double seconds = 0.0;
+      for (size_t i = 0; i < coords.size(); i++)
+      {
+        Timer timer;
+        generator.generate(coords[i], chunk);
+        seconds += timer.seconds();
+        chunk.unpack(&out[i * CHUNK_VOLUME]);
+      }
+      if (level == SimdLevel::Scalar)
+        scalarSeconds = seconds;
+
+      std::printf("  generate [%s]: %zu chunks, %.1f Mvoxels/s, %.2f ms/chunk, %.2fx vs scalar\n", simdLevelName(level), coords.size(),
+        voxels / seconds / 1e6, seconds * 1000.0 / coords.size(), scalarSeconds / seconds);
+      if (level != SimdLevel::Scalar)
+        ok &= check(reference == output, "simd terrain matches scalar terrain block for block");
+    }
+
+    // deterministic across generator instances, and heightAt agrees with generate
+    TerrainGenerator a, b;
+    Chunk chunkA, chunkB;
+    a.generate({ 3, 2, -5 }, chunkA);
+    b.generate({ 3, 2, -5 }, chunkB);
+    std::vector<BlockId> blocksA(CHUNK_VOLUME), blocksB(CHUNK_VOLUME);
+    chunkA.unpack(blocksA.data());
+    chunkB.unpack(blocksB.data());
+    ok &= check(blocksA == blocksB, "same seed gives the same chunk");
+
+    int biomes[4] = {};
+    for (int z = -2048; z < 2048; z += 64)
+      for (int x = -2048; x < 2048; x += 64)
+        biomes[int(a.biomeAt(x, z))]++;
+    std::printf("  biomes over 4096^2: plains %d, hills %d, desert %d, mountains %d\n", biomes[0], biomes[1], biomes[2], biomes[3]);
+
+    return ok ? 0 : 1;
+  }
+}
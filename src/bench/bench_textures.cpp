@@ -0,0 +1,123 @@
+#include "bench/bench.h"
+
+#include "assets/texture_array_asset.h"
+#include "core/paths.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace zm::bench
+{
+  namespace
+  {
+    // reads every byte the GL upload would, so warm timings include paging
+    // the mapped cache in
+    uint64_t touchAll(const TextureArrayAsset& asset)
+    {
+      uint64_t sum = 0;
+      for (uint32_t level = 0; level < asset.mipCount(); level++)
+      {
+        const uint8_t* data = asset.mipData(level);
+        for (size_t i = 0; i < asset.mipBytes(level); i += 64)
+          sum += data[i];
+      }
+      return sum;
+    }
+
+    bool sameData(const TextureArrayAsset& a, const TextureArrayAsset& b)
+    {
+      if (a.layerSize() != b.layerSize() || a.layerCount() != b.layerCount() || a.mipCount() != b.mipCount())
+        return false;
+      for (uint32_t level = 0; level < a.mipCount(); level++)
+        if (std::memcmp(a.mipData(level), b.mipData(level), a.mipBytes(level)) != 0)
+          return false;
+      return true;
+    }
+  }
+
+  int textures(int argc, char** argv)
+  {
+    const std::filesystem::path directory = argc > 0 ? std::filesystem::path(argv[0]) : findAssetRoot() / "textures";
+    const std::filesystem::path scratch = std::filesystem::temp_directory_path() / "zim-bench-textures";
+    const std::filesystem::path cachePath = argc > 1 ? std::filesystem::path(argv[1]) : scratch / "block_textures.zta";
+    bool ok = true;
+
+    std::error_code error;
+    std::filesystem::remove(cachePath, error);
+    if (listTextureFiles(directory).empty())
+    {
+      std::printf("  no images in %s\n", directory.string().c_str());
+      return 1;
+    }
+
+    // cold: hash, decode, resample, build mips and write the cache
+    TextureArrayAsset cold;
+    Timer coldTimer;
+    ok &= check(cold.load(directory, cachePath), "textures load");
+    const double coldMs = coldTimer.seconds() * 1000.0;
+    ok &= check(!cold.loadedFromCache(), "first load builds");
+
+    // warm: hash the sources and map the cache, best of a few runs
+    double warmMs = 1e30, hashMs = 1e30;
+    TextureArrayAsset warm;
+    uint64_t checksum = 0;
+    for (int run = 0; run < 5; run++)
+    {
+      Timer hashTimer;
+      hashTextureSources(listTextureFiles(directory), {});
+      hashMs = std::min(hashMs, hashTimer.seconds() * 1000.0);
+
+      warm = TextureArrayAsset();
+      Timer warmTimer;
+      ok &= check(warm.load(directory, cachePath), "textures load from cache");
+      checksum += touchAll(warm);
+      warmMs = std::min(warmMs, warmTimer.seconds() * 1000.0);
+    }
+    ok &= check(warm.loadedFromCache(), "second load maps the cache");
+    ok &= check(sameData(cold, warm), "cached pixels match the freshly built ones");
+
+    size_t bytes = 0;
+    for (uint32_t level = 0; level < cold.mipCount(); level++)
+      bytes += cold.mipBytes(level);
+    std::printf("  %u layers of %upx, %u mips, %.1f MB\n", cold.layerCount(), cold.layerSize(), cold.mipCount(), bytes / 1048576.0);
+    std::printf("  cold (decode + mips + write): %8.2f ms\n", coldMs);
+    std::printf("  warm (hash + mmap + read):    %8.2f ms, of which %.2f ms content hash, %.0fx faster (checksum %llu)\n",
+      warmMs, hashMs, coldMs / warmMs, (unsigned long long)checksum);
+
+    // invalidation: other settings, a corrupt file, and changed image bytes
+    {
+      TextureArraySettings small;
+      small.layerSize = 64;
+      TextureArrayAsset asset;
+      ok &= check(asset.load(directory, cachePath, small) && !asset.loadedFromCache() && asset.layerSize() == 64, "new settings rebuild");
+
+      std::filesystem::resize_file(cachePath, 1000, error);
+      asset = TextureArrayAsset();
+      ok &= check(asset.load(directory, cachePath, small) && !asset.loadedFromCache(), "truncated cache is rejected");
+
+      const std::filesystem::path copy = scratch / "images";
+      std::filesystem::remove_all(copy, error);
+      std::filesystem::create_directories(copy, error);
+      for (const std::filesystem::path& file : listTextureFiles(directory))
+        std::filesystem::copy_file(file, copy / file.filename(), error);
+
+      asset = TextureArrayAsset();
+      asset.load(copy, cachePath, small);
+      const std::filesystem::path edited = listTextureFiles(copy).front();
+      {
+        std::ofstream stream(edited, std::ios::binary | std::ios::app);
+        stream.put('\0');
+      }
+      asset = TextureArrayAsset();
+      ok &= check(asset.load(copy, cachePath, small) && !asset.loadedFromCache(), "edited image bytes rebuild");
+      std::filesystem::remove_all(copy, error);
+    }
+
+    if (argc <= 1)
+      std::filesystem::remove(cachePath, error);
+    return ok ? 0 : 1;
+  }
+}
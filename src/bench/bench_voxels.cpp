@@ -0,0 +1,185 @@
+#include "bench/bench.h"
+
+#include "physics/raycast.h"
+#include "render/voxel_tree.h"
+#include "world/terrain_generator.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace zm::bench
+{
+  namespace
+  {
+    bool everythingReady(ChunkCoord) { return true; }
+
+    // every block of the chunks in [min, max) read back through the tree
+    size_t countMismatches(const VoxelTree& tree, const ChunkStorage& world, ChunkCoord min, ChunkCoord max)
+    {
+      size_t mismatches = 0;
+      for (int cy = min.y; cy < max.y; cy++)
+        for (int cz = min.z; cz < max.z; cz++)
+          for (int cx = min.x; cx < max.x; cx++)
+            for (int y = cy * CHUNK_SIZE; y < (cy + 1) * CHUNK_SIZE; y++)
+              for (int z = cz * CHUNK_SIZE; z < (cz + 1) * CHUNK_SIZE; z++)
+                for (int x = cx * CHUNK_SIZE; x < (cx + 1) * CHUNK_SIZE; x++)
+                  mismatches += tree.getBlock(x, y, z) != world.getBlock(x, y, z);
+      return mismatches;
+    }
+
+    // the same rays through the tree and a plain DDA over the chunks
+    struct RayComparison
+    {
+      size_t rays = 0;
+      size_t hits = 0;
+      size_t mismatches = 0;
+      double treeSeconds = 0.0;
+      double ddaSeconds = 0.0;
+    };
+
+    RayComparison compareRays(const VoxelTree& tree, const ChunkStorage& world, int rayCount, int radius, float maxDistance, uint64_t seed)
+    {
+      const float extent = float(radius * CHUNK_SIZE);
+      std::vector<glm::vec3> origins, directions;
+      Rng rng(seed);
+      for (int i = 0; i < rayCount; i++)
+      {
+        origins.emplace_back(float(rng.range(-10000, 10000)) / 10000.0f * extent, float(rng.range(40, 150)) + 0.5f,
+                             float(rng.range(-10000, 10000)) / 10000.0f * extent);
+        directions.push_back(randomDirection(rng));
+      }
+
+      RayComparison out;
+      out.rays = size_t(rayCount);
+      std::vector<VoxelHit> treeHits(origins.size());
+      std::vector<char> treeHit(origins.size());
+      const Timer treeTimer;
+      for (size_t i = 0; i < origins.size(); i++)
+        treeHit[i] = tree.raycast(origins[i], directions[i], maxDistance, treeHits[i]);
+      out.treeSeconds = treeTimer.seconds();
+
+      const Timer ddaTimer;
+      for (size_t i = 0; i < origins.size(); i++)
+      {
+        RayHit hit;
+        const bool found = raycastVoxels(origins[i], directions[i], maxDistance, [&](int x, int y, int z) { return world.getBlock(x, y, z) != BLOCK_AIR; }, hit);
+        out.hits += found;
+        // a ray crossing a block edge right where it hits may take either
+        // block next to the edge, as long as that one is solid too. A hit
+        // right at maxDistance may round either way
+        const glm::ivec3 apart = glm::abs(hit.block - treeHits[i].block);
+        const bool same = found == bool(treeHit[i]) &&
+                          (!found || (std::abs(hit.distance - treeHits[i].distance) < 1e-2f && apart.x <= 1 && apart.y <= 1 && apart.z <= 1 &&
+                                      world.getBlock(treeHits[i].block.x, treeHits[i].block.y, treeHits[i].block.z) == treeHits[i].id));
+        const bool edge = found != bool(treeHit[i]) && std::abs((found ? hit.distance : treeHits[i].distance) - maxDistance) < 1e-2f;
+        out.mismatches += !same && !edge;
+      }
+      out.ddaSeconds = ddaTimer.seconds();
+      return out;
+    }
+  }
+
+  int voxels(int argc, char** argv)
+  {
+    const int radius = argc > 0 ? std::atoi(argv[0]) : 4;
+    const int rayCount = argc > 1 ? std::atoi(argv[1]) : 200000;
+    bool ok = true;
+
+    // hand built: blocks on both sides of the origin, a solid cube that
+    // collapses, mixed leaves
+    {
+      ChunkStorage world;
+      for (int y = 0; y < 16; y++)
+        for (int z = 0; z < 16; z++)
+          for (int x = 0; x < 16; x++)
+            world.setBlock(x + 16, y, z + 16, BLOCK_STONE);
+      world.setBlock(-1, -1, -1, BLOCK_DIRT);
+      world.setBlock(-5, 3, 7, BLOCK_LAMP);
+      world.setBlock(-4, 3, 7, BLOCK_SAND);
+      world.setBlock(40, 70, -33, BLOCK_GRASS);
+
+      VoxelTree tree(1u << 16);
+      world.forEachChunk([&](ChunkCoord coord, const Chunk&) { tree.markChunk(coord); });
+      tree.update(world, everythingReady);
+      ok &= check(countMismatches(tree, world, { -2, -1, -2 }, { 2, 3, 2 }) == 0, "every block reads back from the tree");
+
+      VoxelHit hit;
+      ok &= check(tree.raycast(glm::vec3(-10.5f, 3.5f, 7.5f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, hit) && hit.block == glm::ivec3(-5, 3, 7) &&
+                    hit.id == BLOCK_LAMP && hit.face == FACE_NEG_X && std::abs(hit.distance - 5.5f) < 1e-4f,
+                  "ray stops at the first block and reports its face");
+      ok &= check(tree.raycast(glm::vec3(24.5f, 40.5f, 24.5f), glm::vec3(0.0f, -1.0f, 0.0f), 100.0f, hit) && hit.block == glm::ivec3(24, 15, 24) &&
+                    hit.face == FACE_POS_Y,
+                  "ray from above lands on the collapsed cube");
+      ok &= check(!tree.raycast(glm::vec3(0.5f, 100.5f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f), 5000.0f, hit), "ray into the sky misses");
+      ok &= check(tree.raycast(glm::vec3(-3000.0f, 70.5f, -32.5f), glm::vec3(1.0f, 0.0f, 0.0f), 5000.0f, hit) && hit.block == glm::ivec3(40, 70, -33),
+                  "ray entering the root from outside");
+      ok &= check(tree.stats().usedNodes < 200, "a solid 16^3 cube is a single node");
+
+      world.setBlock(-5, 3, 7, BLOCK_AIR);
+      tree.markChunk(worldToChunk(-5, 3, 7));
+      tree.update(world, everythingReady);
+      ok &= check(tree.raycast(glm::vec3(-10.5f, 3.5f, 7.5f), glm::vec3(1.0f, 0.0f, 0.0f), 20.0f, hit) && hit.id == BLOCK_SAND,
+                  "an edit shows up after the update");
+    }
+
+    // generated terrain
+    ChunkStorage world;
+    TerrainGenerator generator;
+    const ChunkCoord min = { -radius, 0, -radius }, max = { radius, 5, radius };
+    for (int y = min.y; y < max.y; y++)
+      for (int z = min.z; z < max.z; z++)
+        for (int x = min.x; x < max.x; x++)
+          generator.generate({ x, y, z }, world.getOrCreateChunk({ x, y, z }));
+
+    VoxelTree tree;
+    world.forEachChunk([&](ChunkCoord coord, const Chunk&) { tree.markChunk(coord); });
+    const Timer buildTimer;
+    const size_t bricks = tree.update(world, everythingReady);
+    const double buildSeconds = buildTimer.seconds();
+    const VoxelTreeStats stats = tree.stats();
+    ok &= check(stats.failedBricks == 0, "every brick fits");
+    ok &= check(countMismatches(tree, world, min, max) == 0, "generated terrain reads back from the tree");
+
+    const RayComparison rays = compareRays(tree, world, rayCount, radius, 256.0f, 11);
+    ok &= check(rays.hits > rays.rays / 4, "rays hit the terrain");
+    ok &= check(rays.mismatches == 0, "tree traversal matches the DDA ray for ray");
+
+    // edits: random blocks changed, their bricks rebuilt
+    Rng rng(5);
+    const int edits = 2000;
+    for (int i = 0; i < edits; i++)
+    {
+      const int x = rng.range(min.x * CHUNK_SIZE, max.x * CHUNK_SIZE);
+      const int y = rng.range(40, 120);
+      const int z = rng.range(min.z * CHUNK_SIZE, max.z * CHUNK_SIZE);
+      world.setBlock(x, y, z, rng.range(0, 2) ? BLOCK_AIR : BLOCK_LAMP);
+      tree.markChunk(worldToChunk(x, y, z));
+    }
+    std::vector<BufferRange> ranges;
+    tree.takeDirtyRanges(ranges);
+    const Timer updateTimer;
+    const size_t rebuilt = tree.update(world, everythingReady);
+    const double updateSeconds = updateTimer.seconds();
+    tree.takeDirtyRanges(ranges);
+    size_t uploadNodes = 0;
+    for (const BufferRange& range : ranges)
+      uploadNodes += range.size;
+    ok &= check(countMismatches(tree, world, min, max) == 0, "edited terrain reads back from the tree");
+    const RayComparison editedRays = compareRays(tree, world, rayCount / 4, radius, 256.0f, 12);
+    ok &= check(editedRays.mismatches == 0, "traversal still matches after the edits");
+
+    size_t chunkBytes = 0;
+    world.forEachChunk([&](ChunkCoord, const Chunk& chunk) { chunkBytes += chunk.memoryUsage(); });
+    const double blocks = double(world.chunkCount()) * CHUNK_VOLUME;
+    std::printf("  %zu chunks in %zu bricks built in %.1f ms (%.2f ms/brick), %u nodes (%.2f MB, %.3f bytes/block vs %.3f in chunks), %u top nodes\n",
+      world.chunkCount(), bricks, buildSeconds * 1000.0, buildSeconds * 1000.0 / double(bricks), stats.usedNodes,
+      stats.usedNodes * sizeof(VoxelNode) / 1048576.0, stats.usedNodes * sizeof(VoxelNode) / blocks, chunkBytes / blocks, stats.topNodes);
+    std::printf("  rays: %.2f M rays/s through the tree, %.2f M rays/s DDA over chunks, %zu of %zu hit\n", double(rays.rays) / rays.treeSeconds / 1e6,
+      double(rays.rays) / rays.ddaSeconds / 1e6, rays.hits, rays.rays);
+    std::printf("  %d edits: %zu bricks rebuilt in %.2f ms (%.2f ms/brick), %zu upload ranges of %.2f MB total\n", edits, rebuilt,
+      updateSeconds * 1000.0, updateSeconds * 1000.0 / double(rebuilt ? rebuilt : 1), ranges.size(), uploadNodes * sizeof(VoxelNode) / 1048576.0);
+
+    return ok ? 0 : 1;
+  }
+}
@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+// xy texture coordinates, z the block texture array layer
+in vec3 TexCoord;
+// sunlight and block light, 0..1
+in vec2 Light;
+// ambient occlusion, 1 when nothing is near
+in float Occlusion;
+
+uniform sampler2DArray ourTexture;
+
+void main()
+{
+    // the brighter of the two, with a floor so caves are not pitch black,
+    // darkened in the creases
+    float light = max(max(Light.x, Light.y), 0.08) * Occlusion;
+    vec4 color = texture(ourTexture, TexCoord);
+    FragColor = vec4(color.rgb * light, color.a);
+}
@@ -0,0 +1,63 @@
+#version 450 core
+// gl_DrawIDARB is gl_DrawID of 4.6, the extension also runs on Mesa's
+// llvmpipe which stops at 4.5
+#extension GL_ARB_shader_draw_parameters : require
+
+// one world offset per indirect draw, w is the LOD scale (1, 2, 4 or 8),
+// see src/render/draw_commands.h
+layout (std430, binding = 0) readonly buffer ChunkOffsets
+{
+    vec4 chunkOffsets[];
+};
+
+// face records of three words, see src/mesh/packed_face.h for the bit
+// layout. There are no vertex attributes, every six vertices pull one record
+// and make a quad
+layout (std430, binding = 1) readonly buffer Faces
+{
+    uint faceWords[];
+};
+
+out vec3 TexCoord;
+// smoothed sunlight and block light at the corner, 0..1
+out vec2 Light;
+// ambient occlusion at the corner, 1 when nothing is near
+out float Occlusion;
+
+uniform mat4 viewProjection;
+
+// quad corner of each vertex, triangles 0 1 2 and 2 3 0
+const uint quadCorners[6] = uint[6](0u, 1u, 2u, 2u, 3u, 0u);
+// axes texture u and v run along per normal axis (faceTextureAxes)
+const uint textureU[3] = uint[3](2u, 0u, 0u);
+const uint textureV[3] = uint[3](1u, 2u, 1u);
+// how much light reaches a corner with 3 to 0 of its cells open
+const float occlusionCurve[4] = float[4](0.45, 0.65, 0.82, 1.0);
+
+void main()
+{
+    uint record = uint(gl_VertexID / 6) * 3u;
+    uvec3 face = uvec3(faceWords[record], faceWords[record + 1u], faceWords[record + 2u]);
+    uint direction = (face.x >> 18) & 7u;
+    uint axis = direction >> 1;
+
+    // counter-clockwise from outside, negative faces go round 0 3 2 1.
+    // Flipped quads start a corner later and split along 1-3 instead
+    uint corner = (quadCorners[gl_VertexID % 6] + (face.x >> 31)) & 3u;
+    if ((direction & 1u) == 0u)
+        corner = (4u - corner) & 3u;
+    vec2 size = vec2(((face.x >> 21) & 31u) + 1u, ((face.x >> 26) & 31u) + 1u);
+    vec2 extent = vec2(corner == 1u || corner == 2u, corner >= 2u) * size;
+    vec3 local = vec3(0.0);
+    local[(axis + 1u) % 3u] = extent.x;
+    local[(axis + 2u) % 3u] = extent.y;
+
+    vec4 offset = chunkOffsets[gl_DrawIDARB];
+    vec3 pos = vec3(face.x & 63u, (face.x >> 6) & 63u, (face.x >> 12) & 63u) + local;
+    gl_Position = viewProjection * vec4(pos * offset.w + offset.xyz, 1.0);
+    // textures keep tiling once per block on coarse nodes too
+    TexCoord = vec3(vec2(local[textureU[axis]], local[textureV[axis]]) * offset.w, face.y & 4095u);
+    uint light = (face.z >> (corner * 8u)) & 255u;
+    Light = vec2(light >> 4, light & 15u) / 15.0;
+    Occlusion = occlusionCurve[(face.y >> (12u + corner * 2u)) & 3u];
+}
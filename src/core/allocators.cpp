@@ -0,0 +1,345 @@
+#include "core/allocators.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace zm
+{
+  namespace
+  {
+    struct Counters
+    {
+      std::atomic<size_t> live{ 0 };
+      std::atomic<size_t> peakLive{ 0 };
+      std::atomic<size_t> reserved{ 0 };
+      std::atomic<size_t> highWater{ 0 };
+      std::atomic<uint64_t> allocations{ 0 };
+      std::atomic<uint64_t> heapAllocations{ 0 };
+    };
+
+    Counters counters[MEMORY_CATEGORY_COUNT];
+
+    std::atomic<bool> pooling{ true };
+    // set by the first allocation, the mode can't change after that
+    std::atomic<bool> anythingAllocated{ false };
+
+    void raise(std::atomic<size_t>& peak, size_t value)
+    {
+      size_t current = peak.load(std::memory_order_relaxed);
+      while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+      {
+      }
+    }
+
+    bool usePools()
+    {
+      anythingAllocated.store(true, std::memory_order_relaxed);
+      return pooling.load(std::memory_order_relaxed);
+    }
+
+    size_t alignUp(size_t value, size_t alignment)
+    {
+      return (value + alignment - 1) & ~(alignment - 1);
+    }
+  }
+
+  namespace detail
+  {
+    void trackReserve(MemoryCategory category, ptrdiff_t bytes, bool fromHeap)
+    {
+      Counters& c = counters[category];
+      const size_t reserved = c.reserved.fetch_add(size_t(bytes), std::memory_order_relaxed) + size_t(bytes);
+      if (bytes > 0)
+        raise(c.highWater, reserved);
+      if (fromHeap)
+        c.heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void trackLive(MemoryCategory category, ptrdiff_t bytes)
+    {
+      Counters& c = counters[category];
+      const size_t live = c.live.fetch_add(size_t(bytes), std::memory_order_relaxed) + size_t(bytes);
+      if (bytes > 0)
+      {
+        raise(c.peakLive, live);
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  const char* memoryCategoryName(MemoryCategory category)
+  {
+    switch (category)
+    {
+      case MEMORY_CHUNK_BLOCKS: return "chunk blocks";
+      case MEMORY_MESH_SCRATCH: return "mesh scratch";
+      case MEMORY_VERTEX_STAGING: return "vertex staging";
+      default: return "?";
+    }
+  }
+
+  MemoryStats memoryStats(MemoryCategory category)
+  {
+    const Counters& c = counters[category];
+    MemoryStats stats;
+    stats.liveBytes = c.live.load(std::memory_order_relaxed);
+    stats.peakLiveBytes = c.peakLive.load(std::memory_order_relaxed);
+    stats.reservedBytes = c.reserved.load(std::memory_order_relaxed);
+    stats.highWaterBytes = c.highWater.load(std::memory_order_relaxed);
+    stats.allocations = c.allocations.load(std::memory_order_relaxed);
+    stats.heapAllocations = c.heapAllocations.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  bool setMemoryPooling(bool enabled)
+  {
+    if (anythingAllocated.load(std::memory_order_relaxed))
+      return enabled == pooling.load(std::memory_order_relaxed);
+    pooling.store(enabled, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool memoryPooling()
+  {
+    return pooling.load(std::memory_order_relaxed);
+  }
+
+  ProcessMemory processMemory()
+  {
+    ProcessMemory memory;
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS info;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info)))
+    {
+      memory.residentBytes = info.WorkingSetSize;
+      memory.peakResidentBytes = info.PeakWorkingSetSize;
+    }
+#elif defined(__linux__)
+    if (std::FILE* statm = std::fopen("/proc/self/statm", "r"))
+    {
+      unsigned long size = 0, resident = 0;
+      if (std::fscanf(statm, "%lu %lu", &size, &resident) == 2)
+        memory.residentBytes = size_t(resident) * size_t(sysconf(_SC_PAGESIZE));
+      std::fclose(statm);
+    }
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+      memory.peakResidentBytes = size_t(usage.ru_maxrss) * 1024; // kilobytes on Linux
+#endif
+    return memory;
+  }
+
+  SlabPool::SlabPool(size_t blockSize, size_t slabBytes, MemoryCategory category)
+    : blockBytes(alignUp(std::max(blockSize, sizeof(void*)), alignof(std::max_align_t))),
+      blocksPerSlab(std::max<size_t>(1, slabBytes / blockBytes)), category(category)
+  {
+  }
+
+  SlabPool::~SlabPool()
+  {
+    for (void* slab : slabs)
+      ::operator delete(slab);
+  }
+
+  void* SlabPool::allocate()
+  {
+    detail::trackLive(category, ptrdiff_t(blockBytes));
+    if (!usePools())
+    {
+      detail::trackReserve(category, ptrdiff_t(blockBytes), true);
+      return ::operator new(blockBytes);
+    }
+
+    std::lock_guard lock(mutex);
+    if (!freeList)
+    {
+      // a new slab, its blocks chained up in address order
+      char* slab = static_cast<char*>(::operator new(blockBytes * blocksPerSlab));
+      slabs.push_back(slab);
+      detail::trackReserve(category, ptrdiff_t(blockBytes * blocksPerSlab), true);
+      for (size_t i = blocksPerSlab; i-- > 0;)
+      {
+        void* block = slab + i * blockBytes;
+        *static_cast<void**>(block) = freeList;
+        freeList = block;
+      }
+    }
+    void* block = freeList;
+    freeList = *static_cast<void**>(block);
+    return block;
+  }
+
+  void SlabPool::deallocate(void* block)
+  {
+    if (!block)
+      return;
+    detail::trackLive(category, -ptrdiff_t(blockBytes));
+    if (!memoryPooling())
+    {
+      detail::trackReserve(category, -ptrdiff_t(blockBytes), false);
+      ::operator delete(block);
+      return;
+    }
+
+    std::lock_guard lock(mutex);
+    *static_cast<void**>(block) = freeList;
+    freeList = block;
+  }
+
+  SizeClassPool::SizeClassPool(size_t minBytes, size_t maxBytes, size_t cacheBytes, MemoryCategory category)
+    : minShift(std::bit_width(std::max<size_t>(minBytes, 1) - 1)), maxShift(std::bit_width(std::max(maxBytes, minBytes) - 1)),
+      cacheBytes(cacheBytes), category(category), freeBuffers(size_t(maxShift - minShift + 1))
+  {
+  }
+
+  SizeClassPool::~SizeClassPool()
+  {
+    for (std::vector<void*>& buffers : freeBuffers)
+      for (void* buffer : buffers)
+        ::operator delete(buffer);
+  }
+
+  // smallest class that fits, -1 when bytes is past the largest class
+  int SizeClassPool::sizeClass(size_t bytes) const
+  {
+    const int shift = std::max(minShift, int(std::bit_width(std::max<size_t>(bytes, 1) - 1)));
+    return shift > maxShift ? -1 : shift - minShift;
+  }
+
+  void* SizeClassPool::allocate(size_t bytes)
+  {
+    const int index = usePools() ? sizeClass(bytes) : -1;
+    if (index < 0)
+    {
+      detail::trackLive(category, ptrdiff_t(bytes));
+      detail::trackReserve(category, ptrdiff_t(bytes), true);
+      return ::operator new(bytes);
+    }
+
+    const size_t classBytes = size_t(1) << (minShift + index);
+    detail::trackLive(category, ptrdiff_t(classBytes));
+    {
+      std::lock_guard lock(mutex);
+      std::vector<void*>& buffers = freeBuffers[size_t(index)];
+      if (!buffers.empty())
+      {
+        void* buffer = buffers.back();
+        buffers.pop_back();
+        return buffer;
+      }
+    }
+    detail::trackReserve(category, ptrdiff_t(classBytes), true);
+    return ::operator new(classBytes);
+  }
+
+  void SizeClassPool::deallocate(void* buffer, size_t bytes)
+  {
+    if (!buffer)
+      return;
+    const int index = memoryPooling() ? sizeClass(bytes) : -1;
+    if (index < 0)
+    {
+      detail::trackLive(category, -ptrdiff_t(bytes));
+      detail::trackReserve(category, -ptrdiff_t(bytes), false);
+      ::operator delete(buffer);
+      return;
+    }
+
+    const size_t classBytes = size_t(1) << (minShift + index);
+    detail::trackLive(category, -ptrdiff_t(classBytes));
+    {
+      std::lock_guard lock(mutex);
+      std::vector<void*>& buffers = freeBuffers[size_t(index)];
+      // always keep a couple, even of the big classes
+      if (buffers.size() < 2 || (buffers.size() + 1) * classBytes <= cacheBytes)
+      {
+        buffers.push_back(buffer);
+        return;
+      }
+    }
+    detail::trackReserve(category, -ptrdiff_t(classBytes), false);
+    ::operator delete(buffer);
+  }
+
+  LinearArena::LinearArena(MemoryCategory category, size_t blockSize) : category(category), blockSize(blockSize)
+  {
+  }
+
+  LinearArena::~LinearArena()
+  {
+    detail::trackLive(category, -ptrdiff_t(used));
+    release();
+  }
+
+  void LinearArena::release()
+  {
+    for (const Block& block : blocks)
+      ::operator delete(block.data);
+    detail::trackReserve(category, -ptrdiff_t(reserved), false);
+    blocks.clear();
+    reserved = 0;
+    offset = 0;
+  }
+
+  void* LinearArena::allocate(size_t bytes, size_t alignment)
+  {
+    detail::trackLive(category, ptrdiff_t(bytes));
+    used += bytes;
+
+    // without pooling every allocation is its own trip to the heap
+    const bool pooled = usePools();
+    if (pooled && !blocks.empty())
+    {
+      const Block& block = blocks.back();
+      const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+      const size_t start = alignUp(base + offset, alignment) - base;
+      if (start + bytes <= block.size)
+      {
+        offset = start + bytes;
+        return block.data + start;
+      }
+    }
+
+    const size_t size = pooled ? std::max(blockSize, bytes + alignment) : bytes + alignment;
+    Block block = { static_cast<char*>(::operator new(size)), size };
+    blocks.push_back(block);
+    reserved += size;
+    detail::trackReserve(category, ptrdiff_t(size), true);
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+    const size_t start = alignUp(base, alignment) - base;
+    offset = start + bytes;
+    return block.data + start;
+  }
+
+  void LinearArena::reset()
+  {
+    detail::trackLive(category, -ptrdiff_t(used));
+    // one block big enough for everything this round needed
+    if (blocks.size() > 1 || !memoryPooling())
+    {
+      const size_t total = reserved;
+      release();
+      if (memoryPooling())
+      {
+        blocks.push_back({ static_cast<char*>(::operator new(total)), total });
+        reserved = total;
+        detail::trackReserve(category, ptrdiff_t(total), true);
+      }
+    }
+    used = 0;
+    offset = 0;
+  }
+}
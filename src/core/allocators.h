@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace zm
+{
+  // What pooled memory is used for, each kind is counted on its own
+  enum MemoryCategory
+  {
+    MEMORY_CHUNK_BLOCKS,   // packed block words of chunks, slab pools
+    MEMORY_MESH_SCRATCH,   // mesher arenas, reset for every mesh
+    MEMORY_VERTEX_STAGING, // finished meshes waiting to be uploaded, size classes
+    MEMORY_CATEGORY_COUNT
+  };
+
+  const char* memoryCategoryName(MemoryCategory category);
+
+  struct MemoryStats
+  {
+    size_t liveBytes = 0;       // handed out and not given back yet
+    size_t peakLiveBytes = 0;
+    size_t reservedBytes = 0;   // held by the allocator, live plus free lists
+    size_t highWaterBytes = 0;  // most ever reserved
+    uint64_t allocations = 0;
+    uint64_t heapAllocations = 0; // allocations that had to go to the system heap
+  };
+
+  MemoryStats memoryStats(MemoryCategory category);
+
+  // Off sends every allocation straight to new/delete, for comparing against
+  // plain STL containers. Only takes effect before anything is allocated
+  // through the pools, returns false when that is too late
+  bool setMemoryPooling(bool enabled);
+  bool memoryPooling();
+
+  // Resident and peak resident set size of the whole process, 0 where the
+  // platform can't tell
+  struct ProcessMemory
+  {
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+  };
+
+  ProcessMemory processMemory();
+
+  namespace detail
+  {
+    // counters behind memoryStats
+    void trackReserve(MemoryCategory category, ptrdiff_t bytes, bool fromHeap);
+    void trackLive(MemoryCategory category, ptrdiff_t bytes);
+  }
+
+  // Fixed size blocks carved out of bigger slabs. Freed blocks go on a free
+  // list threaded through the blocks themselves and slabs are never given
+  // back, so the pool stays at its high-water mark. Thread safe
+  class SlabPool
+  {
+  public:
+    SlabPool(size_t blockSize, size_t slabBytes, MemoryCategory category);
+    ~SlabPool();
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    void* allocate();
+    void deallocate(void* block);
+
+    size_t blockSize() const { return blockBytes; }
+
+  private:
+    const size_t blockBytes;
+    const size_t blocksPerSlab;
+    const MemoryCategory category;
+
+    std::mutex mutex;
+    void* freeList = nullptr;
+    std::vector<void*> slabs;
+  };
+
+  // Buffers bucketed into power of two size classes from minBytes to
+  // maxBytes. A freed buffer is kept for the next request of its class, up
+  // to cacheBytes per class, so buffers of similar size keep being recycled
+  // instead of fragmenting the heap. Bigger requests go to the heap. Thread
+  // safe, buffers are usually filled on one thread and freed on another
+  class SizeClassPool
+  {
+  public:
+    SizeClassPool(size_t minBytes, size_t maxBytes, size_t cacheBytes, MemoryCategory category);
+    ~SizeClassPool();
+
+    SizeClassPool(const SizeClassPool&) = delete;
+    SizeClassPool& operator=(const SizeClassPool&) = delete;
+
+    // deallocate needs the same bytes allocate got
+    void* allocate(size_t bytes);
+    void deallocate(void* buffer, size_t bytes);
+
+  private:
+    int sizeClass(size_t bytes) const;
+
+    const int minShift;
+    const int maxShift;
+    const size_t cacheBytes;
+    const MemoryCategory category;
+
+    std::mutex mutex;
+    std::vector<std::vector<void*>> freeBuffers; // per class
+  };
+
+  // Bump allocator for scratch space that all dies at once. reset() frees
+  // everything, keeping one block as big as everything used before so the
+  // next round allocates nothing. Not thread safe, one per thread
+  class LinearArena
+  {
+  public:
+    explicit LinearArena(MemoryCategory category, size_t blockSize = 1 << 20);
+    ~LinearArena();
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    // uninitialized, T must not need a destructor
+    template <typename T>
+    T* allocate(size_t count)
+    {
+      return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+    size_t usedBytes() const { return used; }
+
+  private:
+    struct Block
+    {
+      char* data;
+      size_t size;
+    };
+
+    void release();
+
+    const MemoryCategory category;
+    const size_t blockSize;
+    std::vector<Block> blocks;
+    size_t offset = 0; // into blocks.back()
+    size_t used = 0;
+    size_t reserved = 0;
+  };
+
+  // std allocator over a pool with static allocate(bytes) and
+  // deallocate(pointer, bytes), so containers can keep their usual interface
+  template <typename T, typename Pool>
+  struct PoolAllocator
+  {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, Pool>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(Pool::allocate(count * sizeof(T))); }
+    void deallocate(T* pointer, size_t count) { Pool::deallocate(pointer, count * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U, Pool>&) const { return true; }
+  };
+}
@@ -0,0 +1,132 @@
+#include "core/bench_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace zm
+{
+  namespace
+  {
+    std::string jsonString(const std::string& text)
+    {
+      std::string out = "\"";
+      for (char c : text)
+      {
+        if (c == '"' || c == '\\')
+        {
+          out += '\\';
+          out += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+          char escaped[8];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)(unsigned char)c);
+          out += escaped;
+        }
+        else
+          out += c;
+      }
+      return out + "\"";
+    }
+
+    std::string jsonNumber(double value)
+    {
+      // JSON has no inf or nan
+      if (!std::isfinite(value))
+        return "null";
+      char text[32];
+      std::snprintf(text, sizeof(text), "%.4g", value);
+      return text;
+    }
+
+    // nearest rank on a sorted copy
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+      if (sorted.empty())
+        return 0.0;
+      return sorted[std::min(sorted.size() - 1, size_t(p * double(sorted.size())))];
+    }
+
+    template <typename Field>
+    std::string summary(const std::vector<BenchFrame>& frames, Field field)
+    {
+      std::vector<double> values;
+      values.reserve(frames.size());
+      double total = 0.0;
+      for (const BenchFrame& frame : frames)
+      {
+        values.push_back(double(field(frame)));
+        total += values.back();
+      }
+      std::sort(values.begin(), values.end());
+      const double mean = values.empty() ? 0.0 : total / double(values.size());
+      return "{\"mean\":" + jsonNumber(mean) + ",\"p50\":" + jsonNumber(percentile(values, 0.5)) + ",\"p90\":" + jsonNumber(percentile(values, 0.9)) +
+             ",\"p99\":" + jsonNumber(percentile(values, 0.99)) + ",\"max\":" + jsonNumber(values.empty() ? 0.0 : values.back()) + "}";
+    }
+  }
+
+  void BenchReport::setInfo(const std::string& key, const std::string& value)
+  {
+    info.emplace_back(key, jsonString(value));
+  }
+
+  void BenchReport::setInfo(const std::string& key, double value)
+  {
+    info.emplace_back(key, jsonNumber(value));
+  }
+
+  std::string BenchReport::json(double seconds) const
+  {
+    uint64_t meshes = 0, faces = 0, uploadBytes = 0, drawCalls = 0;
+    double meshingMs = 0.0;
+    for (const BenchFrame& frame : frames)
+    {
+      meshes += frame.meshesUploaded;
+      faces += frame.facesUploaded;
+      uploadBytes += frame.bytesUploaded;
+      drawCalls += frame.drawCalls;
+      meshingMs += frame.meshingMs;
+    }
+
+    std::string out = "{\n";
+    for (const auto& [key, value] : info)
+      out += "  " + jsonString(key) + ": " + value + ",\n";
+    out += "  \"frames\": " + std::to_string(frames.size()) + ",\n";
+    out += "  \"seconds\": " + jsonNumber(seconds) + ",\n";
+    out += "  \"fps\": " + jsonNumber(seconds > 0.0 ? double(frames.size()) / seconds : 0.0) + ",\n";
+    out += "  \"frame_ms\": " + summary(frames, [](const BenchFrame& f) { return f.milliseconds; }) + ",\n";
+    out += "  \"meshing\": {\"meshes\":" + std::to_string(meshes) + ",\"faces\":" + std::to_string(faces) +
+           ",\"upload_mb\":" + jsonNumber(double(uploadBytes) / 1048576.0) +
+           ",\"meshes_per_second\":" + jsonNumber(seconds > 0.0 ? double(meshes) / seconds : 0.0) +
+           ",\"faces_per_second\":" + jsonNumber(seconds > 0.0 ? double(faces) / seconds : 0.0) +
+           ",\"job_ms\":" + jsonNumber(meshingMs) + ",\"job_ms_per_mesh\":" + jsonNumber(meshes ? meshingMs / double(meshes) : 0.0) + "},\n";
+    out += "  \"draw_calls\": " + summary(frames, [](const BenchFrame& f) { return f.drawCalls; }) + ",\n";
+    out += "  \"draw_calls_total\": " + std::to_string(drawCalls) + ",\n";
+    out += "  \"draw_commands\": " + summary(frames, [](const BenchFrame& f) { return f.drawCommands; }) + ",\n";
+    out += "  \"visible_nodes\": " + summary(frames, [](const BenchFrame& f) { return f.visibleNodes; }) + "\n";
+    out += "}\n";
+    return out;
+  }
+
+  bool BenchReport::write(const std::filesystem::path& path, double seconds) const
+  {
+    const std::string text = json(seconds);
+    if (path == "-")
+      return std::fwrite(text.data(), 1, text.size(), stdout) == text.size();
+
+    std::error_code error;
+    if (path.has_parent_path())
+      std::filesystem::create_directories(path.parent_path(), error);
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file)
+    {
+      std::fprintf(stderr, "Failed to write bench report %s\n", path.string().c_str());
+      return false;
+    }
+    std::fwrite(text.data(), 1, text.size(), file);
+    const bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace zm
+{
+  // What one frame of a benchmark run did
+  struct BenchFrame
+  {
+    double milliseconds = 0.0;   // whole frame, including waiting for the GPU
+    uint32_t drawCalls = 0;
+    uint32_t drawCommands = 0;   // indirect commands inside the chunk multi-draw
+    uint32_t visibleNodes = 0;
+    uint32_t meshesUploaded = 0;
+    size_t facesUploaded = 0;    // quads, one face record each
+    size_t bytesUploaded = 0;
+    double meshingMs = 0.0;      // mesher job time that ended during the frame, all threads
+  };
+
+  // Frames of an engine benchmark run (zim-engine --bench), summed up as
+  // percentiles and totals and written out as one JSON object so runs on
+  // different commits or machines can be compared by a script
+  class BenchReport
+  {
+  public:
+    // shows up as a top level string field, e.g. the GL renderer
+    void setInfo(const std::string& key, const std::string& value);
+    void setInfo(const std::string& key, double value);
+
+    void addFrame(const BenchFrame& frame) { frames.push_back(frame); }
+    size_t frameCount() const { return frames.size(); }
+
+    // seconds is the wall clock length of the run, for the per second rates
+    std::string json(double seconds) const;
+    // "-" writes to stdout. False when the file can't be written
+    bool write(const std::filesystem::path& path, double seconds) const;
+
+  private:
+    std::vector<std::pair<std::string, std::string>> info; // values already JSON encoded
+    std::vector<BenchFrame> frames;
+  };
+}
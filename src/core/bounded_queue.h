@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace zm
+{
+  // Multi-producer queue with a fixed capacity. Producers never block, a full
+  // queue just refuses the item, and the consumer takes a bounded batch at a
+  // time so it can cap how much work it does per frame
+  template <typename T>
+  class BoundedQueue
+  {
+  public:
+    explicit BoundedQueue(size_t capacity) : maxSize(capacity) {}
+
+    bool tryPush(T&& value)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (items.size() >= maxSize)
+        return false;
+      items.push_back(std::move(value));
+      return true;
+    }
+
+    // Moves up to maxItems into out (appended), returns how many were taken
+    size_t drain(std::vector<T>& out, size_t maxItems)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      const size_t count = items.size() < maxItems ? items.size() : maxItems;
+      for (size_t i = 0; i < count; i++)
+      {
+        out.push_back(std::move(items.front()));
+        items.pop_front();
+      }
+      return count;
+    }
+
+    size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      return items.size();
+    }
+
+    size_t capacity() const { return maxSize; }
+
+  private:
+    mutable std::mutex mutex;
+    std::deque<T> items;
+    size_t maxSize;
+  };
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zm
+{
+  // FNV-1a, used to key on-disk caches by their inputs. Chain calls by
+  // passing the previous result back in
+  constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+  constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+  inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+  {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+      hash = (hash ^ bytes[i]) * FNV_PRIME;
+    return hash;
+  }
+
+  inline uint64_t fnv1a(const void* data, size_t size)
+  {
+    return fnv1a(FNV_OFFSET, data, size);
+  }
+}
@@ -0,0 +1,223 @@
+#include "core/job_system.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+
+namespace zm
+{
+  namespace
+  {
+    thread_local const JobSystem* tlsOwner = nullptr;
+    thread_local int tlsWorkerIndex = -1;
+  }
+
+  JobSystem::JobSystem(unsigned workerCount, const char* name)
+    : name(name)
+  {
+    if (workerCount == 0)
+    {
+      const unsigned hardware = std::thread::hardware_concurrency();
+      workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for (unsigned i = 0; i < workerCount; i++)
+      queues.push_back(std::make_unique<WorkerQueue>());
+
+    for (unsigned i = 0; i < workerCount; i++)
+      workers.emplace_back([this, i] { workerLoop(int(i)); });
+  }
+
+  JobSystem::~JobSystem()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::thread& worker : workers)
+      worker.join();
+  }
+
+  int JobSystem::currentWorker()
+  {
+    return tlsWorkerIndex;
+  }
+
+  JobHandle JobSystem::submit(std::function<void()> function, float priority, std::initializer_list<JobHandle> dependencies)
+  {
+    return submitWithDependencies(std::move(function), priority, dependencies);
+  }
+
+  JobHandle JobSystem::submit(std::function<void()> function, float priority, const std::vector<JobHandle>& dependencies)
+  {
+    return submitWithDependencies(std::move(function), priority, dependencies);
+  }
+
+  template <typename Range>
+  JobHandle JobSystem::submitWithDependencies(std::function<void()> function, float priority, const Range& dependencies)
+  {
+    JobHandle job = std::make_shared<Job>();
+    job->function = std::move(function);
+    job->priority = priority;
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+
+    // pendingDependencies starts at 1 so the job can't be released while
+    // we're still registering it with its dependencies
+    for (const JobHandle& dependency : dependencies)
+    {
+      if (!dependency)
+        continue;
+
+      std::lock_guard<std::mutex> lock(dependency->continuationMutex);
+      if (!dependency->finished.load(std::memory_order_relaxed))
+      {
+        job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+        dependency->continuations.push_back(job);
+      }
+    }
+
+    if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      schedule(job);
+
+    return job;
+  }
+
+  void JobSystem::schedule(JobHandle job)
+  {
+    queued.fetch_add(1, std::memory_order_release);
+
+    if (tlsOwner == this)
+    {
+      WorkerQueue& queue = *queues[tlsWorkerIndex];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(std::move(job));
+    }
+    else
+    {
+      std::lock_guard<std::mutex> lock(globalMutex);
+      globalHeap.push_back(std::move(job));
+      std::push_heap(globalHeap.begin(), globalHeap.end(), PriorityOrder{});
+    }
+
+    // taking the lock orders this against a worker about to go to sleep
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeCondition.notify_one();
+  }
+
+  JobHandle JobSystem::findJob(int self)
+  {
+    JobHandle job;
+
+    // 1. newest job on our own deque
+    if (self >= 0)
+    {
+      WorkerQueue& queue = *queues[self];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.jobs.empty())
+      {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+      }
+    }
+
+    // 2. highest priority job from outside
+    if (!job)
+    {
+      std::lock_guard<std::mutex> lock(globalMutex);
+      if (!globalHeap.empty())
+      {
+        std::pop_heap(globalHeap.begin(), globalHeap.end(), PriorityOrder{});
+        job = std::move(globalHeap.back());
+        globalHeap.pop_back();
+      }
+    }
+
+    // 3. oldest job from someone else's deque
+    const int count = int(queues.size());
+    for (int i = 1; !job && i <= count; i++)
+    {
+      const int victim = (std::max(self, 0) + i) % count;
+      if (victim == self)
+        continue;
+
+      WorkerQueue& queue = *queues[victim];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.jobs.empty())
+      {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+      }
+    }
+
+    if (job)
+      queued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+  }
+
+  void JobSystem::execute(JobHandle job)
+  {
+    if (!job->isCancelled())
+      job->function();
+    job->function = nullptr;
+
+    std::vector<JobHandle> released;
+    {
+      std::lock_guard<std::mutex> lock(job->continuationMutex);
+      job->finished.store(true, std::memory_order_release);
+      released.swap(job->continuations);
+    }
+
+    for (JobHandle& continuation : released)
+    {
+      if (continuation->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        schedule(std::move(continuation));
+    }
+
+    if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      { std::lock_guard<std::mutex> lock(sleepMutex); }
+      idleCondition.notify_all();
+    }
+  }
+
+  void JobSystem::workerLoop(int index)
+  {
+    tlsOwner = this;
+    tlsWorkerIndex = index;
+    Profiler::get().setThreadName(name + " " + std::to_string(index));
+
+    while (true)
+    {
+      if (JobHandle job = findJob(index))
+      {
+        execute(std::move(job));
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      wakeCondition.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+      if (stopping)
+        return;
+    }
+  }
+
+  void JobSystem::wait(const JobHandle& handle)
+  {
+    const int self = tlsOwner == this ? tlsWorkerIndex : -1;
+    while (handle && !handle->isFinished())
+    {
+      if (JobHandle job = findJob(self))
+        execute(std::move(job));
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  void JobSystem::waitIdle()
+  {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    idleCondition.wait(lock, [this] { return unfinished.load(std::memory_order_acquire) == 0; });
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zm
+{
+  class JobSystem;
+
+  // One unit of work. Held through JobHandle so dependants can hang on to it
+  // after it ran
+  class Job
+  {
+  public:
+    bool isFinished() const { return finished.load(std::memory_order_acquire); }
+    // The function is skipped but dependants still run, so a cancelled
+    // pipeline drains instead of hanging
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+    float getPriority() const { return priority; }
+
+  private:
+    friend class JobSystem;
+
+    std::function<void()> function;
+    float priority = 0.0f;
+    std::atomic<int> pendingDependencies{ 1 };
+    std::atomic<bool> finished{ false };
+    std::atomic<bool> cancelled{ false };
+    std::mutex continuationMutex;
+    std::vector<std::shared_ptr<Job>> continuations;
+  };
+
+  using JobHandle = std::shared_ptr<Job>;
+
+  // Work-stealing scheduler. Jobs submitted from outside the pool go into a
+  // shared queue ordered by priority (lower runs first, e.g. distance to the
+  // camera). Jobs released by a finishing dependency go onto that worker's own
+  // deque, so a generate -> mesh chain tends to stay on one core. Idle workers
+  // steal from the front of other workers' deques
+  class JobSystem
+  {
+  public:
+    // 0 workers means one per hardware thread minus one for the main thread.
+    // Workers show up in profiler traces as "<name> <index>"
+    explicit JobSystem(unsigned workerCount = 0, const char* name = "worker");
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Runs function once every job in dependencies has finished. Null
+    // handles in dependencies are ignored
+    JobHandle submit(std::function<void()> function, float priority = 0.0f, std::initializer_list<JobHandle> dependencies = {});
+    JobHandle submit(std::function<void()> function, float priority, const std::vector<JobHandle>& dependencies);
+
+    // Helps run jobs on the calling thread until handle has finished
+    void wait(const JobHandle& handle);
+    // Blocks until every submitted job has finished
+    void waitIdle();
+
+    unsigned workerCount() const { return unsigned(workers.size()); }
+    size_t pendingJobs() const { return unfinished.load(std::memory_order_relaxed); }
+
+    // Index of the calling worker, -1 on threads outside the pool
+    static int currentWorker();
+
+  private:
+    struct WorkerQueue
+    {
+      std::mutex mutex;
+      std::deque<JobHandle> jobs;
+    };
+
+    struct PriorityOrder
+    {
+      bool operator()(const JobHandle& a, const JobHandle& b) const { return a->priority > b->priority; }
+    };
+
+    template <typename Range>
+    JobHandle submitWithDependencies(std::function<void()> function, float priority, const Range& dependencies);
+
+    void schedule(JobHandle job);
+    JobHandle findJob(int self);
+    void execute(JobHandle job);
+    void workerLoop(int index);
+
+    std::string name;
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+    std::mutex globalMutex;
+    std::vector<JobHandle> globalHeap;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable idleCondition;
+    std::atomic<size_t> queued{ 0 };     // scheduled and not yet picked up
+    std::atomic<size_t> unfinished{ 0 }; // submitted and not yet finished
+    bool stopping = false;
+  };
+}
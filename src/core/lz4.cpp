@@ -0,0 +1,206 @@
+#include "core/lz4.h"
+
+#include <bit>
+#include <cstring>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr int minMatch = 4;
+    constexpr size_t lastLiterals = 5;   // the block always ends in at least this many literals
+    constexpr size_t matchSearchLimit = 12; // no match may start closer than this to the end
+    constexpr int hashBits = 12;
+    constexpr uint32_t maxOffset = 65535;
+
+    uint32_t read32(const uint8_t* p)
+    {
+      uint32_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    uint64_t read64(const uint8_t* p)
+    {
+      uint64_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    uint32_t hash4(uint32_t sequence)
+    {
+      return (sequence * 2654435761u) >> (32 - hashBits);
+    }
+
+    // bytes in common at a and b, stopping at limit (for a)
+    size_t commonLength(const uint8_t* a, const uint8_t* b, const uint8_t* limit)
+    {
+      const uint8_t* start = a;
+      while (a + 8 <= limit)
+      {
+        const uint64_t diff = read64(a) ^ read64(b);
+        if (diff)
+          return size_t(a - start) + size_t(std::countr_zero(diff) >> 3);
+        a += 8;
+        b += 8;
+      }
+      while (a < limit && *a == *b)
+      {
+        a++;
+        b++;
+      }
+      return size_t(a - start);
+    }
+
+    // length continuation bytes: 255 255 ... remainder
+    bool writeLength(uint8_t*& op, const uint8_t* end, size_t length)
+    {
+      for (; length >= 255; length -= 255)
+      {
+        if (op >= end)
+          return false;
+        *op++ = 255;
+      }
+      if (op >= end)
+        return false;
+      *op++ = uint8_t(length);
+      return true;
+    }
+
+    bool writeSequence(uint8_t*& op, const uint8_t* end, const uint8_t* literals, size_t literalLength, uint32_t offset, size_t matchLength)
+    {
+      if (op >= end)
+        return false;
+      uint8_t* token = op++;
+      *token = uint8_t((literalLength >= 15 ? 15 : literalLength) << 4);
+      if (literalLength >= 15 && !writeLength(op, end, literalLength - 15))
+        return false;
+
+      if (size_t(end - op) < literalLength)
+        return false;
+      std::memcpy(op, literals, literalLength);
+      op += literalLength;
+
+      // the final sequence has literals only
+      if (matchLength == 0)
+        return true;
+
+      if (end - op < 2)
+        return false;
+      *op++ = uint8_t(offset);
+      *op++ = uint8_t(offset >> 8);
+
+      const size_t code = matchLength - minMatch;
+      *token |= uint8_t(code >= 15 ? 15 : code);
+      return code < 15 || writeLength(op, end, code - 15);
+    }
+
+    bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+    {
+      uint8_t byte;
+      do
+      {
+        if (ip >= end)
+          return false;
+        byte = *ip++;
+        length += byte;
+      } while (byte == 255);
+      return true;
+    }
+  }
+
+  size_t lz4Compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+  {
+    uint8_t* op = dst;
+    const uint8_t* const opEnd = dst + capacity;
+    const uint8_t* anchor = src;
+
+    if (size >= matchSearchLimit + 1)
+    {
+      // positions + 1, so 0 means empty
+      uint32_t table[1 << hashBits] = {};
+      const uint8_t* ip = src;
+      const uint8_t* const searchEnd = src + size - matchSearchLimit;
+      const uint8_t* const matchEnd = src + size - lastLiterals;
+
+      while (ip < searchEnd)
+      {
+        const uint32_t sequence = read32(ip);
+        uint32_t& slot = table[hash4(sequence)];
+        const uint8_t* ref = slot ? src + (slot - 1) : nullptr;
+        slot = uint32_t(ip - src) + 1;
+
+        if (!ref || uint32_t(ip - ref) > maxOffset || read32(ref) != sequence)
+        {
+          ip++;
+          continue;
+        }
+
+        const size_t matchLength = minMatch + commonLength(ip + minMatch, ref + minMatch, matchEnd);
+        if (!writeSequence(op, opEnd, anchor, size_t(ip - anchor), uint32_t(ip - ref), matchLength))
+          return 0;
+
+        ip += matchLength;
+        anchor = ip;
+        // seed the table inside the match so the next one is found sooner
+        if (ip - 2 >= src && ip < searchEnd)
+          table[hash4(read32(ip - 2))] = uint32_t(ip - 2 - src) + 1;
+      }
+    }
+
+    if (!writeSequence(op, opEnd, anchor, size_t(src + size - anchor), 0, 0))
+      return 0;
+    return size_t(op - dst);
+  }
+
+  bool lz4Decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+  {
+    const uint8_t* ip = src;
+    const uint8_t* const ipEnd = src + size;
+    uint8_t* op = dst;
+    uint8_t* const opEnd = dst + dstSize;
+
+    while (ip < ipEnd)
+    {
+      const uint8_t token = *ip++;
+
+      size_t literalLength = token >> 4;
+      if (literalLength == 15 && !readLength(ip, ipEnd, literalLength))
+        return false;
+      if (size_t(ipEnd - ip) < literalLength || size_t(opEnd - op) < literalLength)
+        return false;
+      std::memcpy(op, ip, literalLength);
+      ip += literalLength;
+      op += literalLength;
+
+      // end of block
+      if (ip == ipEnd)
+        break;
+
+      if (ipEnd - ip < 2)
+        return false;
+      const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+      ip += 2;
+      if (offset == 0 || offset > size_t(op - dst))
+        return false;
+
+      size_t matchLength = token & 15;
+      if (matchLength == 15 && !readLength(ip, ipEnd, matchLength))
+        return false;
+      matchLength += minMatch;
+      if (size_t(opEnd - op) < matchLength)
+        return false;
+
+      // overlapping copies repeat the last offset bytes, go byte by byte then
+      const uint8_t* match = op - offset;
+      if (offset >= matchLength)
+        std::memcpy(op, match, matchLength);
+      else
+        for (size_t i = 0; i < matchLength; i++)
+          op[i] = match[i];
+      op += matchLength;
+    }
+
+    return op == opEnd;
+  }
+}
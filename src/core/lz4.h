@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zm
+{
+  // Small LZ4 block format codec (no frame format, no dictionary). Output is
+  // readable by the reference LZ4_decompress_safe and vice versa. Greedy
+  // single-probe matching, which is what makes LZ4 fast rather than small
+
+  // worst case compressed size for size input bytes
+  constexpr size_t lz4CompressBound(size_t size)
+  {
+    return size + size / 255 + 16;
+  }
+
+  // Returns the compressed size, 0 when capacity is too small
+  size_t lz4Compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+  // Decodes exactly dstSize bytes, false on malformed or truncated input.
+  // Never reads or writes outside the given buffers
+  bool lz4Decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
+}
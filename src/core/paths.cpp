@@ -0,0 +1,57 @@
+#include "core/paths.h"
+
+#include <system_error>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace zm
+{
+  namespace
+  {
+    std::filesystem::path searchUp(std::filesystem::path dir, const std::filesystem::path& marker)
+    {
+      std::error_code error;
+      while (!dir.empty())
+      {
+        if (std::filesystem::exists(dir / marker, error))
+          return dir;
+        std::filesystem::path parent = dir.parent_path();
+        if (parent == dir)
+          break;
+        dir = parent;
+      }
+      return {};
+    }
+  }
+
+  std::filesystem::path executableDirectory()
+  {
+    std::error_code error;
+#if defined(_WIN32)
+    wchar_t buffer[MAX_PATH];
+    const DWORD length = GetModuleFileNameW(nullptr, buffer, MAX_PATH);
+    if (length > 0 && length < MAX_PATH)
+      return std::filesystem::path(buffer).parent_path();
+#else
+    const std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (!error)
+      return exe.parent_path();
+#endif
+    return std::filesystem::current_path(error);
+  }
+
+  std::filesystem::path findAssetRoot(const std::filesystem::path& marker)
+  {
+    std::filesystem::path root = searchUp(executableDirectory(), marker);
+    if (root.empty())
+    {
+      std::error_code error;
+      root = searchUp(std::filesystem::current_path(error), marker);
+    }
+    return root;
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <filesystem>
+
+namespace zm
+{
+  // Directory holding the running executable, falls back to the working
+  // directory when the OS won't say
+  std::filesystem::path executableDirectory();
+
+  // The repository/install root that holds the game's data: the first
+  // directory containing marker, searching up from the executable and then
+  // from the working directory. Empty when nothing matches
+  std::filesystem::path findAssetRoot(const std::filesystem::path& marker = "textures");
+}
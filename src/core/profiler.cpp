@@ -0,0 +1,280 @@
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+namespace zm
+{
+  namespace
+  {
+    void writeJsonString(std::FILE* file, const char* text)
+    {
+      std::fputc('"', file);
+      for (const char* c = text; *c; c++)
+      {
+        if (*c == '"' || *c == '\\')
+          std::fputc('\\', file);
+        if (uint8_t(*c) >= 0x20)
+          std::fputc(*c, file);
+      }
+      std::fputc('"', file);
+    }
+  }
+
+  Profiler& Profiler::get()
+  {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  namespace
+  {
+    // hands the ring back for reuse when its thread exits, so pools that
+    // come and go (benches) don't pile up rings
+    struct RingOwner
+    {
+      std::shared_ptr<void> ring;
+      std::atomic<bool>* retired = nullptr;
+      std::string pendingName;
+
+      ~RingOwner()
+      {
+        if (retired)
+          retired->store(true, std::memory_order_release);
+      }
+    };
+
+    thread_local RingOwner ringOwner;
+  }
+
+  Profiler::ThreadRing& Profiler::threadRing()
+  {
+    thread_local ThreadRing* ring = nullptr;
+    if (!ring)
+    {
+      std::lock_guard<std::mutex> lock(ringMutex);
+      std::shared_ptr<ThreadRing> claimed;
+      for (const auto& candidate : rings)
+        if (candidate->retired.exchange(false, std::memory_order_acquire))
+        {
+          claimed = candidate;
+          break;
+        }
+      if (!claimed)
+      {
+        claimed = std::make_shared<ThreadRing>();
+        claimed->events = std::make_unique<ProfileEvent[]>(RING_SIZE);
+        claimed->id = uint32_t(rings.size());
+        rings.push_back(claimed);
+      }
+      claimed->depth = 0;
+      claimed->name = ringOwner.pendingName.empty() ? "thread " + std::to_string(claimed->id) : ringOwner.pendingName;
+      ringOwner.ring = claimed;
+      ringOwner.retired = &claimed->retired;
+      ring = claimed.get();
+    }
+    return *ring;
+  }
+
+  void Profiler::setThreadName(const std::string& name)
+  {
+    // the ring is only created once something is recorded
+    ringOwner.pendingName = name;
+    if (ringOwner.ring)
+    {
+      std::lock_guard<std::mutex> lock(ringMutex);
+      static_cast<ThreadRing*>(ringOwner.ring.get())->name = name;
+    }
+  }
+
+  void Profiler::push(ThreadRing& ring, const ProfileEvent& event)
+  {
+    const uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.events[index & (RING_SIZE - 1)] = event;
+    ring.written.store(index + 1, std::memory_order_release);
+  }
+
+  void Profiler::record(const char* name, uint64_t start, uint64_t end, uint16_t depth)
+  {
+    if (enabled())
+      push(threadRing(), { name, start, end, depth, ProfileEvent::SCOPE });
+  }
+
+  void Profiler::counter(const char* name, double value)
+  {
+    if (enabled())
+      push(threadRing(), { name, profilerNow(), std::bit_cast<uint64_t>(value), 0, ProfileEvent::COUNTER });
+  }
+
+  void Profiler::collect(const ThreadRing& ring, uint64_t since, std::vector<ProfileEvent>& out) const
+  {
+    // the slot after the newest event may be mid-write, so at most
+    // RING_SIZE - 1 events are readable
+    const uint64_t written = ring.written.load(std::memory_order_acquire);
+    const uint64_t oldest = written >= RING_SIZE ? written - RING_SIZE + 1 : 0;
+    const size_t first = out.size();
+
+    // events are pushed when they end, so walking back from the newest
+    // stops at the first one that ended before since
+    for (uint64_t i = written; i > oldest; i--)
+    {
+      const ProfileEvent& event = ring.events[(i - 1) & (RING_SIZE - 1)];
+      const uint64_t finished = event.kind == ProfileEvent::COUNTER ? event.start : event.end;
+      if (finished < since)
+        break;
+      out.push_back(event);
+    }
+
+    // anything the writer lapped while we copied may be torn, drop it
+    // (the copy is newest first, so those are at its end)
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t after = ring.written.load(std::memory_order_relaxed);
+    const uint64_t safe = after >= RING_SIZE ? after - RING_SIZE + 1 : 0;
+    const uint64_t copiedFrom = written - (out.size() - first);
+    if (safe > copiedFrom)
+      out.resize(out.size() - size_t(std::min<uint64_t>(safe - copiedFrom, out.size() - first)));
+    std::reverse(out.begin() + std::ptrdiff_t(first), out.end());
+  }
+
+  void Profiler::beginFrame()
+  {
+    frameStart = profilerNow();
+  }
+
+  void Profiler::endFrame()
+  {
+    const uint64_t now = profilerNow();
+    lastFrameStart = frameStart;
+    lastFrameEnd = now;
+
+    const float milliseconds = float(double(now - frameStart) / 1e6);
+    if (frameHistory.size() < FRAME_HISTORY)
+      frameHistory.push_back(milliseconds);
+    else
+      frameHistory[frameCursor] = milliseconds;
+    frameCursor = (frameCursor + 1) % FRAME_HISTORY;
+  }
+
+  std::vector<float> Profiler::frameTimes() const
+  {
+    if (frameHistory.size() < FRAME_HISTORY)
+      return frameHistory;
+    std::vector<float> ordered(frameHistory.begin() + std::ptrdiff_t(frameCursor), frameHistory.end());
+    ordered.insert(ordered.end(), frameHistory.begin(), frameHistory.begin() + std::ptrdiff_t(frameCursor));
+    return ordered;
+  }
+
+  void Profiler::lastFrame(std::vector<ScopeTiming>& scopes, std::vector<CounterValue>& counters) const
+  {
+    scopes.clear();
+    counters.clear();
+    if (lastFrameEnd == 0)
+      return;
+
+    std::vector<std::shared_ptr<ThreadRing>> snapshot;
+    {
+      std::lock_guard<std::mutex> lock(ringMutex);
+      snapshot = rings;
+    }
+
+    std::vector<ProfileEvent> events;
+    for (const auto& ring : snapshot)
+      collect(*ring, lastFrameStart, events);
+
+    for (const ProfileEvent& event : events)
+    {
+      if (event.kind == ProfileEvent::COUNTER)
+      {
+        if (event.start > lastFrameEnd)
+          continue;
+        auto it = std::find_if(counters.begin(), counters.end(), [&](const CounterValue& c) { return std::strcmp(c.name, event.name) == 0; });
+        if (it == counters.end())
+          counters.push_back({ event.name, std::bit_cast<double>(event.end) });
+        else
+          it->value = std::bit_cast<double>(event.end);
+        continue;
+      }
+
+      // scopes that finished inside the frame, clipped to its start
+      if (event.end > lastFrameEnd)
+        continue;
+      const uint64_t start = std::max(event.start, lastFrameStart);
+      auto it = std::find_if(scopes.begin(), scopes.end(), [&](const ScopeTiming& s) { return std::strcmp(s.name, event.name) == 0; });
+      if (it == scopes.end())
+        it = scopes.insert(scopes.end(), { event.name, 0.0, 0, event.depth });
+      it->milliseconds += double(event.end - start) / 1e6;
+      it->calls++;
+      it->depth = std::min(it->depth, event.depth);
+    }
+
+    std::stable_sort(scopes.begin(), scopes.end(), [](const ScopeTiming& a, const ScopeTiming& b) { return a.depth < b.depth; });
+  }
+
+  bool Profiler::writeChromeTrace(const std::filesystem::path& path) const
+  {
+    std::vector<std::shared_ptr<ThreadRing>> snapshot;
+    std::vector<std::string> names;
+    {
+      std::lock_guard<std::mutex> lock(ringMutex);
+      snapshot = rings;
+      for (const auto& ring : rings)
+        names.push_back(ring->name);
+    }
+
+    std::vector<std::vector<ProfileEvent>> events(snapshot.size());
+    uint64_t origin = UINT64_MAX;
+    for (size_t i = 0; i < snapshot.size(); i++)
+    {
+      collect(*snapshot[i], 0, events[i]);
+      for (const ProfileEvent& event : events[i])
+        origin = std::min(origin, event.start);
+    }
+
+    std::error_code error;
+    if (path.has_parent_path())
+      std::filesystem::create_directories(path.parent_path(), error);
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file)
+    {
+      std::fprintf(stderr, "Failed to write trace %s\n", path.string().c_str());
+      return false;
+    }
+
+    // timestamps are microseconds from the oldest event
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t i = 0; i < snapshot.size(); i++)
+    {
+      const uint32_t tid = snapshot[i]->id;
+      std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", tid);
+      writeJsonString(file, names[i].c_str());
+      std::fprintf(file, "}}");
+      first = false;
+
+      for (const ProfileEvent& event : events[i])
+      {
+        std::fprintf(file, ",\n{\"name\":");
+        writeJsonString(file, event.name);
+        const double ts = double(event.start - origin) / 1000.0;
+        if (event.kind == ProfileEvent::COUNTER)
+          std::fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.6g}}", tid, ts, std::bit_cast<double>(event.end));
+        else
+          std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", tid, ts, double(event.end - event.start) / 1000.0);
+      }
+    }
+    std::fprintf(file, "\n]}\n");
+
+    const bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    return ok;
+  }
+
+  size_t Profiler::threadCount() const
+  {
+    std::lock_guard<std::mutex> lock(ringMutex);
+    return rings.size();
+  }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace zm
+{
+  // Nanoseconds on the steady clock, the time base of every event
+  inline uint64_t profilerNow()
+  {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  struct ProfileEvent
+  {
+    enum Kind : uint8_t
+    {
+      SCOPE,
+      COUNTER,
+    };
+
+    const char* name; // string literal, never copied
+    uint64_t start;
+    uint64_t end;     // for counters the value, bit cast from a double
+    uint16_t depth;
+    Kind kind;
+  };
+
+  // Time spent in one scope name during a frame, summed over every thread
+  struct ScopeTiming
+  {
+    const char* name;
+    double milliseconds;
+    uint32_t calls;
+    uint16_t depth; // smallest depth it was seen at, for indenting
+  };
+
+  struct CounterValue
+  {
+    const char* name;
+    double value;
+  };
+
+  // Per-thread event rings. Each thread that records gets its own ring
+  // on first use and is the only writer to it, so recording a scope is two
+  // clock reads and a store with no locks. Old events are overwritten once
+  // a ring is full. Readers copy events out and drop any the writer may
+  // have lapped while they were copying.
+  //
+  // Scopes and counters are recorded from any thread. beginFrame()/endFrame()
+  // and the readers are meant for one thread (the main loop or a bench)
+  class Profiler
+  {
+  public:
+    static constexpr size_t RING_SIZE = 1 << 15;
+    static constexpr size_t FRAME_HISTORY = 240;
+
+    static Profiler& get();
+
+    // Recording costs a branch while disabled
+    void setEnabled(bool enabled) { active.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    // Shows up as the thread name in traces, copied. Threads that exit give
+    // their ring (and its events) to the next new thread
+    void setThreadName(const std::string& name);
+
+    void record(const char* name, uint64_t start, uint64_t end, uint16_t depth);
+    void counter(const char* name, double value);
+
+    // Frame boundaries for the overlay statistics and the frame time graph
+    void beginFrame();
+    void endFrame();
+
+    // Frame times in ms, oldest first
+    std::vector<float> frameTimes() const;
+    // Scopes and the latest counter values of the last finished frame
+    void lastFrame(std::vector<ScopeTiming>& scopes, std::vector<CounterValue>& counters) const;
+
+    // Every event still held in the rings as a Chrome trace
+    // (chrome://tracing, Perfetto). False when the file can't be written
+    bool writeChromeTrace(const std::filesystem::path& path) const;
+
+    size_t threadCount() const;
+
+  private:
+    friend class ProfileScope;
+
+    struct ThreadRing
+    {
+      std::string name;
+      uint32_t id = 0;
+      uint16_t depth = 0;
+      std::atomic<bool> retired{ false }; // its thread exited, free to reuse
+      std::atomic<uint64_t> written{ 0 };
+      std::unique_ptr<ProfileEvent[]> events;
+    };
+
+    Profiler() = default;
+
+    ThreadRing& threadRing();
+    void push(ThreadRing& ring, const ProfileEvent& event);
+    // events of one ring with end >= since (scopes) or start >= since (counters)
+    void collect(const ThreadRing& ring, uint64_t since, std::vector<ProfileEvent>& out) const;
+
+    std::atomic<bool> active{ false };
+
+    mutable std::mutex ringMutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings; // outlive their threads
+
+    uint64_t frameStart = 0;
+    uint64_t lastFrameStart = 0;
+    uint64_t lastFrameEnd = 0;
+    std::vector<float> frameHistory;
+    size_t frameCursor = 0;
+  };
+
+  // Times the enclosing block into the profiler
+  class ProfileScope
+  {
+  public:
+    explicit ProfileScope(const char* name)
+    {
+      Profiler& profiler = Profiler::get();
+      if (!profiler.enabled())
+        return;
+      ring = &profiler.threadRing();
+      this->name = name;
+      depth = ring->depth++;
+      start = profilerNow();
+    }
+
+    ~ProfileScope()
+    {
+      if (!ring)
+        return;
+      const uint64_t end = profilerNow();
+      ring->depth--;
+      Profiler::get().push(*ring, { name, start, end, depth, ProfileEvent::SCOPE });
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+  private:
+    Profiler::ThreadRing* ring = nullptr;
+    const char* name = nullptr;
+    uint64_t start = 0;
+    uint16_t depth = 0;
+  };
+}
+
+#define ZM_PROFILE_CONCAT_(a, b) a##b
+#define ZM_PROFILE_CONCAT(a, b) ZM_PROFILE_CONCAT_(a, b)
+// name must be a string literal (or otherwise outlive the profiler)
+#define ZM_PROFILE_SCOPE(name) ::zm::ProfileScope ZM_PROFILE_CONCAT(zmProfileScope, __LINE__)(name)
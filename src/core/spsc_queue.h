@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace zm
+{
+  // Lock-free ring for exactly one producer thread and one consumer thread.
+  // Neither side ever blocks or allocates after construction, a full queue
+  // refuses the item. Capacity is rounded up to a power of two
+  template <typename T>
+  class SpscQueue
+  {
+  public:
+    explicit SpscQueue(size_t capacity) : slots(roundUp(capacity)), mask(slots.size() - 1) {}
+
+    // Producer only
+    bool tryPush(const T& value)
+    {
+      const size_t tail = writeIndex.load(std::memory_order_relaxed);
+      if (tail - readIndex.load(std::memory_order_acquire) == slots.size())
+        return false;
+      slots[tail & mask] = value;
+      writeIndex.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer only
+    bool tryPop(T& out)
+    {
+      const size_t head = readIndex.load(std::memory_order_relaxed);
+      if (head == writeIndex.load(std::memory_order_acquire))
+        return false;
+      out = slots[head & mask];
+      readIndex.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Either side, a snapshot that may be stale by the time it is used
+    size_t size() const { return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire); }
+    size_t capacity() const { return slots.size(); }
+
+  private:
+    static size_t roundUp(size_t capacity)
+    {
+      size_t size = 1;
+      while (size < capacity)
+        size <<= 1;
+      return size;
+    }
+
+    std::vector<T> slots;
+    size_t mask;
+    // on their own cache lines, producer and consumer each write one
+    alignas(64) std::atomic<size_t> writeIndex{ 0 };
+    alignas(64) std::atomic<size_t> readIndex{ 0 };
+  };
+}
@@ -1,11 +1,12 @@
 #version 330 core
 out vec4 FragColor;
 
-in vec2 TexCoord;
+// xy texture coordinates, z the block texture array layer
+in vec3 TexCoord;
 
-uniform sampler2D ourTexture;
+uniform sampler2DArray ourTexture;
 
 void main()
 {
     FragColor = texture(ourTexture, TexCoord);
-}
\ No newline at end of file
+}
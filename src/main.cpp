@@ -15,57 +15,164 @@
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
 
-// Loading image formats
-#define STB_IMAGE_IMPLEMENTATION //modifies header file so only contains the relevant definition source code
-#include <stb_image.h>
-
 // Loading text-based files
 #include <iostream>
-#include <fstream>
 #include <sstream>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// World
+#include "assets/texture_array_asset.h"
+#include "core/allocators.h"
+#include "core/bench_report.h"
+#include "core/job_system.h"
+#include "core/paths.h"
+#include "core/profiler.h"
+#include "render/camera.h"
+#include "render/camera_path.h"
+#include "render/chunk_renderer.h"
+#include "render/culling.h"
+#include "render/gpu_profiler.h"
+#include "render/profiler_overlay.h"
+#include "render/shader_cache.h"
+#include "render/texture_array.h"
+#include "render/voxel_renderer.h"
+#include "physics/collision.h"
+#include "physics/raycast.h"
+#include "sim/simulation.h"
+#include "world/chunk_builder.h"
+#include "world/chunk_streamer.h"
+#include "world/lod_terrain.h"
+#include "world/world_editor.h"
+#include "world/world_save.h"
+
 //Global variables - change this later
 float lastX = 400, lastY = 300;
-float yaw = -90.0f;
-float pitch = 0.0f;
 bool firstMouse = true;
-float fov = 45.0f;
 bool altKeyPressed = false;
-
-void onStart()
+// the input callbacks feed it, set while the main loop runs
+zm::Simulation* simulation = nullptr;
+
+// Finished chunk meshes uploaded per frame, caps the upload cost of a frame
+const size_t MESH_UPLOADS_PER_FRAME = 8;
+// Dirty chunks are written out in batches every few seconds, bounded so one
+// flush never snapshots the whole world in a single frame
+const float SAVE_FLUSH_INTERVAL = 2.0f;
+const size_t SAVE_FLUSH_MAX_CHUNKS = 512;
+// K digs a sphere around the block under the crosshair, L puts a lamp in
+// front of it
+const float PICK_DISTANCE = 8.0f;
+const int DIG_RADIUS = 3;
+// blocks around the player copied for the simulation to collide with each
+// frame, far more than a tick can move
+const int PLAYER_SOLIDS_RADIUS = 4;
+// F4 switches between chunk meshes and ray marching the voxel 64-tree.
+// Bricks are rebuilt a few per frame as chunks arrive or change
+const uint32_t VOXEL_NODE_CAPACITY = 1u << 23;
+const size_t VOXEL_BRICKS_PER_FRAME = 8;
+const float VOXEL_VIEW_DISTANCE = 2048.0f;
+// blocks and light of every chunk in memory, chunks further than the
+// streaming radius are dropped once merged into coarser LOD nodes
+const size_t STREAMING_BUDGET = 256u << 20;
+// bench frames step the camera path by a fixed 60 Hz, so every run renders
+// the same camera positions however fast the machine is
+const float BENCH_FRAME_SECONDS = 1.0f / 60.0f;
+
+// Command line, see printUsage
+struct LaunchOptions
 {
-  
+  bool headless = false;   // no window or display, GLFW's null platform with an EGL or OSMesa context
+  bool bench = false;      // replay a camera path and write frame statistics as JSON
+  bool voxels = false;     // start in the ray marched voxel mode
+  uint32_t seed = zm::TerrainSettings{}.seed;
+  int frames = 0;          // 0 plays the whole camera path
+  std::string cameraPath;  // empty orbits the spawn
+  std::string output = "-";
+};
+
+void printUsage()
+{
+  std::cout << "usage: zim-engine [--headless] [--bench] [--voxels] [--seed N] [--frames N] [--path camera_path.txt] [--out report.json]\n"
+            << "  --headless  render without a window, through EGL (Mesa llvmpipe works) or OSMesa\n"
+            << "  --bench     fly a camera path over a fresh world (nothing is loaded or saved) and\n"
+            << "              report frame time percentiles, meshing throughput and draw calls as JSON\n"
+            << "  --voxels    ray march the voxel 64-tree instead of drawing chunk meshes (F4)\n"
+            << "  --seed N    terrain seed, default " << zm::TerrainSettings{}.seed << "\n"
+            << "  --frames N  frames to run, default the length of the camera path at 60 fps\n"
+            << "  --path F    camera path recorded with F9, default an orbit around the spawn\n"
+            << "  --out F     where the JSON goes, default stdout" << std::endl;
 }
 
-int LoadShader(const std::string shaderFilePath, GLenum shaderType)
+bool parseOptions(int argc, char** argv, LaunchOptions& options)
 {
-  std::ifstream shaderFile(shaderFilePath);
-  if (!shaderFile.is_open()) {
-      std::cerr << "Failed to open shader file: " << shaderFilePath << std::endl;
-      return -1;
+  for (int i = 1; i < argc; i++)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--headless") == 0)
+      options.headless = true;
+    else if (std::strcmp(argv[i], "--bench") == 0)
+      options.bench = true;
+    else if (std::strcmp(argv[i], "--voxels") == 0)
+      options.voxels = true;
+    else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+      options.seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+    else if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+      options.frames = std::atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "--path") == 0 && hasValue)
+      options.cameraPath = argv[++i];
+    else if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+      options.output = argv[++i];
+    else
+    {
+      std::cout << "Unknown argument " << argv[i] << std::endl;
+      return false;
+    }
   }
+  return true;
+}
 
-  std::stringstream shaderStream;
-  shaderStream << shaderFile.rdbuf(); // Read file contents
-  std::string shaderCode = shaderStream.str();
-  const char* shaderSource = shaderCode.c_str();
-
-  // Create and compile the shader
-  unsigned int shaderID = glCreateShader(shaderType);
-  glShaderSource(shaderID, 1, &shaderSource, nullptr);
-  glCompileShader(shaderID);
-
-  // Check for compilation errors
-  int success;
-  char infoLog[512];
-  glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
-  if (!success) {
-      glGetShaderInfoLog(shaderID, 512, nullptr, infoLog);
-      std::cerr << "Shader compilation error (" << shaderFilePath << "):\n" << infoLog << std::endl;
-      return -1;
-  }
+// player state the bench camera has at time seconds into the path
+zm::PlayerState playerOnPath(const zm::CameraPath& path, float time)
+{
+  const zm::CameraKeyframe key = path.sample(time);
+  zm::PlayerState player;
+  player.position = key.position;
+  player.yaw = key.yaw;
+  player.pitch = key.pitch;
+  return player;
+}
 
-  return shaderID;
+// Uniform locations of the cube program, fetched again only when the
+// shader cache has hot reloaded it
+struct CubeUniforms
+{
+  uint32_t revision = 0;
+  int transform = -1;
+  int textureLayer = -1;
+};
+
+void updateCubeUniforms(const zm::ShaderProgram& program, CubeUniforms& uniforms)
+{
+  if (uniforms.revision == program.revision())
+    return;
+
+  uniforms.revision = program.revision();
+  uniforms.transform = program.uniform("transform");
+  uniforms.textureLayer = program.uniform("textureLayer");
+}
+
+// Texture array layer the spinning cubes use, the jpeg they always had
+const float CUBE_TEXTURE_LAYER = 2.0f;
+
+void onStart()
+{
+  
 }
 
 // Debug message function for when something goes wrong
@@ -130,53 +237,19 @@ void GLAPIENTRY DebugMessageCallback(
     std::cout << "OpenGL Message:" << type << debugMessageStream.str() << std::endl;
 }
 
-void renderTriangle(float rot, unsigned int shaderProgram, unsigned int VAO, unsigned int texture, glm::vec3 cubePositions[], glm::vec3 cameraPos, glm::vec3 cameraUp, glm::vec3* cameraFront)
+void renderTriangle(float rot, const zm::ShaderProgram& shaderProgram, CubeUniforms& uniforms, unsigned int VAO, unsigned int texture, glm::vec3 cubePositions[], const glm::mat4& view, const glm::mat4& projection)
 {
-  //recalculate camera direction
-  glm::vec3 direction;
-  direction.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-  direction.y = sin(glm::radians(pitch));
-  direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-  *cameraFront = glm::normalize(direction);
-
   // 2. use our shader program when we want to render an object
-  glUseProgram(shaderProgram);
-
-  glm::mat4 vec = glm::mat4(1.0f);
-  //vec = glm::translate(vec, glm::vec3(1.0f, 1.0f, 0.0f));
-  //vec = glm::rotate(vec, glm::radians(rot), glm::vec3(0.0f, 0.0f, 1.0f));
-  //vec = glm::rotate(vec, (float)glfwGetTime(), glm::vec3(0.0f, 1.0f, 0.0f));
-  //vec = glm::scale(vec, glm::vec3(0.5, 0.5, 0.5));  
-  unsigned int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-  glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(vec));
-
-  // the model matrix to render our first 3D object
-  glm::mat4 model = glm::mat4(1.0f);
-  //model = glm::rotate(model, glm::radians(-55.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-  model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));  
-  int modelLoc = glGetUniformLocation(shaderProgram, "model");
-  glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-  const float radius = 10.0f;
-  //float camX = sin(glfwGetTime()) * radius;
-  //float camZ = cos(glfwGetTime()) * radius;
-  glm::mat4 view;
-  view = glm::lookAt(cameraPos, cameraPos + *cameraFront, cameraUp);
-
-  // glm::mat4 view = glm::mat4(1.0f);
-  // note that we're translating the scene in the reverse direction of where we want to move
-  // view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f)); 
-  int viewLoc = glGetUniformLocation(shaderProgram, "view");
-  glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-  glm::mat4 projection;
-  //projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
-  projection = glm::perspective(glm::radians(fov), 800.0f / 600.0f, 0.1f, 100.0f);  // makes it so you're moving forward according to camera fov
-  int projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-  glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+  updateCubeUniforms(shaderProgram, uniforms);
+  glUseProgram(shaderProgram.id());
+
+  // view and projection come from the frame's zm::Camera, multiplied once
+  // here and with each cube's model matrix below
+  const glm::mat4 viewProjection = projection * view;
+  glUniform1f(uniforms.textureLayer, CUBE_TEXTURE_LAYER);
 
   // 2.5 bind texture before drawing
-  glBindTexture(GL_TEXTURE_2D, texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
   // 3. bind the VAO we're going to use to switch between different vertex arrays easy
   glBindVertexArray(VAO);
   // 4. now draw the object 
@@ -187,8 +260,8 @@ void renderTriangle(float rot, unsigned int shaderProgram, unsigned int VAO, uns
     model = glm::translate(model, cubePositions[i]);
     float angle = 20.0f * i; 
     model = glm::rotate(model, glm::radians(angle) + (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(1.0f, 0.3f, 0.5f));
-    int modelLoc = glGetUniformLocation(shaderProgram, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    const glm::mat4 transform = viewProjection * model;
+    glUniformMatrix4fv(uniforms.transform, 1, GL_FALSE, glm::value_ptr(transform));
 
     glDrawArrays(GL_TRIANGLES, 0, 36);
   }
@@ -197,9 +270,9 @@ void renderTriangle(float rot, unsigned int shaderProgram, unsigned int VAO, uns
   glBindVertexArray(0);
 }
 
-void processInput(GLFWwindow *window, glm::vec3* cameraPos, glm::vec3 cameraUp, glm::vec3 cameraFront, float deltaTime)
+// movement keys go to the simulation through key_callback
+void processInput(GLFWwindow *window)
 {
-  const float cameraSpeed = 2.5f * deltaTime; // adjust accordingly
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
       glfwSetWindowShouldClose(window, true);
   if (glfwGetKey(window, GLFW_KEY_LEFT_ALT) == GLFW_PRESS) {
@@ -208,14 +281,24 @@ void processInput(GLFWwindow *window, glm::vec3* cameraPos, glm::vec3 cameraUp,
   if (glfwGetKey(window, GLFW_KEY_LEFT_ALT) == GLFW_RELEASE) {
       glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
       altKeyPressed = false; }
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-      *cameraPos += cameraSpeed * cameraFront;
-  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-      *cameraPos -= cameraSpeed * cameraFront;
-  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-      *cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
-  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-      *cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
+}
+
+void key_callback([[maybe_unused]] GLFWwindow* window, int key, [[maybe_unused]] int scancode, int action, [[maybe_unused]] int mods)
+{
+  if (!simulation || action == GLFW_REPEAT)
+    return;
+
+  zm::InputEvent event;
+  event.type = action == GLFW_PRESS ? zm::InputType::Press : zm::InputType::Release;
+  switch (key)
+  {
+  case GLFW_KEY_W: event.action = zm::INPUT_FORWARD; break;
+  case GLFW_KEY_S: event.action = zm::INPUT_BACK; break;
+  case GLFW_KEY_A: event.action = zm::INPUT_LEFT; break;
+  case GLFW_KEY_D: event.action = zm::INPUT_RIGHT; break;
+  default: return;
+  }
+  simulation->pushInput(event);
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -238,30 +321,69 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
   xoffset *= sensitivity;
   yoffset *= sensitivity;
 
-  yaw += xoffset;
-  pitch += yoffset;
+  if (simulation)
+    simulation->pushInput({ zm::InputType::Look, zm::INPUT_FORWARD, xoffset, yoffset });
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    fov -= (float)yoffset;
-    if (fov < 1.0f)
-        fov = 1.0f;
-    if (fov > 45.0f)
-        fov = 45.0f; 
+    if (simulation)
+        simulation->pushInput({ zm::InputType::Zoom, zm::INPUT_FORWARD, -(float)yoffset, 0.0f });
+}
+
+void error_callback(int error, const char* description)
+{
+  std::cout << "GLFW error " << error << ": " << description << std::endl;
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
+  LaunchOptions options;
+  if (!parseOptions(argc, argv, options))
+  {
+    printUsage();
+    return -1;
+  }
+
+  zm::CameraPath benchPath;
+  if (options.bench && !options.cameraPath.empty() && !benchPath.load(options.cameraPath))
+  {
+    std::cout << "Failed to load camera path " << options.cameraPath << std::endl;
+    return -1;
+  }
+
   GLFWwindow* window;
 
+  glfwSetErrorCallback(error_callback);
+  // the null platform needs no display, it is always built into GLFW
+  if (options.headless)
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
   if (!glfwInit())
   {
     return -1;
   }
 
-  window = glfwCreateWindow(1280, 820, "zim-engine", nullptr, nullptr);
+  // the chunk renderer needs persistent buffers, multi-draw indirect and
+  // ARB_shader_draw_parameters, 4.5 core so llvmpipe can run it too
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  if (options.headless)
+  {
+    // EGL gives Mesa's surfaceless platform, OSMesa is the fallback on
+    // machines without libEGL
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    window = glfwCreateWindow(1280, 820, "zim-engine", nullptr, nullptr);
+    if (!window)
+    {
+      glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+      window = glfwCreateWindow(1280, 820, "zim-engine", nullptr, nullptr);
+    }
+  }
+  else
+    window = glfwCreateWindow(1280, 820, "zim-engine", nullptr, nullptr);
 
   if (!window)
   {
@@ -270,21 +392,26 @@ int main()
   }
 
   glfwMakeContextCurrent(window);
+  // bench frames run as fast as they can
+  if (options.bench)
+    glfwSwapInterval(0);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // locks cursor to center of screen
   glfwSetCursorPosCallback(window, mouse_callback);
   glfwSetScrollCallback(window, scroll_callback);
+  glfwSetKeyCallback(window, key_callback);
 
   if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress))
   {
     std::cout << "Failed to initialize GLAD! " << "from zim engine" << std::endl;
 
   }
+  const std::string glRenderer = (const char*)glGetString(GL_RENDERER);
+  const std::string glVersion = (const char*)glGetString(GL_VERSION);
+  std::cout << "OpenGL " << glVersion << ", " << glRenderer << std::endl;
 
 
   float red = 0;
   float delta = 0.01;
-  float deltaTime = 0.0f;	// Time between current frame and last frame
-  float lastFrame = 0.0f; // Time of last frame
 
 
   // setup imgui
@@ -294,6 +421,13 @@ int main()
   ImGui_ImplOpenGL3_Init("#version 150");
   ImGui::StyleColorsDark();
 
+  // CPU scopes from every thread plus GPU pass timings, shown in the
+  // profiler window (F3) and written out as Chrome traces from there
+  zm::Profiler& profiler = zm::Profiler::get();
+  profiler.setThreadName("main");
+  profiler.setEnabled(true);
+  auto gpuProfiler = std::make_unique<zm::GpuProfiler>();
+
   // Initialize all the variables
   // float vertices[] = {
   //   -0.5f, -0.75f, 0.0f, 0.0f, 0.0f,  // lower-left corner  
@@ -365,7 +499,7 @@ int main()
     glm::vec3(-1.3f,  1.0f, -1.5f)  
   };
 
-  // camera position
+  // camera position, moved above the terrain once the world is set up
   glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);  
   glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
   glm::vec3 cameraDirection = glm::normalize(cameraPos - cameraTarget);
@@ -374,18 +508,6 @@ int main()
   glm::vec3 cameraUp = glm::cross(cameraDirection, cameraRight);
   glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 
-  // glm::vec3 front;
-  // front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-  // front.y = sin(glm::radians(pitch));
-  // front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-  // cameraFront = glm::normalize(front);
-
-  glm::vec3 direction;
-  direction.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-  direction.y = sin(glm::radians(pitch));
-  direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-  cameraFront = glm::normalize(direction);
-
 
   // Run the initialize buffer functions
   unsigned int VAO;
@@ -402,20 +524,17 @@ int main()
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);  
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-  // Load shaders
-  int vertexShader = LoadShader("C:/Users/azrom/Documents/GitHub/newvoxelengine/src/vertex_shader.glsl", GL_VERTEX_SHADER);
-  int fragmentShader = LoadShader("C:/Users/azrom/Documents/GitHub/newvoxelengine/src/fragment_shader1.glsl", GL_FRAGMENT_SHADER);
-
-  // Create shaderProgram
-  unsigned int shaderProgram;
-  shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-  glLinkProgram(shaderProgram);
+  // Shaders live in src/ of the asset root, found relative to the
+  // executable. Edits are picked up while running, linked programs are
+  // cached as binaries for the next start
+  const std::filesystem::path assetRoot = zm::findAssetRoot();
+  auto shaders = std::make_unique<zm::ShaderCache>(assetRoot / "src", assetRoot / "build" / "cache" / "shaders");
+  const zm::ShaderProgram& shaderProgram = shaders->load("vertex_shader.glsl", "fragment_shader1.glsl");
+  CubeUniforms cubeUniforms;
 
-  // Delete shaders
-  glDeleteShader(vertexShader);
-  glDeleteShader(fragmentShader);
+  // Chunk shader program, same fragment shader as the cubes
+  const zm::ShaderProgram& chunkProgram = shaders->load("chunk_vertex_shader.glsl", "chunk_fragment_shader.glsl");
+  const zm::ShaderProgram& voxelProgram = shaders->load("voxel_vertex_shader.glsl", "voxel_fragment_shader.glsl");
 
   // Set format for vertexes
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
@@ -425,48 +544,156 @@ int main()
   glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
   glEnableVertexAttribArray(1);
 
-  // Set texture parameters
-  unsigned int texture;
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-  // Load texture
-  int width, height, nrChannels;
-  stbi_set_flip_vertically_on_load(true);  
-  unsigned char *data = stbi_load("C:\\Users\\azrom\\Documents\\GitHub\\newvoxelengine\\textures\\GimdAa9bYAIVQBa.jpg", &width, &height, &nrChannels, 0);
-  if (data) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-  } else {
-      std::cout << "Failed to load texture" << std::endl;
-  }
-  stbi_image_free(data);
+  // Block textures: every image in textures/ packed into one texture array.
+  // The first run decodes and builds the mips, later runs map the cache
+  zm::TextureArrayAsset blockTextures;
+  float textureStart = (float)glfwGetTime();
+  if (!blockTextures.load(assetRoot / "textures", assetRoot / "build" / "cache" / "block_textures.zta"))
+    std::cout << "Failed to load textures from " << (assetRoot / "textures").string() << std::endl;
+  unsigned int texture = zm::createTextureArray(blockTextures);
+  std::cout << "Block textures: " << blockTextures.layerCount() << " layers, " << blockTextures.layerSize() << "px, "
+            << (blockTextures.loadedFromCache() ? "cached" : "rebuilt") << ", " << ((float)glfwGetTime() - textureStart) * 1000.0f << " ms" << std::endl;
 
   glDebugMessageCallback(DebugMessageCallback, nullptr);
   glEnable(GL_DEBUG_OUTPUT);
   glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
   glEnable(GL_DEPTH_TEST); // this makes it so tris have proper z-depth rendering
   
+  // World: terrain generation and meshing run on the job system, the loop
+  // below only uploads a few finished meshes per frame
+  zm::JobSystem jobs;
+  zm::ChunkStorage world;
+  zm::TerrainSettings terrainSettings;
+  terrainSettings.seed = options.seed;
+  zm::TerrainGenerator generator(terrainSettings);
+  // saved chunks load instead of generating, generated ones are written
+  // back in batches from the loop below. Bench runs always generate
+  std::unique_ptr<zm::WorldSave> worldSave;
+  if (!options.bench)
+    worldSave = std::make_unique<zm::WorldSave>(assetRoot / "saves" / "world");
+  // full detail near the camera, 2x/4x/8x merged chunks in rings further out
+  zm::LodSettings lodSettings;
+  // sunlight enters from above the highest chunk row the terrain uses
+  zm::LightStorage light(lodSettings.maxChunkY);
+  zm::ChunkBuilder chunkBuilder(jobs, world, generator, worldSave.get(), 256, &light);
+  zm::LodTerrain lodTerrain(jobs, world, chunkBuilder, lodSettings);
+  // full detail chunks stay loaded a little past the 1x ring, everything
+  // else only lives until it has been merged
+  zm::StreamingSettings streamingSettings;
+  streamingSettings.loadRadius = lodSettings.ringRadius[0] + 3.0f;
+  streamingSettings.unloadRadius = streamingSettings.loadRadius + 2.0f;
+  streamingSettings.memoryBudget = STREAMING_BUDGET;
+  streamingSettings.minChunkY = lodSettings.minChunkY;
+  streamingSettings.maxChunkY = lodSettings.maxChunkY;
+  zm::ChunkStreamer streamer(world, &light, chunkBuilder, streamingSettings);
+  // K digs, L places a lamp, applied once per frame before meshes are requested
+  zm::WorldEditor editor(world, light, chunkBuilder, worldSave.get());
+  std::vector<zm::DirtyRegion> dirtyRegions;
+  bool digKeyWasDown = false;
+  bool lampKeyWasDown = false;
+  float lastSaveFlush = (float)glfwGetTime();
+  // owns GL objects, released before the context goes away
+  auto chunkRenderer = std::make_unique<zm::ChunkRenderer>(chunkProgram);
+  // the same world as a 64-tree for the ray marched mode, only kept up to
+  // date while that mode is on
+  zm::VoxelTree voxelTree(VOXEL_NODE_CAPACITY);
+  auto voxelRenderer = std::make_unique<zm::VoxelRenderer>(voxelProgram, VOXEL_NODE_CAPACITY);
+  bool voxelMode = options.voxels;
+  bool voxelTreeCurrent = false;
+  bool voxelKeyWasDown = false;
+  const std::vector<zm::LodKey> noNodes;
+  std::vector<zm::BuiltLodMesh> builtMeshes;
+  std::vector<zm::LodKey> lodNodes;
+  std::vector<zm::LodKey> unusedNodes;
+  cameraPos.y = (float)generator.heightAt(0, 3) + 8.0f;
+
+  // the player moves at a fixed tick rate on its own thread, frames blend
+  // its last two states
+  zm::PlayerState startPlayer;
+  startPlayer.position = cameraPos;
+  zm::Simulation sim(startPlayer);
+  simulation = &sim;
+  // bench runs follow the camera path instead
+  if (!options.bench)
+    sim.start();
+
+  // the dive below the surface exercises occlusion culling
+  if (options.bench && benchPath.empty())
+    benchPath = zm::CameraPath::orbit(glm::vec3(0.0f, cameraPos.y, 0.0f), 96.0f, cameraPos.y - 24.0f, cameraPos.y + 40.0f, 20.0f, 64);
+  const int benchFrames = options.frames > 0 ? options.frames : (int)(benchPath.duration() / BENCH_FRAME_SECONDS) + 1;
+  zm::BenchReport benchReport;
+  int benchFrame = 0;
+  double benchStart = glfwGetTime();
+  double lastFrameEnd = benchStart;
+  std::vector<zm::ScopeTiming> frameScopes;
+  std::vector<zm::CounterValue> frameCounters;
+
+  zm::ProfilerOverlay profilerOverlay(assetRoot / "build" / "traces");
+  bool overlayKeyWasDown = false;
+
+  zm::Camera camera;
+  // the coarsest ring ends at the far plane
+  camera.farPlane = lodSettings.viewDistance();
+  zm::ChunkCuller culler;
+  std::vector<zm::ChunkCoord> visibleChunks;
+  std::vector<zm::LodKey> visibleNodes;
+  bool occlusionCulling = true;
+
+  // F9 records the camera into camera_path.txt, replayed by zim-bench culling
+  zm::CameraPath recordedPath;
+  bool recordingPath = false;
+  bool recordKeyWasDown = false;
+  float recordStart = 0.0f;
+
   float rotation = 0.0f;
-  while (!glfwWindowShouldClose(window))
+  while (!glfwWindowShouldClose(window) && !(options.bench && benchFrame >= benchFrames))
   {
+    profiler.beginFrame();
+    gpuProfiler->beginFrame();
 
-    // Camera fixing
-    if(pitch > 89.0f)
-      pitch =  89.0f;
-    if(pitch < -89.0f)
-      pitch = -89.0f;
-
-    // Input
     float currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
+    processInput(window);
+    const zm::PlayerState player = options.bench ? playerOnPath(benchPath, (float)benchFrame * BENCH_FRAME_SECONDS) : sim.interpolated();
+    cameraPos = player.position;
+
+    // build this frame's camera once, everything below uses its matrices
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    if (framebufferHeight > 0)
+      camera.aspect = (float)framebufferWidth / (float)framebufferHeight;
+    camera.fov = player.fov;
+    camera.up = cameraUp;
+    camera.setRotation(player.yaw, player.pitch);
+    cameraFront = camera.front;
+    camera.position = cameraPos;
+    glm::mat4 view = camera.view();
+    glm::mat4 projection = camera.projection();
+
+    bool recordKeyDown = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if (recordKeyDown && !recordKeyWasDown)
+    {
+      recordingPath = !recordingPath;
+      if (recordingPath)
+      {
+        recordedPath.clear();
+        recordStart = currentFrame;
+      }
+      else if (recordedPath.save("camera_path.txt"))
+        std::cout << "Saved camera path (" << recordedPath.keyframes().size() << " keyframes) to camera_path.txt" << std::endl;
+    }
+    recordKeyWasDown = recordKeyDown;
+    if (recordingPath)
+      recordedPath.addKeyframe({ currentFrame - recordStart, cameraPos, player.yaw, player.pitch });
+
+    bool overlayKeyDown = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (overlayKeyDown && !overlayKeyWasDown)
+      profilerOverlay.visible = !profilerOverlay.visible;
+    overlayKeyWasDown = overlayKeyDown;
 
-    processInput(window, &cameraPos, cameraUp, cameraFront, deltaTime);
+    bool voxelKeyDown = glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS;
+    if (voxelKeyDown && !voxelKeyWasDown)
+      voxelMode = !voxelMode;
+    voxelKeyWasDown = voxelKeyDown;
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -479,30 +706,294 @@ int main()
       
     glClearColor(red, 0.0, 0.0, 1.0);
 
-    renderTriangle(rotation, shaderProgram, VAO, texture, cubePositions, cameraPos, cameraUp, &cameraFront);
+    bool digKeyDown = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+    bool lampKeyDown = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+    // blocks still generating don't stop the ray
+    zm::RayHit pick;
+    const bool picked = zm::raycastVoxels(cameraPos, cameraFront, PICK_DISTANCE, [&](int x, int y, int z) {
+      return chunkBuilder.isReady(zm::worldToChunk(x, y, z)) && zm::isOpaque(world.getBlock(x, y, z));
+    }, pick);
+    const glm::ivec3 target = pick.block;
+    if (picked && digKeyDown && !digKeyWasDown)
+      for (int z = -DIG_RADIUS; z <= DIG_RADIUS; z++)
+        for (int y = -DIG_RADIUS; y <= DIG_RADIUS; y++)
+          for (int x = -DIG_RADIUS; x <= DIG_RADIUS; x++)
+            if (x * x + y * y + z * z <= DIG_RADIUS * DIG_RADIUS)
+              editor.breakBlock(target.x + x, target.y + y, target.z + z);
+    if (picked && lampKeyDown && !lampKeyWasDown)
+      editor.setBlock(pick.previous.x, pick.previous.y, pick.previous.z, zm::BLOCK_LAMP);
+    digKeyWasDown = digKeyDown;
+    lampKeyWasDown = lampKeyDown;
+    {
+      ZM_PROFILE_SCOPE("edits");
+      editor.apply(dirtyRegions);
+      for (const zm::DirtyRegion& region : dirtyRegions)
+      {
+        lodTerrain.remesh(region.coord);
+        streamer.touch(region.coord);
+        if (voxelMode)
+          voxelTree.markChunk(region.coord);
+      }
+    }
+    {
+      ZM_PROFILE_SCOPE("capture solids");
+      auto solids = std::make_shared<zm::SolidGrid>();
+      solids->capture(world, glm::ivec3(glm::floor(cameraPos)), PLAYER_SOLIDS_RADIUS,
+                      [&](zm::ChunkCoord coord) { return chunkBuilder.isReady(coord); });
+      sim.setSolids(std::move(solids));
+    }
+
+    // pick the LOD nodes around the camera and queue what they need, then
+    // upload a bounded batch
+    {
+      ZM_PROFILE_SCOPE("request chunks");
+      streamer.update(cameraPos, cameraFront);
+      lodTerrain.update(cameraPos, streamer.chunkAllowance());
+    }
+
+    shaders->reloadChanged();
+    {
+      ZM_PROFILE_SCOPE("wait frame fence");
+      chunkRenderer->beginFrame();
+    }
+    size_t facesUploaded = 0, bytesUploaded = 0;
+    {
+      ZM_PROFILE_SCOPE("upload meshes");
+      builtMeshes.clear();
+      lodTerrain.drainMeshes(builtMeshes, MESH_UPLOADS_PER_FRAME);
+      for (const zm::BuiltLodMesh& built : builtMeshes)
+      {
+        // empty chunks still go to the culler, the occlusion search walks through them
+        if (built.key.level == 0)
+          culler.setChunk(built.key.origin(), built.mesh.faceConnectivity, !built.mesh.empty());
+        if (!chunkRenderer->upload(built.key, built.mesh))
+          std::cout << "Chunk face buffer is full, chunk not uploaded" << std::endl;
+        facesUploaded += built.mesh.quadCount();
+        bytesUploaded += built.mesh.byteSize();
+
+        // a mesh means its chunks are done generating, the voxel tree can have them
+        if (voxelMode)
+        {
+          const zm::ChunkCoord origin = built.key.origin();
+          const int span = built.key.span();
+          for (int y = 0; y < span; y++)
+            for (int z = 0; z < span; z++)
+              for (int x = 0; x < span; x++)
+                voxelTree.markChunk({ origin.x + x, origin.y + y, origin.z + z });
+        }
+      }
+
+      // meshes replaced by another level are dropped once nothing stands in with them
+      lodTerrain.drawNodes(lodNodes);
+      unusedNodes.clear();
+      lodTerrain.collectUnused(unusedNodes);
+      for (const zm::LodKey& key : unusedNodes)
+      {
+        chunkRenderer->remove(key);
+        if (key.level == 0)
+          culler.removeChunk(key.origin());
+      }
+    }
+
+    if (voxelMode)
+    {
+      ZM_PROFILE_SCOPE("voxel tree");
+      // switching the mode on picks up everything that changed while it was off
+      if (!voxelTreeCurrent)
+        world.forEachChunk([&](zm::ChunkCoord coord, zm::Chunk&) { voxelTree.markChunk(coord); });
+      voxelTreeCurrent = true;
+      voxelTree.update(world, [&](zm::ChunkCoord coord) { return chunkBuilder.isReady(coord); }, VOXEL_BRICKS_PER_FRAME);
+      voxelRenderer->upload(voxelTree);
+    }
+    else
+      voxelTreeCurrent = false;
+
+    if (worldSave && (float)glfwGetTime() - lastSaveFlush > SAVE_FLUSH_INTERVAL)
+    {
+      worldSave->flush(world, SAVE_FLUSH_MAX_CHUNKS);
+      lastSaveFlush = (float)glfwGetTime();
+    }
+
+    {
+      ZM_PROFILE_SCOPE("cull");
+      culler.setOcclusionEnabled(occlusionCulling);
+      culler.cull(projection * view, cameraPos, visibleChunks);
+
+      // full detail chunks get occlusion culled, coarser nodes only frustum culled
+      visibleNodes.clear();
+      for (const zm::ChunkCoord& coord : visibleChunks)
+        if (lodTerrain.isDrawn(zm::lodKey(coord)))
+          visibleNodes.push_back(zm::lodKey(coord));
+      const zm::Frustum frustum = zm::Frustum::fromViewProjection(projection * view);
+      for (const zm::LodKey& key : lodNodes)
+      {
+        if (key.level == 0)
+          continue;
+        const zm::ChunkCoord origin = key.origin();
+        const glm::vec3 min = glm::vec3(origin.x, origin.y, origin.z) * (float)zm::CHUNK_SIZE;
+        if (frustum.intersectsBox(min, min + (float)(key.span() * zm::CHUNK_SIZE)))
+          visibleNodes.push_back(key);
+      }
+    }
+
+    {
+      ZM_PROFILE_SCOPE("draw cubes");
+      zm::GpuScope gpuScope(*gpuProfiler, "gpu cubes (ms)");
+      renderTriangle(rotation, shaderProgram, cubeUniforms, VAO, texture, cubePositions, view, projection);
+    }
+    {
+      ZM_PROFILE_SCOPE("draw chunks");
+      zm::GpuScope gpuScope(*gpuProfiler, "gpu chunks (ms)");
+      // still called with nothing to draw, it fences the frame
+      chunkRenderer->draw(voxelMode ? noNodes : visibleNodes, view, projection, texture);
+    }
+    if (voxelMode)
+    {
+      ZM_PROFILE_SCOPE("draw voxels");
+      zm::GpuScope gpuScope(*gpuProfiler, "gpu voxels (ms)");
+      voxelRenderer->draw(voxelTree, view, projection, cameraPos, VOXEL_VIEW_DISTANCE, texture);
+    }
     rotation += 0.01f;
 
+    const zm::ChunkRendererStats renderStats = chunkRenderer->stats();
+    const zm::LodStats lodStats = lodTerrain.stats();
+    profiler.counter("chunks meshed", double(builtMeshes.size()));
+    profiler.counter("faces uploaded", double(facesUploaded));
+    profiler.counter("meshes in flight", double(lodStats.pendingMeshes));
+    profiler.counter("visible chunks", double(visibleNodes.size()));
+    profiler.counter("draw commands", double(renderStats.drawCommands));
+    // renderTriangle draws its 10 cubes one by one, the chunks are one
+    // multi-draw, the voxels one fullscreen triangle
+    const uint32_t drawCalls = 10 + (voxelMode || renderStats.drawCommands > 0 ? 1 : 0);
+    profiler.counter("draw calls", double(drawCalls));
 
     ImGui_ImplGlfw_NewFrame();
     ImGui_ImplOpenGL3_NewFrame();
     ImGui::NewFrame();
 
     {
+      ZM_PROFILE_SCOPE("imgui");
       static uint32_t counter = 0;
       ImGui::Begin("zim-engine");
         ImGui::Text("frame counter: %d", counter);
+        ImGui::Text("chunks meshed: %u, meshes in flight: %zu", renderStats.chunks, lodStats.pendingMeshes);
+        ImGui::Text("lod nodes: %u / %u / %u / %u (1x/2x/4x/8x), %u drawn, %zu merged chunks (%.1f MB)", lodStats.selected[0],
+          lodStats.selected[1], lodStats.selected[2], lodStats.selected[3], lodStats.drawn, lodStats.lodChunks, lodStats.lodChunkBytes / 1048576.0);
+        ImGui::Text("chunk faces: %.1f / %.1f MB, largest free %.1f MB, %u draw commands", renderStats.usedBytes / 1048576.0,
+          renderStats.capacityBytes / 1048576.0, renderStats.largestFreeBytes / 1048576.0, renderStats.drawCommands);
+        const zm::CullStats& cullStats = culler.stats();
+        ImGui::Text("culling: %u tested, %u frustum, %u occlusion, %u drawn", cullStats.tested, cullStats.frustumCulled, cullStats.occlusionCulled, cullStats.drawn);
+        ImGui::Checkbox("occlusion culling", &occlusionCulling);
+        ImGui::Checkbox("ray marched voxels (F4)", &voxelMode);
+        if (voxelMode)
+        {
+          const zm::VoxelTreeStats voxelStats = voxelTree.stats();
+          ImGui::Text("voxel tree: %zu bricks, %zu waiting, %.1f / %.1f MB nodes, %u top nodes, %.1f KB uploaded", voxelStats.bricks,
+            voxelStats.dirtyBricks, voxelStats.usedNodes * sizeof(zm::VoxelNode) / 1048576.0, voxelStats.capacityNodes * sizeof(zm::VoxelNode) / 1048576.0,
+            voxelStats.topNodes, voxelRenderer->lastUploadBytes() / 1024.0);
+        }
+        const zm::StreamingStats streamingStats = streamer.stats();
+        ImGui::Text("streaming: %zu pending, %zu generating, %zu meshing, %zu resident, %.1f + %.1f / %.1f MB, %llu loaded, %llu evicted",
+          streamingStats.pending, streamingStats.generating, streamingStats.meshing, streamingStats.resident, streamingStats.residentBytes / 1048576.0,
+          streamingStats.reservedBytes / 1048576.0, streamingStats.budgetBytes / 1048576.0, (unsigned long long)streamingStats.loaded,
+          (unsigned long long)streamingStats.evicted);
+        const zm::WorldSaveStats saveStats = worldSave ? worldSave->stats() : zm::WorldSaveStats{};
+        ImGui::Text("save: %zu dirty, %llu saved (%.1f KB/chunk), %llu loaded, %zu regions", saveStats.dirtyChunks,
+          (unsigned long long)saveStats.chunksSaved, saveStats.chunksSaved ? saveStats.bytesWritten / 1024.0 / saveStats.chunksSaved : 0.0,
+          (unsigned long long)saveStats.chunksLoaded, saveStats.regionsOpen);
+        const zm::EditStats& editStats = editor.stats();
+        ImGui::Text("edits: %llu applied, %llu coalesced, %llu rejected, %llu light cells, %llu remeshed chunks (K dig, L lamp)",
+          (unsigned long long)editStats.applied, (unsigned long long)editStats.coalesced, (unsigned long long)editStats.rejected,
+          (unsigned long long)editStats.lightCells, (unsigned long long)editStats.dirtyChunks);
+        if (picked)
+          ImGui::Text("looking at %d %d %d (face %d, %.1f blocks)", pick.block.x, pick.block.y, pick.block.z, pick.face, pick.distance);
+        const zm::SimStats simStats = sim.stats();
+        ImGui::Text("simulation: %.0f Hz, %.3f ms/tick (max %.3f), %llu late, %llu skipped, %llu inputs (%llu dropped)", 1.0f / sim.tickSeconds(),
+          simStats.ticks ? simStats.totalTickMs / simStats.ticks : 0.0, simStats.maxTickMs, (unsigned long long)simStats.lateTicks,
+          (unsigned long long)simStats.skippedTicks, (unsigned long long)simStats.inputEvents, (unsigned long long)simStats.droppedInputs);
+        ImGui::Text("shader binaries: %s, %d loaded from cache", shaders->binaryCacheSupported() ? "on" : "unsupported", shaders->binaryCacheHits());
+        const zm::ProcessMemory processMemory = zm::processMemory();
+        ImGui::Text("memory: %.1f MB resident, %.1f MB peak", processMemory.residentBytes / 1048576.0, processMemory.peakResidentBytes / 1048576.0);
+        for (int category = 0; category < zm::MEMORY_CATEGORY_COUNT; category++)
+        {
+          const zm::MemoryStats memory = zm::memoryStats(zm::MemoryCategory(category));
+          ImGui::Text("  %s: %.1f MB live (peak %.1f), %.1f MB reserved (high-water %.1f), %llu allocations, %llu from the heap",
+            zm::memoryCategoryName(zm::MemoryCategory(category)), memory.liveBytes / 1048576.0, memory.peakLiveBytes / 1048576.0,
+            memory.reservedBytes / 1048576.0, memory.highWaterBytes / 1048576.0, (unsigned long long)memory.allocations,
+            (unsigned long long)memory.heapAllocations);
+        }
+        if (recordingPath)
+          ImGui::Text("recording camera path (F9 to stop)");
       ImGui::End();
 
-      ImGui::ShowDemoWindow();
+      profilerOverlay.draw(gpuProfiler.get());
       counter++;
     }
 
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-    
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    {
+      ZM_PROFILE_SCOPE("imgui render");
+      zm::GpuScope gpuScope(*gpuProfiler, "gpu imgui (ms)");
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+
+    {
+      ZM_PROFILE_SCOPE("swap");
+      glfwSwapBuffers(window);
+      glfwPollEvents();
+    }
+    profiler.endFrame();
+
+    if (options.bench)
+    {
+      // the frame isn't over until the GPU has drawn it
+      glFinish();
+      const double frameEnd = glfwGetTime();
+      zm::BenchFrame frame;
+      frame.milliseconds = (frameEnd - lastFrameEnd) * 1000.0;
+      frame.drawCalls = drawCalls;
+      frame.drawCommands = renderStats.drawCommands;
+      frame.visibleNodes = (uint32_t)visibleNodes.size();
+      frame.meshesUploaded = (uint32_t)builtMeshes.size();
+      frame.facesUploaded = facesUploaded;
+      frame.bytesUploaded = bytesUploaded;
+      profiler.lastFrame(frameScopes, frameCounters);
+      for (const zm::ScopeTiming& scope : frameScopes)
+        if (std::strcmp(scope.name, "mesh") == 0 || std::strcmp(scope.name, "mesh lod") == 0)
+          frame.meshingMs += scope.milliseconds;
+      benchReport.addFrame(frame);
+      lastFrameEnd = frameEnd;
+      benchFrame++;
+    }
   }
-  
+
+  sim.stop();
+  simulation = nullptr;
+
+  int exitCode = 0;
+  if (options.bench)
+  {
+    benchReport.setInfo("renderer", glRenderer);
+    benchReport.setInfo("gl_version", glVersion);
+    benchReport.setInfo("headless", options.headless ? 1.0 : 0.0);
+    benchReport.setInfo("seed", (double)options.seed);
+    benchReport.setInfo("render_mode", voxelMode ? "voxels" : "chunks");
+    benchReport.setInfo("camera_path", options.cameraPath.empty() ? "orbit" : options.cameraPath);
+    benchReport.setInfo("peak_rss_mb", zm::processMemory().peakResidentBytes / 1048576.0);
+    if (!benchReport.write(options.output, lastFrameEnd - benchStart))
+      exitCode = 1;
+  }
+
+  // everything generated so far goes to disk, the WorldSave destructor
+  // waits for the writes
+  jobs.waitIdle();
+  if (worldSave)
+    worldSave->flush(world);
+
+  chunkRenderer.reset();
+  voxelRenderer.reset();
+  gpuProfiler.reset();
+  shaders.reset();
   glfwTerminate();
+  return exitCode;
 }
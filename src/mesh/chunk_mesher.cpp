@@ -0,0 +1,309 @@
+#include "mesh/chunk_mesher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace zm
+{
+  namespace
+  {
+    // Padded array strides per axis (x, y, z)
+    constexpr int axisStride[3] = { 1, PADDED_AREA, PADDED_SIZE };
+
+    // every block face as its own quad, the most a chunk can ever need.
+    // Only the part written to is ever touched
+    constexpr size_t MAX_MESH_FACES = size_t(CHUNK_VOLUME) * FACE_COUNT;
+
+    // 4KB to 16MB classes, up to 16MB of each kept around
+    SizeClassPool& stagingPool()
+    {
+      // never destroyed, meshes may still be queued during static destruction
+      static SizeClassPool* pool = new SizeClassPool(4096, 16u << 20, 16u << 20, MEMORY_VERTEX_STAGING);
+      return *pool;
+    }
+
+    bool outsideChunk(int c)
+    {
+      return c < 0 || c >= CHUNK_SIZE;
+    }
+
+    // sunlight in bits 16-19 and block light in 0-3, so the lights of four
+    // cells add up without carrying into each other
+    uint32_t spreadLight(uint8_t light)
+    {
+      return (uint32_t(light & 0xF0) << 12) | (light & 15u);
+    }
+
+    // x * RECIPROCALS[n] >> 8 is x / n for the sums of up to four lights
+    constexpr uint32_t RECIPROCALS[5] = { 0, 256, 128, 86, 64 };
+
+    // Splits along corners 1-3 when they are brighter than 0 and 2, so a
+    // lone dark corner darkens one triangle instead of the whole diagonal
+    bool flipQuad(uint32_t cornerAo, uint32_t cornerLight)
+    {
+      int brightness[4];
+      for (int c = 0; c < 4; c++)
+      {
+        const int light = int(cornerLight >> (8 * c)) & 0xFF;
+        brightness[c] = (int(cornerAo >> (2 * c) & 3) + 1) * (std::max(light >> 4, light & 15) + 1);
+      }
+      return brightness[1] + brightness[3] > brightness[0] + brightness[2];
+    }
+  }
+
+  void* VertexStagingPool::allocate(size_t bytes)
+  {
+    return stagingPool().allocate(bytes);
+  }
+
+  void VertexStagingPool::deallocate(void* faces, size_t bytes)
+  {
+    stagingPool().deallocate(faces, bytes);
+  }
+
+  void ChunkMesher::gatherBlocks(const Chunk& chunk, const Chunk* const neighbours[FACE_COUNT])
+  {
+    std::fill(padded.begin(), padded.end(), BLOCK_AIR);
+
+    chunk.unpack(blocks.data());
+    for (int y = 0; y < CHUNK_SIZE; y++)
+      for (int z = 0; z < CHUNK_SIZE; z++)
+        std::memcpy(&padded[paddedIndex(0, y, z)], &blocks[chunkIndex(0, y, z)], CHUNK_SIZE * sizeof(BlockId));
+
+    // one layer from each face neighbour, edges and corners stay air
+    for (int face = 0; face < FACE_COUNT; face++)
+    {
+      const Chunk* neighbour = neighbours[face];
+      if (!neighbour)
+        continue;
+
+      const int axis = face / 2;
+      const int inside = (face & 1) ? 0 : CHUNK_SIZE - 1;  // layer we read from the neighbour
+      const int outside = (face & 1) ? CHUNK_SIZE : -1;    // where it goes in the padded array
+
+      for (int a = 0; a < CHUNK_SIZE; a++)
+      {
+        for (int b = 0; b < CHUNK_SIZE; b++)
+        {
+          int src[3], dst[3];
+          src[axis] = inside;
+          dst[axis] = outside;
+          src[(axis + 1) % 3] = dst[(axis + 1) % 3] = a;
+          src[(axis + 2) % 3] = dst[(axis + 2) % 3] = b;
+          padded[paddedIndex(dst[0], dst[1], dst[2])] = neighbour->get(src[0], src[1], src[2]);
+        }
+      }
+    }
+
+    for (int i = 0; i < PADDED_VOLUME; i++)
+      paddedOpaque[i] = isOpaque(padded[i]);
+  }
+
+  void ChunkMesher::gatherLight(const MeshLight* light)
+  {
+    // only cells next to a face are ever read: the chunk and one layer of
+    // each face neighbour, and with smooth shading the edges and corners
+    paddedLight.fill(LIGHT_FULL_SKY);
+    if (!light)
+      return;
+
+    if (light->chunk && !(light->chunk->isUniform() && light->chunk->get(0) == LIGHT_FULL_SKY))
+      for (int y = 0; y < CHUNK_SIZE; y++)
+        for (int z = 0; z < CHUNK_SIZE; z++)
+          for (int x = 0; x < CHUNK_SIZE; x++)
+            paddedLight[paddedIndex(x, y, z)] = light->chunk->get(chunkIndex(x, y, z));
+
+    for (int face = 0; face < FACE_COUNT; face++)
+    {
+      const ChunkLight* neighbour = light->neighbours[face];
+      if (!neighbour)
+        continue;
+
+      const int axis = face / 2;
+      const int inside = (face & 1) ? 0 : CHUNK_SIZE - 1;
+      const int outside = (face & 1) ? CHUNK_SIZE : -1;
+      for (int a = 0; a < CHUNK_SIZE; a++)
+        for (int b = 0; b < CHUNK_SIZE; b++)
+        {
+          int src[3], dst[3];
+          src[axis] = inside;
+          dst[axis] = outside;
+          src[(axis + 1) % 3] = dst[(axis + 1) % 3] = a;
+          src[(axis + 2) % 3] = dst[(axis + 2) % 3] = b;
+          paddedLight[paddedIndex(dst[0], dst[1], dst[2])] = neighbour->get(chunkIndex(src[0], src[1], src[2]));
+        }
+    }
+
+    // edges and corners have no chunk to read from, they copy the face layer
+    // next to them so averaging neither leaks sunlight into caves along the
+    // chunk's edges nor darkens them
+    if (!smoothShading)
+      return;
+    for (int y = -1; y <= CHUNK_SIZE; y++)
+      for (int z = -1; z <= CHUNK_SIZE; z++)
+      {
+        const int outside = outsideChunk(y) + outsideChunk(z);
+        if (outside == 0)
+          continue;
+        // with one of y and z outside only the two ends of the row are edges
+        const int step = outside == 2 ? 1 : CHUNK_SIZE + 1;
+        for (int x = -1; x <= CHUNK_SIZE; x += step)
+        {
+          // keeping only the first coordinate outside lands in a face layer
+          int source[3] = { x, y, z };
+          bool kept = false;
+          for (int& c : source)
+            if (outsideChunk(c))
+            {
+              if (kept)
+                c = std::clamp(c, 0, CHUNK_SIZE - 1);
+              kept = true;
+            }
+          paddedLight[paddedIndex(x, y, z)] = paddedLight[paddedIndex(source[0], source[1], source[2])];
+        }
+      }
+  }
+
+  uint64_t ChunkMesher::shadeFace(int front, int strideU, int strideV) const
+  {
+    // the cells around front in the face's plane, going round from -u -v.
+    // Corner c has cell 2c diagonally and cells 2c - 1 and 2c + 1 beside it
+    const int ring[8] = { -strideU - strideV, -strideV, strideU - strideV, strideU, strideU + strideV, strideV, strideV - strideU, -strideU };
+    uint32_t opaque[8], light[8];
+    for (int k = 0; k < 8; k++)
+    {
+      opaque[k] = paddedOpaque[front + ring[k]];
+      light[k] = spreadLight(paddedLight[front + ring[k]]);
+    }
+
+    // no branches: opaque cells drop out of the light sums through masks,
+    // occlusion is 3 minus the closed cells
+    const uint32_t center = spreadLight(paddedLight[front]);
+    uint32_t cornerAo = 0, cornerLight = 0;
+    for (int c = 0; c < 4; c++)
+    {
+      const int before = (2 * c + 7) & 7, after = 2 * c + 1, diagonal = 2 * c;
+      // two closed sides hide the diagonal cell, light doesn't come round them
+      const uint32_t hidden = opaque[diagonal] | (opaque[before] & opaque[after]);
+      cornerAo |= (3 - opaque[before] - opaque[after] - hidden) << (2 * c);
+
+      const uint32_t sum = center + (light[before] & (opaque[before] - 1)) + (light[after] & (opaque[after] - 1)) + (light[diagonal] & (hidden - 1));
+      const uint32_t average = (sum * RECIPROCALS[4 - opaque[before] - opaque[after] - hidden] >> 8) & 0x000F000Fu;
+      cornerLight |= ((average >> 12) | (average & 15)) << (8 * c);
+    }
+    return (uint64_t(cornerAo) << 16) | (uint64_t(cornerLight) << 24);
+  }
+
+  size_t ChunkMesher::meshFace(int face, PackedFace* faces, size_t count)
+  {
+    const int axis = face / 2;
+    const bool positive = face & 1;
+    const int axisU = (axis + 1) % 3;
+    const int axisV = (axis + 2) % 3;
+
+    const int strideD = axisStride[axis];
+    const int strideU = axisStride[axisU];
+    const int strideV = axisStride[axisV];
+    const int normalStep = positive ? strideD : -strideD;
+    const int origin = paddedIndex(0, 0, 0);
+
+    for (int d = 0; d < CHUNK_SIZE; d++)
+    {
+      // 1. mark every visible face in this slice with a key: texture layer
+      // + 1 in bits 0-15, corner occlusion in 16-23 and corner light in
+      // 24-55 (as in PackedFace). Faces merge only when their keys match
+      for (int v = 0; v < CHUNK_SIZE; v++)
+      {
+        int index = origin + d * strideD + v * strideV;
+        uint64_t* row = &mask[v * CHUNK_SIZE];
+        for (int u = 0; u < CHUNK_SIZE; u++, index += strideU)
+        {
+          const BlockId block = padded[index];
+          const int front = index + normalStep;
+          if (block == BLOCK_AIR || block == padded[front] || paddedOpaque[front])
+          {
+            row[u] = 0;
+            continue;
+          }
+          const uint64_t shading =
+            smoothShading ? shadeFace(front, strideU, strideV) : (uint64_t(CORNERS_OPEN) << 16) | (uint64_t(paddedLight[front] * 0x01010101u) << 24);
+          row[u] = (uint64_t(blockInfo(block).textureLayer[face]) + 1) | shading;
+        }
+      }
+
+      // 2. greedily grow rectangles of equal keys, first along u then along v
+      for (int v = 0; v < CHUNK_SIZE; v++)
+      {
+        for (int u = 0; u < CHUNK_SIZE;)
+        {
+          const uint64_t key = mask[v * CHUNK_SIZE + u];
+          if (!key)
+          {
+            u++;
+            continue;
+          }
+
+          int width = 1;
+          while (u + width < CHUNK_SIZE && mask[v * CHUNK_SIZE + u + width] == key)
+            width++;
+
+          int height = 1;
+          for (; v + height < CHUNK_SIZE; height++)
+          {
+            const uint64_t* row = &mask[(v + height) * CHUNK_SIZE + u];
+            bool same = true;
+            for (int k = 0; k < width && same; k++)
+              same = row[k] == key;
+            if (!same)
+              break;
+          }
+
+          for (int h = 0; h < height; h++)
+            std::fill_n(&mask[(v + h) * CHUNK_SIZE + u], width, uint64_t(0));
+
+          // 3. emit the quad from its first corner, the shader winds it
+          int p[3];
+          p[axis] = d + (positive ? 1 : 0);
+          p[axisU] = u;
+          p[axisV] = v;
+          const uint32_t cornerAo = uint32_t(key >> 16) & 0xFF;
+          const uint32_t cornerLight = uint32_t(key >> 24);
+          faces[count++] = packFace(p[0], p[1], p[2], face, width, height, int(key & 0xFFFF) - 1, cornerLight, cornerAo, flipQuad(cornerAo, cornerLight));
+
+          u += width;
+        }
+      }
+    }
+    return count;
+  }
+
+  void ChunkMesher::mesh(const Chunk& chunk, const Chunk* const neighbours[FACE_COUNT], ChunkMesh& out, const MeshLight* light)
+  {
+    out.clear();
+
+    // an all-air chunk has nothing to draw
+    if (chunk.isUniform() && chunk.uniformBlock() == BLOCK_AIR)
+      return;
+
+    gatherBlocks(chunk, neighbours);
+    gatherLight(light);
+    if (chunk.isUniform())
+      out.faceConnectivity = isOpaque(chunk.uniformBlock()) ? FACE_CONNECTIVITY_NONE : FACE_CONNECTIVITY_ALL;
+    else
+      out.faceConnectivity = computeFaceConnectivity(blocks.data());
+
+    scratch.reset();
+    PackedFace* faces = scratch.allocate<PackedFace>(MAX_MESH_FACES);
+    size_t count = 0;
+    for (int face = 0; face < FACE_COUNT; face++)
+      count = meshFace(face, faces, count);
+    out.faces.assign(faces, faces + count);
+  }
+
+  ChunkMesher& ChunkMesher::forThisThread()
+  {
+    thread_local std::unique_ptr<ChunkMesher> mesher = std::make_unique<ChunkMesher>();
+    return *mesher;
+  }
+}
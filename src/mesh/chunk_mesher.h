@@ -0,0 +1,105 @@
+#pragma once
+
+#include "core/allocators.h"
+#include "mesh/face_connectivity.h"
+#include "mesh/packed_face.h"
+#include "world/chunk.h"
+#include "world/light.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace zm
+{
+  constexpr int PADDED_SIZE = CHUNK_SIZE + 2;
+  constexpr int PADDED_AREA = PADDED_SIZE * PADDED_SIZE;
+  constexpr int PADDED_VOLUME = PADDED_AREA * PADDED_SIZE;
+
+  // Index into a chunk with a one block border, x/y/z in -1..32
+  inline int paddedIndex(int x, int y, int z)
+  {
+    return (x + 1) + (z + 1) * PADDED_SIZE + (y + 1) * PADDED_AREA;
+  }
+
+  // Finished meshes wait in queues until the render thread has uploaded them
+  // and come in every size, their face buffers are recycled by size class
+  struct VertexStagingPool
+  {
+    static void* allocate(size_t bytes);
+    static void deallocate(void* faces, size_t bytes);
+  };
+
+  using StagingFaces = std::vector<PackedFace, PoolAllocator<PackedFace, VertexStagingPool>>;
+
+  // One PackedFace per quad, the vertex shader expands them into triangles
+  struct ChunkMesh
+  {
+    StagingFaces faces;
+    // for occlusion culling, worked out while the blocks are unpacked anyway
+    FaceConnectivity faceConnectivity = FACE_CONNECTIVITY_ALL;
+
+    size_t quadCount() const { return faces.size(); }
+    size_t triangleCount() const { return quadCount() * 2; }
+    size_t byteSize() const { return faces.size() * sizeof(PackedFace); }
+    bool empty() const { return faces.empty(); }
+    void clear()
+    {
+      faces.clear();
+      faceConnectivity = FACE_CONNECTIVITY_ALL;
+    }
+  };
+
+  // Light of the chunk being meshed and of its face neighbours (Face order).
+  // nullptr anywhere means full sunlight
+  struct MeshLight
+  {
+    const ChunkLight* chunk = nullptr;
+    const ChunkLight* neighbours[FACE_COUNT] = {};
+  };
+
+  // Greedy mesher: emits only faces between a block and a non-opaque
+  // different neighbour, then merges coplanar faces with the same texture
+  // into the largest rectangles it can. Every corner of a face gets ambient
+  // occlusion from the opaque blocks around it and the light of the open
+  // cells it touches averaged (smooth lighting), and only faces whose
+  // corners all match merge, so a merged quad shades exactly like its
+  // blocks would. Quads are split along the diagonal with the brighter
+  // corners, which keeps occlusion from smearing across the quad. Blocks
+  // past the edges of the chunk's face neighbours count as open, their light
+  // as that of the face layer next to them.
+  // Holds its scratch buffers so one mesher per thread can be reused without
+  // allocating. Faces are collected in an arena and copied out once at their
+  // final size, the arena is reset for every mesh
+  class ChunkMesher
+  {
+  public:
+    // neighbours are in Face order (-X, +X, -Y, +Y, -Z, +Z), nullptr means
+    // air. Without light every face gets full sunlight
+    void mesh(const Chunk& chunk, const Chunk* const neighbours[FACE_COUNT], ChunkMesh& out, const MeshLight* light = nullptr);
+
+    // Off lights every corner of a face with the block in front of it and
+    // leaves out occlusion, the way faces were shaded before
+    void setSmoothShading(bool enabled) { smoothShading = enabled; }
+
+    // Meshers carry ~230KB of scratch space, jobs share one per worker thread
+    static ChunkMesher& forThisThread();
+
+  private:
+    void gatherBlocks(const Chunk& chunk, const Chunk* const neighbours[FACE_COUNT]);
+    void gatherLight(const MeshLight* light);
+    // corner occlusion and light of a face whose open cell in front is
+    // front, as mask key bits 16-55 (see meshFace)
+    uint64_t shadeFace(int front, int strideU, int strideV) const;
+    // appends face's quads at faces + count, returns the new count
+    size_t meshFace(int face, PackedFace* faces, size_t count);
+
+    std::array<BlockId, PADDED_VOLUME> padded;
+    std::array<uint8_t, PADDED_VOLUME> paddedOpaque;
+    std::array<uint8_t, PADDED_VOLUME> paddedLight;
+    std::array<BlockId, CHUNK_VOLUME> blocks;
+    std::array<uint64_t, CHUNK_AREA> mask;
+    bool smoothShading = true;
+    LinearArena scratch{ MEMORY_MESH_SCRATCH };
+  };
+}
@@ -0,0 +1,69 @@
+#include "mesh/face_connectivity.h"
+
+#include "world/chunk.h"
+
+#include <array>
+#include <bitset>
+
+namespace zm
+{
+  FaceConnectivity computeFaceConnectivity(const BlockId* blocks)
+  {
+    thread_local std::bitset<CHUNK_VOLUME> visited;
+    thread_local std::array<uint16_t, CHUNK_VOLUME> stack;
+
+    visited.reset();
+    FaceConnectivity connectivity = FACE_CONNECTIVITY_NONE;
+
+    for (int start = 0; start < CHUNK_VOLUME; start++)
+    {
+      if (visited[start] || isOpaque(blocks[start]))
+        continue;
+
+      // flood one open region, noting every chunk face it reaches
+      uint8_t touched = 0;
+      int top = 0;
+      stack[top++] = uint16_t(start);
+      visited[start] = true;
+
+      while (top > 0)
+      {
+        const int index = stack[--top];
+        const int x = index & CHUNK_MASK;
+        const int z = (index >> CHUNK_SHIFT) & CHUNK_MASK;
+        const int y = index >> (2 * CHUNK_SHIFT);
+
+        touched |= (x == 0) << FACE_NEG_X | (x == CHUNK_MASK) << FACE_POS_X;
+        touched |= (y == 0) << FACE_NEG_Y | (y == CHUNK_MASK) << FACE_POS_Y;
+        touched |= (z == 0) << FACE_NEG_Z | (z == CHUNK_MASK) << FACE_POS_Z;
+
+        const int neighbours[6] = {
+          x > 0 ? index - 1 : -1,
+          x < CHUNK_MASK ? index + 1 : -1,
+          y > 0 ? index - CHUNK_AREA : -1,
+          y < CHUNK_MASK ? index + CHUNK_AREA : -1,
+          z > 0 ? index - CHUNK_SIZE : -1,
+          z < CHUNK_MASK ? index + CHUNK_SIZE : -1,
+        };
+        for (int n : neighbours)
+        {
+          if (n >= 0 && !visited[n] && !isOpaque(blocks[n]))
+          {
+            visited[n] = true;
+            stack[top++] = uint16_t(n);
+          }
+        }
+      }
+
+      for (int a = 0; a < FACE_COUNT; a++)
+        for (int b = a + 1; b < FACE_COUNT; b++)
+          if ((touched >> a & 1) && (touched >> b & 1))
+            connectivity |= FaceConnectivity(1u << facePairBit(a, b));
+
+      if (connectivity == FACE_CONNECTIVITY_ALL)
+        break;
+    }
+
+    return connectivity;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "world/block.h"
+
+#include <cstdint>
+
+namespace zm
+{
+  // Which pairs of chunk faces can see each other through non-opaque blocks,
+  // one bit per unordered pair (15 pairs). Used by the cave culling pass to
+  // decide whether looking in through one face can come out of another
+  using FaceConnectivity = uint16_t;
+
+  constexpr FaceConnectivity FACE_CONNECTIVITY_NONE = 0;
+  constexpr FaceConnectivity FACE_CONNECTIVITY_ALL = 0x7fff;
+
+  inline int facePairBit(int a, int b)
+  {
+    // bit index for an unordered pair of distinct faces
+    static constexpr int8_t table[FACE_COUNT][FACE_COUNT] = {
+      { -1, 0, 1, 2, 3, 4 },
+      { 0, -1, 5, 6, 7, 8 },
+      { 1, 5, -1, 9, 10, 11 },
+      { 2, 6, 9, -1, 12, 13 },
+      { 3, 7, 10, 12, -1, 14 },
+      { 4, 8, 11, 13, 14, -1 },
+    };
+    return table[a][b];
+  }
+
+  inline bool facesConnected(FaceConnectivity connectivity, int a, int b)
+  {
+    return a != b && (connectivity >> facePairBit(a, b)) & 1;
+  }
+
+  // Flood fills the non-opaque blocks of a chunk (CHUNK_VOLUME ids in
+  // chunkIndex order) and records which faces each open region touches
+  FaceConnectivity computeFaceConnectivity(const BlockId* blocks);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+
+namespace zm
+{
+  // 12 byte record per greedy quad. The chunk vertex shader pulls it from an
+  // SSBO with gl_VertexID / 6 and expands it into two triangles itself
+  // (chunk_vertex_shader.glsl), so no vertex or index data exists at all
+  //
+  //   position   bits 0-5 x, 6-11 y, 12-17 z of the quad's first corner
+  //              (0..32, chunk local), 18-20 face, 21-25 width - 1 and
+  //              26-30 height - 1 (1..32 along the face's u and v axes),
+  //              31 set when the quad is split along corners 1-3
+  //   attributes bits 0-11 texture array layer, 12-19 ambient occlusion of
+  //              corner i in bits 12 + 2i (0 fully occluded..3 open),
+  //              20-31 free
+  //   light      smoothed light at corner i in bits 8i..8i+7, packed like
+  //              the light storage (sunlight high nibble, block light low)
+  //
+  // Corners are numbered as in expandFace: 0 at the first corner, 1 along u,
+  // 2 along u and v, 3 along v
+  struct PackedFace
+  {
+    uint32_t position;
+    uint32_t attributes;
+    uint32_t light;
+  };
+  static_assert(sizeof(PackedFace) == 12);
+
+  // every corner in full sunlight and not occluded at all
+  constexpr uint32_t CORNERS_FULL_SKY = 0xF0F0F0F0u;
+  constexpr uint32_t CORNERS_OPEN = 0xFFu;
+
+  struct UnpackedFace
+  {
+    int x, y, z;
+    int face;
+    int width, height;
+    int layer;
+    int ao[4];
+    uint8_t light[4];
+    bool flipped;
+  };
+
+  inline PackedFace packFace(int x, int y, int z, int face, int width, int height, int layer, uint32_t cornerLight = CORNERS_FULL_SKY,
+                             uint32_t cornerAo = CORNERS_OPEN, bool flipped = false)
+  {
+    PackedFace packed;
+    packed.position = uint32_t(x) | (uint32_t(y) << 6) | (uint32_t(z) << 12) | (uint32_t(face) << 18) | (uint32_t(width - 1) << 21) |
+                      (uint32_t(height - 1) << 26) | (uint32_t(flipped) << 31);
+    packed.attributes = uint32_t(layer) | (cornerAo << 12);
+    packed.light = cornerLight;
+    return packed;
+  }
+
+  inline UnpackedFace unpackFace(PackedFace packed)
+  {
+    UnpackedFace out;
+    out.x = int(packed.position & 63);
+    out.y = int((packed.position >> 6) & 63);
+    out.z = int((packed.position >> 12) & 63);
+    out.face = int((packed.position >> 18) & 7);
+    out.width = int((packed.position >> 21) & 31) + 1;
+    out.height = int((packed.position >> 26) & 31) + 1;
+    out.flipped = packed.position >> 31;
+    out.layer = int(packed.attributes & 4095);
+    for (int i = 0; i < 4; i++)
+    {
+      out.ao[i] = int((packed.attributes >> (12 + 2 * i)) & 3);
+      out.light[i] = uint8_t(packed.light >> (8 * i));
+    }
+    return out;
+  }
+
+  // A quad spans width blocks along the axis after the face's normal axis
+  // (u) and height along the one after that (v). Textures run along these
+  // axes per normal axis instead, so side textures stay upright
+  constexpr int faceTextureAxes[3][2] = { { 2, 1 }, { 0, 2 }, { 0, 1 } };
+
+  struct FaceCorner
+  {
+    int corner;      // which of the face's corners, indexes ao and light
+    int position[3]; // chunk local
+    int u, v;        // tiling texture coordinates in blocks
+  };
+
+  // The four corners the vertex shader makes of a face, in drawing order:
+  // counter-clockwise seen from outside, triangles 0 1 2 and 2 3 0. Flipped
+  // faces start one corner later so the split runs along the other diagonal
+  inline void expandFace(const UnpackedFace& face, FaceCorner out[4])
+  {
+    const int axis = face.face / 2;
+    const bool positive = face.face & 1;
+    for (int i = 0; i < 4; i++)
+    {
+      // negative faces go round the other way, 0 3 2 1
+      const int rotated = (i + face.flipped) & 3;
+      const int corner = positive ? rotated : (4 - rotated) & 3;
+      int offset[3] = {};
+      offset[(axis + 1) % 3] = corner == 1 || corner == 2 ? face.width : 0;
+      offset[(axis + 2) % 3] = corner >= 2 ? face.height : 0;
+      out[i].corner = corner;
+      out[i].position[0] = face.x + offset[0];
+      out[i].position[1] = face.y + offset[1];
+      out[i].position[2] = face.z + offset[2];
+      out[i].u = offset[faceTextureAxes[axis][0]];
+      out[i].v = offset[faceTextureAxes[axis][1]];
+    }
+  }
+}
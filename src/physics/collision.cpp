@@ -0,0 +1,32 @@
+#include "physics/collision.h"
+
+namespace zm
+{
+  void SolidGrid::capture(const ChunkStorage& world, const glm::ivec3& center, int radius, const std::function<bool(ChunkCoord)>& isReady)
+  {
+    origin = center - glm::ivec3(radius);
+    size = 2 * radius + 1;
+    solid.assign(size_t(size) * size * size, 1);
+
+    // chunk by chunk, one map lookup each instead of one per block
+    const glm::ivec3 last = origin + glm::ivec3(size - 1);
+    const ChunkCoord first = worldToChunk(origin.x, origin.y, origin.z), end = worldToChunk(last.x, last.y, last.z);
+    for (int cy = first.y; cy <= end.y; cy++)
+      for (int cz = first.z; cz <= end.z; cz++)
+        for (int cx = first.x; cx <= end.x; cx++)
+        {
+          const ChunkCoord coord = { cx, cy, cz };
+          const Chunk* chunk = world.getChunk(coord);
+          if (!chunk || !isReady(coord))
+            continue;
+
+          const glm::ivec3 chunkMin = glm::ivec3(cx, cy, cz) * CHUNK_SIZE;
+          const glm::ivec3 lo = glm::max(origin, chunkMin), hi = glm::min(last, chunkMin + glm::ivec3(CHUNK_MASK));
+          for (int y = lo.y; y <= hi.y; y++)
+            for (int z = lo.z; z <= hi.z; z++)
+              for (int x = lo.x; x <= hi.x; x++)
+                solid[(size_t(y - origin.y) * size + size_t(z - origin.z)) * size + size_t(x - origin.x)] =
+                  isOpaque(chunk->get(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK));
+        }
+  }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "world/chunk_storage.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+namespace zm
+{
+  struct Aabb
+  {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    Aabb translated(const glm::vec3& offset) const { return { min + offset, max + offset }; }
+    bool overlaps(const Aabb& other) const
+    {
+      return min.x < other.max.x && other.min.x < max.x && min.y < other.max.y && other.min.y < max.y && min.z < other.max.z &&
+             other.min.z < max.z;
+    }
+  };
+
+  struct SweepResult
+  {
+    glm::vec3 moved = glm::vec3(0.0f); // the part of the motion that was possible
+    bool blocked[3] = {};              // per axis, blocked[1] while falling means on the ground
+  };
+
+  // Moves box by motion through the block grid, one axis at a time (y
+  // first, so landing happens before sliding). Every block layer the leading
+  // face crosses is tested across the whole box, so nothing tunnels however
+  // large the motion is, and a blocked axis ends flush against the block.
+  // isSolid(x, y, z) as for raycastVoxels
+  template <typename IsSolid>
+  SweepResult sweepAabb(const Aabb& box, const glm::vec3& motion, IsSolid&& isSolid)
+  {
+    SweepResult result;
+    Aabb current = box;
+    for (int axis : { 1, 0, 2 })
+    {
+      const float m = motion[axis];
+      if (m == 0.0f)
+        continue;
+
+      const int a = (axis + 1) % 3, b = (axis + 2) % 3;
+      // blocks the box covers across the sweep, touching faces don't count
+      const int aMin = int(std::floor(current.min[a])), aMax = int(std::ceil(current.max[a])) - 1;
+      const int bMin = int(std::floor(current.min[b])), bMax = int(std::ceil(current.max[b])) - 1;
+      auto layerSolid = [&](int layer) {
+        glm::ivec3 cell;
+        cell[axis] = layer;
+        for (cell[a] = aMin; cell[a] <= aMax; cell[a]++)
+          for (cell[b] = bMin; cell[b] <= bMax; cell[b]++)
+            if (isSolid(cell.x, cell.y, cell.z))
+              return true;
+        return false;
+      };
+
+      const float size = current.max[axis] - current.min[axis];
+      if (m > 0.0f)
+      {
+        const float target = current.max[axis] + m;
+        float end = target;
+        for (int layer = int(std::ceil(current.max[axis])); float(layer) < target; layer++)
+          if (layerSolid(layer))
+          {
+            end = float(layer);
+            result.blocked[axis] = true;
+            break;
+          }
+        current.max[axis] = end;
+        current.min[axis] = end - size;
+      }
+      else
+      {
+        const float target = current.min[axis] + m;
+        float end = target;
+        for (int layer = int(std::floor(current.min[axis])) - 1; float(layer + 1) > target; layer--)
+          if (layerSolid(layer))
+          {
+            end = float(layer + 1);
+            result.blocked[axis] = true;
+            break;
+          }
+        current.min[axis] = end;
+        current.max[axis] = end + size;
+      }
+    }
+    result.moved = current.min - box.min;
+    return result;
+  }
+
+  // Solid/empty bits for a cube of blocks, a copy of the world the
+  // simulation thread can read while the render thread keeps changing the
+  // real one. Blocks outside the cube count as solid
+  class SolidGrid
+  {
+  public:
+    // Cube of side 2 * radius + 1 around center. isReady tells which chunks
+    // have their blocks, the others count as solid
+    void capture(const ChunkStorage& world, const glm::ivec3& center, int radius, const std::function<bool(ChunkCoord)>& isReady);
+
+    bool isSolid(int x, int y, int z) const
+    {
+      const unsigned lx = unsigned(x - origin.x), ly = unsigned(y - origin.y), lz = unsigned(z - origin.z);
+      if (lx >= unsigned(size) || ly >= unsigned(size) || lz >= unsigned(size))
+        return true;
+      return solid[(size_t(ly) * size + lz) * size + lx] != 0;
+    }
+
+    const glm::ivec3& getOrigin() const { return origin; }
+    int getSize() const { return size; }
+
+  private:
+    glm::ivec3 origin = glm::ivec3(0);
+    int size = 0;
+    std::vector<uint8_t> solid;
+  };
+}
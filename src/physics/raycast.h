@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <limits>
+
+namespace zm
+{
+  struct RayHit
+  {
+    glm::ivec3 block = glm::ivec3(0);
+    // the empty block the ray came through last, where a placed block goes
+    glm::ivec3 previous = glm::ivec3(0);
+    // Face of block the ray entered through, -1 when it started inside it
+    int face = -1;
+    float distance = 0.0f;
+  };
+
+  // Amanatides-Woo grid traversal: visits every block the ray passes through
+  // in order, one compare and one add per step, and stops at the first one
+  // isSolid(x, y, z) accepts. direction must be normalized, distances are
+  // in blocks. Templated on the query so it inlines into the caller's
+  // chunk lookup
+  template <typename IsSolid>
+  bool raycastVoxels(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, IsSolid&& isSolid, RayHit& hit)
+  {
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    glm::ivec3 cell = glm::ivec3(glm::floor(origin));
+    glm::ivec3 step;
+    glm::vec3 tMax, tDelta;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      const float d = direction[axis];
+      step[axis] = d > 0.0f ? 1 : d < 0.0f ? -1 : 0;
+      tDelta[axis] = step[axis] ? std::abs(1.0f / d) : infinity;
+      const float boundary = float(step[axis] > 0 ? cell[axis] + 1 : cell[axis]);
+      tMax[axis] = step[axis] ? (boundary - origin[axis]) / d : infinity;
+    }
+
+    glm::ivec3 previous = cell;
+    int face = -1;
+    float distance = 0.0f;
+    while (distance <= maxDistance)
+    {
+      if (isSolid(cell.x, cell.y, cell.z))
+      {
+        hit.block = cell;
+        hit.previous = previous;
+        hit.face = face;
+        hit.distance = distance;
+        return true;
+      }
+
+      const int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+      previous = cell;
+      cell[axis] += step[axis];
+      distance = tMax[axis];
+      tMax[axis] += tDelta[axis];
+      // moving up an axis enters the next block through its negative face
+      face = axis * 2 + (step[axis] > 0 ? 0 : 1);
+    }
+    return false;
+  }
+}
@@ -0,0 +1,75 @@
+#include "physics/spatial_hash.h"
+
+#include <algorithm>
+
+namespace zm
+{
+  void SpatialHash::clear()
+  {
+    boxes.clear();
+    ids.clear();
+    entries.clear();
+  }
+
+  void SpatialHash::insert(uint32_t id, const Aabb& box)
+  {
+    const uint32_t index = uint32_t(boxes.size());
+    boxes.push_back(box);
+    ids.push_back(id);
+
+    const glm::ivec3 lo = cellOf(box.min), hi = cellOf(box.max);
+    for (int y = lo.y; y <= hi.y; y++)
+      for (int z = lo.z; z <= hi.z; z++)
+        for (int x = lo.x; x <= hi.x; x++)
+          entries.push_back({ cellKey({ x, y, z }), index });
+  }
+
+  void SpatialHash::build()
+  {
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.cell != b.cell ? a.cell < b.cell : a.box < b.box; });
+  }
+
+  void SpatialHash::findPairs(std::vector<std::pair<uint32_t, uint32_t>>& out) const
+  {
+    for (size_t begin = 0; begin < entries.size();)
+    {
+      size_t end = begin + 1;
+      while (end < entries.size() && entries[end].cell == entries[begin].cell)
+        end++;
+
+      for (size_t i = begin; i < end; i++)
+        for (size_t j = i + 1; j < end; j++)
+        {
+          const Aabb& a = boxes[entries[i].box];
+          const Aabb& b = boxes[entries[j].box];
+          if (!a.overlaps(b))
+            continue;
+          // boxes sharing several cells are reported only from the cell
+          // holding the corner of their overlap
+          if (cellKey(cellOf(glm::max(a.min, b.min))) != entries[begin].cell)
+            continue;
+          const uint32_t idA = ids[entries[i].box], idB = ids[entries[j].box];
+          out.emplace_back(std::min(idA, idB), std::max(idA, idB));
+        }
+      begin = end;
+    }
+  }
+
+  void SpatialHash::query(const Aabb& box, std::vector<uint32_t>& out) const
+  {
+    const size_t first = out.size();
+    const glm::ivec3 lo = cellOf(box.min), hi = cellOf(box.max);
+    for (int y = lo.y; y <= hi.y; y++)
+      for (int z = lo.z; z <= hi.z; z++)
+        for (int x = lo.x; x <= hi.x; x++)
+        {
+          const uint64_t key = cellKey({ x, y, z });
+          auto it = std::lower_bound(entries.begin(), entries.end(), key, [](const Entry& e, uint64_t k) { return e.cell < k; });
+          for (; it != entries.end() && it->cell == key; ++it)
+            if (boxes[it->box].overlaps(box))
+              out.push_back(ids[it->box]);
+        }
+    std::sort(out.begin() + first, out.end());
+    out.erase(std::unique(out.begin() + first, out.end()), out.end());
+  }
+}
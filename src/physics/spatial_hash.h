@@ -0,0 +1,54 @@
+#pragma once
+
+#include "physics/collision.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace zm
+{
+  // Broadphase for many moving boxes, rebuilt from scratch every step. Each
+  // box is entered into every grid cell it touches, keyed by the cell's
+  // packed coordinates. The keys are sorted instead of hashed into buckets:
+  // one sort per step, no per-cell allocations, and the cells of a query are
+  // found by binary search. Pick a cell size around the size of the boxes
+  class SpatialHash
+  {
+  public:
+    explicit SpatialHash(float cellSize) : inverseCell(1.0f / cellSize) {}
+
+    void clear();
+    void insert(uint32_t id, const Aabb& box);
+    // After the inserts, before any query
+    void build();
+
+    // Every overlapping pair once, lower id first
+    void findPairs(std::vector<std::pair<uint32_t, uint32_t>>& out) const;
+    // Ids of the boxes overlapping box, each once, appended
+    void query(const Aabb& box, std::vector<uint32_t>& out) const;
+
+    size_t boxCount() const { return boxes.size(); }
+    size_t entryCount() const { return entries.size(); }
+
+  private:
+    struct Entry
+    {
+      uint64_t cell;
+      uint32_t box; // index into boxes/ids
+    };
+
+    glm::ivec3 cellOf(const glm::vec3& p) const { return glm::ivec3(glm::floor(p * inverseCell)); }
+    static uint64_t cellKey(const glm::ivec3& cell)
+    {
+      // 21 bits per axis, wraps far out, which only costs a few false candidates
+      return (uint64_t(uint32_t(cell.x) & 0x1FFFFF) << 42) | (uint64_t(uint32_t(cell.y) & 0x1FFFFF) << 21) | uint64_t(uint32_t(cell.z) & 0x1FFFFF);
+    }
+
+    float inverseCell;
+    std::vector<Aabb> boxes;
+    std::vector<uint32_t> ids;
+    std::vector<Entry> entries;
+  };
+}
@@ -0,0 +1,100 @@
+#include "render/buffer_allocator.h"
+
+#include <cassert>
+
+namespace zm
+{
+  BufferAllocator::BufferAllocator(uint32_t capacity, uint32_t alignment)
+  {
+    reset(capacity, alignment);
+  }
+
+  void BufferAllocator::reset(uint32_t capacity, uint32_t alignment)
+  {
+    assert(alignment > 0);
+    align = alignment;
+    // only whole aligned blocks are ever handed out
+    totalSize = capacity / alignment * alignment;
+    used = 0;
+    allocations = 0;
+    freeByOffset.clear();
+    freeBySize.clear();
+    if (totalSize)
+      insertFree(0, totalSize);
+  }
+
+  BufferRange BufferAllocator::allocate(uint32_t size)
+  {
+    if (size == 0 || size > totalSize)
+      return {};
+    size = (size + align - 1) / align * align;
+
+    auto best = freeBySize.lower_bound({ size, 0 });
+    if (best == freeBySize.end())
+      return {};
+
+    const uint32_t blockSize = best->first;
+    const uint32_t offset = best->second;
+    eraseFree(freeByOffset.find(offset));
+
+    // the rest of the block stays free
+    if (blockSize > size)
+      insertFree(offset + size, blockSize - size);
+
+    used += size;
+    allocations++;
+    return { offset, size };
+  }
+
+  void BufferAllocator::free(BufferRange range)
+  {
+    if (!range.valid())
+      return;
+    assert(range.offset + range.size <= totalSize);
+
+    uint32_t offset = range.offset;
+    uint32_t size = range.size;
+    used -= size;
+    allocations--;
+
+    // merge with the free blocks on either side
+    auto next = freeByOffset.lower_bound(offset);
+    assert(next == freeByOffset.end() || next->first >= offset + size);
+    if (next != freeByOffset.end() && next->first == offset + size)
+    {
+      size += next->second;
+      next = std::next(next);
+      eraseFree(std::prev(next));
+    }
+    if (next != freeByOffset.begin())
+    {
+      auto previous = std::prev(next);
+      assert(previous->first + previous->second <= offset);
+      if (previous->first + previous->second == offset)
+      {
+        offset = previous->first;
+        size += previous->second;
+        eraseFree(previous);
+      }
+    }
+
+    insertFree(offset, size);
+  }
+
+  uint32_t BufferAllocator::largestFreeBlock() const
+  {
+    return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+  }
+
+  void BufferAllocator::insertFree(uint32_t offset, uint32_t size)
+  {
+    freeByOffset.emplace(offset, size);
+    freeBySize.emplace(size, offset);
+  }
+
+  void BufferAllocator::eraseFree(std::map<uint32_t, uint32_t>::iterator it)
+  {
+    freeBySize.erase({ it->second, it->first });
+    freeByOffset.erase(it);
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace zm
+{
+  // A range handed out by BufferAllocator, in whatever unit the allocator
+  // counts (the chunk renderer counts faces). size 0 means no allocation
+  struct BufferRange
+  {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+
+    bool valid() const { return size != 0; }
+  };
+
+  // Sub-allocator for one big GPU buffer. Knows nothing about GL, it only
+  // hands out offsets, so it can be exercised on the CPU. Best fit over a
+  // free list kept both by offset (to merge neighbours on free) and by size
+  // (to find the smallest block that fits)
+  class BufferAllocator
+  {
+  public:
+    explicit BufferAllocator(uint32_t capacity = 0, uint32_t alignment = 1);
+
+    // forgets every allocation
+    void reset(uint32_t capacity, uint32_t alignment = 1);
+
+    // size is rounded up to the alignment, returns an invalid range when
+    // no free block is large enough
+    BufferRange allocate(uint32_t size);
+    void free(BufferRange range);
+
+    uint32_t capacity() const { return totalSize; }
+    uint32_t alignment() const { return align; }
+    uint32_t usedSize() const { return used; }
+    uint32_t freeSize() const { return totalSize - used; }
+    uint32_t largestFreeBlock() const;
+    uint32_t allocationCount() const { return allocations; }
+    uint32_t freeBlockCount() const { return uint32_t(freeByOffset.size()); }
+
+  private:
+    void insertFree(uint32_t offset, uint32_t size);
+    void eraseFree(std::map<uint32_t, uint32_t>::iterator it);
+
+    std::map<uint32_t, uint32_t> freeByOffset;        // offset -> size
+    std::set<std::pair<uint32_t, uint32_t>> freeBySize; // (size, offset)
+    uint32_t totalSize = 0;
+    uint32_t align = 1;
+    uint32_t used = 0;
+    uint32_t allocations = 0;
+  };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+namespace zm
+{
+  // Fly camera. Holds everything needed to build the view and projection once
+  // per frame, so nothing downstream has to call lookAt/perspective itself
+  struct Camera
+  {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 front = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+    float fov = 45.0f; // degrees, vertical
+    float aspect = 800.0f / 600.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+
+    // yaw/pitch in degrees, same convention as the mouse look
+    void setRotation(float yaw, float pitch)
+    {
+      glm::vec3 direction;
+      direction.x = std::cos(glm::radians(yaw)) * std::cos(glm::radians(pitch));
+      direction.y = std::sin(glm::radians(pitch));
+      direction.z = std::sin(glm::radians(yaw)) * std::cos(glm::radians(pitch));
+      front = glm::normalize(direction);
+    }
+
+    glm::mat4 view() const { return glm::lookAt(position, position + front, up); }
+    glm::mat4 projection() const { return glm::perspective(glm::radians(fov), aspect, nearPlane, farPlane); }
+    glm::mat4 viewProjection() const { return projection() * view(); }
+  };
+}
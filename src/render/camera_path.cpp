@@ -0,0 +1,87 @@
+#include "render/camera_path.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace zm
+{
+  CameraKeyframe CameraPath::sample(float time) const
+  {
+    if (keys.empty())
+      return {};
+    if (time <= keys.front().time)
+      return keys.front();
+    if (time >= keys.back().time)
+      return keys.back();
+
+    size_t next = 1;
+    while (keys[next].time < time)
+      next++;
+
+    const CameraKeyframe& a = keys[next - 1];
+    const CameraKeyframe& b = keys[next];
+    const float span = b.time - a.time;
+    const float t = span > 0.0f ? (time - a.time) / span : 0.0f;
+
+    CameraKeyframe out;
+    out.time = time;
+    out.position = glm::mix(a.position, b.position, t);
+    out.yaw = a.yaw + (b.yaw - a.yaw) * t;
+    out.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    return out;
+  }
+
+  bool CameraPath::save(const std::string& path) const
+  {
+    std::ofstream file(path);
+    if (!file.is_open())
+      return false;
+
+    file << "# time x y z yaw pitch\n";
+    for (const CameraKeyframe& key : keys)
+      file << key.time << ' ' << key.position.x << ' ' << key.position.y << ' ' << key.position.z << ' ' << key.yaw << ' ' << key.pitch << '\n';
+    return file.good();
+  }
+
+  bool CameraPath::load(const std::string& path)
+  {
+    std::ifstream file(path);
+    if (!file.is_open())
+      return false;
+
+    keys.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+      if (line.empty() || line[0] == '#')
+        continue;
+
+      std::istringstream stream(line);
+      CameraKeyframe key;
+      if (stream >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)
+        keys.push_back(key);
+    }
+    return !keys.empty();
+  }
+
+  CameraPath CameraPath::orbit(glm::vec3 center, float radius, float minY, float maxY, float duration, int keyframeCount)
+  {
+    CameraPath path;
+    for (int i = 0; i < keyframeCount; i++)
+    {
+      const float t = float(i) / float(keyframeCount - 1);
+      const float angle = t * 6.2831853f;
+
+      CameraKeyframe key;
+      key.time = t * duration;
+      key.position = center + glm::vec3(std::cos(angle) * radius, 0.0f, std::sin(angle) * radius);
+      key.position.y = minY + (maxY - minY) * (0.5f + 0.5f * std::cos(angle * 3.0f));
+      // tangent of the circle, in the mouse-look yaw convention
+      key.yaw = glm::degrees(angle) + 90.0f;
+      key.pitch = -10.0f;
+      path.addKeyframe(key);
+    }
+    return path;
+  }
+}
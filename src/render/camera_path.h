@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace zm
+{
+  struct CameraKeyframe
+  {
+    float time = 0.0f; // seconds from the start of the path
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = -90.0f;
+    float pitch = 0.0f;
+  };
+
+  // Recorded or scripted camera movement, replayed by the benchmarks so every
+  // run sees the same frames. Saved as plain text, one keyframe per line:
+  //   time x y z yaw pitch
+  class CameraPath
+  {
+  public:
+    // keyframes must be added in time order
+    void addKeyframe(const CameraKeyframe& keyframe) { keys.push_back(keyframe); }
+    void clear() { keys.clear(); }
+
+    bool empty() const { return keys.empty(); }
+    float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+    const std::vector<CameraKeyframe>& keyframes() const { return keys; }
+
+    // Linear interpolation between the surrounding keyframes, clamped at the ends
+    CameraKeyframe sample(float time) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // Circle around center while bobbing between minY and maxY, looking
+    // along the direction of travel. Dipping below the terrain is what
+    // exercises occlusion culling
+    static CameraPath orbit(glm::vec3 center, float radius, float minY, float maxY, float duration, int keyframeCount);
+
+  private:
+    std::vector<CameraKeyframe> keys;
+  };
+}
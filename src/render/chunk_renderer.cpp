@@ -0,0 +1,177 @@
+#include "render/chunk_renderer.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    size_t alignUp(size_t value, size_t alignment)
+    {
+      return (value + alignment - 1) / alignment * alignment;
+    }
+
+    unsigned int createPersistentBuffer(GLenum target, size_t size, void** mapped)
+    {
+      unsigned int buffer;
+      glGenBuffers(1, &buffer);
+      glBindBuffer(target, buffer);
+      glBufferStorage(target, GLsizeiptr(size), nullptr, persistentFlags);
+      *mapped = glMapBufferRange(target, 0, GLsizeiptr(size), persistentFlags);
+      return buffer;
+    }
+  }
+
+  ChunkRenderer::ChunkRenderer(const ShaderProgram& program, uint32_t faceCapacity, uint32_t maxDraws)
+    : program(program), allocator(faceCapacity), maxDraws(maxDraws)
+  {
+    GLint ssboAlignment = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+    indirectStride = size_t(maxDraws) * sizeof(DrawArraysIndirectCommand);
+    offsetStride = alignUp(size_t(maxDraws) * sizeof(glm::vec4), size_t(std::max(ssboAlignment, 1)));
+
+    glGenVertexArrays(1, &vao);
+
+    void* mapped;
+    faceBuffer = createPersistentBuffer(GL_SHADER_STORAGE_BUFFER, size_t(allocator.capacity()) * sizeof(PackedFace), &mapped);
+    mappedFaces = static_cast<PackedFace*>(mapped);
+
+    indirectBuffer = createPersistentBuffer(GL_DRAW_INDIRECT_BUFFER, indirectStride * FRAMES_IN_FLIGHT, &mapped);
+    mappedIndirect = static_cast<uint8_t*>(mapped);
+    offsetBuffer = createPersistentBuffer(GL_SHADER_STORAGE_BUFFER, offsetStride * FRAMES_IN_FLIGHT, &mapped);
+    mappedOffsets = static_cast<uint8_t*>(mapped);
+
+    if (!mappedFaces || !mappedIndirect || !mappedOffsets)
+      std::fprintf(stderr, "ChunkRenderer: failed to map persistent buffers\n");
+  }
+
+  ChunkRenderer::~ChunkRenderer()
+  {
+    for (GLsync fence : fences)
+      if (fence)
+        glDeleteSync(fence);
+
+    // deleting a buffer also unmaps it
+    const unsigned int buffers[] = { faceBuffer, indirectBuffer, offsetBuffer };
+    glDeleteBuffers(3, buffers);
+    glDeleteVertexArrays(1, &vao);
+  }
+
+  void ChunkRenderer::beginFrame()
+  {
+    frame = (frame + 1) % FRAMES_IN_FLIGHT;
+
+    // the GPU is done with everything up to the frame that last used this
+    // region, including reads of ranges retired back then
+    if (GLsync fence = fences[frame])
+    {
+      GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+      while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED)
+        flags = 0;
+      glDeleteSync(fence);
+      fences[frame] = nullptr;
+    }
+
+    for (BufferRange range : retired[frame])
+      allocator.free(range);
+    retired[frame].clear();
+  }
+
+  bool ChunkRenderer::upload(LodKey key, const ChunkMesh& mesh)
+  {
+    remove(key);
+    if (mesh.empty())
+      return true;
+
+    const BufferRange range = allocator.allocate(uint32_t(mesh.faces.size()));
+    if (!range.valid())
+    {
+      failedUploads++;
+      return false;
+    }
+
+    std::memcpy(mappedFaces + range.offset, mesh.faces.data(), mesh.byteSize());
+    ranges.emplace(key, range);
+    return true;
+  }
+
+  void ChunkRenderer::remove(LodKey key)
+  {
+    auto it = ranges.find(key);
+    if (it == ranges.end())
+      return;
+
+    retire(it->second);
+    ranges.erase(it);
+  }
+
+  void ChunkRenderer::retire(BufferRange range)
+  {
+    // frames already submitted may still read it
+    retired[frame].push_back(range);
+  }
+
+  void ChunkRenderer::draw(const std::vector<LodKey>& visible, const glm::mat4& view, const glm::mat4& projection, unsigned int texture)
+  {
+    builder.clear();
+    for (const LodKey& key : visible)
+    {
+      if (builder.size() == maxDraws)
+        break;
+      auto it = ranges.find(key);
+      if (it != ranges.end())
+        builder.add(key, it->second);
+    }
+    lastDrawCommands = uint32_t(builder.size());
+
+    if (!builder.empty())
+      submit(projection * view, texture);
+
+    // fenced even when nothing was drawn, beginFrame relies on it before
+    // recycling this frame's retired ranges
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  void ChunkRenderer::submit(const glm::mat4& viewProjection, unsigned int texture)
+  {
+    const size_t indirectOffset = indirectStride * frame;
+    const size_t offsetsOffset = offsetStride * frame;
+    std::memcpy(mappedIndirect + indirectOffset, builder.commands().data(), builder.size() * sizeof(DrawArraysIndirectCommand));
+    std::memcpy(mappedOffsets + offsetsOffset, builder.chunkOffsets().data(), builder.size() * sizeof(glm::vec4));
+
+    if (programRevision != program.revision())
+    {
+      viewProjectionLocation = program.uniform("viewProjection");
+      programRevision = program.revision();
+    }
+
+    glUseProgram(program.id());
+    glUniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, offsetBuffer, GLintptr(offsetsOffset), GLsizeiptr(builder.size() * sizeof(glm::vec4)));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, faceBuffer);
+    glMultiDrawArraysIndirect(GL_TRIANGLES, (const void*)indirectOffset, GLsizei(builder.size()), 0);
+    glBindVertexArray(0);
+  }
+
+  ChunkRendererStats ChunkRenderer::stats() const
+  {
+    ChunkRendererStats stats;
+    stats.chunks = uint32_t(ranges.size());
+    stats.drawCommands = lastDrawCommands;
+    stats.usedBytes = size_t(allocator.usedSize()) * sizeof(PackedFace);
+    stats.capacityBytes = size_t(allocator.capacity()) * sizeof(PackedFace);
+    stats.largestFreeBytes = size_t(allocator.largestFreeBlock()) * sizeof(PackedFace);
+    stats.failedUploads = failedUploads;
+    return stats;
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "mesh/chunk_mesher.h"
+#include "render/buffer_allocator.h"
+#include "render/draw_commands.h"
+#include "render/shader_cache.h"
+#include "world/chunk_storage.h"
+#include "world/lod.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  struct ChunkRendererStats
+  {
+    uint32_t chunks = 0;          // LOD nodes with geometry in the face buffer
+    uint32_t drawCommands = 0;    // indirect commands issued last frame
+    size_t usedBytes = 0;
+    size_t capacityBytes = 0;
+    size_t largestFreeBytes = 0;
+    uint32_t failedUploads = 0;   // meshes that did not fit, since startup
+  };
+
+  // All chunk meshes live in one persistently mapped SSBO of face records
+  // carved up by a BufferAllocator. Each frame the visible chunks become one
+  // glMultiDrawArraysIndirect call without vertex attributes: the vertex
+  // shader pulls a record per gl_VertexID / 6 and the chunk's world offset
+  // per gl_DrawID, and view-projection comes premultiplied. Meshes are keyed
+  // by LOD node, full detail chunks are level 0 nodes.
+  //
+  // The indirect commands and offsets are written into one of FRAMES_IN_FLIGHT
+  // regions guarded by fences, and freed vertex ranges are only reused once
+  // the frames that could still read them have finished on the GPU
+  class ChunkRenderer
+  {
+  public:
+    static constexpr int FRAMES_IN_FLIGHT = 3;
+
+    // program must be linked from chunk_vertex_shader.glsl. Its uniform
+    // locations are cached and only fetched again after a hot reload
+    ChunkRenderer(const ShaderProgram& program, uint32_t faceCapacity = 1u << 20, uint32_t maxDraws = 1u << 14);
+    ~ChunkRenderer();
+
+    ChunkRenderer(const ChunkRenderer&) = delete;
+    ChunkRenderer& operator=(const ChunkRenderer&) = delete;
+
+    // waits for this frame's region to be free and recycles retired ranges,
+    // call once per frame before any upload/remove/draw
+    void beginFrame();
+
+    // copies the mesh into the face buffer, an empty mesh removes the node
+    bool upload(LodKey key, const ChunkMesh& mesh);
+    void remove(LodKey key);
+    bool contains(LodKey key) const { return ranges.count(key) != 0; }
+
+    // must be called every frame, even with nothing visible. texture is the
+    // block texture array
+    void draw(const std::vector<LodKey>& visible, const glm::mat4& view, const glm::mat4& projection, unsigned int texture);
+
+    ChunkRendererStats stats() const;
+
+  private:
+    void retire(BufferRange range);
+    void submit(const glm::mat4& viewProjection, unsigned int texture);
+
+    const ShaderProgram& program;
+    uint32_t programRevision = 0;
+    int viewProjectionLocation = -1;
+
+    // no attributes, core profile still wants one bound to draw
+    unsigned int vao = 0;
+    unsigned int faceBuffer = 0;
+    unsigned int indirectBuffer = 0;
+    unsigned int offsetBuffer = 0;
+
+    PackedFace* mappedFaces = nullptr;
+    uint8_t* mappedIndirect = nullptr;
+    uint8_t* mappedOffsets = nullptr;
+    size_t indirectStride = 0;  // bytes per frame region
+    size_t offsetStride = 0;    // bytes per frame region, SSBO offset aligned
+
+    BufferAllocator allocator;
+    uint32_t maxDraws;
+    std::unordered_map<LodKey, BufferRange, LodKeyHash> ranges;
+    DrawCommandBuilder builder;
+
+    int frame = 0;
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+    std::vector<BufferRange> retired[FRAMES_IN_FLIGHT];
+
+    uint32_t lastDrawCommands = 0;
+    uint32_t failedUploads = 0;
+  };
+}
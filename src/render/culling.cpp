@@ -0,0 +1,260 @@
+#include "render/culling.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZM_CULL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace zm
+{
+  namespace
+  {
+    constexpr int faceOffsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    glm::vec3 chunkMin(ChunkCoord c)
+    {
+      return glm::vec3(c.x, c.y, c.z) * float(CHUNK_SIZE);
+    }
+  }
+
+  Frustum Frustum::fromViewProjection(const glm::mat4& m)
+  {
+    // glm is column major, m[col][row]
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0; // left
+    frustum.planes[1] = row3 - row0; // right
+    frustum.planes[2] = row3 + row1; // bottom
+    frustum.planes[3] = row3 - row1; // top
+    frustum.planes[4] = row3 + row2; // near
+    frustum.planes[5] = row3 - row2; // far
+
+    for (glm::vec4& plane : frustum.planes)
+      plane /= glm::length(glm::vec3(plane));
+    return frustum;
+  }
+
+  bool Frustum::intersectsBox(glm::vec3 min, glm::vec3 max) const
+  {
+    for (const glm::vec4& plane : planes)
+    {
+      // the box corner furthest along the plane normal
+      const glm::vec3 p(plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y, plane.z >= 0.0f ? max.z : min.z);
+      if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f)
+        return false;
+    }
+    return true;
+  }
+
+  void frustumCullBoxes(const Frustum& frustum, const BoxArrays& boxes, uint8_t* visible, bool simd)
+  {
+    const size_t count = boxes.size();
+    size_t i = 0;
+
+#ifdef ZM_CULL_SSE2
+    if (simd)
+    {
+      for (; i + 4 <= count; i += 4)
+      {
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& plane : frustum.planes)
+        {
+          // same corner choice for all 4 boxes since they share the plane
+          const float* xs = plane.x >= 0.0f ? boxes.maxX.data() : boxes.minX.data();
+          const float* ys = plane.y >= 0.0f ? boxes.maxY.data() : boxes.minY.data();
+          const float* zs = plane.z >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+
+          __m128 distance = _mm_mul_ps(_mm_loadu_ps(xs + i), _mm_set1_ps(plane.x));
+          distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(ys + i), _mm_set1_ps(plane.y)));
+          distance = _mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(zs + i), _mm_set1_ps(plane.z)));
+          distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+          outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+
+        const int mask = _mm_movemask_ps(outside);
+        visible[i + 0] = !(mask & 1);
+        visible[i + 1] = !(mask & 2);
+        visible[i + 2] = !(mask & 4);
+        visible[i + 3] = !(mask & 8);
+      }
+    }
+#else
+    (void)simd;
+#endif
+
+    for (; i < count; i++)
+    {
+      visible[i] = frustum.intersectsBox(glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]),
+                                         glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+    }
+  }
+
+  void ChunkCuller::setChunk(ChunkCoord coord, FaceConnectivity connectivity, bool hasGeometry)
+  {
+    auto it = indices.find(coord);
+    if (it != indices.end())
+    {
+      entries[it->second].connectivity = connectivity;
+      entries[it->second].hasGeometry = hasGeometry;
+      return;
+    }
+
+    indices.emplace(coord, uint32_t(entries.size()));
+    entries.push_back({ coord, connectivity, hasGeometry });
+
+    const glm::vec3 min = chunkMin(coord);
+    const glm::vec3 max = min + float(CHUNK_SIZE);
+    boxes.minX.push_back(min.x);
+    boxes.minY.push_back(min.y);
+    boxes.minZ.push_back(min.z);
+    boxes.maxX.push_back(max.x);
+    boxes.maxY.push_back(max.y);
+    boxes.maxZ.push_back(max.z);
+  }
+
+  void ChunkCuller::removeChunk(ChunkCoord coord)
+  {
+    auto it = indices.find(coord);
+    if (it == indices.end())
+      return;
+
+    // swap the last entry into the hole to keep the arrays dense
+    const uint32_t index = it->second;
+    const uint32_t last = uint32_t(entries.size() - 1);
+    indices.erase(it);
+    if (index != last)
+    {
+      entries[index] = entries[last];
+      boxes.minX[index] = boxes.minX[last];
+      boxes.minY[index] = boxes.minY[last];
+      boxes.minZ[index] = boxes.minZ[last];
+      boxes.maxX[index] = boxes.maxX[last];
+      boxes.maxY[index] = boxes.maxY[last];
+      boxes.maxZ[index] = boxes.maxZ[last];
+      indices[entries[index].coord] = index;
+    }
+
+    entries.pop_back();
+    boxes.minX.pop_back();
+    boxes.minY.pop_back();
+    boxes.minZ.pop_back();
+    boxes.maxX.pop_back();
+    boxes.maxY.pop_back();
+    boxes.maxZ.pop_back();
+  }
+
+  void ChunkCuller::clear()
+  {
+    entries.clear();
+    indices.clear();
+    boxes = {};
+  }
+
+  void ChunkCuller::searchVisible(const Frustum& frustum, glm::vec3 cameraPos)
+  {
+    // the search is confined to the loaded area plus a one chunk border, so
+    // it can cross empty sky between chunks but always terminates
+    ChunkCoord lo = { INT_MAX, INT_MAX, INT_MAX };
+    ChunkCoord hi = { INT_MIN, INT_MIN, INT_MIN };
+    for (const Entry& entry : entries)
+    {
+      lo = { std::min(lo.x, entry.coord.x - 1), std::min(lo.y, entry.coord.y - 1), std::min(lo.z, entry.coord.z - 1) };
+      hi = { std::max(hi.x, entry.coord.x + 1), std::max(hi.y, entry.coord.y + 1), std::max(hi.z, entry.coord.z + 1) };
+    }
+
+    const ChunkCoord start = worldToChunk(int(std::floor(cameraPos.x)), int(std::floor(cameraPos.y)), int(std::floor(cameraPos.z)));
+    const bool startInside = start.x >= lo.x && start.x <= hi.x && start.y >= lo.y && start.y <= hi.y && start.z >= lo.z && start.z <= hi.z;
+    if (!startInside)
+    {
+      // camera is well away from everything loaded, nothing can be hidden
+      // from it by our chunks alone, fall back to frustum only
+      std::fill(reached.begin(), reached.end(), 1);
+      return;
+    }
+
+    const int sizeX = hi.x - lo.x + 1;
+    const int sizeY = hi.y - lo.y + 1;
+    const int sizeZ = hi.z - lo.z + 1;
+    auto gridIndex = [&](ChunkCoord c) { return size_t(c.x - lo.x) + size_t(sizeX) * (size_t(c.z - lo.z) + size_t(sizeZ) * size_t(c.y - lo.y)); };
+
+    visitedGrid.assign(size_t(sizeX) * sizeY * sizeZ, 0);
+    queue.clear();
+    queue.push_back({ start, uint8_t(FACE_COUNT), 0 });
+    visitedGrid[gridIndex(start)] = 1;
+
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+      const SearchNode node = queue[head];
+
+      auto it = indices.find(node.coord);
+      const FaceConnectivity connectivity = it != indices.end() ? entries[it->second].connectivity : FACE_CONNECTIVITY_ALL;
+      if (it != indices.end())
+        reached[it->second] = 1;
+
+      for (int face = 0; face < FACE_COUNT; face++)
+      {
+        // never walk back towards the camera
+        if (node.directions & (1 << (face ^ 1)))
+          continue;
+        if (node.enteredFace != FACE_COUNT && !facesConnected(connectivity, node.enteredFace, face))
+          continue;
+
+        const ChunkCoord next = { node.coord.x + faceOffsets[face][0], node.coord.y + faceOffsets[face][1], node.coord.z + faceOffsets[face][2] };
+        if (next.x < lo.x || next.x > hi.x || next.y < lo.y || next.y > hi.y || next.z < lo.z || next.z > hi.z)
+          continue;
+
+        const size_t cell = gridIndex(next);
+        if (visitedGrid[cell])
+          continue;
+
+        auto nextIt = indices.find(next);
+        const bool visible = nextIt != indices.end() ? inFrustum[nextIt->second] != 0
+                                                     : frustum.intersectsBox(chunkMin(next), chunkMin(next) + float(CHUNK_SIZE));
+        if (!visible)
+          continue;
+
+        visitedGrid[cell] = 1;
+        queue.push_back({ next, uint8_t(face ^ 1), uint8_t(node.directions | (1 << face)) });
+      }
+    }
+  }
+
+  void ChunkCuller::cull(const glm::mat4& viewProjection, glm::vec3 cameraPos, std::vector<ChunkCoord>& visible)
+  {
+    visible.clear();
+    lastStats = {};
+
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection);
+    inFrustum.resize(entries.size());
+    frustumCullBoxes(frustum, boxes, inFrustum.data(), simdEnabled);
+
+    reached.assign(entries.size(), occlusionEnabled ? 0 : 1);
+    if (occlusionEnabled && !entries.empty())
+      searchVisible(frustum, cameraPos);
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+      if (!entries[i].hasGeometry)
+        continue;
+
+      lastStats.tested++;
+      if (!inFrustum[i])
+        lastStats.frustumCulled++;
+      else if (!reached[i])
+        lastStats.occlusionCulled++;
+      else
+      {
+        lastStats.drawn++;
+        visible.push_back(entries[i].coord);
+      }
+    }
+  }
+}
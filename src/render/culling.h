@@ -0,0 +1,98 @@
+#pragma once
+
+#include "mesh/face_connectivity.h"
+#include "world/chunk_storage.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  struct Frustum
+  {
+    // xyz is the inward facing normal, w the distance: inside when dot(n, p) + w >= 0
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann plane extraction, works for any GL-style clip space matrix
+    static Frustum fromViewProjection(const glm::mat4& viewProjection);
+
+    bool intersectsBox(glm::vec3 min, glm::vec3 max) const;
+  };
+
+  // Boxes as separate coordinate arrays so the test runs 4 boxes per
+  // instruction. visible[i] is set to 1 when box i touches the frustum
+  struct BoxArrays
+  {
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+    size_t size() const { return minX.size(); }
+  };
+
+  void frustumCullBoxes(const Frustum& frustum, const BoxArrays& boxes, uint8_t* visible, bool simd = true);
+
+  struct CullStats
+  {
+    uint32_t tested = 0;          // chunks with geometry
+    uint32_t frustumCulled = 0;   // outside the view frustum
+    uint32_t occlusionCulled = 0; // in the frustum but unreachable from the camera
+    uint32_t drawn = 0;
+  };
+
+  // Decides which meshed chunks get drawn. First every chunk box is tested
+  // against the frustum in one batch, then a breadth-first search walks out
+  // from the camera chunk through chunk faces that are connected by open
+  // space (cave culling). Chunks the search never reaches are hidden behind
+  // solid ground and are skipped
+  class ChunkCuller
+  {
+  public:
+    // connectivity comes from the mesher, empty chunks still matter because
+    // the search has to walk through them
+    void setChunk(ChunkCoord coord, FaceConnectivity connectivity, bool hasGeometry);
+    void removeChunk(ChunkCoord coord);
+    void clear();
+    size_t chunkCount() const { return entries.size(); }
+    bool hasChunk(ChunkCoord coord) const { return indices.count(coord) != 0; }
+
+    void setOcclusionEnabled(bool enabled) { occlusionEnabled = enabled; }
+    void setSimdEnabled(bool enabled) { simdEnabled = enabled; }
+
+    // Fills visible with the chunks to draw this frame and updates stats()
+    void cull(const glm::mat4& viewProjection, glm::vec3 cameraPos, std::vector<ChunkCoord>& visible);
+    const CullStats& stats() const { return lastStats; }
+
+  private:
+    struct Entry
+    {
+      ChunkCoord coord;
+      FaceConnectivity connectivity;
+      bool hasGeometry;
+    };
+
+    struct SearchNode
+    {
+      ChunkCoord coord;
+      uint8_t enteredFace;  // face of this chunk we came in through, FACE_COUNT for the start
+      uint8_t directions;   // every direction stepped so far, never step back against one
+    };
+
+    void searchVisible(const Frustum& frustum, glm::vec3 cameraPos);
+
+    std::vector<Entry> entries;
+    BoxArrays boxes;
+    std::unordered_map<ChunkCoord, uint32_t, ChunkCoordHash> indices;
+
+    std::vector<uint8_t> inFrustum;
+    std::vector<uint8_t> reached;
+    std::vector<uint8_t> visitedGrid;
+    std::vector<SearchNode> queue;
+
+    bool occlusionEnabled = true;
+    bool simdEnabled = true;
+    CullStats lastStats;
+  };
+}
@@ -0,0 +1,28 @@
+#include "render/draw_commands.h"
+
+#include "world/chunk.h"
+
+namespace zm
+{
+  void DrawCommandBuilder::clear()
+  {
+    drawCommands.clear();
+    offsets.clear();
+  }
+
+  void DrawCommandBuilder::add(LodKey key, BufferRange faces)
+  {
+    if (!faces.valid())
+      return;
+
+    DrawArraysIndirectCommand command;
+    command.count = faces.size * VERTICES_PER_FACE;
+    command.instanceCount = 1;
+    command.first = faces.offset * VERTICES_PER_FACE;
+    command.baseInstance = uint32_t(drawCommands.size());
+    drawCommands.push_back(command);
+
+    const ChunkCoord origin = key.origin();
+    offsets.push_back(glm::vec4(glm::vec3(origin.x, origin.y, origin.z) * float(CHUNK_SIZE), float(key.span())));
+  }
+}
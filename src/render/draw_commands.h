@@ -0,0 +1,53 @@
+#pragma once
+
+#include "render/buffer_allocator.h"
+#include "world/chunk_storage.h"
+#include "world/lod.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zm
+{
+  // Same layout as GL's DrawArraysIndirectCommand, written straight into
+  // the indirect buffer
+  struct DrawArraysIndirectCommand
+  {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t first;
+    uint32_t baseInstance;
+  };
+  static_assert(sizeof(DrawArraysIndirectCommand) == 16, "must match the GL indirect command layout");
+
+  // The shader makes six vertices of every face record
+  constexpr uint32_t VERTICES_PER_FACE = 6;
+
+  // Builds one indirect command per visible chunk plus the matching world
+  // offset for the chunk offset SSBO (std430 vec4 array, indexed with
+  // gl_DrawID). The offset's w is the node's scale, 2^level, so coarse LOD
+  // meshes use the same face format as full detail ones. Commands draw
+  // arrays without vertex data: gl_VertexID runs from first, six per face
+  // record, and picks the record to pull
+  class DrawCommandBuilder
+  {
+  public:
+    void clear();
+
+    // faces is the chunk's range in the face buffer, counted in faces
+    void add(LodKey key, BufferRange faces);
+    void add(ChunkCoord coord, BufferRange faces) { add(lodKey(coord), faces); }
+
+    const std::vector<DrawArraysIndirectCommand>& commands() const { return drawCommands; }
+    const std::vector<glm::vec4>& chunkOffsets() const { return offsets; }
+    size_t size() const { return drawCommands.size(); }
+    bool empty() const { return drawCommands.empty(); }
+
+  private:
+    std::vector<DrawArraysIndirectCommand> drawCommands;
+    std::vector<glm::vec4> offsets;
+  };
+}
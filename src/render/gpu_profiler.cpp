@@ -0,0 +1,79 @@
+#include "render/gpu_profiler.h"
+
+#include "core/profiler.h"
+
+namespace zm
+{
+  GpuProfiler::GpuProfiler()
+  {
+    for (Frame& f : frames)
+      glGenQueries(MAX_PASSES, f.queries);
+  }
+
+  GpuProfiler::~GpuProfiler()
+  {
+    for (Frame& f : frames)
+      glDeleteQueries(MAX_PASSES, f.queries);
+  }
+
+  void GpuProfiler::beginFrame()
+  {
+    frame = (frame + 1) % LATENCY;
+    Frame& oldest = frames[frame];
+
+    // the last query finishes last, once it is in so are the others
+    GLint available = 0;
+    if (oldest.count > 0)
+      glGetQueryObjectiv(oldest.queries[oldest.count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+      latest.clear();
+      double total = 0.0;
+      for (int i = 0; i < oldest.count; i++)
+      {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(oldest.queries[i], GL_QUERY_RESULT, &nanoseconds);
+        const double milliseconds = double(nanoseconds) / 1e6;
+        latest.push_back({ oldest.names[i], milliseconds });
+        Profiler::get().counter(oldest.names[i], milliseconds);
+        total += milliseconds;
+      }
+
+      if (history.size() < FRAME_HISTORY)
+        history.push_back(float(total));
+      else
+        history[historyCursor] = float(total);
+      historyCursor = (historyCursor + 1) % FRAME_HISTORY;
+    }
+    // still pending after LATENCY frames, the results are dropped
+    oldest.count = 0;
+  }
+
+  void GpuProfiler::begin(const char* name)
+  {
+    Frame& current = frames[frame];
+    if (open || current.count == MAX_PASSES)
+      return;
+    current.names[current.count] = name;
+    glBeginQuery(GL_TIME_ELAPSED, current.queries[current.count]);
+    open = true;
+  }
+
+  void GpuProfiler::end()
+  {
+    if (!open)
+      return;
+    glEndQuery(GL_TIME_ELAPSED);
+    frames[frame].count++;
+    open = false;
+  }
+
+  std::vector<float> GpuProfiler::frameTimes() const
+  {
+    if (history.size() < FRAME_HISTORY)
+      return history;
+    std::vector<float> ordered(history.begin() + std::ptrdiff_t(historyCursor), history.end());
+    ordered.insert(ordered.end(), history.begin(), history.begin() + std::ptrdiff_t(historyCursor));
+    return ordered;
+  }
+}
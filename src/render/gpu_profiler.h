@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zm
+{
+  struct GpuTiming
+  {
+    const char* name;
+    double milliseconds;
+  };
+
+  // GL_TIME_ELAPSED queries around render passes. Results are read
+  // LATENCY frames later, when the GPU is long done with them, so reading
+  // never stalls. Every resolved pass is also published as a profiler
+  // counter under its name, which puts GPU time in traces next to the CPU.
+  //
+  // Elapsed-time queries can't nest, passes have to follow each other
+  class GpuProfiler
+  {
+  public:
+    static constexpr int LATENCY = 4;
+    static constexpr int MAX_PASSES = 16;
+    static constexpr size_t FRAME_HISTORY = 240;
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Resolves the frame recorded LATENCY frames ago, then starts a new one
+    void beginFrame();
+
+    // name must be a string literal. Passes past MAX_PASSES are not timed
+    void begin(const char* name);
+    void end();
+
+    // Passes of the newest resolved frame
+    const std::vector<GpuTiming>& results() const { return latest; }
+    // Summed GPU time per resolved frame in ms, oldest first
+    std::vector<float> frameTimes() const;
+
+  private:
+    struct Frame
+    {
+      GLuint queries[MAX_PASSES] = {};
+      const char* names[MAX_PASSES] = {};
+      int count = 0;
+    };
+
+    Frame frames[LATENCY];
+    int frame = 0;
+    bool open = false;
+
+    std::vector<GpuTiming> latest;
+    std::vector<float> history;
+    size_t historyCursor = 0;
+  };
+
+  // Times the enclosing block as one GPU pass
+  class GpuScope
+  {
+  public:
+    GpuScope(GpuProfiler& profiler, const char* name) : profiler(profiler) { profiler.begin(name); }
+    ~GpuScope() { profiler.end(); }
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+
+  private:
+    GpuProfiler& profiler;
+  };
+}
@@ -0,0 +1,103 @@
+#include "render/profiler_overlay.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace zm
+{
+  namespace
+  {
+    void plotFrameTimes(const char* label, const std::vector<float>& times)
+    {
+      if (times.empty())
+        return;
+      float sum = 0.0f, worst = 0.0f;
+      for (float t : times)
+      {
+        sum += t;
+        worst = std::max(worst, t);
+      }
+      char overlay[64];
+      std::snprintf(overlay, sizeof(overlay), "avg %.2f ms, max %.2f ms", sum / float(times.size()), worst);
+      // fixed scale up to 33 ms so spikes are comparable between frames
+      ImGui::PlotLines(label, times.data(), int(times.size()), 0, overlay, 0.0f, std::max(33.3f, worst), ImVec2(0.0f, 60.0f));
+    }
+  }
+
+  void ProfilerOverlay::draw(const GpuProfiler* gpu)
+  {
+    if (!visible)
+      return;
+
+    Profiler& profiler = Profiler::get();
+    if (!ImGui::Begin("profiler", &visible))
+    {
+      ImGui::End();
+      return;
+    }
+
+    bool recording = profiler.enabled();
+    if (ImGui::Checkbox("record", &recording))
+      profiler.setEnabled(recording);
+    ImGui::SameLine();
+    if (ImGui::Button("write trace"))
+    {
+      const auto stamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      const std::filesystem::path path = traceDirectory / ("trace_" + std::to_string(stamp) + ".json");
+      lastTrace = profiler.writeChromeTrace(path) ? path.string() : "failed to write " + path.string();
+    }
+    if (!lastTrace.empty())
+      ImGui::TextWrapped("%s", lastTrace.c_str());
+
+    plotFrameTimes("cpu", profiler.frameTimes());
+    if (gpu)
+      plotFrameTimes("gpu", gpu->frameTimes());
+
+    profiler.lastFrame(scopes, counters);
+    if (ImGui::BeginTable("scopes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+      ImGui::TableSetupColumn("scope (all threads)");
+      ImGui::TableSetupColumn("ms");
+      ImGui::TableSetupColumn("calls");
+      ImGui::TableHeadersRow();
+      for (const ScopeTiming& scope : scopes)
+      {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        // Indent(0) means the default width, only indent nested scopes
+        if (scope.depth > 0)
+          ImGui::Indent(float(scope.depth) * 8.0f);
+        ImGui::TextUnformatted(scope.name);
+        if (scope.depth > 0)
+          ImGui::Unindent(float(scope.depth) * 8.0f);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", scope.milliseconds);
+        ImGui::TableNextColumn();
+        ImGui::Text("%u", scope.calls);
+      }
+      ImGui::EndTable();
+    }
+
+    if (ImGui::BeginTable("counters", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+      ImGui::TableSetupColumn("counter");
+      ImGui::TableSetupColumn("value");
+      ImGui::TableHeadersRow();
+      for (const CounterValue& counter : counters)
+      {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(counter.name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.6g", counter.value);
+      }
+      ImGui::EndTable();
+    }
+
+    ImGui::Text("%zu threads recorded", profiler.threadCount());
+    ImGui::End();
+  }
+}
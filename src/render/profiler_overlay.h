@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/profiler.h"
+#include "render/gpu_profiler.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace zm
+{
+  // ImGui window over the profiler: CPU and GPU frame time graphs, the last
+  // frame's scopes summed over all threads, counters, and a button that
+  // writes a Chrome trace into traceDirectory
+  class ProfilerOverlay
+  {
+  public:
+    explicit ProfilerOverlay(std::filesystem::path traceDirectory) : traceDirectory(std::move(traceDirectory)) {}
+
+    // between ImGui::NewFrame() and ImGui::Render(). gpu may be null
+    void draw(const GpuProfiler* gpu);
+
+    bool visible = true;
+
+  private:
+    std::filesystem::path traceDirectory;
+    std::string lastTrace;
+    std::vector<ScopeTiming> scopes;
+    std::vector<CounterValue> counters;
+  };
+}
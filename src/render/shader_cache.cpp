@@ -0,0 +1,292 @@
+#include "render/shader_cache.h"
+
+#include "core/hash.h"
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr uint32_t binaryMagic = 0x42534D5A; // "ZMSB"
+    constexpr uint32_t binaryVersion = 1;
+
+    struct BinaryHeader
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint64_t key;
+      uint32_t format;
+      uint32_t length;
+    };
+
+    bool readFile(const std::filesystem::path& path, std::string& out)
+    {
+      std::ifstream file(path, std::ios::binary);
+      if (!file.is_open())
+        return false;
+      std::stringstream stream;
+      stream << file.rdbuf();
+      out = stream.str();
+      return true;
+    }
+
+    std::filesystem::file_time_type modifiedTime(const std::filesystem::path& path)
+    {
+      std::error_code error;
+      return std::filesystem::last_write_time(path, error);
+    }
+
+    unsigned int compileShader(GLenum type, const std::string& source, const std::string& name)
+    {
+      const char* text = source.c_str();
+      unsigned int shader = glCreateShader(type);
+      glShaderSource(shader, 1, &text, nullptr);
+      glCompileShader(shader);
+
+      int success;
+      glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+      if (!success)
+      {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+        std::cerr << "Shader compilation error (" << name << "):\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+      }
+      return shader;
+    }
+
+    bool linkSucceeded(unsigned int program, const std::string& name, bool logErrors)
+    {
+      int success;
+      glGetProgramiv(program, GL_LINK_STATUS, &success);
+      if (!success && logErrors)
+      {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+        std::cerr << "Shader link error (" << name << "):\n" << infoLog << std::endl;
+      }
+      return success != 0;
+    }
+
+    std::string programName(const std::string& vertexFile, const std::string& fragmentFile)
+    {
+      return vertexFile + " + " + fragmentFile;
+    }
+  }
+
+  int ShaderProgram::uniform(std::string_view name) const
+  {
+    auto it = uniforms.find(std::string(name));
+    return it != uniforms.end() ? it->second : -1;
+  }
+
+  ShaderCache::ShaderCache(std::filesystem::path shaderDirectory, std::filesystem::path binaryDirectory)
+    : shaderDirectory(std::move(shaderDirectory)), binaryDirectory(std::move(binaryDirectory))
+  {
+    // binaries only load back on the exact same driver
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+      if (const GLubyte* value = glGetString(name))
+        driverId += reinterpret_cast<const char*>(value);
+
+    int formats = 0;
+    if (GLAD_GL_VERSION_4_1)
+      glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    binarySupported = formats > 0 && !this->binaryDirectory.empty();
+    if (binarySupported)
+    {
+      std::error_code error;
+      std::filesystem::create_directories(this->binaryDirectory, error);
+    }
+  }
+
+  ShaderCache::~ShaderCache()
+  {
+    for (Entry& entry : entries)
+      if (entry.program->programId)
+        glDeleteProgram(entry.program->programId);
+  }
+
+  const ShaderProgram& ShaderCache::load(const std::string& vertexFile, const std::string& fragmentFile)
+  {
+    for (const Entry& entry : entries)
+      if (entry.vertexFile == vertexFile && entry.fragmentFile == fragmentFile)
+        return *entry.program;
+
+    Entry& entry = entries.emplace_back();
+    entry.vertexFile = vertexFile;
+    entry.fragmentFile = fragmentFile;
+    entry.program = std::make_unique<ShaderProgram>();
+    build(entry);
+    return *entry.program;
+  }
+
+  int ShaderCache::reloadChanged()
+  {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < pollInterval)
+      return 0;
+    lastPoll = now;
+
+    int reloaded = 0;
+    for (Entry& entry : entries)
+    {
+      if (modifiedTime(shaderDirectory / entry.vertexFile) == entry.vertexTime &&
+          modifiedTime(shaderDirectory / entry.fragmentFile) == entry.fragmentTime)
+        continue;
+
+      // build() records the new times, a broken edit is not retried until
+      // the file changes again
+      if (build(entry))
+      {
+        std::cout << "Reloaded shader " << programName(entry.vertexFile, entry.fragmentFile) << std::endl;
+        reloaded++;
+      }
+    }
+    return reloaded;
+  }
+
+  bool ShaderCache::build(Entry& entry)
+  {
+    const std::string name = programName(entry.vertexFile, entry.fragmentFile);
+    entry.vertexTime = modifiedTime(shaderDirectory / entry.vertexFile);
+    entry.fragmentTime = modifiedTime(shaderDirectory / entry.fragmentFile);
+
+    std::string vertexSource, fragmentSource;
+    if (!readFile(shaderDirectory / entry.vertexFile, vertexSource) || !readFile(shaderDirectory / entry.fragmentFile, fragmentSource))
+    {
+      std::cerr << "Failed to open shader files: " << name << " in " << shaderDirectory.string() << std::endl;
+      return false;
+    }
+
+    // the binary is only valid for these exact sources on this exact driver
+    uint64_t key = fnv1a(&binaryVersion, sizeof(binaryVersion));
+    key = fnv1a(key, driverId.data(), driverId.size());
+    key = fnv1a(key, vertexSource.c_str(), vertexSource.size() + 1);
+    key = fnv1a(key, fragmentSource.c_str(), fragmentSource.size() + 1);
+
+    unsigned int program = 0;
+    if (binarySupported)
+    {
+      program = loadBinary(binaryPath(entry), key);
+      if (program)
+        binaryHits++;
+    }
+    if (!program)
+    {
+      program = compileAndLink(entry, vertexSource, fragmentSource);
+      if (!program)
+        return false;
+      if (binarySupported)
+        saveBinary(program, binaryPath(entry), key);
+    }
+
+    ShaderProgram& target = *entry.program;
+    if (target.programId)
+      glDeleteProgram(target.programId);
+    target.programId = program;
+    target.programRevision++;
+
+    // reflect every active uniform once, arrays under their plain name
+    target.uniforms.clear();
+    int count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; i++)
+    {
+      char uniformName[256];
+      GLsizei length = 0;
+      GLint size;
+      GLenum type;
+      glGetActiveUniform(program, GLuint(i), sizeof(uniformName), &length, &size, &type, uniformName);
+      std::string uniform(uniformName, size_t(length));
+      if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+        uniform.resize(uniform.size() - 3);
+      target.uniforms[uniform] = glGetUniformLocation(program, uniformName);
+    }
+    return true;
+  }
+
+  unsigned int ShaderCache::compileAndLink(const Entry& entry, const std::string& vertexSource, const std::string& fragmentSource)
+  {
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, entry.vertexFile);
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, entry.fragmentFile);
+    if (!vertexShader || !fragmentShader)
+    {
+      glDeleteShader(vertexShader);
+      glDeleteShader(fragmentShader);
+      return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    if (binarySupported)
+      glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if (!linkSucceeded(program, programName(entry.vertexFile, entry.fragmentFile), true))
+    {
+      glDeleteProgram(program);
+      return 0;
+    }
+    return program;
+  }
+
+  unsigned int ShaderCache::loadBinary(const std::filesystem::path& path, uint64_t key)
+  {
+    std::ifstream file(path, std::ios::binary);
+    BinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+      return 0;
+    if (header.magic != binaryMagic || header.version != binaryVersion || header.key != key || header.length == 0)
+      return 0;
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), std::streamsize(binary.size())))
+      return 0;
+
+    // drivers may still refuse a binary (e.g. after an update that kept the
+    // version string), that just means a normal compile
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+    if (!linkSucceeded(program, path.string(), false))
+    {
+      glDeleteProgram(program);
+      return 0;
+    }
+    return program;
+  }
+
+  void ShaderCache::saveBinary(unsigned int program, const std::filesystem::path& path, uint64_t key)
+  {
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+      return;
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    const BinaryHeader header = { binaryMagic, binaryVersion, key, format, uint32_t(length) };
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+  }
+
+  std::filesystem::path ShaderCache::binaryPath(const Entry& entry) const
+  {
+    return binaryDirectory / (std::filesystem::path(entry.vertexFile).stem().string() + "+" +
+                              std::filesystem::path(entry.fragmentFile).stem().string() + ".bin");
+  }
+}
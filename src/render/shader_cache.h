@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  // A linked program and its reflected uniform locations. The GL id and the
+  // locations change when the cache hot reloads it, revision() goes up each
+  // time so users can re-fetch locations they cached
+  class ShaderProgram
+  {
+  public:
+    unsigned int id() const { return programId; }
+    uint32_t revision() const { return programRevision; }
+
+    // -1 when the program has no active uniform of that name
+    int uniform(std::string_view name) const;
+
+  private:
+    friend class ShaderCache;
+
+    unsigned int programId = 0;
+    uint32_t programRevision = 0;
+    std::unordered_map<std::string, int> uniforms;
+  };
+
+  // Compiles and links vertex + fragment pairs from shaderDirectory and keeps
+  // them up to date:
+  //  - reloadChanged() polls file modification times and relinks edited
+  //    programs in place, a program that fails to build keeps the old one
+  //  - linked programs are saved with glGetProgramBinary and loaded back on
+  //    the next run, keyed on the sources and the driver, skipping the
+  //    compile entirely when nothing changed
+  class ShaderCache
+  {
+  public:
+    // binaryDirectory empty disables the binary cache
+    ShaderCache(std::filesystem::path shaderDirectory, std::filesystem::path binaryDirectory);
+    ~ShaderCache();
+
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    // file names are relative to shaderDirectory. The returned program lives
+    // as long as the cache. Its id is 0 if the first build failed
+    const ShaderProgram& load(const std::string& vertexFile, const std::string& fragmentFile);
+
+    // cheap to call every frame, only stats the files every pollInterval.
+    // Returns how many programs were rebuilt
+    int reloadChanged();
+
+    bool binaryCacheSupported() const { return binarySupported; }
+    int binaryCacheHits() const { return binaryHits; }
+
+    std::chrono::milliseconds pollInterval{ 250 };
+
+  private:
+    struct Entry
+    {
+      std::string vertexFile;
+      std::string fragmentFile;
+      std::filesystem::file_time_type vertexTime;
+      std::filesystem::file_time_type fragmentTime;
+      std::unique_ptr<ShaderProgram> program;
+    };
+
+    bool build(Entry& entry);
+    unsigned int compileAndLink(const Entry& entry, const std::string& vertexSource, const std::string& fragmentSource);
+    unsigned int loadBinary(const std::filesystem::path& path, uint64_t key);
+    void saveBinary(unsigned int program, const std::filesystem::path& path, uint64_t key);
+    std::filesystem::path binaryPath(const Entry& entry) const;
+
+    std::filesystem::path shaderDirectory;
+    std::filesystem::path binaryDirectory;
+    std::vector<Entry> entries;
+    std::string driverId;
+    bool binarySupported = false;
+    int binaryHits = 0;
+    std::chrono::steady_clock::time_point lastPoll;
+  };
+}
@@ -0,0 +1,32 @@
+#include "render/texture_array.h"
+
+#include <glad/glad.h>
+
+namespace zm
+{
+  unsigned int createTextureArray(const TextureArrayAsset& asset)
+  {
+    if (asset.layerCount() == 0)
+      return 0;
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, GLsizei(asset.mipCount()), GL_RGBA8, GLsizei(asset.layerSize()), GLsizei(asset.layerSize()), GLsizei(asset.layerCount()));
+
+    // RGBA8 rows are always 4 byte aligned, don't depend on whatever the
+    // unpack state was left at
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (uint32_t level = 0; level < asset.mipCount(); level++)
+    {
+      const GLsizei size = GLsizei(asset.mipSize(level));
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, GLint(level), 0, 0, 0, size, size, GLsizei(asset.layerCount()), GL_RGBA, GL_UNSIGNED_BYTE, asset.mipData(level));
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+  }
+}
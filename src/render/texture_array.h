@@ -0,0 +1,10 @@
+#pragma once
+
+#include "assets/texture_array_asset.h"
+
+namespace zm
+{
+  // Uploads every mip of the asset into a new GL_TEXTURE_2D_ARRAY, one call
+  // per mip level straight from the asset's memory. Returns 0 on failure
+  unsigned int createTextureArray(const TextureArrayAsset& asset);
+}
@@ -0,0 +1,97 @@
+#include "render/voxel_renderer.h"
+
+#include "world/block.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+namespace zm
+{
+  namespace
+  {
+    // matches the faceLayers array in voxel_fragment_shader.glsl
+    constexpr int MAX_SHADED_BLOCKS = 16;
+  }
+
+  VoxelRenderer::VoxelRenderer(const ShaderProgram& program, uint32_t nodeCapacity) : program(program), capacity(nodeCapacity)
+  {
+    // core profile draws need a vertex array even without attributes
+    glGenVertexArrays(1, &vao);
+
+    glGenBuffers(1, &nodeBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(size_t(capacity) * sizeof(VoxelNode)), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  VoxelRenderer::~VoxelRenderer()
+  {
+    glDeleteBuffers(1, &nodeBuffer);
+    glDeleteVertexArrays(1, &vao);
+  }
+
+  void VoxelRenderer::upload(VoxelTree& tree)
+  {
+    tree.takeDirtyRanges(ranges);
+    uploadBytes = 0;
+    if (ranges.empty())
+      return;
+
+    // glBufferSubData waits for draws still reading the old contents, the
+    // tree only ever rewrites ranges it has reallocated
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBuffer);
+    const std::vector<VoxelNode>& nodes = tree.nodes();
+    for (const BufferRange& range : ranges)
+    {
+      if (range.offset + range.size > capacity)
+        continue;
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(size_t(range.offset) * sizeof(VoxelNode)), GLsizeiptr(size_t(range.size) * sizeof(VoxelNode)),
+                      &nodes[range.offset]);
+      uploadBytes += size_t(range.size) * sizeof(VoxelNode);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  void VoxelRenderer::draw(const VoxelTree& tree, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition,
+                           float maxDistance, unsigned int texture)
+  {
+    if (!tree.hasRoot())
+      return;
+
+    if (programRevision != program.revision())
+    {
+      viewProjectionLocation = program.uniform("viewProjection");
+      inverseViewProjectionLocation = program.uniform("inverseViewProjection");
+      cameraPositionLocation = program.uniform("cameraPosition");
+      rootOriginLocation = program.uniform("rootOrigin");
+      rootIndexLocation = program.uniform("rootIndex");
+      maxDistanceLocation = program.uniform("maxDistance");
+      faceLayersLocation = program.uniform("faceLayers");
+      programRevision = program.revision();
+    }
+
+    GLuint faceLayers[MAX_SHADED_BLOCKS * FACE_COUNT] = {};
+    for (int id = 0; id < std::min<int>(BLOCK_COUNT, MAX_SHADED_BLOCKS); id++)
+      for (int face = 0; face < FACE_COUNT; face++)
+        faceLayers[id * FACE_COUNT + face] = blockInfo(BlockId(id)).textureLayer[face];
+
+    const glm::mat4 viewProjection = projection * view;
+    const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+    const glm::vec3 origin = glm::vec3(tree.origin());
+    glUseProgram(program.id());
+    glUniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glUniformMatrix4fv(inverseViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+    glUniform3fv(cameraPositionLocation, 1, glm::value_ptr(cameraPosition - origin));
+    glUniform3fv(rootOriginLocation, 1, glm::value_ptr(origin));
+    glUniform1ui(rootIndexLocation, tree.rootIndex());
+    glUniform1f(maxDistanceLocation, maxDistance);
+    glUniform1uiv(faceLayersLocation, MAX_SHADED_BLOCKS * FACE_COUNT, faceLayers);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, nodeBuffer);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "render/buffer_allocator.h"
+#include "render/shader_cache.h"
+#include "render/voxel_tree.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zm
+{
+  // Draws a VoxelTree by ray marching it, one fullscreen triangle running
+  // voxel_fragment_shader.glsl, instead of a mesh per chunk. The node array
+  // is an SSBO as big as the tree's capacity and each upload only copies
+  // the ranges the tree rewrote since the last one
+  class VoxelRenderer
+  {
+  public:
+    // program must be linked from voxel_vertex_shader.glsl and
+    // voxel_fragment_shader.glsl
+    VoxelRenderer(const ShaderProgram& program, uint32_t nodeCapacity);
+    ~VoxelRenderer();
+
+    VoxelRenderer(const VoxelRenderer&) = delete;
+    VoxelRenderer& operator=(const VoxelRenderer&) = delete;
+
+    void upload(VoxelTree& tree);
+
+    // texture is the block texture array. Writes depth, so it mixes with
+    // anything rasterized in the same frame
+    void draw(const VoxelTree& tree, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float maxDistance,
+              unsigned int texture);
+
+    // bytes copied to the GPU by the last upload
+    size_t lastUploadBytes() const { return uploadBytes; }
+
+  private:
+    const ShaderProgram& program;
+    uint32_t programRevision = 0;
+    int viewProjectionLocation = -1;
+    int inverseViewProjectionLocation = -1;
+    int cameraPositionLocation = -1;
+    int rootOriginLocation = -1;
+    int rootIndexLocation = -1;
+    int maxDistanceLocation = -1;
+    int faceLayersLocation = -1;
+
+    unsigned int vao = 0;
+    unsigned int nodeBuffer = 0;
+    uint32_t capacity;
+    std::vector<BufferRange> ranges;
+    size_t uploadBytes = 0;
+  };
+}
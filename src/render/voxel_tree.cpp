@@ -0,0 +1,464 @@
+#include "render/voxel_tree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace zm
+{
+  namespace
+  {
+    bool usesOffset(const VoxelNode& node)
+    {
+      return node.kind() == VOXEL_INTERNAL || (node.kind() == VOXEL_LEAF && !(node.flags & VOXEL_SINGLE_BLOCK));
+    }
+
+    int brickIndex(int x, int y, int z)
+    {
+      return x | (z << VoxelTree::BRICK_SHIFT) | (y << (2 * VoxelTree::BRICK_SHIFT));
+    }
+
+    glm::ivec3 bitCell(int bit) { return { bit & 3, bit >> 4, (bit >> 2) & 3 }; }
+
+    // block id rank of a leaf, stored as bytes 16 to a node slot
+    BlockId leafBlock(const std::vector<VoxelNode>& nodes, uint32_t leaf, int rank)
+    {
+      const VoxelNode& node = nodes[leaf];
+      if (node.flags & VOXEL_SINGLE_BLOCK)
+        return node.block();
+      uint32_t words[4];
+      std::memcpy(words, &nodes[leaf + node.offset + rank / 16], sizeof(words));
+      return BlockId((words[(rank & 15) >> 2] >> ((rank & 3) * 8)) & 0xFFu);
+    }
+  }
+
+  VoxelTree::VoxelTree(uint32_t nodeCapacity)
+    : allocator(nodeCapacity), brickBlocks(size_t(BRICK_SIZE) * BRICK_SIZE * BRICK_SIZE), chunkBlocks(CHUNK_VOLUME)
+  {
+  }
+
+  void VoxelTree::markChunk(ChunkCoord coord)
+  {
+    const glm::ivec3 block = glm::ivec3(coord.x, coord.y, coord.z) * CHUNK_SIZE - origin();
+    if (glm::any(glm::lessThan(block, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(block, glm::ivec3(ROOT_SIZE))))
+      return;
+    dirty.insert(brickKey(block >> BRICK_SHIFT));
+  }
+
+  size_t VoxelTree::update(const ChunkStorage& world, const std::function<bool(ChunkCoord)>& isReady, size_t maxBricks)
+  {
+    constexpr int chunksPerBrick = BRICK_SIZE / CHUNK_SIZE;
+    size_t built = 0;
+    for (auto it = dirty.begin(); it != dirty.end() && built < maxBricks;)
+    {
+      const glm::ivec3 first = (brickCoord(*it) * BRICK_SIZE + origin()) / CHUNK_SIZE;
+      bool ready = true;
+      for (int y = 0; y < chunksPerBrick; y++)
+        for (int z = 0; z < chunksPerBrick; z++)
+          for (int x = 0; x < chunksPerBrick; x++)
+          {
+            const ChunkCoord coord = { first.x + x, first.y + y, first.z + z };
+            if (world.getChunk(coord) && !isReady(coord))
+              ready = false;
+          }
+      if (!ready)
+      {
+        ++it;
+        continue;
+      }
+      buildBrick(world, *it);
+      built++;
+      it = dirty.erase(it);
+    }
+    if (built > 0)
+      rebuildTop();
+    return built;
+  }
+
+  bool VoxelTree::buildBrick(const ChunkStorage& world, uint32_t key)
+  {
+    constexpr int chunksPerBrick = BRICK_SIZE / CHUNK_SIZE;
+    const glm::ivec3 first = (brickCoord(key) * BRICK_SIZE + origin()) / CHUNK_SIZE;
+    std::fill(brickBlocks.begin(), brickBlocks.end(), BLOCK_AIR);
+    for (int cy = 0; cy < chunksPerBrick; cy++)
+      for (int cz = 0; cz < chunksPerBrick; cz++)
+        for (int cx = 0; cx < chunksPerBrick; cx++)
+        {
+          const Chunk* chunk = world.getChunk({ first.x + cx, first.y + cy, first.z + cz });
+          if (!chunk || (chunk->isUniform() && chunk->uniformBlock() == BLOCK_AIR))
+            continue;
+          chunk->unpack(chunkBlocks.data());
+          // rows along x stay contiguous in both layouts
+          for (int y = 0; y < CHUNK_SIZE; y++)
+            for (int z = 0; z < CHUNK_SIZE; z++)
+              std::copy_n(&chunkBlocks[chunkIndex(0, y, z)], CHUNK_SIZE,
+                          &brickBlocks[brickIndex(cx * CHUNK_SIZE, cy * CHUNK_SIZE + y, cz * CHUNK_SIZE + z)]);
+        }
+
+    blob.clear();
+    VoxelNode root = encode(BRICK_SHIFT, glm::ivec3(0));
+    bricksBuilt++;
+
+    auto it = bricks.find(key);
+    if (it != bricks.end())
+    {
+      allocator.free(it->second.range);
+      bricks.erase(it);
+    }
+    if (root.empty())
+      return true;
+
+    Brick brick;
+    brick.root = root;
+    if (!blob.empty())
+    {
+      brick.range = allocator.allocate(uint32_t(blob.size()));
+      if (!brick.range.valid())
+      {
+        failedBricks++;
+        return false;
+      }
+      write(brick.range, blob.data());
+    }
+    bricks.emplace(key, brick);
+    return true;
+  }
+
+  // Node of size 1 << shift at min inside the brick. Children are encoded
+  // first, each appending its own subtree to blob, then stored together.
+  // Offsets come back relative to the start of blob and are made relative
+  // to the node once it has its slot
+  VoxelNode VoxelTree::encode(int shift, const glm::ivec3& min)
+  {
+    VoxelNode node;
+    if (shift == 2)
+    {
+      uint64_t mask = 0;
+      uint8_t ids[64];
+      int count = 0;
+      bool single = true;
+      for (int bit = 0; bit < 64; bit++)
+      {
+        const glm::ivec3 block = min + bitCell(bit);
+        const BlockId id = brickBlocks[brickIndex(block.x, block.y, block.z)];
+        if (id == BLOCK_AIR)
+          continue;
+        mask |= uint64_t(1) << bit;
+        // ids above 255 don't exist yet, one byte each keeps leaves small
+        ids[count] = uint8_t(std::min<BlockId>(id, 255));
+        single &= ids[count] == ids[0];
+        count++;
+      }
+      if (mask == 0)
+        return node;
+      if (mask == ~uint64_t(0) && single)
+      {
+        node.flags = VOXEL_SOLID | (uint32_t(ids[0]) << 16);
+        return node;
+      }
+
+      node.maskLow = uint32_t(mask);
+      node.maskHigh = uint32_t(mask >> 32);
+      if (single)
+      {
+        node.flags = VOXEL_LEAF | VOXEL_SINGLE_BLOCK | (uint32_t(ids[0]) << 16);
+        return node;
+      }
+      node.flags = VOXEL_LEAF;
+      node.offset = int32_t(blob.size());
+      const size_t slots = size_t(count + 15) / 16;
+      blob.resize(blob.size() + slots);
+      uint8_t* bytes = reinterpret_cast<uint8_t*>(&blob[size_t(node.offset)]);
+      std::memset(bytes, 0, slots * sizeof(VoxelNode));
+      for (int i = 0; i < count; i++)
+        bytes[i] = ids[i];
+      return node;
+    }
+
+    VoxelNode children[64];
+    uint64_t mask = 0;
+    bool uniform = true;
+    const int childShift = shift - 2;
+    for (int bit = 0; bit < 64; bit++)
+    {
+      children[bit] = encode(childShift, min + (bitCell(bit) << childShift));
+      if (!children[bit].empty())
+        mask |= uint64_t(1) << bit;
+      uniform &= children[bit].kind() == VOXEL_SOLID && children[bit].block() == children[0].block();
+    }
+    if (mask == 0)
+      return node;
+    if (uniform)
+    {
+      node.flags = children[0].flags;
+      return node;
+    }
+
+    const uint32_t base = uint32_t(blob.size());
+    blob.resize(blob.size() + size_t(std::popcount(mask)));
+    uint32_t slot = base;
+    for (uint64_t bits = mask; bits; bits &= bits - 1, slot++)
+    {
+      VoxelNode child = children[std::countr_zero(bits)];
+      if (usesOffset(child))
+        child.offset -= int32_t(slot);
+      blob[slot] = child;
+    }
+    node.maskLow = uint32_t(mask);
+    node.maskHigh = uint32_t(mask >> 32);
+    node.offset = int32_t(base);
+    node.flags = VOXEL_INTERNAL;
+    return node;
+  }
+
+  // Root, 1024 and 256 block nodes over the bricks, rebuilt whole whenever
+  // a brick changes. It is one node per occupied cell, tiny next to the
+  // bricks, and a fresh range keeps it contiguous
+  void VoxelTree::rebuildTop()
+  {
+    for (auto& masks : topMasks)
+      masks.clear();
+    for (const auto& [key, brick] : bricks)
+    {
+      const glm::ivec3 b = brickCoord(key);
+      topMasks[2][brickKey(b >> 2)] |= uint64_t(1) << voxelCellBit(b.x & 3, b.y & 3, b.z & 3);
+      topMasks[1][brickKey(b >> 4)] |= uint64_t(1) << voxelCellBit((b.x >> 2) & 3, (b.y >> 2) & 3, (b.z >> 2) & 3);
+      topMasks[0][0] |= uint64_t(1) << voxelCellBit(b.x >> 4, b.y >> 4, b.z >> 4);
+    }
+
+    if (topRange.valid())
+      allocator.free(topRange);
+    topRange = {};
+    if (bricks.empty())
+      return;
+
+    const uint32_t count = uint32_t(1 + topMasks[1].size() + topMasks[2].size() + bricks.size());
+    topRange = allocator.allocate(count);
+    if (!topRange.valid())
+    {
+      std::fprintf(stderr, "VoxelTree: no room for the top levels (%u nodes)\n", count);
+      return;
+    }
+    if (image.size() < size_t(topRange.offset) + topRange.size)
+      image.resize(size_t(topRange.offset) + topRange.size);
+    uint32_t cursor = topRange.offset + 1;
+    encodeTop(0, 0, topMasks[0][0], topRange.offset, cursor);
+    dirtyRanges.push_back(topRange);
+  }
+
+  void VoxelTree::encodeTop(int depth, uint32_t cell, uint64_t mask, uint32_t index, uint32_t& cursor)
+  {
+    VoxelNode node;
+    node.maskLow = uint32_t(mask);
+    node.maskHigh = uint32_t(mask >> 32);
+    node.flags = VOXEL_INTERNAL;
+    const uint32_t base = cursor;
+    cursor += uint32_t(std::popcount(mask));
+    node.offset = int32_t(base) - int32_t(index);
+    image[index] = node;
+
+    const glm::ivec3 coord = brickCoord(cell);
+    uint32_t slot = base;
+    for (uint64_t bits = mask; bits; bits &= bits - 1, slot++)
+    {
+      const uint32_t childKey = brickKey(coord * 4 + bitCell(std::countr_zero(bits)));
+      if (depth == 2)
+      {
+        // a copy of the brick's root, pointing into the brick's range
+        const Brick& brick = bricks.at(childKey);
+        VoxelNode root = brick.root;
+        if (usesOffset(root))
+          root.offset = int32_t(brick.range.offset) + root.offset - int32_t(slot);
+        image[slot] = root;
+      }
+      else
+        encodeTop(depth + 1, childKey, topMasks[depth + 1][childKey], slot, cursor);
+    }
+  }
+
+  void VoxelTree::write(BufferRange range, const VoxelNode* source)
+  {
+    if (image.size() < size_t(range.offset) + range.size)
+      image.resize(size_t(range.offset) + range.size);
+    std::copy_n(source, range.size, &image[range.offset]);
+    dirtyRanges.push_back(range);
+  }
+
+  BlockId VoxelTree::getBlock(int x, int y, int z) const
+  {
+    const glm::ivec3 block = glm::ivec3(x, y, z) - origin();
+    if (!hasRoot() || glm::any(glm::lessThan(block, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(block, glm::ivec3(ROOT_SIZE))))
+      return BLOCK_AIR;
+
+    uint32_t index = rootIndex();
+    for (int depth = 0; depth < DEPTH; depth++)
+    {
+      const VoxelNode& node = image[index];
+      if (node.kind() == VOXEL_SOLID)
+        return node.block();
+      const glm::ivec3 cell = (block >> (ROOT_SHIFT - 2 * (depth + 1))) & 3;
+      const int bit = voxelCellBit(cell.x, cell.y, cell.z);
+      const uint64_t mask = node.mask();
+      if (!(mask & (uint64_t(1) << bit)))
+        return BLOCK_AIR;
+      if (node.kind() == VOXEL_LEAF)
+        return leafBlock(image, index, voxelRank(mask, bit));
+      index += uint32_t(node.offset + voxelRank(mask, bit));
+    }
+    return BLOCK_AIR;
+  }
+
+  bool VoxelTree::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, VoxelHit& hit) const
+  {
+    if (!hasRoot())
+      return false;
+
+    // everything in root space, 0..ROOT_SIZE on each axis
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    const glm::vec3 o = origin - glm::vec3(this->origin());
+    glm::vec3 inverse;
+    float tEnter = 0.0f, tExit = maxDistance;
+    int enterAxis = -1;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      if (direction[axis] == 0.0f)
+      {
+        inverse[axis] = infinity;
+        if (o[axis] < 0.0f || o[axis] >= float(ROOT_SIZE))
+          return false;
+        continue;
+      }
+      inverse[axis] = 1.0f / direction[axis];
+      float t0 = -o[axis] * inverse[axis];
+      float t1 = (float(ROOT_SIZE) - o[axis]) * inverse[axis];
+      if (t0 > t1)
+        std::swap(t0, t1);
+      if (t0 > tEnter)
+      {
+        tEnter = t0;
+        enterAxis = axis;
+      }
+      tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit)
+      return false;
+
+    // the block the ray is in is tracked in integers, floats only decide
+    // which face of a cell it leaves through
+    float t = tEnter;
+    glm::ivec3 block = glm::clamp(glm::ivec3(glm::floor(o + direction * t)), glm::ivec3(0), glm::ivec3(ROOT_SIZE - 1));
+    int face = -1;
+    if (enterAxis >= 0)
+    {
+      block[enterAxis] = direction[enterAxis] > 0.0f ? 0 : ROOT_SIZE - 1;
+      face = enterAxis * 2 + (direction[enterAxis] > 0.0f ? 0 : 1);
+    }
+
+    uint32_t stack[DEPTH];
+    glm::ivec3 nodeCells[DEPTH];
+    nodeCells[0] = glm::ivec3(0);
+    int depth = 0;
+    uint32_t index = rootIndex();
+    for (int step = 0; step < MAX_STEPS; step++)
+    {
+      const VoxelNode& node = image[index];
+      const int childShift = ROOT_SHIFT - 2 * (depth + 1);
+      BlockId id = BLOCK_AIR;
+      if (node.kind() == VOXEL_SOLID)
+        id = node.block();
+      else
+      {
+        const glm::ivec3 cell = (block >> childShift) & 3;
+        const int bit = voxelCellBit(cell.x, cell.y, cell.z);
+        const uint64_t mask = node.mask();
+        if (mask & (uint64_t(1) << bit))
+        {
+          if (node.kind() == VOXEL_LEAF)
+            id = leafBlock(image, index, voxelRank(mask, bit));
+          else
+          {
+            stack[depth] = index;
+            depth++;
+            nodeCells[depth] = block >> childShift;
+            index += uint32_t(node.offset + voxelRank(mask, bit));
+            continue;
+          }
+        }
+      }
+      if (id != BLOCK_AIR)
+      {
+        hit.block = block + this->origin();
+        hit.id = id;
+        hit.face = face;
+        hit.distance = t;
+        return true;
+      }
+
+      // an empty cell, leave it through the nearest face
+      const int size = 1 << childShift;
+      const glm::ivec3 cellMin = (block >> childShift) << childShift;
+      float next = infinity;
+      int axis = 0;
+      for (int a = 0; a < 3; a++)
+      {
+        if (direction[a] == 0.0f)
+          continue;
+        const float boundary = float(cellMin[a] + (direction[a] > 0.0f ? size : 0));
+        const float ta = (boundary - o[a]) * inverse[a];
+        if (ta < next)
+        {
+          next = ta;
+          axis = a;
+        }
+      }
+      if (next > tExit)
+        return false;
+      t = std::max(t, next);
+
+      // the other axes stay inside the cell whatever the rounding did
+      const glm::vec3 position = o + direction * t;
+      for (int a = 0; a < 3; a++)
+        block[a] = std::clamp(int(std::floor(position[a])), cellMin[a], cellMin[a] + size - 1);
+      block[axis] = direction[axis] > 0.0f ? cellMin[axis] + size : cellMin[axis] - 1;
+      face = axis * 2 + (direction[axis] > 0.0f ? 0 : 1);
+      if (block[axis] < 0 || block[axis] >= ROOT_SIZE)
+        return false;
+
+      while (depth > 0 && (block >> (ROOT_SHIFT - 2 * depth)) != nodeCells[depth])
+        index = stack[--depth];
+    }
+    return false;
+  }
+
+  void VoxelTree::takeDirtyRanges(std::vector<BufferRange>& out)
+  {
+    out.clear();
+    std::sort(dirtyRanges.begin(), dirtyRanges.end(), [](const BufferRange& a, const BufferRange& b) { return a.offset < b.offset; });
+    for (const BufferRange& range : dirtyRanges)
+    {
+      if (!out.empty() && range.offset <= out.back().offset + out.back().size)
+      {
+        const uint32_t end = std::max(out.back().offset + out.back().size, range.offset + range.size);
+        out.back().size = end - out.back().offset;
+      }
+      else
+        out.push_back(range);
+    }
+    dirtyRanges.clear();
+  }
+
+  VoxelTreeStats VoxelTree::stats() const
+  {
+    VoxelTreeStats out;
+    out.bricks = bricks.size();
+    out.dirtyBricks = dirty.size();
+    out.usedNodes = allocator.usedSize();
+    out.capacityNodes = allocator.capacity();
+    out.topNodes = topRange.size;
+    out.bricksBuilt = bricksBuilt;
+    out.failedBricks = failedBricks;
+    return out;
+  }
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "render/buffer_allocator.h"
+#include "world/chunk_storage.h"
+
+#include <glm/glm.hpp>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace zm
+{
+  enum VoxelNodeKind : uint32_t
+  {
+    VOXEL_INTERNAL = 0, // offset points at the children, one per set mask bit
+    VOXEL_LEAF = 1,     // 4x4x4 blocks, the mask is which ones are there
+    VOXEL_SOLID = 2,    // completely filled with one block, no children
+  };
+  // leaves whose blocks are all the same keep it in the flags, no materials
+  constexpr uint32_t VOXEL_SINGLE_BLOCK = 4;
+
+  // One 64-tree node, laid out as the uvec4 the shader reads. Every node
+  // splits its cube into 4x4x4 cells, bit x | z << 2 | y << 4 of the mask is
+  // set for the cells with anything in them. Children (and a leaf's block
+  // ids, one byte each, 16 per node slot) are stored contiguously in mask
+  // bit order, so child i is at index + offset + popcount of the mask below
+  // bit i. offset is relative to the node's own index, which lets whole
+  // subtrees move around the buffer without being rewritten
+  struct VoxelNode
+  {
+    uint32_t maskLow = 0;
+    uint32_t maskHigh = 0;
+    int32_t offset = 0;
+    uint32_t flags = 0; // kind in bits 0-1, VOXEL_SINGLE_BLOCK, block id in bits 16-31
+
+    uint64_t mask() const { return uint64_t(maskLow) | (uint64_t(maskHigh) << 32); }
+    uint32_t kind() const { return flags & 3u; }
+    BlockId block() const { return BlockId(flags >> 16); }
+    bool empty() const { return maskLow == 0 && maskHigh == 0 && kind() != VOXEL_SOLID; }
+  };
+  static_assert(sizeof(VoxelNode) == 16, "VoxelNode is a uvec4 on the GPU");
+
+  inline int voxelCellBit(int x, int y, int z) { return x | (z << 2) | (y << 4); }
+  // children (or blocks) stored before the one for bit
+  inline int voxelRank(uint64_t mask, int bit) { return std::popcount(mask & ((uint64_t(1) << bit) - 1)); }
+
+  struct VoxelHit
+  {
+    glm::ivec3 block = glm::ivec3(0);
+    BlockId id = BLOCK_AIR;
+    // face of the block the ray entered through as in Face, -1 when it started inside
+    int face = -1;
+    float distance = 0.0f;
+  };
+
+  struct VoxelTreeStats
+  {
+    size_t bricks = 0;           // non-empty 64^3 bricks in the tree
+    size_t dirtyBricks = 0;      // waiting for update(), some on chunks still generating
+    uint32_t usedNodes = 0;      // node slots in use, bricks and top levels
+    uint32_t capacityNodes = 0;
+    uint32_t topNodes = 0;
+    uint64_t bricksBuilt = 0;    // since startup
+    uint32_t failedBricks = 0;   // did not fit, since startup
+  };
+
+  // The world as a sparse 64-tree in one flat node array, the same array
+  // the ray marching shader gets as an SSBO. The root covers a 4096 block
+  // cube around the world origin, six levels down to 4x4x4 leaves.
+  //
+  // The tree is kept in 64^3 block bricks (2x2x2 chunks), each built on its
+  // own from the chunk data into a range of the node array handed out by a
+  // BufferAllocator. Changing a chunk rebuilds its brick into a new range and
+  // the few top levels above the bricks, so the GPU copy only needs the
+  // ranges that changed. Cells filled with one block collapse into a single
+  // VOXEL_SOLID node at any level, which keeps solid ground cheap.
+  //
+  // Render thread only, like the ChunkStorage map it reads
+  class VoxelTree
+  {
+  public:
+    static constexpr int ROOT_SHIFT = 12;
+    static constexpr int ROOT_SIZE = 1 << ROOT_SHIFT;
+    static constexpr int BRICK_SHIFT = 6;
+    static constexpr int BRICK_SIZE = 1 << BRICK_SHIFT;
+    static constexpr int DEPTH = 6; // root down to the leaves
+    static constexpr int MAX_STEPS = 1024;
+
+    explicit VoxelTree(uint32_t nodeCapacity = 1u << 22);
+
+    // world block at the root's minimum corner
+    glm::ivec3 origin() const { return glm::ivec3(-ROOT_SIZE / 2); }
+
+    // coord changed (or just finished generating), its brick is rebuilt by
+    // the next update. Chunks outside the root are ignored
+    void markChunk(ChunkCoord coord);
+
+    // Rebuilds up to maxBricks marked bricks from world, then the top levels
+    // if anything changed. Bricks with a chunk isReady says is still being
+    // generated stay marked for a later update. Returns the bricks rebuilt
+    size_t update(const ChunkStorage& world, const std::function<bool(ChunkCoord)>& isReady, size_t maxBricks = SIZE_MAX);
+
+    // Reference traversal, the same walk voxel_fragment_shader.glsl does:
+    // descend to the cell containing the ray, skip empty cells whole, pop
+    // back up when the ray leaves a node. direction must be normalized
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, VoxelHit& hit) const;
+
+    // block at a world position as the tree stores it, for checks
+    BlockId getBlock(int x, int y, int z) const;
+
+    // node array, valid up to the highest range in use
+    const std::vector<VoxelNode>& nodes() const { return image; }
+    // index of the root node, false when the tree is empty
+    bool hasRoot() const { return topRange.valid(); }
+    uint32_t rootIndex() const { return topRange.offset; }
+
+    // node ranges rewritten since the last call, sorted and merged, for the
+    // GPU copy to pick up
+    void takeDirtyRanges(std::vector<BufferRange>& out);
+
+    VoxelTreeStats stats() const;
+
+  private:
+    struct Brick
+    {
+      BufferRange range;   // empty for bricks that are a single solid node
+      VoxelNode root;      // offset relative to range.offset
+    };
+
+    // brick coords are 6 bits per axis inside the root
+    static uint32_t brickKey(const glm::ivec3& brick) { return uint32_t(brick.x) | (uint32_t(brick.y) << 6) | (uint32_t(brick.z) << 12); }
+    static glm::ivec3 brickCoord(uint32_t key) { return { int(key & 63u), int((key >> 6) & 63u), int((key >> 12) & 63u) }; }
+
+    bool buildBrick(const ChunkStorage& world, uint32_t key);
+    VoxelNode encode(int shift, const glm::ivec3& cell);
+    void rebuildTop();
+    void encodeTop(int depth, uint32_t cell, uint64_t mask, uint32_t index, uint32_t& cursor);
+    void write(BufferRange range, const VoxelNode* source);
+
+    BufferAllocator allocator;
+    std::vector<VoxelNode> image;
+    std::unordered_map<uint32_t, Brick> bricks;
+    std::unordered_set<uint32_t> dirty;
+    BufferRange topRange;
+    std::vector<BufferRange> dirtyRanges;
+
+    // blocks of the brick being built, x fastest then z then y like chunks
+    std::vector<BlockId> brickBlocks;
+    std::vector<BlockId> chunkBlocks;
+    std::vector<VoxelNode> blob;
+    // occupied cells per top level while rebuilding the top
+    std::unordered_map<uint32_t, uint64_t> topMasks[3];
+
+    uint64_t bricksBuilt = 0;
+    uint32_t failedBricks = 0;
+  };
+}
@@ -0,0 +1,198 @@
+#include "sim/simulation.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace zm
+{
+  namespace
+  {
+    glm::vec3 frontOf(const PlayerState& player)
+    {
+      glm::vec3 direction;
+      direction.x = std::cos(glm::radians(player.yaw)) * std::cos(glm::radians(player.pitch));
+      direction.y = std::sin(glm::radians(player.pitch));
+      direction.z = std::sin(glm::radians(player.yaw)) * std::cos(glm::radians(player.pitch));
+      return glm::normalize(direction);
+    }
+  }
+
+  PlayerState interpolate(const PlayerState& from, const PlayerState& to, float t)
+  {
+    PlayerState out;
+    out.position = glm::mix(from.position, to.position, t);
+    out.yaw = from.yaw + (to.yaw - from.yaw) * t;
+    out.pitch = from.pitch + (to.pitch - from.pitch) * t;
+    out.fov = from.fov + (to.fov - from.fov) * t;
+    return out;
+  }
+
+  Simulation::Simulation(const PlayerState& start, const SimSettings& settings)
+    : settings(settings), tickLength(1.0f / settings.tickRate), inputs(settings.inputCapacity), player(start), previous(start), current(start),
+      currentTime(Clock::now())
+  {
+  }
+
+  Simulation::~Simulation()
+  {
+    stop();
+  }
+
+  void Simulation::start()
+  {
+    if (running.exchange(true))
+      return;
+    thread = std::thread([this] { run(); });
+  }
+
+  void Simulation::stop()
+  {
+    running.store(false);
+    if (thread.joinable())
+      thread.join();
+  }
+
+  void Simulation::step()
+  {
+    tick(Clock::now());
+  }
+
+  void Simulation::setSolids(std::shared_ptr<const SolidGrid> grid)
+  {
+    std::lock_guard<std::mutex> lock(solidsMutex);
+    solids = std::move(grid);
+  }
+
+  bool Simulation::pushInput(const InputEvent& event)
+  {
+    if (inputs.tryPush(event))
+      return true;
+    droppedInputs.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  void Simulation::run()
+  {
+    Profiler::get().setThreadName("simulation");
+    const auto length = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickLength));
+    Clock::time_point next = Clock::now();
+    while (running.load(std::memory_order_relaxed))
+    {
+      std::this_thread::sleep_until(next);
+      const Clock::time_point now = Clock::now();
+      if (now - next > length)
+        counters.lateTicks++;
+
+      // after a long stall start over from now, running every missed tick
+      // back to back would only make the next frames late too
+      if (now - next > length * settings.maxCatchUpTicks)
+      {
+        counters.skippedTicks += uint64_t((now - next) / length);
+        next = now;
+      }
+      tick(next);
+      next += length;
+    }
+  }
+
+  void Simulation::tick(Clock::time_point scheduled)
+  {
+    ZM_PROFILE_SCOPE("sim tick");
+    const Clock::time_point start = Clock::now();
+
+    InputEvent event;
+    while (inputs.tryPop(event))
+    {
+      counters.inputEvents++;
+      switch (event.type)
+      {
+      case InputType::Press:
+        held[event.action] = true;
+        break;
+      case InputType::Release:
+        held[event.action] = false;
+        break;
+      case InputType::Look:
+        player.yaw += event.x;
+        player.pitch = std::clamp(player.pitch + event.y, -89.0f, 89.0f);
+        break;
+      case InputType::Zoom:
+        player.fov = std::clamp(player.fov + event.x, 1.0f, 45.0f);
+        break;
+      }
+    }
+
+    // fly movement, the same speed whatever the tick rate
+    const glm::vec3 front = frontOf(player);
+    const glm::vec3 right = glm::normalize(glm::cross(front, glm::vec3(0.0f, 1.0f, 0.0f)));
+    const float distance = settings.moveSpeed * tickLength;
+    glm::vec3 motion(0.0f);
+    if (held[INPUT_FORWARD])
+      motion += front * distance;
+    if (held[INPUT_BACK])
+      motion -= front * distance;
+    if (held[INPUT_LEFT])
+      motion -= right * distance;
+    if (held[INPUT_RIGHT])
+      motion += right * distance;
+
+    std::shared_ptr<const SolidGrid> grid;
+    {
+      std::lock_guard<std::mutex> lock(solidsMutex);
+      grid = solids;
+    }
+    if (grid && motion != glm::vec3(0.0f))
+    {
+      const Aabb box = { player.position + settings.boxMin, player.position + settings.boxMax };
+      motion = sweepAabb(box, motion, [&](int x, int y, int z) { return grid->isSolid(x, y, z); }).moved;
+    }
+    player.position += motion;
+
+    if (tickHook)
+      tickHook(counters.ticks, tickLength);
+
+    counters.ticks++;
+    counters.lastTickMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    counters.maxTickMs = std::max(counters.maxTickMs, counters.lastTickMs);
+    counters.totalTickMs += counters.lastTickMs;
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    previous = current;
+    current = player;
+    currentTime = scheduled;
+    published = counters;
+  }
+
+  PlayerState Simulation::interpolated(Clock::time_point now) const
+  {
+    PlayerState from, to;
+    Clock::time_point time;
+    {
+      std::lock_guard<std::mutex> lock(stateMutex);
+      from = previous;
+      to = current;
+      time = currentTime;
+    }
+    const float t = std::chrono::duration<float>(now - time).count() / tickLength;
+    return interpolate(from, to, std::clamp(t, 0.0f, 1.0f));
+  }
+
+  PlayerState Simulation::latest() const
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return current;
+  }
+
+  SimStats Simulation::stats() const
+  {
+    SimStats out;
+    {
+      std::lock_guard<std::mutex> lock(stateMutex);
+      out = published;
+    }
+    out.droppedInputs = droppedInputs.load(std::memory_order_relaxed);
+    return out;
+  }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "core/spsc_queue.h"
+#include "physics/collision.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace zm
+{
+  enum InputAction : uint8_t
+  {
+    INPUT_FORWARD,
+    INPUT_BACK,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_ACTION_COUNT
+  };
+
+  enum class InputType : uint8_t
+  {
+    Press,   // action held from now on
+    Release,
+    Look,    // x/y: yaw/pitch change in degrees
+    Zoom,    // x: field of view change in degrees
+  };
+
+  // What the window saw, in engine terms so the simulation never needs GLFW
+  struct InputEvent
+  {
+    InputType type = InputType::Look;
+    InputAction action = INPUT_FORWARD;
+    float x = 0.0f;
+    float y = 0.0f;
+  };
+
+  struct PlayerState
+  {
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = -90.0f; // degrees, same convention as Camera::setRotation
+    float pitch = 0.0f;
+    float fov = 45.0f;
+  };
+
+  // Straight blend, yaw is never wrapped so it needs no special case
+  PlayerState interpolate(const PlayerState& from, const PlayerState& to, float t);
+
+  struct SimSettings
+  {
+    float tickRate = 60.0f;   // ticks per second
+    float moveSpeed = 2.5f;   // blocks per second
+    // a thread that fell further behind than this many ticks skips ahead
+    // instead of running them all back to back
+    int maxCatchUpTicks = 5;
+    size_t inputCapacity = 1024;
+    // the player's box around the camera, used once there are solids
+    glm::vec3 boxMin = glm::vec3(-0.3f, -1.5f, -0.3f);
+    glm::vec3 boxMax = glm::vec3(0.3f, 0.3f, 0.3f);
+  };
+
+  struct SimStats
+  {
+    uint64_t ticks = 0;
+    uint64_t lateTicks = 0;     // started after the tick they belong to was over
+    uint64_t skippedTicks = 0;  // given up on after a long stall
+    uint64_t inputEvents = 0;
+    uint64_t droppedInputs = 0; // queue was full
+    double lastTickMs = 0.0;
+    double maxTickMs = 0.0;
+    double totalTickMs = 0.0;
+  };
+
+  // Player movement (and whatever the tick hook adds) at a fixed rate on its
+  // own thread, so its cost doesn't depend on the frame rate and a slow tick
+  // doesn't hold up a frame. The window thread pushes input events into a
+  // lock-free queue the tick drains, and after every tick the player state
+  // is published next to the one before. Rendering blends the two by how far
+  // it is into the current tick, which puts it one tick behind but smooth at
+  // any frame rate.
+  //
+  // Headless users can skip start() and call step() themselves
+  class Simulation
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+    // Runs on the simulation thread at the end of every tick
+    using TickHook = std::function<void(uint64_t tick, float seconds)>;
+
+    explicit Simulation(const PlayerState& start, const SimSettings& settings = {});
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Set before start()
+    void setTickHook(TickHook hook) { tickHook = std::move(hook); }
+
+    // Blocks around the player to collide with, from any thread. The next
+    // tick picks up the newest grid, without one the player flies through
+    // everything
+    void setSolids(std::shared_ptr<const SolidGrid> grid);
+
+    void start();
+    void stop();
+    bool isRunning() const { return running.load(std::memory_order_relaxed); }
+
+    // One tick on the calling thread, only while the thread isn't running
+    void step();
+
+    // From one producer thread only. False when the queue is full, the
+    // event is dropped and counted
+    bool pushInput(const InputEvent& event);
+
+    // Player state for a frame drawn at now
+    PlayerState interpolated(Clock::time_point now = Clock::now()) const;
+    // The newest tick's state, no blending
+    PlayerState latest() const;
+
+    SimStats stats() const;
+    float tickSeconds() const { return tickLength; }
+
+  private:
+    void run();
+    void tick(Clock::time_point scheduled);
+
+    SimSettings settings;
+    float tickLength;
+    TickHook tickHook;
+    SpscQueue<InputEvent> inputs;
+    std::atomic<uint64_t> droppedInputs{ 0 };
+    std::mutex solidsMutex;
+    std::shared_ptr<const SolidGrid> solids;
+
+    // simulation thread only
+    PlayerState player;
+    bool held[INPUT_ACTION_COUNT] = {};
+    SimStats counters;
+
+    // published after every tick, only ever held for a copy
+    mutable std::mutex stateMutex;
+    PlayerState previous;
+    PlayerState current;
+    Clock::time_point currentTime;
+    SimStats published;
+
+    std::thread thread;
+    std::atomic<bool> running{ false };
+  };
+}
@@ -2,15 +2,14 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
-out vec2 TexCoord;
-  
+out vec3 TexCoord;
+
+// projection * view * model, multiplied once per cube on the CPU
 uniform mat4 transform;
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform float textureLayer;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-} 
\ No newline at end of file
+    gl_Position = transform * vec4(aPos, 1.0);
+    TexCoord = vec3(aTexCoord.x, aTexCoord.y, textureLayer);
+}
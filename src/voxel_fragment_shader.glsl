@@ -0,0 +1,186 @@
+#version 450 core
+// Ray marches the 64-tree of src/render/voxel_tree.h, the same walk as
+// VoxelTree::raycast: descend to the cell holding the ray, step over empty
+// cells whole, pop back up once the ray leaves a node
+layout (std430, binding = 1) readonly buffer VoxelNodes
+{
+    // mask low, mask high, relative offset, flags
+    uvec4 nodes[];
+};
+
+in vec2 ScreenPos;
+out vec4 FragColor;
+
+uniform mat4 viewProjection;
+uniform mat4 inverseViewProjection;
+// camera relative to the root's minimum corner, the tree's own space
+uniform vec3 cameraPosition;
+uniform vec3 rootOrigin;
+uniform uint rootIndex;
+uniform float maxDistance;
+// block texture array layer per block id and face, see src/world/block.cpp
+uniform uint faceLayers[96];
+uniform sampler2DArray ourTexture;
+
+const int ROOT_SHIFT = 12;
+const int ROOT_SIZE = 1 << ROOT_SHIFT;
+const int DEPTH = 6;
+const int MAX_STEPS = 512;
+const uint VOXEL_LEAF = 1u;
+const uint VOXEL_SOLID = 2u;
+const uint VOXEL_SINGLE_BLOCK = 4u;
+// per face, -X +X -Y +Y -Z +Z
+const float faceShade[6] = float[6](0.8, 0.8, 0.55, 1.0, 0.9, 0.9);
+
+bool hasBit(uvec4 node, int bit)
+{
+    return ((bit < 32 ? node.x >> bit : node.y >> (bit - 32)) & 1u) != 0u;
+}
+
+int rankOf(uvec4 node, int bit)
+{
+    if (bit < 32)
+        return bitCount(node.x & ((1u << bit) - 1u));
+    return bitCount(node.x) + bitCount(node.y & ((1u << (bit - 32)) - 1u));
+}
+
+uint leafBlock(uint leaf, uvec4 node, int rank)
+{
+    if ((node.w & VOXEL_SINGLE_BLOCK) != 0u)
+        return node.w >> 16;
+    uvec4 slot = nodes[leaf + uint(int(node.z)) + uint(rank >> 4)];
+    return (slot[(rank & 15) >> 2] >> ((rank & 3) * 8)) & 0xFFu;
+}
+
+bool trace(vec3 o, vec3 d, out ivec3 block, out uint id, out int face, out float t)
+{
+    vec3 inv;
+    float tEnter = 0.0, tExit = maxDistance;
+    int enterAxis = -1;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (d[axis] == 0.0)
+        {
+            inv[axis] = 0.0;
+            if (o[axis] < 0.0 || o[axis] >= float(ROOT_SIZE))
+                return false;
+            continue;
+        }
+        inv[axis] = 1.0 / d[axis];
+        float t0 = -o[axis] * inv[axis];
+        float t1 = (float(ROOT_SIZE) - o[axis]) * inv[axis];
+        if (t0 > t1)
+        {
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+        if (t0 > tEnter)
+        {
+            tEnter = t0;
+            enterAxis = axis;
+        }
+        tExit = min(tExit, t1);
+    }
+    if (tEnter > tExit)
+        return false;
+
+    t = tEnter;
+    block = clamp(ivec3(floor(o + d * t)), ivec3(0), ivec3(ROOT_SIZE - 1));
+    face = -1;
+    if (enterAxis >= 0)
+    {
+        block[enterAxis] = d[enterAxis] > 0.0 ? 0 : ROOT_SIZE - 1;
+        face = enterAxis * 2 + (d[enterAxis] > 0.0 ? 0 : 1);
+    }
+
+    uint stack[DEPTH];
+    ivec3 nodeCells[DEPTH];
+    nodeCells[0] = ivec3(0);
+    int depth = 0;
+    uint index = rootIndex;
+    for (int step = 0; step < MAX_STEPS; step++)
+    {
+        uvec4 node = nodes[index];
+        int childShift = ROOT_SHIFT - 2 * (depth + 1);
+        id = 0u;
+        if ((node.w & 3u) == VOXEL_SOLID)
+            id = node.w >> 16;
+        else
+        {
+            ivec3 cell = (block >> childShift) & 3;
+            int bit = cell.x | (cell.z << 2) | (cell.y << 4);
+            if (hasBit(node, bit))
+            {
+                if ((node.w & 3u) == VOXEL_LEAF)
+                    id = leafBlock(index, node, rankOf(node, bit));
+                else
+                {
+                    stack[depth] = index;
+                    depth++;
+                    nodeCells[depth] = block >> childShift;
+                    index = uint(int(index) + int(node.z) + rankOf(node, bit));
+                    continue;
+                }
+            }
+        }
+        if (id != 0u)
+            return true;
+
+        // an empty cell, leave it through the nearest face
+        int size = 1 << childShift;
+        ivec3 cellMin = (block >> childShift) << childShift;
+        float next = 1e30;
+        int axis = 0;
+        for (int a = 0; a < 3; a++)
+        {
+            if (d[a] == 0.0)
+                continue;
+            float boundary = float(cellMin[a] + (d[a] > 0.0 ? size : 0));
+            float ta = (boundary - o[a]) * inv[a];
+            if (ta < next)
+            {
+                next = ta;
+                axis = a;
+            }
+        }
+        if (next > tExit)
+            return false;
+        t = max(t, next);
+
+        block = clamp(ivec3(floor(o + d * t)), cellMin, cellMin + size - 1);
+        block[axis] = d[axis] > 0.0 ? cellMin[axis] + size : cellMin[axis] - 1;
+        face = axis * 2 + (d[axis] > 0.0 ? 0 : 1);
+        if (block[axis] < 0 || block[axis] >= ROOT_SIZE)
+            return false;
+
+        while (depth > 0 && (block >> (ROOT_SHIFT - 2 * depth)) != nodeCells[depth])
+            index = stack[--depth];
+    }
+    return false;
+}
+
+void main()
+{
+    vec4 far = inverseViewProjection * vec4(ScreenPos, 1.0, 1.0);
+    vec3 direction = normalize(far.xyz / far.w - (cameraPosition + rootOrigin));
+
+    ivec3 block;
+    uint id;
+    int face;
+    float t;
+    if (!trace(cameraPosition, direction, block, id, face, t))
+        discard;
+
+    vec3 hit = cameraPosition + direction * t;
+    // texture coordinates across the face that was hit, the top when inside a block
+    int shown = face < 0 ? 3 : face;
+    int axis = shown >> 1;
+    vec2 uv = fract(axis == 0 ? hit.zy : axis == 1 ? hit.xz : hit.xy);
+    uint layer = id < 16u ? faceLayers[id * 6u + uint(shown)] : 0u;
+    vec4 color = texture(ourTexture, vec3(uv, float(layer)));
+    FragColor = vec4(color.rgb * faceShade[shown], color.a);
+
+    vec4 clip = viewProjection * vec4(hit + rootOrigin, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+}
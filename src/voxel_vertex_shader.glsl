@@ -0,0 +1,10 @@
+#version 450 core
+// one triangle covering the screen, no vertex buffer needed
+out vec2 ScreenPos;
+
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    ScreenPos = pos;
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
@@ -0,0 +1,25 @@
+#include "world/block.h"
+
+namespace zm
+{
+  namespace detail
+  {
+    // Layers index the block texture array, in the order the images in
+    // textures/ are packed
+    const BlockInfo blockTable[BLOCK_COUNT] = {
+      { false, { 0, 0, 0, 0, 0, 0 } }, // air
+      { true,  { 0, 0, 0, 0, 0, 0 } }, // stone
+      { true,  { 1, 1, 1, 1, 1, 1 } }, // dirt
+      { true,  { 1, 1, 1, 2, 1, 1 } }, // grass, dirt sides and bottom
+      { true,  { 3, 3, 3, 3, 3, 3 } }, // sand
+      { false, { 2, 2, 2, 2, 2, 2 } }, // water
+      { true,  { 0, 0, 0, 0, 0, 0 } }, // coal ore
+      { true,  { 0, 0, 0, 0, 0, 0 } }, // iron ore
+      { true,  { 0, 0, 0, 0, 0, 0 } }, // gold ore
+      { true,  { 0, 0, 0, 0, 0, 0 } }, // diamond ore
+      { true,  { 3, 3, 3, 3, 3, 3 }, 15 }, // lamp, sand texture until it has its own
+    };
+
+    const BlockInfo unknownBlock = { true, { 0, 0, 0, 0, 0, 0 } };
+  }
+}
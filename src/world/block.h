@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+namespace zm
+{
+  // Block IDs are plain 16-bit values, 0 is always air
+  using BlockId = uint16_t;
+
+  constexpr BlockId BLOCK_AIR = 0;
+  constexpr BlockId BLOCK_STONE = 1;
+  constexpr BlockId BLOCK_DIRT = 2;
+  constexpr BlockId BLOCK_GRASS = 3;
+  constexpr BlockId BLOCK_SAND = 4;
+  constexpr BlockId BLOCK_WATER = 5;
+  constexpr BlockId BLOCK_COAL_ORE = 6;
+  constexpr BlockId BLOCK_IRON_ORE = 7;
+  constexpr BlockId BLOCK_GOLD_ORE = 8;
+  constexpr BlockId BLOCK_DIAMOND_ORE = 9;
+  constexpr BlockId BLOCK_LAMP = 10;
+  constexpr BlockId BLOCK_COUNT = 11;
+
+  // Face order used everywhere: -X, +X, -Y, +Y, -Z, +Z. face / 2 is the axis,
+  // face & 1 is set for the positive direction
+  enum Face : uint8_t
+  {
+    FACE_NEG_X = 0,
+    FACE_POS_X,
+    FACE_NEG_Y,
+    FACE_POS_Y,
+    FACE_NEG_Z,
+    FACE_POS_Z,
+    FACE_COUNT
+  };
+
+  struct BlockInfo
+  {
+    bool opaque;
+    // texture array layer per face
+    uint16_t textureLayer[FACE_COUNT];
+    // block light level it gives off, 0..15
+    uint8_t lightEmission = 0;
+  };
+
+  namespace detail
+  {
+    extern const BlockInfo blockTable[BLOCK_COUNT];
+    extern const BlockInfo unknownBlock;
+  }
+
+  // Unknown ids come back as an opaque block on layer 0. Inline because the
+  // mesher asks this for every voxel
+  inline const BlockInfo& blockInfo(BlockId id)
+  {
+    return id < BLOCK_COUNT ? detail::blockTable[id] : detail::unknownBlock;
+  }
+
+  inline bool isOpaque(BlockId id) { return blockInfo(id).opaque; }
+}
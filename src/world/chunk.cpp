@@ -0,0 +1,334 @@
+#include "world/chunk.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <new>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr size_t MAX_PALETTE = 256; // past this we store ids directly
+
+    int bitsForPalette(size_t count)
+    {
+      if (count <= 1) return 0;
+      if (count <= 2) return 1;
+      if (count <= 4) return 2;
+      if (count <= 16) return 4;
+      if (count <= MAX_PALETTE) return 8;
+      return 16;
+    }
+
+    int log2Bits(int bits)
+    {
+      switch (bits)
+      {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return 4;
+      }
+    }
+
+    // one pool per bit width, 4KB (1 bit) to 64KB (16 bits) blocks. Never
+    // destroyed, chunks may outlive static destructors
+    constexpr size_t WORD_POOL_COUNT = 5;
+    constexpr size_t WORD_SLAB_BYTES = 256 * 1024;
+
+    SlabPool* wordPool(size_t bytes)
+    {
+      static SlabPool* const* pools = [] {
+        SlabPool** created = new SlabPool*[WORD_POOL_COUNT];
+        for (size_t i = 0; i < WORD_POOL_COUNT; i++)
+          created[i] = new SlabPool(size_t(CHUNK_VOLUME / 8) << i, WORD_SLAB_BYTES, MEMORY_CHUNK_BLOCKS);
+        return created;
+      }();
+      for (size_t i = 0; i < WORD_POOL_COUNT; i++)
+        if (pools[i]->blockSize() == bytes)
+          return pools[i];
+      return nullptr;
+    }
+
+    // Scratch space for decode/encode. Thread local so chunks can be packed
+    // from worker threads without allocating
+    BlockId* scratchBlocks()
+    {
+      thread_local std::array<BlockId, CHUNK_VOLUME> scratch;
+      return scratch.data();
+    }
+
+    // BlockId -> palette index. Only entries for ids in the current palette
+    // are ever written before being read
+    uint16_t* scratchRemap()
+    {
+      thread_local std::array<uint16_t, 65536> remap;
+      return remap.data();
+    }
+
+    void encode(const BlockId* in, int bits, int bitsShift, const std::vector<BlockId>& palette, ChunkWords& words)
+    {
+      const int perWordShift = 6 - bitsShift;
+      const int perWord = 1 << perWordShift;
+      words.assign(CHUNK_VOLUME >> perWordShift, 0);
+
+      if (bits == 16)
+      {
+        for (int w = 0; w < int(words.size()); w++)
+        {
+          uint64_t word = 0;
+          for (int i = 0; i < perWord; i++)
+            word |= uint64_t(in[w * perWord + i]) << (i << bitsShift);
+          words[w] = word;
+        }
+        return;
+      }
+
+      uint16_t* remap = scratchRemap();
+      for (size_t i = 0; i < palette.size(); i++)
+        remap[palette[i]] = uint16_t(i);
+
+      for (int w = 0; w < int(words.size()); w++)
+      {
+        uint64_t word = 0;
+        for (int i = 0; i < perWord; i++)
+          word |= uint64_t(remap[in[w * perWord + i]]) << (i << bitsShift);
+        words[w] = word;
+      }
+    }
+  }
+
+  void* ChunkWordPool::allocate(size_t bytes)
+  {
+    SlabPool* pool = wordPool(bytes);
+    return pool ? pool->allocate() : ::operator new(bytes);
+  }
+
+  void ChunkWordPool::deallocate(void* words, size_t bytes)
+  {
+    SlabPool* pool = wordPool(bytes);
+    if (pool)
+      pool->deallocate(words);
+    else
+      ::operator delete(words);
+  }
+
+  Chunk::Chunk(BlockId fill)
+  {
+    palette.push_back(fill);
+  }
+
+  void Chunk::fill(BlockId id)
+  {
+    palette.assign(1, id);
+    words.clear();
+    words.shrink_to_fit();
+    bits = 0;
+    bitsShift = 0;
+  }
+
+  int Chunk::findOrAddPalette(BlockId id)
+  {
+    for (size_t i = 0; i < palette.size(); i++)
+    {
+      if (palette[i] == id)
+        return int(i);
+    }
+
+    if (palette.size() >= MAX_PALETTE)
+      return -1;
+
+    palette.push_back(id);
+    return int(palette.size() - 1);
+  }
+
+  void Chunk::setIndex(int index, BlockId id)
+  {
+    if (bits == 0)
+    {
+      if (palette[0] == id)
+        return;
+      palette.push_back(id);
+      repack(1);
+    }
+
+    uint32_t value;
+    if (bits == 16)
+    {
+      value = id;
+    }
+    else
+    {
+      const int found = findOrAddPalette(id);
+      if (found < 0)
+      {
+        // palette is full, switch to storing ids directly
+        repack(16);
+        value = id;
+      }
+      else
+      {
+        if (size_t(found) >= (size_t(1) << bits))
+          repack(bitsForPalette(palette.size()));
+        value = uint32_t(found);
+      }
+    }
+
+    const int perWordShift = 6 - bitsShift;
+    uint64_t& word = words[index >> perWordShift];
+    const int offset = (index & ((1 << perWordShift) - 1)) << bitsShift;
+    const uint64_t mask = ((uint64_t(1) << bits) - 1) << offset;
+    word = (word & ~mask) | (uint64_t(value) << offset);
+  }
+
+  // Re-encode the current contents at a different width. The palette must
+  // already hold every id in use (plus any pending new entry)
+  void Chunk::repack(int newBits)
+  {
+    BlockId* blocks = scratchBlocks();
+    unpack(blocks);
+
+    bits = uint8_t(newBits);
+    bitsShift = uint8_t(log2Bits(newBits));
+    encode(blocks, bits, bitsShift, palette, words);
+
+    if (bits == 16)
+    {
+      palette.clear();
+      palette.shrink_to_fit();
+    }
+  }
+
+  void Chunk::unpack(BlockId* out) const
+  {
+    if (bits == 0)
+    {
+      std::fill(out, out + CHUNK_VOLUME, palette[0]);
+      return;
+    }
+
+    const int perWord = 64 >> bitsShift;
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    for (size_t w = 0; w < words.size(); w++)
+    {
+      uint64_t word = words[w];
+      BlockId* dst = out + w * perWord;
+      if (bits == 16)
+      {
+        for (int i = 0; i < perWord; i++, word >>= 16)
+          dst[i] = BlockId(word & mask);
+      }
+      else
+      {
+        for (int i = 0; i < perWord; i++, word >>= bits)
+          dst[i] = palette[word & mask];
+      }
+    }
+  }
+
+  void Chunk::pack(const BlockId* in)
+  {
+    // Collect distinct ids, runs of the same block are by far the common case
+    std::vector<BlockId> newPalette;
+    newPalette.push_back(in[0]);
+    BlockId last = in[0];
+    bool direct = false;
+    for (int i = 1; i < CHUNK_VOLUME && !direct; i++)
+    {
+      if (in[i] == last)
+        continue;
+      last = in[i];
+      if (std::find(newPalette.begin(), newPalette.end(), last) == newPalette.end())
+      {
+        newPalette.push_back(last);
+        direct = newPalette.size() > MAX_PALETTE;
+      }
+    }
+
+    if (newPalette.size() == 1)
+    {
+      fill(newPalette[0]);
+      return;
+    }
+
+    palette = std::move(newPalette);
+    bits = uint8_t(direct ? 16 : bitsForPalette(palette.size()));
+    bitsShift = uint8_t(log2Bits(bits));
+    encode(in, bits, bitsShift, palette, words);
+
+    if (bits == 16)
+      palette.clear();
+  }
+
+  void Chunk::serialize(std::vector<uint8_t>& out) const
+  {
+    const uint16_t paletteCount = uint16_t(palette.size());
+    const size_t start = out.size();
+    out.resize(start + 4 + paletteCount * sizeof(BlockId) + words.size() * sizeof(uint64_t));
+
+    uint8_t* dst = out.data() + start;
+    dst[0] = bits;
+    dst[1] = 0;
+    std::memcpy(dst + 2, &paletteCount, sizeof(paletteCount));
+    std::memcpy(dst + 4, palette.data(), paletteCount * sizeof(BlockId));
+    std::memcpy(dst + 4 + paletteCount * sizeof(BlockId), words.data(), words.size() * sizeof(uint64_t));
+  }
+
+  bool Chunk::deserialize(const uint8_t* data, size_t size)
+  {
+    if (size < 4)
+      return false;
+
+    const int newBits = data[0];
+    uint16_t paletteCount;
+    std::memcpy(&paletteCount, data + 2, sizeof(paletteCount));
+    if (newBits != 0 && newBits != 1 && newBits != 2 && newBits != 4 && newBits != 8 && newBits != 16)
+      return false;
+    if (newBits == 0 ? paletteCount != 1 : newBits == 16 ? paletteCount != 0 : (paletteCount == 0 || paletteCount > (1u << newBits)))
+      return false;
+
+    const size_t wordCount = newBits == 0 ? 0 : size_t(CHUNK_VOLUME) * newBits / 64;
+    if (size != 4 + paletteCount * sizeof(BlockId) + wordCount * sizeof(uint64_t))
+      return false;
+
+    std::vector<BlockId> newPalette(paletteCount);
+    ChunkWords newWords(wordCount);
+    std::memcpy(newPalette.data(), data + 4, paletteCount * sizeof(BlockId));
+    std::memcpy(newWords.data(), data + 4 + paletteCount * sizeof(BlockId), wordCount * sizeof(uint64_t));
+
+    // every index has to land inside the palette, getIndex doesn't check
+    if (newBits != 0 && newBits != 16 && paletteCount < (1u << newBits))
+    {
+      const uint64_t mask = (uint64_t(1) << newBits) - 1;
+      for (uint64_t word : newWords)
+        for (int shift = 0; shift < 64; shift += newBits)
+          if (((word >> shift) & mask) >= paletteCount)
+            return false;
+    }
+
+    palette = std::move(newPalette);
+    words = std::move(newWords);
+    bits = uint8_t(newBits);
+    bitsShift = uint8_t(newBits == 0 ? 0 : log2Bits(newBits));
+    return true;
+  }
+
+  void Chunk::compact()
+  {
+    if (bits == 0)
+      return;
+
+    BlockId* blocks = scratchBlocks();
+    unpack(blocks);
+    pack(blocks);
+    palette.shrink_to_fit();
+    words.shrink_to_fit();
+  }
+
+  size_t Chunk::memoryUsage() const
+  {
+    return sizeof(Chunk) + palette.capacity() * sizeof(BlockId) + words.capacity() * sizeof(uint64_t);
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "core/allocators.h"
+#include "world/block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zm
+{
+  constexpr int CHUNK_SHIFT = 5;
+  constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT; // 32
+  constexpr int CHUNK_MASK = CHUNK_SIZE - 1;
+  constexpr int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+  constexpr int CHUNK_VOLUME = CHUNK_AREA * CHUNK_SIZE;
+
+  // Flat layout is x fastest, then z, then y so a row along x is contiguous
+  // and a horizontal slice is one 1024 entry block
+  inline int chunkIndex(int x, int y, int z)
+  {
+    return x | (z << CHUNK_SHIFT) | (y << (2 * CHUNK_SHIFT));
+  }
+
+  // Packed words only come in five sizes, 1 to 16 bits per block, each size
+  // has its own slab pool so chunks streaming in and out reuse the same
+  // memory. Anything else goes to the heap
+  struct ChunkWordPool
+  {
+    static void* allocate(size_t bytes);
+    static void deallocate(void* words, size_t bytes);
+  };
+
+  using ChunkWords = std::vector<uint64_t, PoolAllocator<uint64_t, ChunkWordPool>>;
+
+  // 32^3 blocks stored as indices into a per-chunk palette, bit-packed into
+  // 64-bit words. Entries never straddle a word so get/set are a shift and
+  // a mask. Three storage modes depending on how many distinct blocks there are:
+  //   uniform  - 0 bits, the whole chunk is palette[0] (no words allocated)
+  //   palette  - 1/2/4/8 bits per block
+  //   direct   - 16 bits per block, the stored value is the BlockId itself
+  class Chunk
+  {
+  public:
+    explicit Chunk(BlockId fill = BLOCK_AIR);
+
+    BlockId get(int x, int y, int z) const { return getIndex(chunkIndex(x, y, z)); }
+    void set(int x, int y, int z, BlockId id) { setIndex(chunkIndex(x, y, z), id); }
+
+    BlockId getIndex(int index) const
+    {
+      if (bits == 0)
+        return palette[0];
+
+      const int perWordShift = 6 - bitsShift;
+      const uint64_t word = words[index >> perWordShift];
+      const int offset = (index & ((1 << perWordShift) - 1)) << bitsShift;
+      const uint32_t value = uint32_t(word >> offset) & ((1u << bits) - 1u);
+      return bits == 16 ? BlockId(value) : palette[value];
+    }
+
+    void setIndex(int index, BlockId id);
+
+    // Overwrite every block with one value, collapses to uniform storage
+    void fill(BlockId id);
+
+    // Decode into / rebuild from a flat CHUNK_VOLUME array in chunkIndex order.
+    // pack() picks the smallest storage mode for the data
+    void unpack(BlockId* out) const;
+    void pack(const BlockId* in);
+
+    // Raw storage as bytes: bits, palette size, palette, then the packed
+    // words, little endian. Appends to out. deserialize() validates sizes
+    // and palette indices and leaves the chunk untouched on failure
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+
+    // Drop palette entries that are no longer referenced and shrink the bit
+    // width if possible. set() only ever grows the palette
+    void compact();
+
+    bool isUniform() const { return bits == 0; }
+    BlockId uniformBlock() const { return palette[0]; }
+    int bitsPerBlock() const { return bits; }
+    size_t paletteSize() const { return bits == 16 ? 0 : palette.size(); }
+
+    // Heap + object bytes actually held by this chunk
+    size_t memoryUsage() const;
+
+  private:
+    int findOrAddPalette(BlockId id);
+    void repack(int newBits);
+
+    std::vector<BlockId> palette;
+    ChunkWords words;
+    uint8_t bits = 0;
+    uint8_t bitsShift = 0; // log2(bits), only meaningful when bits != 0
+  };
+}
@@ -0,0 +1,224 @@
+#include "world/chunk_builder.h"
+
+#include "core/profiler.h"
+
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr int faceOffsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+  }
+
+  ChunkBuilder::ChunkBuilder(JobSystem& jobs, ChunkStorage& world, const TerrainGenerator& generator, WorldSave* save, size_t maxInFlight,
+                             LightStorage* light)
+    : jobs(jobs), world(world), generator(generator), save(save), light(light), finished(maxInFlight)
+  {
+  }
+
+  ChunkBuilder::~ChunkBuilder()
+  {
+    // jobs hold raw pointers into world, let them finish first
+    jobs.waitIdle();
+  }
+
+  JobHandle ChunkBuilder::requestGenerate(ChunkCoord coord, float priority)
+  {
+    auto it = generateJobs.find(coord);
+    if (it != generateJobs.end())
+      return it->second;
+
+    Chunk* chunk = &world.getOrCreateChunk(coord);
+    const TerrainGenerator* gen = &generator;
+    WorldSave* saved = save;
+    JobHandle job = jobs.submit([gen, saved, coord, chunk] {
+      if (saved)
+      {
+        ZM_PROFILE_SCOPE("load chunk");
+        if (saved->loadChunk(coord, *chunk))
+          return;
+      }
+      ZM_PROFILE_SCOPE("generate");
+      gen->generate(coord, *chunk);
+      if (saved)
+        saved->markDirty(coord);
+    }, priority);
+    generateJobs.emplace(coord, job);
+    created.push_back(coord);
+    return job;
+  }
+
+  JobHandle ChunkBuilder::requestLight(ChunkCoord coord, float priority)
+  {
+    if (!light)
+      return requestGenerate(coord, priority);
+
+    auto it = lightJobs.find(coord);
+    if (it != lightJobs.end())
+      return it->second;
+
+    std::vector<JobHandle> dependencies;
+    dependencies.push_back(requestGenerate(coord, priority));
+    const ChunkLight* above = nullptr;
+    ChunkCoord up = { coord.x, coord.y + 1, coord.z };
+    if (coord.y < light->getTopChunkY())
+    {
+      dependencies.push_back(requestLight(up, priority));
+      above = light->get(up);
+    }
+
+    const Chunk* chunk = world.getChunk(coord);
+    ChunkLight* out = &light->getOrCreate(coord);
+    const ChunkStorage* storage = &world;
+    JobHandle seed = jobs.submit([storage, chunk, above, out] {
+      ZM_PROFILE_SCOPE("light");
+      // the chunk above may be edited already
+      std::shared_lock lock(storage->accessMutex());
+      seedChunkLight(*chunk, above, *out);
+    }, priority, dependencies);
+    if (above)
+      addReader(up, seed);
+
+    // then join it with the lit chunks around it. Their stitches still to
+    // come run first, so of any two neighbours the later one sees the other
+    LightNeighbourhood around;
+    std::vector<JobHandle> stitchAfter = { seed };
+    for (int dz = -1; dz <= 1; dz++)
+      for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+          const ChunkCoord n = { coord.x + dx, coord.y + dy, coord.z + dz };
+          const int slot = LightNeighbourhood::slot(dx, dy, dz);
+          around.chunks[slot] = world.getChunk(n);
+          around.lights[slot] = light->get(n);
+          auto lit = lightJobs.find(n);
+          if (slot != LightNeighbourhood::CENTRE && lit != lightJobs.end() && !lit->second->isFinished())
+            stitchAfter.push_back(lit->second);
+        }
+    JobHandle job = jobs.submit([storage, around] {
+      ZM_PROFILE_SCOPE("stitch light");
+      std::unique_lock lock(storage->accessMutex());
+      stitchChunkLight(around);
+    }, priority, stitchAfter);
+    lightJobs.emplace(coord, job);
+    for (int dz = -1; dz <= 1; dz++)
+      for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+          if ((dx || dy || dz) && around.lights[LightNeighbourhood::slot(dx, dy, dz)])
+            addReader({ coord.x + dx, coord.y + dy, coord.z + dz }, job);
+    return job;
+  }
+
+  bool ChunkBuilder::isReady(ChunkCoord coord) const
+  {
+    const auto& readyJobs = light ? lightJobs : generateJobs;
+    auto it = readyJobs.find(coord);
+    return it != readyJobs.end() && it->second->isFinished();
+  }
+
+  bool ChunkBuilder::requestMesh(ChunkCoord coord, float priority, uint8_t closedFaces, uint32_t version)
+  {
+    if (pending.load(std::memory_order_relaxed) >= finished.capacity())
+      return false;
+
+    std::vector<JobHandle> dependencies;
+    dependencies.reserve(FACE_COUNT + 1);
+    dependencies.push_back(requestLight(coord, priority));
+
+    std::array<const Chunk*, FACE_COUNT> neighbours;
+    MeshLight meshLight;
+    for (int face = 0; face < FACE_COUNT; face++)
+    {
+      const ChunkCoord n = { coord.x + faceOffsets[face][0], coord.y + faceOffsets[face][1], coord.z + faceOffsets[face][2] };
+      dependencies.push_back(requestLight(n, priority));
+      const bool closed = closedFaces & (1u << face);
+      neighbours[face] = closed ? nullptr : world.getChunk(n);
+      meshLight.neighbours[face] = closed || !light ? nullptr : light->get(n);
+    }
+
+    const Chunk* chunk = world.getChunk(coord);
+    meshLight.chunk = light ? light->get(coord) : nullptr;
+    const bool lit = light != nullptr;
+    pending.fetch_add(1, std::memory_order_relaxed);
+
+    JobHandle job = jobs.submit([this, coord, closedFaces, version, chunk, neighbours, meshLight, lit] {
+      ZM_PROFILE_SCOPE("mesh");
+      BuiltChunkMesh built;
+      built.coord = coord;
+      built.closedFaces = closedFaces;
+      built.version = version;
+      {
+        std::shared_lock lock(world.accessMutex());
+        ChunkMesher::forThisThread().mesh(*chunk, neighbours.data(), built.mesh, lit ? &meshLight : nullptr);
+      }
+      // can't fail, the queue is as big as the number of meshes allowed in flight
+      finished.tryPush(std::move(built));
+    }, priority, dependencies);
+
+    addReader(coord, job);
+    for (int face = 0; face < FACE_COUNT; face++)
+      if (neighbours[face])
+        addReader({ coord.x + faceOffsets[face][0], coord.y + faceOffsets[face][1], coord.z + faceOffsets[face][2] }, job);
+    return true;
+  }
+
+  void ChunkBuilder::addReader(ChunkCoord coord, const JobHandle& job)
+  {
+    // finished readers don't need remembering
+    std::vector<JobHandle>& jobsReading = readers[coord];
+    std::erase_if(jobsReading, [](const JobHandle& reader) { return reader->isFinished(); });
+    jobsReading.push_back(job);
+  }
+
+  bool ChunkBuilder::isIdle(ChunkCoord coord)
+  {
+    auto generate = generateJobs.find(coord);
+    if (generate != generateJobs.end() && !generate->second->isFinished())
+      return false;
+    auto lit = lightJobs.find(coord);
+    if (lit != lightJobs.end() && !lit->second->isFinished())
+      return false;
+
+    auto it = readers.find(coord);
+    if (it == readers.end())
+      return true;
+    std::erase_if(it->second, [](const JobHandle& reader) { return reader->isFinished(); });
+    if (!it->second.empty())
+      return false;
+    readers.erase(it);
+    return true;
+  }
+
+  void ChunkBuilder::evict(const std::vector<ChunkCoord>& coords)
+  {
+    // the save snapshots them right away, they can go straight after
+    if (save)
+      save->flush(world, coords);
+    for (const ChunkCoord& coord : coords)
+    {
+      world.removeChunk(coord);
+      if (light)
+        light->remove(coord);
+      generateJobs.erase(coord);
+      lightJobs.erase(coord);
+      readers.erase(coord);
+    }
+  }
+
+  void ChunkBuilder::takeCreated(std::vector<ChunkCoord>& out)
+  {
+    out.insert(out.end(), created.begin(), created.end());
+    created.clear();
+  }
+
+  size_t ChunkBuilder::drainMeshes(std::vector<BuiltChunkMesh>& out, size_t maxMeshes)
+  {
+    const size_t count = finished.drain(out, maxMeshes);
+    pending.fetch_sub(count, std::memory_order_relaxed);
+    return count;
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/bounded_queue.h"
+#include "core/job_system.h"
+#include "mesh/chunk_mesher.h"
+#include "world/chunk_storage.h"
+#include "world/light.h"
+#include "world/terrain_generator.h"
+#include "world/world_save.h"
+
+#include <atomic>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  struct BuiltChunkMesh
+  {
+    ChunkCoord coord;
+    // faces meshed against air instead of the neighbour, see requestMesh
+    uint8_t closedFaces = 0;
+    // whatever the requester passed, to tell remeshes of one chunk apart
+    uint32_t version = 0;
+    ChunkMesh mesh;
+  };
+
+  // Runs the generate -> mesh pipeline on the job system. A chunk's mesh job
+  // depends on the generate jobs of the chunk and its six neighbours, and
+  // finished meshes land in a bounded queue for the render thread to upload.
+  //
+  // With a WorldSave, chunks already on disk are loaded instead of generated
+  // and freshly generated ones are marked dirty so the next flush keeps them.
+  // With a LightStorage every chunk gets its light seeded after generation,
+  // top down since sunlight comes from the chunk above, then stitched to the
+  // lit chunks around it, and meshes are lit.
+  //
+  // Only the render thread calls into this. Chunk objects are created up front
+  // on that thread and jobs only ever touch the Chunk pointers they were given,
+  // never the storage map itself. Jobs reading finished chunks hold the
+  // storage's access mutex shared, edits may be changing them
+  class ChunkBuilder
+  {
+  public:
+    ChunkBuilder(JobSystem& jobs, ChunkStorage& world, const TerrainGenerator& generator, WorldSave* save = nullptr, size_t maxInFlight = 256,
+                 LightStorage* light = nullptr);
+    ~ChunkBuilder();
+
+    // Queue coord for meshing (generating whatever it needs first). Returns
+    // false when maxInFlight meshes are already pending, try again next frame.
+    // Neighbours on closedFaces (bit per Face) count as air, so the chunk
+    // closes its surface there, used along LOD seams
+    bool requestMesh(ChunkCoord coord, float priority, uint8_t closedFaces = 0, uint32_t version = 0);
+
+    // Generates (or loads) coord without meshing it. The chunk exists in the
+    // world from this call on, its data once the returned job has finished
+    JobHandle requestGenerate(ChunkCoord coord, float priority);
+    // Seeds coord's light once it and the chunks above it are generated and
+    // stitches it to its lit neighbours, the returned job covers both. Just
+    // requestGenerate without a LightStorage
+    JobHandle requestLight(ChunkCoord coord, float priority);
+
+    // Blocks and light of coord are done, from now on only edits and the
+    // stitching of neighbours lit later change them
+    bool isReady(ChunkCoord coord) const;
+    // coord's chunk exists, generated or still on its way
+    bool isRequested(ChunkCoord coord) const { return generateJobs.count(coord) != 0; }
+
+    // A job outside the builder reading coord's blocks, e.g. LOD
+    // downsampling. coord is not idle until it has finished
+    void addReader(ChunkCoord coord, const JobHandle& job);
+    // Nothing is generating, lighting or reading coord any more
+    bool isIdle(ChunkCoord coord);
+    // Saves the dirty ones and drops the blocks and light of coords, which
+    // must all be idle. Requesting them again generates (or loads) them anew
+    void evict(const std::vector<ChunkCoord>& coords);
+    // Chunks the requests above created since the last call, whoever asked
+    void takeCreated(std::vector<ChunkCoord>& out);
+
+    // Take up to maxMeshes finished meshes, oldest first
+    size_t drainMeshes(std::vector<BuiltChunkMesh>& out, size_t maxMeshes);
+
+    size_t inFlight() const { return pending.load(std::memory_order_relaxed); }
+    size_t generatedCount() const { return generateJobs.size(); }
+    LightStorage* getLight() const { return light; }
+
+  private:
+    JobSystem& jobs;
+    ChunkStorage& world;
+    const TerrainGenerator& generator;
+    WorldSave* save;
+    LightStorage* light;
+
+    std::unordered_map<ChunkCoord, JobHandle, ChunkCoordHash> generateJobs;
+    std::unordered_map<ChunkCoord, JobHandle, ChunkCoordHash> lightJobs;
+    // mesh and light jobs of other chunks, and outside jobs, reading a chunk
+    std::unordered_map<ChunkCoord, std::vector<JobHandle>, ChunkCoordHash> readers;
+    std::vector<ChunkCoord> created;
+    BoundedQueue<BuiltChunkMesh> finished;
+    std::atomic<size_t> pending{ 0 };
+  };
+}
@@ -0,0 +1,60 @@
+#include "world/chunk_storage.h"
+
+namespace zm
+{
+  Chunk* ChunkStorage::getChunk(ChunkCoord coord)
+  {
+    auto it = chunks.find(coord);
+    return it != chunks.end() ? it->second.get() : nullptr;
+  }
+
+  const Chunk* ChunkStorage::getChunk(ChunkCoord coord) const
+  {
+    auto it = chunks.find(coord);
+    return it != chunks.end() ? it->second.get() : nullptr;
+  }
+
+  Chunk& ChunkStorage::getOrCreateChunk(ChunkCoord coord)
+  {
+    std::unique_ptr<Chunk>& slot = chunks[coord];
+    if (!slot)
+      slot = std::make_unique<Chunk>();
+    return *slot;
+  }
+
+  bool ChunkStorage::removeChunk(ChunkCoord coord)
+  {
+    return chunks.erase(coord) > 0;
+  }
+
+  BlockId ChunkStorage::getBlock(int wx, int wy, int wz) const
+  {
+    const Chunk* chunk = getChunk(worldToChunk(wx, wy, wz));
+    if (!chunk)
+      return BLOCK_AIR;
+    return chunk->get(wx & CHUNK_MASK, wy & CHUNK_MASK, wz & CHUNK_MASK);
+  }
+
+  void ChunkStorage::setBlock(int wx, int wy, int wz, BlockId id)
+  {
+    const ChunkCoord coord = worldToChunk(wx, wy, wz);
+    Chunk* chunk = getChunk(coord);
+    if (!chunk)
+    {
+      if (id == BLOCK_AIR)
+        return;
+      chunk = &getOrCreateChunk(coord);
+    }
+    chunk->set(wx & CHUNK_MASK, wy & CHUNK_MASK, wz & CHUNK_MASK, id);
+  }
+
+  size_t ChunkStorage::memoryUsage() const
+  {
+    // node = key + unique_ptr + next pointer + cached hash, plus one bucket pointer
+    constexpr size_t nodeBytes = sizeof(ChunkCoord) + sizeof(void*) * 3 + sizeof(size_t);
+    size_t total = sizeof(ChunkStorage) + chunks.bucket_count() * sizeof(void*);
+    for (const auto& [coord, chunk] : chunks)
+      total += nodeBytes + chunk->memoryUsage();
+    return total;
+  }
+}
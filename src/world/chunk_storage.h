@@ -0,0 +1,94 @@
+#pragma once
+
+#include "world/chunk.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace zm
+{
+  struct ChunkCoord
+  {
+    int32_t x = 0, y = 0, z = 0;
+
+    bool operator==(const ChunkCoord& other) const = default;
+  };
+
+  struct ChunkCoordHash
+  {
+    size_t operator()(const ChunkCoord& c) const
+    {
+      // large primes, spreads neighbouring coords across buckets
+      return size_t(uint32_t(c.x) * 73856093u) ^ size_t(uint32_t(c.y) * 19349663u) ^ size_t(uint32_t(c.z) * 83492791u);
+    }
+  };
+
+  // A block in world coordinates, kept apart from ChunkCoord so the two
+  // can't be mixed up as map keys
+  struct BlockPos
+  {
+    int32_t x = 0, y = 0, z = 0;
+
+    bool operator==(const BlockPos& other) const = default;
+  };
+
+  struct BlockPosHash
+  {
+    size_t operator()(const BlockPos& p) const
+    {
+      return size_t(uint32_t(p.x) * 73856093u) ^ size_t(uint32_t(p.y) * 19349663u) ^ size_t(uint32_t(p.z) * 83492791u);
+    }
+  };
+
+  // Arithmetic shift floors towards -inf so negative world coords land in the right chunk
+  inline ChunkCoord worldToChunk(int wx, int wy, int wz)
+  {
+    return { wx >> CHUNK_SHIFT, wy >> CHUNK_SHIFT, wz >> CHUNK_SHIFT };
+  }
+
+  // The world as a sparse set of 32^3 chunks. Chunks that were never written
+  // read back as air and cost nothing
+  class ChunkStorage
+  {
+  public:
+    Chunk* getChunk(ChunkCoord coord);
+    const Chunk* getChunk(ChunkCoord coord) const;
+    Chunk& getOrCreateChunk(ChunkCoord coord);
+    bool removeChunk(ChunkCoord coord);
+    void clear() { chunks.clear(); }
+
+    BlockId getBlock(int wx, int wy, int wz) const;
+    // Setting air inside a missing chunk does not allocate it
+    void setBlock(int wx, int wy, int wz, BlockId id);
+
+    size_t chunkCount() const { return chunks.size(); }
+    // Bytes held by chunk data plus a rough estimate of the hash map nodes
+    size_t memoryUsage() const;
+
+    // Jobs read chunk blocks (and their light) while the render thread
+    // edits them. Readers hold this shared while they read, edits hold it
+    // exclusively while they write. The map itself is still render thread only
+    std::shared_mutex& accessMutex() const { return access; }
+
+    template <typename Fn>
+    void forEachChunk(Fn&& fn)
+    {
+      for (auto& [coord, chunk] : chunks)
+        fn(coord, *chunk);
+    }
+
+    template <typename Fn>
+    void forEachChunk(Fn&& fn) const
+    {
+      for (const auto& [coord, chunk] : chunks)
+        fn(coord, *chunk);
+    }
+
+  private:
+    std::unordered_map<ChunkCoord, std::unique_ptr<Chunk>, ChunkCoordHash> chunks;
+    mutable std::shared_mutex access;
+  };
+}
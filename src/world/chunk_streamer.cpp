@@ -0,0 +1,238 @@
+#include "world/chunk_streamer.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace zm
+{
+  namespace
+  {
+    // horizontal distance in chunks from camera to the nearest point of column (x, z)
+    float columnDistance(glm::vec3 camera, int x, int z)
+    {
+      const float dx = std::max({ float(x) - camera.x, 0.0f, camera.x - float(x + 1) });
+      const float dz = std::max({ float(z) - camera.z, 0.0f, camera.z - float(z + 1) });
+      return std::sqrt(dx * dx + dz * dz);
+    }
+
+    // box distance, shortened for chunks ahead of the camera
+    float loadPriority(glm::vec3 camera, glm::vec3 view, float viewBias, ChunkCoord coord)
+    {
+      const glm::vec3 min(coord.x, coord.y, coord.z);
+      const glm::vec3 d = glm::max(glm::max(min - camera, glm::vec3(0.0f)), camera - (min + 1.0f));
+      const glm::vec3 toChunk = min + 0.5f - camera;
+      const float length = glm::length(toChunk);
+      const float ahead = length > 0.0f ? std::max(glm::dot(view, toChunk) / length, 0.0f) : 0.0f;
+      return glm::length(d) * (1.0f - viewBias * ahead) * float(CHUNK_SIZE);
+    }
+  }
+
+  ChunkStreamer::ChunkStreamer(ChunkStorage& world, LightStorage* light, ChunkBuilder& builder, const StreamingSettings& settings)
+    : world(world), light(light), builder(builder), settings(settings)
+  {
+    this->settings.unloadRadius = std::max(settings.unloadRadius, settings.loadRadius);
+    const int reach = int(std::ceil(settings.loadRadius)) + 1;
+    for (int z = -reach; z <= reach; z++)
+      for (int x = -reach; x <= reach; x++)
+        ringOffsets.push_back({ x, z });
+    std::sort(ringOffsets.begin(), ringOffsets.end(), [](glm::ivec2 a, glm::ivec2 b) { return a.x * a.x + a.y * a.y < b.x * b.x + b.y * b.y; });
+  }
+
+  size_t ChunkStreamer::chunkBytes(ChunkCoord coord) const
+  {
+    size_t bytes = 0;
+    if (const Chunk* chunk = world.getChunk(coord))
+      bytes += chunk->memoryUsage();
+    if (light)
+      if (const ChunkLight* chunkLight = light->get(coord))
+        bytes += chunkLight->memoryUsage();
+    return bytes;
+  }
+
+  size_t ChunkStreamer::missingAbove(ChunkCoord coord) const
+  {
+    size_t missing = 0;
+    const int top = light ? std::max(coord.y, light->getTopChunkY()) : coord.y;
+    for (int y = coord.y; y <= top; y++)
+      missing += !builder.isRequested({ coord.x, y, coord.z });
+    return missing;
+  }
+
+  void ChunkStreamer::adoptCreated()
+  {
+    created.clear();
+    builder.takeCreated(created);
+    for (const ChunkCoord& coord : created)
+      if (entries.emplace(coord, Entry{ 0, frame, false }).second)
+        reservedBytes += MAX_CHUNK_BYTES;
+  }
+
+  void ChunkStreamer::evict(const std::vector<ChunkCoord>& coords)
+  {
+    if (coords.empty())
+      return;
+    builder.evict(coords);
+    for (const ChunkCoord& coord : coords)
+    {
+      auto it = entries.find(coord);
+      residentBytes -= it->second.bytes;
+      residentCount--;
+      entries.erase(it);
+    }
+    evicted += coords.size();
+  }
+
+  void ChunkStreamer::update(glm::vec3 cameraPos, glm::vec3 viewDirection)
+  {
+    ZM_PROFILE_SCOPE("stream chunks");
+    frame++;
+    adoptCreated();
+
+    // finished chunks swap their reservation for what they really take
+    for (auto& [coord, entry] : entries)
+      if (!entry.ready && builder.isIdle(coord))
+      {
+        entry.ready = true;
+        entry.bytes = chunkBytes(coord);
+        reservedBytes -= MAX_CHUNK_BYTES;
+        residentBytes += entry.bytes;
+        residentCount++;
+        loaded++;
+
+        // stitching its light in may have grown the light of the chunks around it
+        if (light)
+          for (int dz = -1; dz <= 1; dz++)
+            for (int dy = -1; dy <= 1; dy++)
+              for (int dx = -1; dx <= 1; dx++)
+              {
+                auto around = entries.find({ coord.x + dx, coord.y + dy, coord.z + dz });
+                if ((dx || dy || dz) && around != entries.end() && around->second.ready)
+                {
+                  const size_t bytes = chunkBytes(around->first);
+                  residentBytes += bytes - around->second.bytes;
+                  around->second.bytes = bytes;
+                }
+              }
+      }
+
+    const glm::vec3 camera = cameraPos / float(CHUNK_SIZE);
+    const glm::vec3 view = glm::length(viewDirection) > 0.0f ? glm::normalize(viewDirection) : glm::vec3(0.0f);
+    const int centerX = int(std::floor(camera.x)), centerZ = int(std::floor(camera.z));
+    candidates.clear();
+    size_t ringGenerating = 0;
+    for (const glm::ivec2& offset : ringOffsets)
+    {
+      const int x = centerX + offset.x, z = centerZ + offset.y;
+      if (columnDistance(camera, x, z) > settings.loadRadius)
+        continue;
+      for (int y = settings.minChunkY; y <= settings.maxChunkY; y++)
+      {
+        auto it = entries.find({ x, y, z });
+        if (it == entries.end())
+        {
+          candidates.push_back({ loadPriority(camera, view, settings.viewBias, { x, y, z }), { x, y, z } });
+          continue;
+        }
+        it->second.lastSeen = frame;
+        ringGenerating += !it->second.ready;
+      }
+    }
+
+    // past the unload radius chunks go as soon as nothing reads them, inside
+    // it they stay until the budget wants their room
+    victims.clear();
+    for (const auto& [coord, entry] : entries)
+      if (entry.ready && entry.lastSeen != frame && columnDistance(camera, coord.x, coord.z) > settings.unloadRadius && builder.isIdle(coord))
+        victims.push_back(coord);
+    evict(victims);
+
+    const size_t slots = settings.maxGenerating > ringGenerating ? settings.maxGenerating - ringGenerating : 0;
+    const size_t wanted = std::min(candidates.size(), slots);
+    if (wanted > 0 && committedBytes() + wanted * MAX_CHUNK_BYTES > settings.memoryBudget)
+    {
+      // least recently seen first
+      leastRecent.clear();
+      for (const auto& [coord, entry] : entries)
+        if (entry.ready && entry.lastSeen != frame && builder.isIdle(coord))
+          leastRecent.push_back({ entry.lastSeen, coord });
+      std::sort(leastRecent.begin(), leastRecent.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+      victims.clear();
+      size_t freed = 0;
+      for (const auto& [lastSeen, coord] : leastRecent)
+      {
+        if (committedBytes() - freed + wanted * MAX_CHUNK_BYTES <= settings.memoryBudget)
+          break;
+        freed += entries[coord].bytes;
+        victims.push_back(coord);
+      }
+      evict(victims);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority < b.priority; });
+    size_t requested = 0;
+    for (const Candidate& candidate : candidates)
+    {
+      if (ringGenerating >= settings.maxGenerating)
+        break;
+      // lighting it creates the column above too
+      const size_t creating = missingAbove(candidate.coord);
+      if (creating == 0)
+        continue;
+      if (committedBytes() + creating * MAX_CHUNK_BYTES > settings.memoryBudget)
+        break;
+      builder.requestLight(candidate.coord, candidate.priority);
+      adoptCreated();
+      ringGenerating += creating;
+      requested += creating;
+    }
+    pendingCount = candidates.size() > requested ? candidates.size() - requested : 0;
+
+    Profiler& profiler = Profiler::get();
+    profiler.counter("chunks pending", double(pendingCount));
+    profiler.counter("chunks generating", double(entries.size() - residentCount));
+    profiler.counter("chunks meshing", double(builder.inFlight()));
+    profiler.counter("chunks resident", double(residentCount));
+    profiler.counter("streaming MB", double(committedBytes()) / 1048576.0);
+  }
+
+  void ChunkStreamer::touch(ChunkCoord coord)
+  {
+    auto it = entries.find(coord);
+    if (it == entries.end() || !it->second.ready)
+      return;
+    residentBytes -= it->second.bytes;
+    it->second.bytes = chunkBytes(coord);
+    residentBytes += it->second.bytes;
+  }
+
+  size_t ChunkStreamer::chunkAllowance() const
+  {
+    // the ring's own pending chunks come first
+    const size_t committed = committedBytes() + std::min(pendingCount, settings.maxGenerating) * MAX_CHUNK_BYTES;
+    return committed < settings.memoryBudget ? (settings.memoryBudget - committed) / MAX_CHUNK_BYTES : 0;
+  }
+
+  bool ChunkStreamer::isResident(ChunkCoord coord) const
+  {
+    auto it = entries.find(coord);
+    return it != entries.end() && it->second.ready;
+  }
+
+  StreamingStats ChunkStreamer::stats() const
+  {
+    StreamingStats stats;
+    stats.pending = pendingCount;
+    stats.generating = entries.size() - residentCount;
+    stats.meshing = builder.inFlight();
+    stats.resident = residentCount;
+    stats.residentBytes = residentBytes;
+    stats.reservedBytes = reservedBytes;
+    stats.budgetBytes = settings.memoryBudget;
+    stats.loaded = loaded;
+    stats.evicted = evicted;
+    return stats;
+  }
+}
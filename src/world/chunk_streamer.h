@@ -0,0 +1,133 @@
+#pragma once
+
+#include "world/chunk_builder.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  struct StreamingSettings
+  {
+    // columns whose nearest point is within loadRadius chunks (horizontally)
+    // of the camera are loaded, the ones past unloadRadius dropped. In between
+    // chunks stay until the budget needs their room
+    float loadRadius = 8.0f;
+    float unloadRadius = 10.0f;
+    // blocks and light of every chunk in the world, including what chunks on
+    // their way may grow to
+    size_t memoryBudget = 256u << 20;
+    // 0 loads in plain distance order, 1 makes a chunk straight ahead count as
+    // if it were right next to the camera
+    float viewBias = 0.5f;
+    // ring chunks generating at once, keeps the job queue short so a camera
+    // turning around isn't stuck behind what it just left
+    size_t maxGenerating = 64;
+    // vertical extent of the world in chunks, inclusive
+    int minChunkY = 0;
+    int maxChunkY = 4;
+  };
+
+  struct StreamingStats
+  {
+    size_t pending = 0;    // ring chunks not requested yet
+    size_t generating = 0; // generating or lighting, their worst case reserved
+    size_t meshing = 0;    // meshes in flight in the builder
+    size_t resident = 0;   // generated chunks in memory
+    size_t residentBytes = 0;
+    size_t reservedBytes = 0;
+    size_t budgetBytes = 0;
+    uint64_t loaded = 0;   // since the start
+    uint64_t evicted = 0;
+  };
+
+  // Keeps the chunks around the camera loaded within a memory budget, on top
+  // of ChunkBuilder. Each update walks the ring of columns within loadRadius
+  // nearest first, marks what is there as seen and requests (generate + light)
+  // what is missing, ahead of the camera first. Chunks are evicted once they
+  // are idle and past unloadRadius, or least recently seen first when the
+  // budget has no room for the ring.
+  //
+  // Every chunk in the world is accounted for, whoever requested it (LOD
+  // downsampling requests chunks far outside the ring). A chunk being
+  // generated is charged MAX_CHUNK_BYTES until it is idle and its real size is
+  // known, so requests never push the total past the budget. Edits can grow
+  // a chunk past its charge until the next touch().
+  //
+  // Only the render thread calls into this
+  class ChunkStreamer
+  {
+  public:
+    // blocks at 16 bits each, a full palette and unpacked light
+    static constexpr size_t MAX_CHUNK_BYTES = sizeof(Chunk) + CHUNK_VOLUME * sizeof(uint64_t) / 4 + 4096 + sizeof(ChunkLight) + CHUNK_VOLUME;
+
+    ChunkStreamer(ChunkStorage& world, LightStorage* light, ChunkBuilder& builder, const StreamingSettings& settings = {});
+
+    ChunkStreamer(const ChunkStreamer&) = delete;
+    ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+
+    // Evicts, then requests, for a camera at cameraPos looking along
+    // viewDirection. Publishes the stats as profiler counters
+    void update(glm::vec3 cameraPos, glm::vec3 viewDirection);
+
+    // coord was edited, its size may have changed
+    void touch(ChunkCoord coord);
+
+    // How many more chunks requests outside the streamer (LOD) may create
+    // before the budget is full, leaving room for the ring chunks still to come
+    size_t chunkAllowance() const;
+
+    bool isResident(ChunkCoord coord) const;
+    size_t committedBytes() const { return residentBytes + reservedBytes; }
+
+    const StreamingSettings& getSettings() const { return settings; }
+    StreamingStats stats() const;
+
+  private:
+    struct Entry
+    {
+      size_t bytes = 0;      // while ready
+      uint64_t lastSeen = 0; // frame it was last inside the ring
+      bool ready = false;
+    };
+
+    struct Candidate
+    {
+      float priority;
+      ChunkCoord coord;
+    };
+
+    // the builder's newly created chunks, reserved for
+    void adoptCreated();
+    void evict(const std::vector<ChunkCoord>& coords);
+    size_t chunkBytes(ChunkCoord coord) const;
+    // chunks requestLight(coord) would create, coord and the column above it
+    size_t missingAbove(ChunkCoord coord) const;
+
+    ChunkStorage& world;
+    LightStorage* light;
+    ChunkBuilder& builder;
+    StreamingSettings settings;
+
+    // column offsets within loadRadius, nearest first
+    std::vector<glm::ivec2> ringOffsets;
+    std::unordered_map<ChunkCoord, Entry, ChunkCoordHash> entries;
+    size_t residentBytes = 0;
+    size_t reservedBytes = 0;
+    size_t residentCount = 0;
+    size_t pendingCount = 0;
+    uint64_t frame = 0;
+    uint64_t loaded = 0;
+    uint64_t evicted = 0;
+
+    // per update scratch
+    std::vector<ChunkCoord> created;
+    std::vector<Candidate> candidates;
+    std::vector<ChunkCoord> victims;
+    std::vector<std::pair<uint64_t, ChunkCoord>> leastRecent;
+  };
+}
@@ -0,0 +1,244 @@
+#include "world/light.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace zm
+{
+  namespace
+  {
+    struct SeedScratch
+    {
+      std::array<BlockId, CHUNK_VOLUME> blocks;
+      std::array<uint8_t, CHUNK_VOLUME> light;
+      std::vector<uint16_t> queue;
+    };
+
+    SeedScratch& threadScratch()
+    {
+      thread_local SeedScratch scratch;
+      return scratch;
+    }
+
+    // a cell relative to the centre chunk's origin
+    struct StitchNode
+    {
+      int16_t x, y, z;
+    };
+
+    // the chunk slot and index of a cell of the neighbourhood, false outside
+    // it and in chunks the fill may not touch yet
+    bool stitchCell(const LightNeighbourhood& around, int x, int y, int z, int& slot, int& index)
+    {
+      const int cx = (x + CHUNK_SIZE) >> CHUNK_SHIFT, cy = (y + CHUNK_SIZE) >> CHUNK_SHIFT, cz = (z + CHUNK_SIZE) >> CHUNK_SHIFT;
+      if (unsigned(cx) > 2 || unsigned(cy) > 2 || unsigned(cz) > 2)
+        return false;
+      slot = cx + 3 * (cy + 3 * cz);
+      const ChunkLight* light = around.lights[slot];
+      if (!light || !around.chunks[slot] || (slot != LightNeighbourhood::CENTRE && !light->isStitched()))
+        return false;
+      index = chunkIndex(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK);
+      return true;
+    }
+
+    // in-chunk flood fill from every queued cell, both channels at once
+    void spreadInChunk(SeedScratch& s)
+    {
+      for (size_t head = 0; head < s.queue.size(); head++)
+      {
+        const int index = s.queue[head];
+        const int x = index & CHUNK_MASK, z = (index >> CHUNK_SHIFT) & CHUNK_MASK, y = index >> (2 * CHUNK_SHIFT);
+        const int sky = skyLight(s.light[index]), block = blockLight(s.light[index]);
+
+        const int next[FACE_COUNT][3] = { { x - 1, y, z }, { x + 1, y, z }, { x, y - 1, z }, { x, y + 1, z }, { x, y, z - 1 }, { x, y, z + 1 } };
+        for (int face = 0; face < FACE_COUNT; face++)
+        {
+          const int nx = next[face][0], ny = next[face][1], nz = next[face][2];
+          if (unsigned(nx) >= unsigned(CHUNK_SIZE) || unsigned(ny) >= unsigned(CHUNK_SIZE) || unsigned(nz) >= unsigned(CHUNK_SIZE))
+            continue;
+          const int n = chunkIndex(nx, ny, nz);
+          if (isOpaque(s.blocks[n]))
+            continue;
+
+          // full sunlight keeps going straight down without fading
+          const int nextSky = face == FACE_NEG_Y && sky == MAX_LIGHT ? MAX_LIGHT : sky - 1;
+          const int oldSky = skyLight(s.light[n]), oldBlock = blockLight(s.light[n]);
+          const int newSky = std::max(oldSky, nextSky), newBlock = std::max(oldBlock, block - 1);
+          if (newSky != oldSky || newBlock != oldBlock)
+          {
+            s.light[n] = packLight(newSky, newBlock);
+            s.queue.push_back(uint16_t(n));
+          }
+        }
+      }
+    }
+  }
+
+  void ChunkLight::set(int index, uint8_t light)
+  {
+    if (values.empty())
+    {
+      if (light == fillValue)
+        return;
+      values.assign(CHUNK_VOLUME, fillValue);
+    }
+    values[index] = light;
+  }
+
+  void ChunkLight::fill(uint8_t light)
+  {
+    values.clear();
+    values.shrink_to_fit();
+    fillValue = light;
+  }
+
+  void ChunkLight::assign(const uint8_t* light)
+  {
+    if (std::all_of(light, light + CHUNK_VOLUME, [&](uint8_t v) { return v == light[0]; }))
+    {
+      fill(light[0]);
+      return;
+    }
+    values.assign(light, light + CHUNK_VOLUME);
+  }
+
+  ChunkLight* LightStorage::get(ChunkCoord coord)
+  {
+    auto it = lights.find(coord);
+    return it != lights.end() ? it->second.get() : nullptr;
+  }
+
+  const ChunkLight* LightStorage::get(ChunkCoord coord) const
+  {
+    auto it = lights.find(coord);
+    return it != lights.end() ? it->second.get() : nullptr;
+  }
+
+  ChunkLight& LightStorage::getOrCreate(ChunkCoord coord)
+  {
+    std::unique_ptr<ChunkLight>& slot = lights[coord];
+    if (!slot)
+      slot = std::make_unique<ChunkLight>();
+    return *slot;
+  }
+
+  size_t LightStorage::memoryUsage() const
+  {
+    size_t total = sizeof(LightStorage) + lights.bucket_count() * sizeof(void*);
+    for (const auto& [coord, light] : lights)
+      total += sizeof(ChunkCoord) + sizeof(void*) * 3 + sizeof(size_t) + light->memoryUsage();
+    return total;
+  }
+
+  void seedChunkLight(const Chunk& chunk, const ChunkLight* above, ChunkLight& out)
+  {
+    // the common cases, open air under open sky and solid ground under solid ground
+    const bool skyAbove = !above || (above->isUniform() && above->get(0) == LIGHT_FULL_SKY);
+    const bool darkAbove = above && above->isUniform() && skyLight(above->get(0)) == 0;
+    if (chunk.isUniform() && blockInfo(chunk.uniformBlock()).lightEmission == 0)
+    {
+      if (isOpaque(chunk.uniformBlock()) || darkAbove)
+      {
+        out.fill(0);
+        return;
+      }
+      if (skyAbove)
+      {
+        out.fill(LIGHT_FULL_SKY);
+        return;
+      }
+    }
+
+    SeedScratch& s = threadScratch();
+    chunk.unpack(s.blocks.data());
+    std::fill(s.light.begin(), s.light.end(), uint8_t(0));
+    s.queue.clear();
+
+    for (int z = 0; z < CHUNK_SIZE; z++)
+      for (int x = 0; x < CHUNK_SIZE; x++)
+      {
+        const int incoming = above ? skyLight(above->get(chunkIndex(x, 0, z))) : MAX_LIGHT;
+        if (incoming == MAX_LIGHT)
+        {
+          for (int y = CHUNK_SIZE - 1; y >= 0 && !isOpaque(s.blocks[chunkIndex(x, y, z)]); y--)
+            s.light[chunkIndex(x, y, z)] = LIGHT_FULL_SKY;
+        }
+        else if (incoming > 1 && !isOpaque(s.blocks[chunkIndex(x, CHUNK_SIZE - 1, z)]))
+        {
+          s.light[chunkIndex(x, CHUNK_SIZE - 1, z)] = packLight(incoming - 1, 0);
+        }
+      }
+
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+    {
+      const int emission = blockInfo(s.blocks[i]).lightEmission;
+      if (emission > 0)
+        s.light[i] = packLight(skyLight(s.light[i]), emission);
+      if (s.light[i] != 0)
+        s.queue.push_back(uint16_t(i));
+    }
+    spreadInChunk(s);
+    out.assign(s.light.data());
+  }
+
+  void stitchChunkLight(const LightNeighbourhood& around)
+  {
+    thread_local std::vector<StitchNode> queue;
+    queue.clear();
+
+    // both sides of every face shared with a stitched neighbour
+    constexpr int offsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    for (int face = 0; face < FACE_COUNT; face++)
+    {
+      int slot, index;
+      const int axis = face / 2;
+      int probe[3] = { 0, 0, 0 };
+      probe[axis] = (face & 1) ? CHUNK_SIZE : -1;
+      if (!stitchCell(around, probe[0], probe[1], probe[2], slot, index))
+        continue;
+      for (const int layer : { (face & 1) ? CHUNK_SIZE - 1 : 0, probe[axis] })
+        for (int a = 0; a < CHUNK_SIZE; a++)
+          for (int b = 0; b < CHUNK_SIZE; b++)
+          {
+            int cell[3];
+            cell[axis] = layer;
+            cell[(axis + 1) % 3] = a;
+            cell[(axis + 2) % 3] = b;
+            stitchCell(around, cell[0], cell[1], cell[2], slot, index);
+            if (around.lights[slot]->get(index) != 0)
+              queue.push_back({ int16_t(cell[0]), int16_t(cell[1]), int16_t(cell[2]) });
+          }
+    }
+
+    // the same fill as spreadInChunk, across chunks
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+      const StitchNode node = queue[head];
+      int slot, index;
+      stitchCell(around, node.x, node.y, node.z, slot, index);
+      const uint8_t light = around.lights[slot]->get(index);
+      const int sky = skyLight(light), block = blockLight(light);
+      if (sky <= 1 && block <= 1)
+        continue;
+
+      for (int face = 0; face < FACE_COUNT; face++)
+      {
+        const int nx = node.x + offsets[face][0], ny = node.y + offsets[face][1], nz = node.z + offsets[face][2];
+        int nextSlot, next;
+        if (!stitchCell(around, nx, ny, nz, nextSlot, next) || isOpaque(around.chunks[nextSlot]->getIndex(next)))
+          continue;
+
+        const int nextSky = face == FACE_NEG_Y && sky == MAX_LIGHT ? MAX_LIGHT : sky - 1;
+        const uint8_t old = around.lights[nextSlot]->get(next);
+        const int newSky = std::max(skyLight(old), nextSky), newBlock = std::max(blockLight(old), block - 1);
+        if (newSky != skyLight(old) || newBlock != blockLight(old))
+        {
+          around.lights[nextSlot]->set(next, packLight(newSky, newBlock));
+          queue.push_back({ int16_t(nx), int16_t(ny), int16_t(nz) });
+        }
+      }
+    }
+    around.lights[LightNeighbourhood::CENTRE]->markStitched();
+  }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "world/chunk_storage.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  constexpr int MAX_LIGHT = 15;
+
+  // One byte per block: sunlight in the high nibble, block light (lamps) in
+  // the low one
+  inline uint8_t packLight(int sky, int block) { return uint8_t((sky << 4) | block); }
+  inline int skyLight(uint8_t light) { return light >> 4; }
+  inline int blockLight(uint8_t light) { return light & 15; }
+
+  // Full sunlight, what every face without light data is lit with
+  constexpr uint8_t LIGHT_FULL_SKY = MAX_LIGHT << 4;
+
+  // Light values of one chunk in chunkIndex order. Chunks that are all open
+  // sky or all dark underground hold a single value and cost no memory,
+  // the array appears on the first write that breaks uniformity
+  class ChunkLight
+  {
+  public:
+    explicit ChunkLight(uint8_t fill = 0) : fillValue(fill) {}
+
+    uint8_t get(int index) const { return values.empty() ? fillValue : values[index]; }
+    void set(int index, uint8_t light);
+    void fill(uint8_t light);
+    // Copies a full CHUNK_VOLUME array, collapsing it when it is uniform
+    void assign(const uint8_t* light);
+
+    bool isUniform() const { return values.empty(); }
+    size_t memoryUsage() const { return sizeof(ChunkLight) + values.capacity(); }
+
+    // joined with its neighbours by stitchChunkLight
+    bool isStitched() const { return stitched; }
+    void markStitched() { stitched = true; }
+
+  private:
+    std::vector<uint8_t> values;
+    uint8_t fillValue;
+    bool stitched = false;
+  };
+
+  // Light for the chunks of a ChunkStorage, same sparse layout. Sunlight
+  // enters the world from above topChunkY: chunks at and above it are lit
+  // straight down from their top layer, the ones below take over the bottom
+  // layer of the chunk above them
+  class LightStorage
+  {
+  public:
+    explicit LightStorage(int topChunkY) : topChunkY(topChunkY) {}
+
+    ChunkLight* get(ChunkCoord coord);
+    const ChunkLight* get(ChunkCoord coord) const;
+    ChunkLight& getOrCreate(ChunkCoord coord);
+    bool remove(ChunkCoord coord) { return lights.erase(coord) > 0; }
+
+    int getTopChunkY() const { return topChunkY; }
+    size_t count() const { return lights.size(); }
+    size_t memoryUsage() const;
+
+  private:
+    int topChunkY;
+    std::unordered_map<ChunkCoord, std::unique_ptr<ChunkLight>, ChunkCoordHash> lights;
+  };
+
+  // Initial light of a freshly generated or loaded chunk: sunlight falls
+  // straight down every column until it hits an opaque block, lamps get
+  // their own level. above is the light of the chunk above, nullptr for open
+  // sky. Light stays inside the chunk, stitchChunkLight carries it across
+  void seedChunkLight(const Chunk& chunk, const ChunkLight* above, ChunkLight& out);
+
+  // The 3x3x3 chunks around a seeded chunk, null where there is none
+  struct LightNeighbourhood
+  {
+    static constexpr int CENTRE = 13;
+    static int slot(int dx, int dy, int dz) { return (dx + 1) + 3 * ((dy + 1) + 3 * (dz + 1)); }
+
+    const Chunk* chunks[27] = {};
+    ChunkLight* lights[27] = {};
+  };
+
+  // Joins the centre's seeded light with the neighbours already stitched: a
+  // flood fill from the cells on both sides of every face they share, which
+  // spreads on through any stitched chunk around it (light fades out well
+  // within one chunk), then marks the centre stitched. Once every chunk has
+  // been stitched, in any order, the light is what one fill over all of them
+  // would give. Needs the storage's access mutex held exclusively
+  void stitchChunkLight(const LightNeighbourhood& around);
+}
@@ -0,0 +1,234 @@
+#include "world/lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr int faceOffsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    constexpr int HALF = CHUNK_SIZE / 2;
+
+    // one child unpacked plus the merged output, 192KB, per worker thread
+    struct DownsampleScratch
+    {
+      BlockId child[CHUNK_VOLUME];
+      BlockId merged[CHUNK_VOLUME];
+      uint8_t mergedLight[CHUNK_VOLUME];
+    };
+
+    DownsampleScratch& threadScratch()
+    {
+      thread_local std::unique_ptr<DownsampleScratch> scratch = std::make_unique<DownsampleScratch>();
+      return *scratch;
+    }
+
+    // most common opaque block of four, BLOCK_AIR if none is
+    BlockId dominantBlock(const BlockId (&blocks)[4])
+    {
+      BlockId best = BLOCK_AIR;
+      int bestCount = 0;
+      for (int i = 0; i < 4; i++)
+      {
+        if (!isOpaque(blocks[i]))
+          continue;
+        int count = 0;
+        for (int j = 0; j < 4; j++)
+          count += blocks[j] == blocks[i];
+        if (count > bestCount)
+        {
+          best = blocks[i];
+          bestCount = count;
+        }
+      }
+      return best;
+    }
+
+    BlockId mergeCell(const BlockId* blocks, int x, int y, int z)
+    {
+      const BlockId bottom[4] = { blocks[chunkIndex(x, y, z)], blocks[chunkIndex(x + 1, y, z)], blocks[chunkIndex(x, y, z + 1)],
+                                  blocks[chunkIndex(x + 1, y, z + 1)] };
+      const BlockId top[4] = { blocks[chunkIndex(x, y + 1, z)], blocks[chunkIndex(x + 1, y + 1, z)], blocks[chunkIndex(x, y + 1, z + 1)],
+                               blocks[chunkIndex(x + 1, y + 1, z + 1)] };
+      int solid = 0, filled = 0;
+      for (int i = 0; i < 4; i++)
+      {
+        solid += isOpaque(bottom[i]) + isOpaque(top[i]);
+        filled += (bottom[i] != BLOCK_AIR) + (top[i] != BLOCK_AIR);
+      }
+      if (solid < 4)
+        return filled < 4 ? BLOCK_AIR : BLOCK_WATER;
+
+      const BlockId upper = dominantBlock(top);
+      return upper != BLOCK_AIR ? upper : dominantBlock(bottom);
+    }
+
+    // light of the merged cells of one child. blocks is nullptr for a
+    // uniform child, every block is fill then
+    void mergeLight(const BlockId* blocks, BlockId fill, const ChunkLight* light, int ox, int oy, int oz, uint8_t* out)
+    {
+      if (!blocks && (!light || light->isUniform()))
+      {
+        const uint8_t value = isOpaque(fill) ? 0 : light ? light->get(0) : LIGHT_FULL_SKY;
+        for (int y = 0; y < HALF; y++)
+          for (int z = 0; z < HALF; z++)
+            std::fill_n(&out[chunkIndex(ox, oy + y, oz + z)], HALF, value);
+        return;
+      }
+
+      for (int y = 0; y < HALF; y++)
+        for (int z = 0; z < HALF; z++)
+          for (int x = 0; x < HALF; x++)
+          {
+            int open = 0, sky = 0, lamp = 0;
+            for (int i = 0; i < 8; i++)
+            {
+              const int index = chunkIndex(x * 2 + (i & 1), y * 2 + ((i >> 1) & 1), z * 2 + ((i >> 2) & 1));
+              if (isOpaque(blocks ? blocks[index] : fill))
+                continue;
+              const uint8_t value = light ? light->get(index) : LIGHT_FULL_SKY;
+              open++;
+              sky += skyLight(value);
+              lamp += blockLight(value);
+            }
+            out[chunkIndex(ox + x, oy + y, oz + z)] = open ? packLight(sky / open, lamp / open) : 0;
+          }
+    }
+
+    void selectNode(const LodKey& key, glm::vec3 camera, const LodSettings& settings, LodSelection& out)
+    {
+      // nodes reaching outside the world vertically still get selected,
+      // their missing chunks are air
+      const int minY = key.origin().y, maxY = minY + key.span() - 1;
+      if (maxY < settings.minChunkY || minY > settings.maxChunkY)
+        return;
+
+      const float distance = lodDistance(camera, key);
+      if (distance > settings.viewRadius)
+        return;
+
+      if (key.level > 0 && distance < settings.ringRadius[key.level - 1])
+      {
+        out.split.insert(key);
+        for (int octant = 0; octant < 8; octant++)
+          selectNode(key.child(octant), camera, settings, out);
+        return;
+      }
+
+      out.nodes.push_back(key);
+      out.selected.insert(key);
+    }
+  }
+
+  void downsampleChunk(const Chunk* const children[8], Chunk& out, const ChunkLight* const childLights[8], ChunkLight* outLight)
+  {
+    DownsampleScratch& scratch = threadScratch();
+    for (int octant = 0; octant < 8; octant++)
+    {
+      const int ox = (octant & 1) * HALF, oy = ((octant >> 1) & 1) * HALF, oz = ((octant >> 2) & 1) * HALF;
+      const Chunk* child = children[octant];
+      const ChunkLight* childLight = childLights ? childLights[octant] : nullptr;
+
+      // uniform children (all air above ground, all stone below) skip the unpack
+      if (!child || child->isUniform())
+      {
+        const BlockId fill = child ? child->uniformBlock() : BLOCK_AIR;
+        for (int y = 0; y < HALF; y++)
+          for (int z = 0; z < HALF; z++)
+            std::fill_n(&scratch.merged[chunkIndex(ox, oy + y, oz + z)], HALF, fill);
+        if (outLight)
+          mergeLight(nullptr, fill, childLight, ox, oy, oz, scratch.mergedLight);
+        continue;
+      }
+
+      child->unpack(scratch.child);
+      for (int y = 0; y < HALF; y++)
+        for (int z = 0; z < HALF; z++)
+          for (int x = 0; x < HALF; x++)
+            scratch.merged[chunkIndex(ox + x, oy + y, oz + z)] = mergeCell(scratch.child, x * 2, y * 2, z * 2);
+      if (outLight)
+        mergeLight(scratch.child, BLOCK_AIR, childLight, ox, oy, oz, scratch.mergedLight);
+    }
+    out.pack(scratch.merged);
+    if (outLight)
+      outLight->assign(scratch.mergedLight);
+  }
+
+  void LodSelection::clear()
+  {
+    nodes.clear();
+    selected.clear();
+    split.clear();
+  }
+
+  uint8_t LodSelection::transitionFaces(const LodKey& key) const
+  {
+    uint8_t faces = 0;
+    for (int face = 0; face < FACE_COUNT; face++)
+    {
+      const LodKey neighbour = lodNeighbour(key, face);
+      if (selected.count(neighbour))
+        continue;
+
+      // split means finer nodes cover it, a selected ancestor a coarser one
+      bool covered = split.count(neighbour) != 0;
+      for (LodKey ancestor = neighbour; !covered && ancestor.level < LOD_LEVELS - 1;)
+      {
+        ancestor = ancestor.parent();
+        covered = selected.count(ancestor) != 0;
+      }
+      if (covered)
+        faces |= uint8_t(1u << face);
+    }
+    return faces;
+  }
+
+  uint8_t LodSelection::sameLevelFaces(const LodKey& key) const
+  {
+    uint8_t faces = 0;
+    for (int face = 0; face < FACE_COUNT; face++)
+      if (selected.count(lodNeighbour(key, face)))
+        faces |= uint8_t(1u << face);
+    return faces;
+  }
+
+  void selectLodNodes(glm::vec3 cameraPos, const LodSettings& settings, LodSelection& out)
+  {
+    out.clear();
+    const glm::vec3 camera = cameraPos / float(CHUNK_SIZE);
+    const int top = LOD_LEVELS - 1;
+    const float span = float(1 << top);
+
+    const int minX = int(std::floor((camera.x - settings.viewRadius) / span));
+    const int maxX = int(std::floor((camera.x + settings.viewRadius) / span));
+    const int minZ = int(std::floor((camera.z - settings.viewRadius) / span));
+    const int maxZ = int(std::floor((camera.z + settings.viewRadius) / span));
+    const int minY = settings.minChunkY >> top;
+    const int maxY = settings.maxChunkY >> top;
+
+    for (int y = minY; y <= maxY; y++)
+      for (int z = minZ; z <= maxZ; z++)
+        for (int x = minX; x <= maxX; x++)
+          selectNode({ x, y, z, top }, camera, settings, out);
+
+    // nearest first, the order meshes get requested in
+    std::sort(out.nodes.begin(), out.nodes.end(), [&](const LodKey& a, const LodKey& b) {
+      return lodDistance(camera, a) < lodDistance(camera, b);
+    });
+  }
+
+  LodKey lodNeighbour(const LodKey& key, int face)
+  {
+    return { key.x + faceOffsets[face][0], key.y + faceOffsets[face][1], key.z + faceOffsets[face][2], key.level };
+  }
+
+  float lodDistance(glm::vec3 point, const LodKey& key)
+  {
+    const ChunkCoord origin = key.origin();
+    const glm::vec3 min(origin.x, origin.y, origin.z);
+    const glm::vec3 max = min + float(key.span());
+    return glm::length(glm::max(glm::max(min - point, point - max), glm::vec3(0.0f)));
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "world/light.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace zm
+{
+  // Level 0 is full detail, level n merges 2^n x 2^n x 2^n blocks into one
+  // voxel, so a level n node is still a 32^3 chunk but covers 2^n chunks
+  // along each axis
+  constexpr int LOD_LEVELS = 4;
+
+  struct LodKey
+  {
+    int32_t x = 0, y = 0, z = 0;
+    int32_t level = 0;
+
+    bool operator==(const LodKey& other) const = default;
+
+    // first full detail chunk covered, and how many chunks along each axis
+    ChunkCoord origin() const { return { x * (1 << level), y * (1 << level), z * (1 << level) }; }
+    int span() const { return 1 << level; }
+
+    LodKey parent() const { return { x >> 1, y >> 1, z >> 1, level + 1 }; }
+    // octant bit 0 is +x, bit 1 +y, bit 2 +z
+    LodKey child(int octant) const { return { x * 2 + (octant & 1), y * 2 + ((octant >> 1) & 1), z * 2 + ((octant >> 2) & 1), level - 1 }; }
+  };
+
+  struct LodKeyHash
+  {
+    size_t operator()(const LodKey& k) const
+    {
+      return ChunkCoordHash{}({ k.x, k.y, k.z }) ^ size_t(uint32_t(k.level) * 2654435761u);
+    }
+  };
+
+  inline LodKey lodKey(ChunkCoord coord) { return { coord.x, coord.y, coord.z, 0 }; }
+
+  // Merges 8 same-level nodes (indexed by octant) into their parent. A 2x2x2
+  // cell becomes solid when at least half of it is opaque, taking the most
+  // common opaque block of its top layer so grass stays on top, falling back
+  // to the bottom layer. Otherwise it is water when at least half of it is
+  // anything but air, so lakes stay see-through instead of turning into
+  // walls. Missing children are air. 4x and 8x come from merging again.
+  // With outLight, each cell's light is the average of its open blocks'
+  // light (dark when none are open). Children without light are full sky
+  void downsampleChunk(const Chunk* const children[8], Chunk& out, const ChunkLight* const childLights[8] = nullptr, ChunkLight* outLight = nullptr);
+
+  struct LodSettings
+  {
+    // a node of level n > 0 is split into its children while the camera is
+    // closer than ringRadius[n - 1] chunks to it
+    float ringRadius[LOD_LEVELS - 1] = { 4.0f, 8.0f, 16.0f };
+    // nothing further than this many chunks is selected
+    float viewRadius = 24.0f;
+    // vertical extent of the world in chunks, inclusive
+    int minChunkY = 0;
+    int maxChunkY = 4;
+
+    float viewDistance() const { return viewRadius * float(CHUNK_SIZE); }
+  };
+
+  // The nodes that tile the view volume around a camera. Walks an octree of
+  // top level nodes down, splitting nodes inside their ring, so detail falls
+  // off in shells of doubling size around the camera (a clipmap built from
+  // octree nodes). Every chunk within viewRadius is covered by exactly one
+  // selected node
+  struct LodSelection
+  {
+    std::vector<LodKey> nodes;
+    std::unordered_set<LodKey, LodKeyHash> selected;
+    std::unordered_set<LodKey, LodKeyHash> split;
+
+    void clear();
+    bool contains(const LodKey& key) const { return selected.count(key) != 0; }
+
+    // Faces whose same-level neighbour is not selected but is drawn by a node
+    // of another level. Meshing treats those neighbours as air so both sides
+    // close their surface along the seam instead of leaving cracks
+    uint8_t transitionFaces(const LodKey& key) const;
+    // Faces with a selected same-level neighbour to mesh against
+    uint8_t sameLevelFaces(const LodKey& key) const;
+  };
+
+  void selectLodNodes(glm::vec3 cameraPos, const LodSettings& settings, LodSelection& out);
+
+  LodKey lodNeighbour(const LodKey& key, int face);
+  // Distance in chunks from a point given in chunks to the node's box
+  float lodDistance(glm::vec3 point, const LodKey& key);
+}
@@ -0,0 +1,360 @@
+#include "world/lod_terrain.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr uint8_t ALL_FACES = (1u << FACE_COUNT) - 1;
+  }
+
+  LodTerrain::LodTerrain(JobSystem& jobs, ChunkStorage& world, ChunkBuilder& builder, const LodSettings& settings, size_t maxInFlight)
+    : jobs(jobs), world(world), builder(builder), settings(settings), finished(maxInFlight)
+  {
+  }
+
+  LodTerrain::~LodTerrain()
+  {
+    // jobs push into finished and read the world
+    jobs.waitIdle();
+  }
+
+  uint8_t LodTerrain::closedFaces(const LodKey& key) const
+  {
+    // full detail chunks mesh against real neighbours wherever they are not
+    // at a seam, coarser nodes only have same-level data to mesh against
+    if (key.level == 0)
+      return current.transitionFaces(key);
+    return ALL_FACES & ~current.sameLevelFaces(key);
+  }
+
+  void LodTerrain::update(glm::vec3 cameraPos, size_t chunkAllowance)
+  {
+    selectLodNodes(cameraPos, settings, current);
+
+    // merged chunks well outside the view are rebuilt if it ever comes back
+    for (auto it = lodChunks.begin(); it != lodChunks.end();)
+    {
+      if (lodDistance(cameraPos / float(CHUNK_SIZE), it->first) > settings.viewRadius * 1.5f && it->second.job->isFinished())
+        it = lodChunks.erase(it);
+      else
+        ++it;
+    }
+
+    const glm::vec3 camera = cameraPos / float(CHUNK_SIZE);
+    bool builderFull = false, lodFull = false;
+    for (const LodKey& key : current.nodes)
+    {
+      const uint8_t closed = closedFaces(key);
+      auto it = requested.find(key);
+      if (it != requested.end() && it->second.closedFaces == closed)
+        continue;
+
+      // chunks the streamer has no room for yet, later nodes may fit
+      const size_t needed = chunkAllowance == SIZE_MAX ? 0 : missingChunks(key, closed, chunkAllowance);
+      if (needed > chunkAllowance)
+        continue;
+
+      const float priority = lodDistance(camera, key) * float(CHUNK_SIZE);
+      const uint32_t version = nextVersion;
+      if (key.level == 0)
+      {
+        if (builderFull || !builder.requestMesh(key.origin(), priority, closed, version))
+        {
+          builderFull = true;
+          continue;
+        }
+      }
+      else if (lodFull || !requestLodMesh(key, closed, version, priority))
+      {
+        lodFull = true;
+        continue;
+      }
+      requested[key] = { closed, version };
+      nextVersion++;
+      if (chunkAllowance != SIZE_MAX)
+        chunkAllowance -= needed;
+    }
+  }
+
+  size_t LodTerrain::missingChunks(const LodKey& key, uint8_t closed, size_t limit) const
+  {
+    // the builder lights all six neighbours of a full detail chunk, seams or not
+    if (key.level == 0)
+    {
+      size_t missing = missingColumn(key.origin());
+      for (int face = 0; face < FACE_COUNT; face++)
+        missing += missingColumn(lodNeighbour(key, face).origin());
+      return missing;
+    }
+    size_t missing = missingBelow(key, limit) + missingAbove(key);
+    for (int face = 0; face < FACE_COUNT && missing <= limit; face++)
+      if (!(closed & (1u << face)))
+        missing += missingBelow(lodNeighbour(key, face), limit - missing) + missingAbove(lodNeighbour(key, face));
+    return missing;
+  }
+
+  size_t LodTerrain::missingBelow(const LodKey& key, size_t limit) const
+  {
+    if (!insideWorld(key))
+      return 0;
+    if (key.level == 0)
+      return !builder.isRequested(key.origin());
+    if (lodChunks.count(key))
+      return 0;
+    size_t missing = 0;
+    for (int octant = 0; octant < 8 && missing <= limit; octant++)
+      missing += missingBelow(key.child(octant), limit - missing);
+    return missing;
+  }
+
+  size_t LodTerrain::missingAbove(const LodKey& key) const
+  {
+    if (!builder.getLight() || !insideWorld(key))
+      return 0;
+    const ChunkCoord origin = key.origin();
+    size_t missing = 0;
+    for (int z = 0; z < key.span(); z++)
+      for (int x = 0; x < key.span(); x++)
+        for (int y = origin.y + key.span(); y <= settings.maxChunkY; y++)
+          missing += !builder.isRequested({ origin.x + x, y, origin.z + z });
+    return missing;
+  }
+
+  size_t LodTerrain::missingColumn(ChunkCoord coord) const
+  {
+    size_t missing = 0;
+    for (int y = coord.y; y <= std::max(coord.y, settings.maxChunkY); y++)
+      missing += !builder.isRequested({ coord.x, y, coord.z });
+    return missing;
+  }
+
+  bool LodTerrain::insideWorld(const LodKey& key) const
+  {
+    const int minY = key.origin().y;
+    return minY + key.span() - 1 >= settings.minChunkY && minY <= settings.maxChunkY;
+  }
+
+  LodTerrain::LodData LodTerrain::requestLodChunk(const LodKey& key, float priority, std::vector<JobHandle>& dependencies)
+  {
+    if (!insideWorld(key))
+      return {};
+
+    LightStorage* light = builder.getLight();
+    if (key.level == 0)
+    {
+      // world chunks and light live as long as the storage, the pointers own
+      // nothing. Without a LightStorage this only generates
+      dependencies.push_back(builder.requestLight(key.origin(), priority));
+      return { std::shared_ptr<const Chunk>(std::shared_ptr<const Chunk>(), world.getChunk(key.origin())),
+               light ? std::shared_ptr<const ChunkLight>(std::shared_ptr<const ChunkLight>(), light->get(key.origin())) : nullptr };
+    }
+
+    auto it = lodChunks.find(key);
+    if (it != lodChunks.end())
+    {
+      dependencies.push_back(it->second.job);
+      return { it->second.chunk, it->second.light };
+    }
+
+    std::vector<JobHandle> childJobs;
+    childJobs.reserve(8);
+    std::array<LodData, 8> children;
+    for (int octant = 0; octant < 8; octant++)
+      children[octant] = requestLodChunk(key.child(octant), priority, childJobs);
+
+    LodChunk& lodChunk = lodChunks[key];
+    lodChunk.chunk = std::make_shared<Chunk>();
+    if (light)
+      lodChunk.light = std::make_shared<ChunkLight>();
+    const ChunkStorage* storage = &world;
+    lodChunk.job = jobs.submit([storage, children, out = lodChunk.chunk, outLight = lodChunk.light] {
+      ZM_PROFILE_SCOPE("downsample");
+      const Chunk* pointers[8];
+      const ChunkLight* lights[8];
+      for (int octant = 0; octant < 8; octant++)
+      {
+        pointers[octant] = children[octant].chunk.get();
+        lights[octant] = children[octant].light.get();
+      }
+      // level 1 reads world chunks that may be edited
+      std::shared_lock lock(storage->accessMutex());
+      downsampleChunk(pointers, *out, lights, outLight.get());
+    }, priority, childJobs);
+
+    // the world chunks must stay until it has read them
+    if (key.level == 1)
+      for (int octant = 0; octant < 8; octant++)
+        if (children[octant].chunk)
+          builder.addReader(key.child(octant).origin(), lodChunk.job);
+
+    dependencies.push_back(lodChunk.job);
+    return { lodChunk.chunk, lodChunk.light };
+  }
+
+  bool LodTerrain::requestLodMesh(const LodKey& key, uint8_t closed, uint32_t version, float priority)
+  {
+    if (pending.load(std::memory_order_relaxed) >= finished.capacity())
+      return false;
+
+    std::vector<JobHandle> dependencies;
+    dependencies.reserve(FACE_COUNT + 1);
+    const LodData node = requestLodChunk(key, priority, dependencies);
+
+    std::array<LodData, FACE_COUNT> neighbours;
+    for (int face = 0; face < FACE_COUNT; face++)
+      if (!(closed & (1u << face)))
+        neighbours[face] = requestLodChunk(lodNeighbour(key, face), priority, dependencies);
+
+    const bool lit = builder.getLight() != nullptr;
+    pending.fetch_add(1, std::memory_order_relaxed);
+    jobs.submit([this, key, closed, version, node, neighbours, lit] {
+      ZM_PROFILE_SCOPE("mesh lod");
+      BuiltLodMesh built;
+      built.key = key;
+      built.closedFaces = closed;
+      built.version = version;
+      const Chunk* pointers[FACE_COUNT];
+      MeshLight meshLight;
+      meshLight.chunk = node.light.get();
+      for (int face = 0; face < FACE_COUNT; face++)
+      {
+        pointers[face] = neighbours[face].chunk.get();
+        meshLight.neighbours[face] = neighbours[face].light.get();
+      }
+      if (node.chunk)
+        ChunkMesher::forThisThread().mesh(*node.chunk, pointers, built.mesh, lit ? &meshLight : nullptr);
+      // can't fail, the queue is as big as the number of meshes allowed in flight
+      finished.tryPush(std::move(built));
+    }, priority, dependencies);
+
+    return true;
+  }
+
+  size_t LodTerrain::drainMeshes(std::vector<BuiltLodMesh>& out, size_t maxMeshes)
+  {
+    const size_t first = out.size();
+    builtChunks.clear();
+    builder.drainMeshes(builtChunks, maxMeshes);
+    for (BuiltChunkMesh& built : builtChunks)
+      out.push_back({ lodKey(built.coord), built.closedFaces, built.version, std::move(built.mesh) });
+
+    const size_t lodCount = finished.drain(out, maxMeshes - builtChunks.size());
+    pending.fetch_sub(lodCount, std::memory_order_relaxed);
+
+    // meshes for nodes that were edited or whose seams moved while they were
+    // built, or for nodes already dropped, are stale. The newest request is
+    // still coming
+    size_t kept = first;
+    for (size_t i = first; i < out.size(); i++)
+    {
+      auto it = requested.find(out[i].key);
+      if (it == requested.end() || it->second.version != out[i].version)
+        continue;
+      ready.insert(out[i].key);
+      if (kept != i)
+        out[kept] = std::move(out[i]);
+      kept++;
+    }
+    out.resize(kept);
+    return kept - first;
+  }
+
+  void LodTerrain::remesh(ChunkCoord coord)
+  {
+    // the chunk itself, then every merged chunk it went into and the nodes
+    // meshed against those. The mesh on screen stays until the new one lands
+    requested.erase(lodKey(coord));
+    LodKey key = lodKey(coord);
+    for (int level = 1; level < LOD_LEVELS; level++)
+    {
+      key = key.parent();
+      lodChunks.erase(key);
+      requested.erase(key);
+      for (int face = 0; face < FACE_COUNT; face++)
+        requested.erase(lodNeighbour(key, face));
+    }
+  }
+
+  void LodTerrain::drawNodes(std::vector<LodKey>& out)
+  {
+    out.clear();
+    drawn.clear();
+    for (const LodKey& key : current.nodes)
+    {
+      if (ready.count(key))
+      {
+        drawn.insert(key);
+        out.push_back(key);
+        continue;
+      }
+
+      // a coarser mesh covers the whole gap at once
+      bool covered = false;
+      for (LodKey ancestor = key; !covered && ancestor.level < LOD_LEVELS - 1;)
+      {
+        ancestor = ancestor.parent();
+        if (ready.count(ancestor))
+        {
+          covered = true;
+          if (drawn.insert(ancestor).second)
+            out.push_back(ancestor);
+        }
+      }
+      if (!covered)
+        addStandIns(key, out);
+    }
+  }
+
+  void LodTerrain::addStandIns(const LodKey& key, std::vector<LodKey>& out)
+  {
+    if (key.level == 0)
+      return;
+    for (int octant = 0; octant < 8; octant++)
+    {
+      const LodKey child = key.child(octant);
+      if (!insideWorld(child))
+        continue;
+      if (!ready.count(child))
+        addStandIns(child, out);
+      else if (drawn.insert(child).second)
+        out.push_back(child);
+    }
+  }
+
+  void LodTerrain::collectUnused(std::vector<LodKey>& out)
+  {
+    for (auto it = ready.begin(); it != ready.end();)
+    {
+      if (current.contains(*it) || drawn.count(*it))
+      {
+        ++it;
+        continue;
+      }
+      out.push_back(*it);
+      requested.erase(*it);
+      it = ready.erase(it);
+    }
+  }
+
+  LodStats LodTerrain::stats() const
+  {
+    LodStats stats;
+    for (const LodKey& key : current.nodes)
+      stats.selected[key.level]++;
+    stats.meshes = uint32_t(ready.size());
+    stats.drawn = uint32_t(drawn.size());
+    stats.pendingMeshes = pending.load(std::memory_order_relaxed) + builder.inFlight();
+    stats.lodChunks = lodChunks.size();
+    for (const auto& [key, lodChunk] : lodChunks)
+      if (lodChunk.job->isFinished())
+        stats.lodChunkBytes += lodChunk.chunk->memoryUsage() + (lodChunk.light ? lodChunk.light->memoryUsage() : 0);
+    return stats;
+  }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "core/bounded_queue.h"
+#include "core/job_system.h"
+#include "mesh/chunk_mesher.h"
+#include "world/chunk_builder.h"
+#include "world/lod.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace zm
+{
+  struct BuiltLodMesh
+  {
+    LodKey key;
+    // faces meshed against air, part of the mesh's identity: a node whose
+    // seams move gets meshed again
+    uint8_t closedFaces = 0;
+    uint32_t version = 0;
+    ChunkMesh mesh;
+  };
+
+  struct LodStats
+  {
+    uint32_t selected[LOD_LEVELS] = {};  // nodes per level around the camera
+    uint32_t meshes = 0;                 // nodes with a finished mesh
+    uint32_t drawn = 0;                  // nodes handed out by drawNodes
+    size_t pendingMeshes = 0;
+    size_t lodChunks = 0;                // downsampled chunks kept for levels > 0
+    size_t lodChunkBytes = 0;
+  };
+
+  // Distance based level of detail on top of ChunkBuilder. Each update picks
+  // the nodes around the camera (selectLodNodes), full detail nodes are meshed
+  // by the ChunkBuilder as before, coarser ones from downsampled chunks.
+  //
+  // Downsampling is a job per node that depends on its 8 children, down to
+  // the ChunkBuilder's generate jobs, so a level 3 node waits on 512 chunks.
+  // When the builder has a LightStorage those are light jobs instead, and the
+  // light is downsampled along with the blocks so coarse caves stay dark.
+  // Downsampled chunks are kept, neighbouring nodes and later remeshes read
+  // them, until an edit below them throws them away.
+  //
+  // Seams: a node meshes against same-level neighbours only. Faces bordering
+  // another level are meshed against air on both sides, so each side closes
+  // its own surface and the seam has walls instead of cracks.
+  //
+  // Like ChunkBuilder, only the render thread calls into this
+  class LodTerrain
+  {
+  public:
+    LodTerrain(JobSystem& jobs, ChunkStorage& world, ChunkBuilder& builder, const LodSettings& settings = {}, size_t maxInFlight = 64);
+    ~LodTerrain();
+
+    LodTerrain(const LodTerrain&) = delete;
+    LodTerrain& operator=(const LodTerrain&) = delete;
+
+    // Reselects nodes around cameraPos and queues meshes for new ones and for
+    // those whose seams moved, nearest first. Requests that would create more
+    // than chunkAllowance world chunks between them wait, see ChunkStreamer
+    void update(glm::vec3 cameraPos, size_t chunkAllowance = SIZE_MAX);
+
+    // Take up to maxMeshes finished meshes of any level, full detail ones
+    // included. Everything drained counts as uploaded
+    size_t drainMeshes(std::vector<BuiltLodMesh>& out, size_t maxMeshes);
+
+    // Blocks of coord changed: the next update remeshes it and rebuilds the
+    // merged chunks above it. Meshes in flight for it are dropped when they land
+    void remesh(ChunkCoord coord);
+
+    // Nodes to draw: the selection where meshes are ready, with the nearest
+    // ready coarser or finer meshes standing in for the rest until they are
+    void drawNodes(std::vector<LodKey>& out);
+    bool isDrawn(const LodKey& key) const { return drawn.count(key) != 0; }
+
+    // Meshes that are neither selected nor standing in for a selected node,
+    // to be removed from the renderer. Forgotten here once returned
+    void collectUnused(std::vector<LodKey>& out);
+
+    const LodSelection& selection() const { return current; }
+    const LodSettings& getSettings() const { return settings; }
+    LodStats stats() const;
+
+  private:
+    // shared with the jobs reading it, an edit may drop it from the map first
+    struct LodChunk
+    {
+      std::shared_ptr<Chunk> chunk;
+      std::shared_ptr<ChunkLight> light; // without a LightStorage nullptr
+      JobHandle job;
+    };
+
+    // blocks and light of a node, as the jobs reading them hold on to them
+    struct LodData
+    {
+      std::shared_ptr<const Chunk> chunk;
+      std::shared_ptr<const ChunkLight> light;
+    };
+
+    struct Request
+    {
+      uint8_t closedFaces;
+      uint32_t version;
+    };
+
+    uint8_t closedFaces(const LodKey& key) const;
+    bool requestLodMesh(const LodKey& key, uint8_t closed, uint32_t version, float priority);
+    // Merged chunk and light for a node, nullptr when it lies outside the
+    // world. Level 0 gives the world's without taking ownership
+    LodData requestLodChunk(const LodKey& key, float priority, std::vector<JobHandle>& dependencies);
+    bool insideWorld(const LodKey& key) const;
+    // World chunks a mesh request for key would create, counting stops past
+    // limit. Full detail meshes are lit, which needs the columns above too
+    size_t missingChunks(const LodKey& key, uint8_t closed, size_t limit) const;
+    size_t missingBelow(const LodKey& key, size_t limit) const;
+    // lighting a node's chunks creates the columns above it too
+    size_t missingAbove(const LodKey& key) const;
+    size_t missingColumn(ChunkCoord coord) const;
+    // ready descendants of key, for when no coarser mesh is ready either
+    void addStandIns(const LodKey& key, std::vector<LodKey>& out);
+
+    JobSystem& jobs;
+    ChunkStorage& world;
+    ChunkBuilder& builder;
+    LodSettings settings;
+
+    LodSelection current;
+    std::unordered_map<LodKey, LodChunk, LodKeyHash> lodChunks;
+    // newest mesh requested per node, and the nodes with a mesh drained
+    std::unordered_map<LodKey, Request, LodKeyHash> requested;
+    std::unordered_set<LodKey, LodKeyHash> ready;
+    uint32_t nextVersion = 1;
+    std::unordered_set<LodKey, LodKeyHash> drawn;
+
+    std::vector<BuiltChunkMesh> builtChunks;
+    BoundedQueue<BuiltLodMesh> finished;
+    std::atomic<size_t> pending{ 0 };
+  };
+}
@@ -0,0 +1,149 @@
+#include "world/noise.h"
+
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace zm
+{
+  namespace detail
+  {
+    // defined in noise_sse41.cpp / noise_avx2.cpp, which are built with the
+    // matching compiler flags. Only called after detectSimdLevel() said so
+    void noiseLine2DSse41(const NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out);
+    void noiseLine3DSse41(const NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out);
+    void noiseLine2DAvx2(const NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out);
+    void noiseLine3DAvx2(const NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out);
+  }
+
+  namespace
+  {
+    struct ScalarOps
+    {
+      static constexpr int width = 1;
+      using F = float;
+      using I = uint32_t;
+
+      static F splat(float v) { return v; }
+      static I splati(uint32_t v) { return v; }
+      static F ramp(int start) { return float(start); }
+      static F add(F a, F b) { return a + b; }
+      static F sub(F a, F b) { return a - b; }
+      static F mul(F a, F b) { return a * b; }
+      static F floor(F a) { return std::floor(a); }
+      static I toInt(F a) { return uint32_t(int32_t(a)); }
+      static F toFloat(I a) { return float(int32_t(a)); }
+      static I addi(I a, I b) { return a + b; }
+      static I muli(I a, I b) { return a * b; }
+      static I xori(I a, I b) { return a ^ b; }
+      static I andi(I a, I b) { return a & b; }
+      template <int N> static I shri(I a) { return a >> N; }
+      static void store(float* out, F a) { *out = a; }
+    };
+
+#include "world/noise_kernels.inl"
+
+    bool cpuHasSse41()
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+      int info[4];
+      __cpuid(info, 1);
+      return (info[2] & (1 << 19)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+      return __builtin_cpu_supports("sse4.1");
+#else
+      return false;
+#endif
+    }
+
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+      int info[4];
+      __cpuid(info, 1);
+      const bool osxsave = (info[2] & (1 << 27)) != 0;
+      const bool avx = (info[2] & (1 << 28)) != 0;
+      if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return false;
+      __cpuidex(info, 7, 0);
+      return (info[1] & (1 << 5)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+    }
+  }
+
+  SimdLevel detectSimdLevel()
+  {
+    static const SimdLevel level = cpuHasAvx2() ? SimdLevel::AVX2 : cpuHasSse41() ? SimdLevel::SSE41 : SimdLevel::Scalar;
+    return level;
+  }
+
+  const char* simdLevelName(SimdLevel level)
+  {
+    switch (level)
+    {
+      case SimdLevel::SSE41: return "sse4.1";
+      case SimdLevel::AVX2: return "avx2";
+      default: return "scalar";
+    }
+  }
+
+  NoiseOctaves::NoiseOctaves(uint32_t seed, int octaves, float frequency, float lacunarity, float gain)
+  {
+    count = octaves < MAX_OCTAVES ? octaves : MAX_OCTAVES;
+
+    float amp = 1.0f;
+    float total = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+      this->seed[i] = seed + uint32_t(i) * 0x9E3779B9u;
+      this->frequency[i] = frequency;
+      amplitude[i] = amp;
+      total += amp;
+      frequency *= lacunarity;
+      amp *= gain;
+    }
+    normalise = total > 0.0f ? 1.0f / total : 1.0f;
+  }
+
+  void noiseLine2D(SimdLevel level, const NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out)
+  {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    if (level == SimdLevel::AVX2)
+      return detail::noiseLine2DAvx2(octaves, x, z, stepX, stepZ, count, out);
+    if (level == SimdLevel::SSE41)
+      return detail::noiseLine2DSse41(octaves, x, z, stepX, stepZ, count, out);
+#endif
+    noiseLine2DKernel<ScalarOps>(octaves, x, z, stepX, stepZ, count, out);
+  }
+
+  void noiseLine3D(SimdLevel level, const NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out)
+  {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    if (level == SimdLevel::AVX2)
+      return detail::noiseLine3DAvx2(octaves, x, y, z, stepX, stepY, stepZ, count, out);
+    if (level == SimdLevel::SSE41)
+      return detail::noiseLine3DSse41(octaves, x, y, z, stepX, stepY, stepZ, count, out);
+#endif
+    noiseLine3DKernel<ScalarOps>(octaves, x, y, z, stepX, stepY, stepZ, count, out);
+  }
+
+  float noise2D(const NoiseOctaves& octaves, float x, float z)
+  {
+    float out;
+    noiseLine2DKernel<ScalarOps>(octaves, x, z, 0.0f, 0.0f, 1, &out);
+    return out;
+  }
+
+  float noise3D(const NoiseOctaves& octaves, float x, float y, float z)
+  {
+    float out;
+    noiseLine3DKernel<ScalarOps>(octaves, x, y, z, 0.0f, 0.0f, 0.0f, 1, &out);
+    return out;
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+namespace zm
+{
+  // Instruction sets the noise kernels are built for. Every level gives
+  // bit-identical results, they only differ in how many lanes run at once
+  enum class SimdLevel : uint8_t
+  {
+    Scalar,
+    SSE41, // 4 lanes
+    AVX2,  // 8 lanes
+  };
+
+  // Best level this CPU and build support
+  SimdLevel detectSimdLevel();
+  const char* simdLevelName(SimdLevel level);
+
+  // Integer lattice hashes, the basis of all the noise functions
+  inline uint32_t hashCoords(uint32_t seed, int32_t x, int32_t y)
+  {
+    uint32_t h = seed ^ (uint32_t(x) * 0x27d4eb2du) ^ (uint32_t(y) * 0x165667b1u);
+    h ^= h >> 15;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
+  inline uint32_t hashCoords(uint32_t seed, int32_t x, int32_t y, int32_t z)
+  {
+    uint32_t h = seed ^ (uint32_t(x) * 0x27d4eb2du) ^ (uint32_t(y) * 0x165667b1u) ^ (uint32_t(z) * 0x9e3779b1u);
+    h ^= h >> 15;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
+  // Octave table for fractal value noise, worked out once so every kernel
+  // uses the exact same per-octave constants
+  struct NoiseOctaves
+  {
+    static constexpr int MAX_OCTAVES = 8;
+
+    int count = 0;
+    uint32_t seed[MAX_OCTAVES] = {};
+    float frequency[MAX_OCTAVES] = {};
+    float amplitude[MAX_OCTAVES] = {};
+    float normalise = 1.0f; // 1 / sum of amplitudes, keeps output in [-1, 1]
+
+    NoiseOctaves() = default;
+    NoiseOctaves(uint32_t seed, int octaves, float frequency, float lacunarity = 2.0f, float gain = 0.5f);
+  };
+
+  // Fractal value noise at count evenly spaced points, sample i is taken at
+  // start + i * step. Lines are how the terrain generator asks for noise, a
+  // row of a heightmap or a column of a chunk per call
+  void noiseLine2D(SimdLevel level, const NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out);
+  void noiseLine3D(SimdLevel level, const NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out);
+
+  // Single samples, scalar
+  float noise2D(const NoiseOctaves& octaves, float x, float z);
+  float noise3D(const NoiseOctaves& octaves, float x, float y, float z);
+}
@@ -0,0 +1,53 @@
+// Built with AVX2 enabled (-mavx2 / /arch:AVX2), see premake5.lua. No FMA on
+// purpose, fused multiply-adds would round differently from the other builds
+#include "world/noise.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+namespace zm
+{
+  namespace
+  {
+    struct Avx2Ops
+    {
+      static constexpr int width = 8;
+      using F = __m256;
+      using I = __m256i;
+
+      static F splat(float v) { return _mm256_set1_ps(v); }
+      static I splati(uint32_t v) { return _mm256_set1_epi32(int(v)); }
+      static F ramp(int start) { return _mm256_add_ps(_mm256_set1_ps(float(start)), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f)); }
+      static F add(F a, F b) { return _mm256_add_ps(a, b); }
+      static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+      static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+      static F floor(F a) { return _mm256_floor_ps(a); }
+      static I toInt(F a) { return _mm256_cvttps_epi32(a); }
+      static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+      static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+      static I muli(I a, I b) { return _mm256_mullo_epi32(a, b); }
+      static I xori(I a, I b) { return _mm256_xor_si256(a, b); }
+      static I andi(I a, I b) { return _mm256_and_si256(a, b); }
+      template <int N> static I shri(I a) { return _mm256_srli_epi32(a, N); }
+      static void store(float* out, F a) { _mm256_storeu_ps(out, a); }
+    };
+
+#include "world/noise_kernels.inl"
+  }
+
+  namespace detail
+  {
+    void noiseLine2DAvx2(const NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out)
+    {
+      noiseLine2DKernel<Avx2Ops>(octaves, x, z, stepX, stepZ, count, out);
+    }
+
+    void noiseLine3DAvx2(const NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out)
+    {
+      noiseLine3DKernel<Avx2Ops>(octaves, x, y, z, stepX, stepY, stepZ, count, out);
+    }
+  }
+}
+
+#endif
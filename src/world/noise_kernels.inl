@@ -0,0 +1,183 @@
+// Noise kernels written once against a small "ops" interface and compiled
+// once per instruction set (noise.cpp, noise_sse41.cpp, noise_avx2.cpp).
+// Include inside an anonymous namespace so each copy stays local to its
+// translation unit and the linker can't mix builds for different CPUs.
+//
+// Ops provides:
+//   width, F (float lanes), I (uint32 lanes)
+//   splat, splati, ramp(start) -> start, start + 1, ...
+//   add, sub, mul, floor, toInt (truncating), toFloat
+//   addi, muli, xori, andi, shri<N>, store
+//
+// Every operation is done in the same order in every build and there is no
+// FMA, so all instruction sets give bit-identical results
+
+template <typename V>
+inline typename V::F fade(typename V::F t)
+{
+  // t * t * (3 - 2t)
+  return V::mul(V::mul(t, t), V::sub(V::splat(3.0f), V::mul(V::splat(2.0f), t)));
+}
+
+template <typename V>
+inline typename V::F lerp(typename V::F a, typename V::F b, typename V::F t)
+{
+  return V::add(a, V::mul(V::sub(b, a), t));
+}
+
+template <typename V>
+inline typename V::I mix(typename V::I h)
+{
+  h = V::xori(h, V::template shri<15>(h));
+  h = V::muli(h, V::splati(0x85ebca6bu));
+  h = V::xori(h, V::template shri<13>(h));
+  h = V::muli(h, V::splati(0xc2b2ae35u));
+  h = V::xori(h, V::template shri<16>(h));
+  return h;
+}
+
+// matches hashCoords() in noise.h
+template <typename V>
+inline typename V::I hash2(typename V::I seed, typename V::I x, typename V::I y)
+{
+  typename V::I h = V::xori(seed, V::muli(x, V::splati(0x27d4eb2du)));
+  h = V::xori(h, V::muli(y, V::splati(0x165667b1u)));
+  return mix<V>(h);
+}
+
+template <typename V>
+inline typename V::I hash3(typename V::I seed, typename V::I x, typename V::I y, typename V::I z)
+{
+  typename V::I h = V::xori(seed, V::muli(x, V::splati(0x27d4eb2du)));
+  h = V::xori(h, V::muli(y, V::splati(0x165667b1u)));
+  h = V::xori(h, V::muli(z, V::splati(0x9e3779b1u)));
+  return mix<V>(h);
+}
+
+// hash -> [-1, 1]
+template <typename V>
+inline typename V::F lattice(typename V::I h)
+{
+  const typename V::F unit = V::toFloat(V::andi(h, V::splati(0xffffffu)));
+  return V::sub(V::mul(unit, V::splat(2.0f / 16777215.0f)), V::splat(1.0f));
+}
+
+template <typename V>
+inline typename V::F valueNoise2D(typename V::I seed, typename V::F x, typename V::F y)
+{
+  using I = typename V::I;
+  using F = typename V::F;
+
+  const F fx = V::floor(x);
+  const F fy = V::floor(y);
+  const I ix = V::toInt(fx);
+  const I iy = V::toInt(fy);
+  const I ix1 = V::addi(ix, V::splati(1));
+  const I iy1 = V::addi(iy, V::splati(1));
+  const F tx = fade<V>(V::sub(x, fx));
+  const F ty = fade<V>(V::sub(y, fy));
+
+  const F a = lattice<V>(hash2<V>(seed, ix, iy));
+  const F b = lattice<V>(hash2<V>(seed, ix1, iy));
+  const F c = lattice<V>(hash2<V>(seed, ix, iy1));
+  const F d = lattice<V>(hash2<V>(seed, ix1, iy1));
+
+  return lerp<V>(lerp<V>(a, b, tx), lerp<V>(c, d, tx), ty);
+}
+
+template <typename V>
+inline typename V::F valueNoise3D(typename V::I seed, typename V::F x, typename V::F y, typename V::F z)
+{
+  using I = typename V::I;
+  using F = typename V::F;
+
+  const F fx = V::floor(x);
+  const F fy = V::floor(y);
+  const F fz = V::floor(z);
+  const I ix = V::toInt(fx);
+  const I iy = V::toInt(fy);
+  const I iz = V::toInt(fz);
+  const I ix1 = V::addi(ix, V::splati(1));
+  const I iy1 = V::addi(iy, V::splati(1));
+  const I iz1 = V::addi(iz, V::splati(1));
+  const F tx = fade<V>(V::sub(x, fx));
+  const F ty = fade<V>(V::sub(y, fy));
+  const F tz = fade<V>(V::sub(z, fz));
+
+  const F c000 = lattice<V>(hash3<V>(seed, ix, iy, iz));
+  const F c100 = lattice<V>(hash3<V>(seed, ix1, iy, iz));
+  const F c010 = lattice<V>(hash3<V>(seed, ix, iy1, iz));
+  const F c110 = lattice<V>(hash3<V>(seed, ix1, iy1, iz));
+  const F c001 = lattice<V>(hash3<V>(seed, ix, iy, iz1));
+  const F c101 = lattice<V>(hash3<V>(seed, ix1, iy, iz1));
+  const F c011 = lattice<V>(hash3<V>(seed, ix, iy1, iz1));
+  const F c111 = lattice<V>(hash3<V>(seed, ix1, iy1, iz1));
+
+  const F y0 = lerp<V>(lerp<V>(c000, c100, tx), lerp<V>(c010, c110, tx), ty);
+  const F y1 = lerp<V>(lerp<V>(c001, c101, tx), lerp<V>(c011, c111, tx), ty);
+  return lerp<V>(y0, y1, tz);
+}
+
+template <typename V>
+inline void storeLanes(float* out, typename V::F value, int lanes)
+{
+  if (lanes == V::width)
+  {
+    V::store(out, value);
+    return;
+  }
+
+  float tail[V::width];
+  V::store(tail, value);
+  for (int i = 0; i < lanes; i++)
+    out[i] = tail[i];
+}
+
+template <typename V>
+void noiseLine2DKernel(const zm::NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out)
+{
+  using F = typename V::F;
+
+  for (int i = 0; i < count; i += V::width)
+  {
+    const F index = V::ramp(i);
+    const F px = V::add(V::splat(x), V::mul(index, V::splat(stepX)));
+    const F pz = V::add(V::splat(z), V::mul(index, V::splat(stepZ)));
+
+    F sum = V::splat(0.0f);
+    for (int o = 0; o < octaves.count; o++)
+    {
+      const F frequency = V::splat(octaves.frequency[o]);
+      const F n = valueNoise2D<V>(V::splati(octaves.seed[o]), V::mul(px, frequency), V::mul(pz, frequency));
+      sum = V::add(sum, V::mul(n, V::splat(octaves.amplitude[o])));
+    }
+
+    const int lanes = count - i < V::width ? count - i : V::width;
+    storeLanes<V>(out + i, V::mul(sum, V::splat(octaves.normalise)), lanes);
+  }
+}
+
+template <typename V>
+void noiseLine3DKernel(const zm::NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out)
+{
+  using F = typename V::F;
+
+  for (int i = 0; i < count; i += V::width)
+  {
+    const F index = V::ramp(i);
+    const F px = V::add(V::splat(x), V::mul(index, V::splat(stepX)));
+    const F py = V::add(V::splat(y), V::mul(index, V::splat(stepY)));
+    const F pz = V::add(V::splat(z), V::mul(index, V::splat(stepZ)));
+
+    F sum = V::splat(0.0f);
+    for (int o = 0; o < octaves.count; o++)
+    {
+      const F frequency = V::splat(octaves.frequency[o]);
+      const F n = valueNoise3D<V>(V::splati(octaves.seed[o]), V::mul(px, frequency), V::mul(py, frequency), V::mul(pz, frequency));
+      sum = V::add(sum, V::mul(n, V::splat(octaves.amplitude[o])));
+    }
+
+    const int lanes = count - i < V::width ? count - i : V::width;
+    storeLanes<V>(out + i, V::mul(sum, V::splat(octaves.normalise)), lanes);
+  }
+}
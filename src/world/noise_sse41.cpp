@@ -0,0 +1,52 @@
+// Built with SSE4.1 enabled (-msse4.1), see premake5.lua
+#include "world/noise.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#include <smmintrin.h>
+
+namespace zm
+{
+  namespace
+  {
+    struct Sse41Ops
+    {
+      static constexpr int width = 4;
+      using F = __m128;
+      using I = __m128i;
+
+      static F splat(float v) { return _mm_set1_ps(v); }
+      static I splati(uint32_t v) { return _mm_set1_epi32(int(v)); }
+      static F ramp(int start) { return _mm_add_ps(_mm_set1_ps(float(start)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)); }
+      static F add(F a, F b) { return _mm_add_ps(a, b); }
+      static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+      static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+      static F floor(F a) { return _mm_floor_ps(a); }
+      static I toInt(F a) { return _mm_cvttps_epi32(a); }
+      static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+      static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+      static I muli(I a, I b) { return _mm_mullo_epi32(a, b); }
+      static I xori(I a, I b) { return _mm_xor_si128(a, b); }
+      static I andi(I a, I b) { return _mm_and_si128(a, b); }
+      template <int N> static I shri(I a) { return _mm_srli_epi32(a, N); }
+      static void store(float* out, F a) { _mm_storeu_ps(out, a); }
+    };
+
+#include "world/noise_kernels.inl"
+  }
+
+  namespace detail
+  {
+    void noiseLine2DSse41(const NoiseOctaves& octaves, float x, float z, float stepX, float stepZ, int count, float* out)
+    {
+      noiseLine2DKernel<Sse41Ops>(octaves, x, z, stepX, stepZ, count, out);
+    }
+
+    void noiseLine3DSse41(const NoiseOctaves& octaves, float x, float y, float z, float stepX, float stepY, float stepZ, int count, float* out)
+    {
+      noiseLine3DKernel<Sse41Ops>(octaves, x, y, z, stepX, stepY, stepZ, count, out);
+    }
+  }
+}
+
+#endif
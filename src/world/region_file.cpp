@@ -0,0 +1,222 @@
+#include "world/region_file.h"
+
+#include "core/lz4.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr uint32_t regionMagic = 0x47524D5A; // "ZMRG"
+    constexpr uint32_t regionVersion = 1;
+    // largest thing Chunk::serialize() can produce, direct mode
+    constexpr uint32_t maxRawSize = 4 + CHUNK_VOLUME * sizeof(BlockId);
+  }
+
+  bool RegionFile::open(const std::filesystem::path& filePath)
+  {
+    std::unique_lock lock(mutex);
+    path = filePath;
+    std::fill(std::begin(table), std::end(table), Entry{});
+    usedSectors.assign(headerSectors(), true);
+
+    std::error_code error;
+    if (!std::filesystem::exists(path, error))
+      return true;
+
+    if (!mapped.open(path.string()) || mapped.size() < headerSize())
+    {
+      std::fprintf(stderr, "Region file %s is unreadable\n", path.string().c_str());
+      mapped.close();
+      return false;
+    }
+
+    uint32_t header[2];
+    std::memcpy(header, mapped.data(), sizeof(header));
+    if (header[0] != regionMagic || header[1] != regionVersion)
+    {
+      std::fprintf(stderr, "Region file %s has a bad header\n", path.string().c_str());
+      mapped.close();
+      return false;
+    }
+    std::memcpy(table, mapped.data() + 8, sizeof(table));
+
+    // rebuild the free map, anything out of bounds or overlapping means the
+    // table can't be trusted
+    const uint32_t fileSectors = sectorsFor(mapped.size());
+    for (const Entry& entry : table)
+    {
+      if (entry.sector == 0)
+        continue;
+      const uint32_t count = sectorsFor(entry.size);
+      bool valid = entry.sector >= headerSectors() && entry.size > 4 && uint64_t(entry.sector) + count <= fileSectors;
+      for (uint32_t s = entry.sector; valid && s < entry.sector + count && s < usedSectors.size(); s++)
+        valid = !usedSectors[s];
+      if (!valid)
+      {
+        std::fprintf(stderr, "Region file %s has a corrupt offset table\n", path.string().c_str());
+        std::fill(std::begin(table), std::end(table), Entry{});
+        usedSectors.assign(headerSectors(), true);
+        mapped.close();
+        return false;
+      }
+      markSectors(entry.sector, count, true);
+    }
+    return true;
+  }
+
+  bool RegionFile::readChunk(int slot, Chunk& out) const
+  {
+    thread_local std::vector<uint8_t> raw;
+
+    std::shared_lock lock(mutex);
+    const Entry& entry = table[slot];
+    if (entry.sector == 0 || !mapped.isOpen() || size_t(entry.sector) * SECTOR_SIZE + entry.size > mapped.size())
+      return false;
+
+    // straight from the mapping, no read() copy in between
+    const uint8_t* payload = mapped.data() + size_t(entry.sector) * SECTOR_SIZE;
+    uint32_t rawSize;
+    std::memcpy(&rawSize, payload, sizeof(rawSize));
+    if (rawSize > maxRawSize)
+      return false;
+    raw.resize(rawSize);
+    if (!lz4Decompress(payload + 4, entry.size - 4, raw.data(), raw.size()))
+      return false;
+    return out.deserialize(raw.data(), raw.size());
+  }
+
+  void RegionFile::compressChunk(const Chunk& chunk, std::vector<uint8_t>& payload)
+  {
+    thread_local std::vector<uint8_t> raw;
+    raw.clear();
+    chunk.serialize(raw);
+
+    const uint32_t rawSize = uint32_t(raw.size());
+    payload.resize(4 + lz4CompressBound(raw.size()));
+    std::memcpy(payload.data(), &rawSize, sizeof(rawSize));
+    payload.resize(4 + lz4Compress(raw.data(), raw.size(), payload.data() + 4, payload.size() - 4));
+  }
+
+  uint32_t RegionFile::allocateSectors(uint32_t count)
+  {
+    // first fit, appending past the end when nothing is free
+    uint32_t run = 0;
+    for (uint32_t s = headerSectors(); s < usedSectors.size(); s++)
+    {
+      run = usedSectors[s] ? 0 : run + 1;
+      if (run == count)
+        return s + 1 - count;
+    }
+    const uint32_t first = uint32_t(usedSectors.size()) - run;
+    return first;
+  }
+
+  void RegionFile::markSectors(uint32_t first, uint32_t count, bool used)
+  {
+    if (usedSectors.size() < first + count)
+      usedSectors.resize(first + count, false);
+    for (uint32_t s = first; s < first + count; s++)
+      usedSectors[s] = used;
+  }
+
+  bool RegionFile::writeChunks(const std::vector<Write>& writes)
+  {
+    std::unique_lock lock(mutex);
+
+    // new sectors for every payload first, the old ones stay reserved until
+    // the table that stops pointing at them is on disk
+    Entry newTable[REGION_CHUNKS];
+    std::memcpy(newTable, table, sizeof(table));
+    std::vector<Entry> released;
+    for (const Write& write : writes)
+    {
+      const uint32_t count = sectorsFor(write.payload.size());
+      const uint32_t sector = allocateSectors(count);
+      markSectors(sector, count, true);
+      if (newTable[write.slot].sector)
+        released.push_back(newTable[write.slot]);
+      newTable[write.slot] = { sector, uint32_t(write.payload.size()) };
+    }
+
+    // the mapping has to go before the file changes size (Windows refuses
+    // otherwise), readers are locked out until it is back
+    mapped.close();
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (!std::filesystem::exists(path, error))
+      std::ofstream(path, std::ios::binary);
+
+    bool ok;
+    {
+      std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+      ok = file.is_open();
+      for (size_t i = 0; ok && i < writes.size(); i++)
+      {
+        const Entry& entry = newTable[writes[i].slot];
+        file.seekp(std::streamoff(entry.sector) * std::streamoff(SECTOR_SIZE));
+        file.write(reinterpret_cast<const char*>(writes[i].payload.data()), std::streamsize(writes[i].payload.size()));
+        ok = bool(file);
+      }
+      if (ok)
+        ok = bool(file.flush());
+
+      // payloads are down, now switch the table over to them
+      if (ok)
+      {
+        const uint32_t header[2] = { regionMagic, regionVersion };
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(newTable), sizeof(newTable));
+        ok = bool(file.flush());
+      }
+    }
+
+    if (ok)
+    {
+      std::memcpy(table, newTable, sizeof(table));
+      for (const Entry& entry : released)
+        markSectors(entry.sector, sectorsFor(entry.size), false);
+    }
+    else
+    {
+      std::fprintf(stderr, "Failed to write region file %s\n", path.string().c_str());
+      // the on-disk table still points at the old payloads, drop the new ones
+      for (const Write& write : writes)
+        if (newTable[write.slot].sector != table[write.slot].sector)
+          markSectors(newTable[write.slot].sector, sectorsFor(newTable[write.slot].size), false);
+    }
+
+    mapped.open(path.string());
+    return ok;
+  }
+
+  bool RegionFile::contains(int slot) const
+  {
+    std::shared_lock lock(mutex);
+    return table[slot].sector != 0;
+  }
+
+  size_t RegionFile::chunkCount() const
+  {
+    std::shared_lock lock(mutex);
+    size_t count = 0;
+    for (const Entry& entry : table)
+      count += entry.sector != 0;
+    return count;
+  }
+
+  size_t RegionFile::fileSize() const
+  {
+    std::shared_lock lock(mutex);
+    return mapped.size();
+  }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "core/mapped_file.h"
+#include "world/chunk.h"
+#include "world/chunk_storage.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <shared_mutex>
+#include <vector>
+
+namespace zm
+{
+  constexpr int REGION_SHIFT = 5;
+  constexpr int REGION_SIZE = 1 << REGION_SHIFT; // 32 chunks along x and z
+  constexpr int REGION_MASK = REGION_SIZE - 1;
+  constexpr int REGION_CHUNKS = REGION_SIZE * REGION_SIZE;
+
+  // Regions are 32x32 chunks on x/z and one chunk tall, so a file never has
+  // more than 1024 entries however deep the world goes
+  struct RegionCoord
+  {
+    int32_t x, y, z;
+
+    bool operator==(const RegionCoord&) const = default;
+  };
+
+  struct RegionCoordHash
+  {
+    size_t operator()(const RegionCoord& c) const
+    {
+      return std::hash<int64_t>()((int64_t(c.x) * 73856093) ^ (int64_t(c.y) * 19349663) ^ (int64_t(c.z) * 83492791));
+    }
+  };
+
+  inline RegionCoord regionOf(ChunkCoord c)
+  {
+    return { c.x >> REGION_SHIFT, c.y, c.z >> REGION_SHIFT };
+  }
+
+  inline int regionSlot(ChunkCoord c)
+  {
+    return (c.x & REGION_MASK) | ((c.z & REGION_MASK) << REGION_SHIFT);
+  }
+
+  // One region on disk:
+  //   header     magic, version, then REGION_CHUNKS {sector, byte size} entries
+  //   payloads   per chunk: uncompressed size + LZ4 block of Chunk::serialize()
+  // Space is handed out in 256 byte sectors. Rewritten chunks always go to
+  // free sectors and the old ones are released after the new table is on
+  // disk, so a crash mid-write leaves the previous version readable.
+  //
+  // Reads decompress straight out of a read-only mapping of the file. Any
+  // number of threads may read at once, writes take the file exclusively
+  class RegionFile
+  {
+  public:
+    static constexpr size_t SECTOR_SIZE = 256;
+
+    // Loads the header if the file exists, a missing file reads as empty
+    // and is created by the first write. False if the file is corrupt
+    bool open(const std::filesystem::path& path);
+
+    // false when the chunk was never saved or fails to decode
+    bool readChunk(int slot, Chunk& out) const;
+
+    // Compressed payloads from compressChunk(), written in one go
+    struct Write
+    {
+      int slot;
+      std::vector<uint8_t> payload;
+    };
+    bool writeChunks(const std::vector<Write>& writes);
+
+    bool contains(int slot) const;
+    size_t chunkCount() const;
+    size_t fileSize() const;
+
+    // serialize + compress, safe on any thread
+    static void compressChunk(const Chunk& chunk, std::vector<uint8_t>& payload);
+
+  private:
+    struct Entry
+    {
+      uint32_t sector = 0; // 0 means not stored, sector 0 is always header
+      uint32_t size = 0;
+    };
+
+    static constexpr size_t headerSize() { return 8 + REGION_CHUNKS * sizeof(Entry); }
+    static constexpr uint32_t headerSectors() { return uint32_t((headerSize() + SECTOR_SIZE - 1) / SECTOR_SIZE); }
+    static uint32_t sectorsFor(size_t bytes) { return uint32_t((bytes + SECTOR_SIZE - 1) / SECTOR_SIZE); }
+
+    uint32_t allocateSectors(uint32_t count);
+    void markSectors(uint32_t first, uint32_t count, bool used);
+
+    std::filesystem::path path;
+    mutable std::shared_mutex mutex;
+    MappedFile mapped;
+    Entry table[REGION_CHUNKS];
+    std::vector<bool> usedSectors;
+  };
+}
@@ -0,0 +1,154 @@
+#include "world/terrain_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace zm
+{
+  namespace
+  {
+    // vertical stretch of the cave noise, > 1 gives wide flat caverns
+    constexpr float CAVE_SQUASH = 1.6f;
+    // caves stay this far below the surface so they don't punch through the grass
+    constexpr int CAVE_ROOF = 5;
+
+    float saturate(float v)
+    {
+      return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+    }
+  }
+
+  TerrainGenerator::TerrainGenerator(const TerrainSettings& settings)
+    : settings(settings),
+      heightOctaves(settings.seed, settings.octaves, settings.frequency),
+      continentOctaves(settings.seed ^ 0x1b873593u, 2, settings.biomeFrequency),
+      temperatureOctaves(settings.seed ^ 0xcc9e2d51u, 2, settings.biomeFrequency * 1.3f),
+      densityOctaves(settings.seed ^ 0xe6546b64u, 2, settings.densityFrequency),
+      caveOctaves(settings.seed ^ 0x85ebca6bu, 2, settings.caveFrequency)
+  {
+  }
+
+  TerrainGenerator::Column TerrainGenerator::makeColumn(float heightNoise, float continental, float temperature) const
+  {
+    // 0 in the lowlands, 1 in the mountains, smooth in between so biome
+    // borders don't turn into cliffs
+    const float m = saturate((continental - 0.1f) * 2.0f);
+    const float mountain = m * m * (3.0f - 2.0f * m);
+
+    Column column;
+    column.height = settings.baseHeight + int(std::floor(continental * 12.0f + heightNoise * settings.heightScale * (0.5f + 1.8f * mountain)));
+    column.overhang = settings.overhangDepth * mountain;
+
+    if (mountain > 0.6f)
+      column.biome = Biome::Mountains;
+    else if (temperature > 0.22f)
+      column.biome = Biome::Desert;
+    else if (continental > -0.15f)
+      column.biome = Biome::Hills;
+    else
+      column.biome = Biome::Plains;
+    return column;
+  }
+
+  BlockId TerrainGenerator::surfaceBlock(const Column& column, int wx, int wy, int wz) const
+  {
+    const int depth = column.height - wy;
+    const bool sandy = column.biome == Biome::Desert || column.height <= settings.seaLevel + 1;
+
+    if (depth >= 0 && depth < 4)
+    {
+      if (sandy)
+        return BLOCK_SAND;
+      if (column.biome == Biome::Mountains && column.height > settings.seaLevel + 50)
+        return BLOCK_STONE;
+      return depth == 0 ? BLOCK_GRASS : BLOCK_DIRT;
+    }
+
+    // ores get rarer and better the deeper they are
+    const uint32_t h = hashCoords(settings.seed ^ 0x0de5eed5u, wx, wy, wz);
+    if ((h & 255) == 0)
+    {
+      const uint32_t roll = (h >> 8) & 255;
+      if (wy < 16 && roll < 8)
+        return BLOCK_DIAMOND_ORE;
+      if (wy < 32 && roll < 40)
+        return BLOCK_GOLD_ORE;
+      if (roll < 120)
+        return BLOCK_IRON_ORE;
+      return BLOCK_COAL_ORE;
+    }
+    return BLOCK_STONE;
+  }
+
+  void TerrainGenerator::generate(ChunkCoord coord, Chunk& chunk) const
+  {
+    const int baseX = coord.x * CHUNK_SIZE;
+    const int baseY = coord.y * CHUNK_SIZE;
+    const int baseZ = coord.z * CHUNK_SIZE;
+    const int topY = baseY + CHUNK_SIZE - 1;
+
+    thread_local std::array<BlockId, CHUNK_VOLUME> blocks;
+    std::array<float, CHUNK_SIZE> heightRow, continentRow, temperatureRow;
+    std::array<float, CHUNK_SIZE> density, cave;
+
+    for (int z = 0; z < CHUNK_SIZE; z++)
+    {
+      const float wz = float(baseZ + z);
+      noiseLine2D(settings.simd, heightOctaves, float(baseX), wz, 1.0f, 0.0f, CHUNK_SIZE, heightRow.data());
+      noiseLine2D(settings.simd, continentOctaves, float(baseX), wz, 1.0f, 0.0f, CHUNK_SIZE, continentRow.data());
+      noiseLine2D(settings.simd, temperatureOctaves, float(baseX), wz, 1.0f, 0.0f, CHUNK_SIZE, temperatureRow.data());
+
+      for (int x = 0; x < CHUNK_SIZE; x++)
+      {
+        const int wx = baseX + x;
+        const Column column = makeColumn(heightRow[x], continentRow[x], temperatureRow[x]);
+        const int overhang = int(std::ceil(column.overhang));
+
+        // only pay for 3D noise where this chunk column can be affected by it
+        const bool useDensity = overhang > 0 && baseY <= column.height + overhang && topY >= column.height - overhang;
+        const bool useCaves = baseY < column.height - CAVE_ROOF;
+        if (useDensity)
+          noiseLine3D(settings.simd, densityOctaves, float(wx), float(baseY), wz, 0.0f, 1.0f, 0.0f, CHUNK_SIZE, density.data());
+        if (useCaves)
+          noiseLine3D(settings.simd, caveOctaves, float(wx), float(baseY) * CAVE_SQUASH, wz, 0.0f, CAVE_SQUASH, 0.0f, CHUNK_SIZE, cave.data());
+
+        for (int y = 0; y < CHUNK_SIZE; y++)
+        {
+          const int wy = baseY + y;
+          bool solid = wy <= column.height;
+
+          if (useDensity && std::abs(wy - column.height) < overhang)
+            solid = float(column.height - wy) + density[y] * column.overhang > 0.0f;
+
+          if (solid && useCaves && wy < column.height - CAVE_ROOF && wy > 1 && cave[y] > settings.caveThreshold)
+            solid = false;
+
+          BlockId id;
+          if (solid)
+            id = surfaceBlock(column, wx, wy, baseZ + z);
+          else if (wy > column.height && wy <= settings.seaLevel)
+            id = BLOCK_WATER;
+          else
+            id = BLOCK_AIR;
+
+          blocks[chunkIndex(x, y, z)] = id;
+        }
+      }
+    }
+
+    chunk.pack(blocks.data());
+  }
+
+  int TerrainGenerator::heightAt(int wx, int wz) const
+  {
+    const float x = float(wx), z = float(wz);
+    return makeColumn(noise2D(heightOctaves, x, z), noise2D(continentOctaves, x, z), noise2D(temperatureOctaves, x, z)).height;
+  }
+
+  Biome TerrainGenerator::biomeAt(int wx, int wz) const
+  {
+    const float x = float(wx), z = float(wz);
+    return makeColumn(noise2D(heightOctaves, x, z), noise2D(continentOctaves, x, z), noise2D(temperatureOctaves, x, z)).biome;
+  }
+}
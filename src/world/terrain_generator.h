@@ -0,0 +1,80 @@
+#pragma once
+
+#include "world/chunk_storage.h"
+#include "world/noise.h"
+
+#include <cstdint>
+
+namespace zm
+{
+  enum class Biome : uint8_t
+  {
+    Plains,
+    Hills,
+    Desert,
+    Mountains,
+  };
+
+  struct TerrainSettings
+  {
+    uint32_t seed = 1337;
+    int seaLevel = 64;
+    int baseHeight = 64;
+
+    // heightmap
+    float heightScale = 28.0f;
+    float frequency = 1.0f / 160.0f;
+    int octaves = 5;
+
+    // biome layer, continentalness drives mountains, temperature deserts
+    float biomeFrequency = 1.0f / 900.0f;
+
+    // 3D density carves overhangs into mountain sides within this many
+    // blocks of the heightmap surface
+    float densityFrequency = 1.0f / 36.0f;
+    float overhangDepth = 14.0f;
+
+    // caves are wherever 3D cave noise is above the threshold
+    float caveFrequency = 1.0f / 30.0f;
+    float caveThreshold = 0.42f;
+
+    SimdLevel simd = detectSimdLevel();
+  };
+
+  // Deterministic, seedable terrain. Same seed and coord always produce the
+  // same chunk on any thread and with any SIMD level, so chunks can be
+  // generated in any order. Noise is evaluated a line at a time: heightmap
+  // and biome noise per row of 32 columns, 3D density and caves per 32 block
+  // column of the chunk
+  class TerrainGenerator
+  {
+  public:
+    explicit TerrainGenerator(const TerrainSettings& settings = {});
+
+    void generate(ChunkCoord coord, Chunk& chunk) const;
+
+    int heightAt(int wx, int wz) const;
+    Biome biomeAt(int wx, int wz) const;
+
+    void setSimdLevel(SimdLevel level) { settings.simd = level; }
+    const TerrainSettings& getSettings() const { return settings; }
+
+  private:
+    struct Column
+    {
+      int height;
+      float overhang;
+      Biome biome;
+    };
+
+    Column makeColumn(float heightNoise, float continental, float temperature) const;
+    BlockId surfaceBlock(const Column& column, int wx, int wy, int wz) const;
+
+    TerrainSettings settings;
+    NoiseOctaves heightOctaves;
+    NoiseOctaves continentOctaves;
+    NoiseOctaves temperatureOctaves;
+    NoiseOctaves densityOctaves;
+    NoiseOctaves caveOctaves;
+  };
+}
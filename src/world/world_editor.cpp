@@ -0,0 +1,253 @@
+#include "world/world_editor.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+
+namespace zm
+{
+  namespace
+  {
+    constexpr int faceOffsets[FACE_COUNT][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    int lightOf(uint8_t light, bool sky) { return sky ? skyLight(light) : blockLight(light); }
+
+    uint8_t withLight(uint8_t light, bool sky, int level)
+    {
+      return sky ? packLight(level, blockLight(light)) : packLight(skyLight(light), level);
+    }
+  }
+
+  WorldEditor::WorldEditor(ChunkStorage& world, LightStorage& light, const ChunkBuilder& builder, WorldSave* save)
+    : world(world), light(light), builder(builder), save(save)
+  {
+  }
+
+  void WorldEditor::setBlock(int wx, int wy, int wz, BlockId id)
+  {
+    editStats.queued++;
+    auto [it, inserted] = editIndex.try_emplace(BlockPos{ wx, wy, wz }, edits.size());
+    if (!inserted)
+    {
+      edits[it->second].block = id;
+      editStats.coalesced++;
+      return;
+    }
+    edits.push_back({ wx, wy, wz, id });
+  }
+
+  const WorldEditor::ChunkRef& WorldEditor::chunkAt(ChunkCoord coord)
+  {
+    auto it = refs.find(coord);
+    if (it != refs.end())
+      return it->second;
+
+    // chunks still generating or waiting for light are walls to the fill
+    ChunkRef ref;
+    if (builder.isReady(coord))
+    {
+      ref.light = light.get(coord);
+      ref.chunk = ref.light ? world.getChunk(coord) : nullptr;
+    }
+    return refs.emplace(coord, ref).first->second;
+  }
+
+  bool WorldEditor::cellAt(int wx, int wy, int wz, ChunkRef& ref, int& index)
+  {
+    ref = chunkAt(worldToChunk(wx, wy, wz));
+    index = chunkIndex(wx & CHUNK_MASK, wy & CHUNK_MASK, wz & CHUNK_MASK);
+    return ref.chunk != nullptr;
+  }
+
+  void WorldEditor::markDirty(int wx, int wy, int wz)
+  {
+    auto expand = [this](int x, int y, int z) {
+      const ChunkCoord coord = worldToChunk(x, y, z);
+      if (!chunkAt(coord).chunk)
+        return;
+      const int local[3] = { x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK };
+      auto [it, inserted] = dirtyRegions.try_emplace(coord);
+      DirtyRegion& region = it->second;
+      if (inserted)
+        region.coord = coord;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        region.min[axis] = inserted ? local[axis] : std::min(region.min[axis], local[axis]);
+        region.max[axis] = inserted ? local[axis] : std::max(region.max[axis], local[axis]);
+      }
+    };
+
+    expand(wx, wy, wz);
+    // blocks on a chunk border are also looked at by the neighbour's faces
+    const ChunkCoord coord = worldToChunk(wx, wy, wz);
+    for (const auto& offset : faceOffsets)
+    {
+      const int nx = wx + offset[0], ny = wy + offset[1], nz = wz + offset[2];
+      if (!(worldToChunk(nx, ny, nz) == coord))
+        expand(nx, ny, nz);
+    }
+  }
+
+  void WorldEditor::setLight(const ChunkRef& ref, int index, int wx, int wy, int wz, bool sky, int level)
+  {
+    ref.light->set(index, withLight(ref.light->get(index), sky, level));
+    editStats.lightCells++;
+    markDirty(wx, wy, wz);
+  }
+
+  void WorldEditor::removeLight(bool sky)
+  {
+    std::vector<LightNode>& queue = removeQueue[sky];
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+      const LightNode node = queue[head];
+      for (int face = 0; face < FACE_COUNT; face++)
+      {
+        const int nx = node.x + faceOffsets[face][0], ny = node.y + faceOffsets[face][1], nz = node.z + faceOffsets[face][2];
+        ChunkRef ref;
+        int index;
+        if (!cellAt(nx, ny, nz, ref, index))
+          continue;
+        const int level = lightOf(ref.light->get(index), sky);
+        if (level == 0)
+          continue;
+
+        // dimmer cells were lit through the removed one, and so was full
+        // sunlight right below full sunlight. Anything else has its own
+        // source and lights the hole back up in the add pass
+        const bool fromAbove = sky && face == FACE_NEG_Y && node.level == MAX_LIGHT;
+        if (level >= node.level && !fromAbove)
+        {
+          addQueue[sky].push_back({ nx, ny, nz, 0 });
+          continue;
+        }
+
+        setLight(ref, index, nx, ny, nz, sky, 0);
+        const int emission = sky ? 0 : blockInfo(ref.chunk->getIndex(index)).lightEmission;
+        if (emission > 0)
+        {
+          setLight(ref, index, nx, ny, nz, sky, emission);
+          addQueue[sky].push_back({ nx, ny, nz, 0 });
+        }
+        queue.push_back({ nx, ny, nz, uint8_t(level) });
+      }
+    }
+    queue.clear();
+  }
+
+  void WorldEditor::addLight(bool sky)
+  {
+    std::vector<LightNode>& queue = addQueue[sky];
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+      const LightNode node = queue[head];
+      ChunkRef ref;
+      int index;
+      if (!cellAt(node.x, node.y, node.z, ref, index))
+        continue;
+      const int level = lightOf(ref.light->get(index), sky);
+      if (level <= 1)
+        continue;
+
+      for (int face = 0; face < FACE_COUNT; face++)
+      {
+        const int nx = node.x + faceOffsets[face][0], ny = node.y + faceOffsets[face][1], nz = node.z + faceOffsets[face][2];
+        ChunkRef next;
+        int nextIndex;
+        if (!cellAt(nx, ny, nz, next, nextIndex) || isOpaque(next.chunk->getIndex(nextIndex)))
+          continue;
+
+        const int target = sky && face == FACE_NEG_Y && level == MAX_LIGHT ? MAX_LIGHT : level - 1;
+        if (target > lightOf(next.light->get(nextIndex), sky))
+        {
+          setLight(next, nextIndex, nx, ny, nz, sky, target);
+          queue.push_back({ nx, ny, nz, 0 });
+        }
+      }
+    }
+    queue.clear();
+  }
+
+  void WorldEditor::apply(std::vector<DirtyRegion>& dirty)
+  {
+    dirty.clear();
+    if (edits.empty())
+      return;
+
+    ZM_PROFILE_SCOPE("apply edits");
+    std::unique_lock lock(world.accessMutex());
+    refs.clear();
+    dirtyRegions.clear();
+
+    // 1. blocks, and darken every edited block that now blocks light or
+    // stopped giving it off
+    size_t applied = 0;
+    for (const Edit& edit : edits)
+    {
+      ChunkRef ref;
+      int index;
+      if (!cellAt(edit.x, edit.y, edit.z, ref, index))
+      {
+        editStats.rejected++;
+        continue;
+      }
+      const BlockId old = ref.chunk->getIndex(index);
+      if (old == edit.block)
+        continue;
+
+      ref.chunk->setIndex(index, edit.block);
+      markDirty(edit.x, edit.y, edit.z);
+      if (save)
+        save->markDirty(worldToChunk(edit.x, edit.y, edit.z));
+      edits[applied++] = edit;
+
+      const uint8_t cell = ref.light->get(index);
+      for (bool sky : { false, true })
+      {
+        const int level = lightOf(cell, sky);
+        const bool lostSource = !sky && blockInfo(old).lightEmission > 0;
+        if (level > 0 && (isOpaque(edit.block) || lostSource))
+        {
+          setLight(ref, index, edit.x, edit.y, edit.z, sky, 0);
+          removeQueue[sky].push_back({ edit.x, edit.y, edit.z, uint8_t(level) });
+        }
+      }
+
+      // an opened block fills from its neighbours
+      if (isOpaque(old) && !isOpaque(edit.block))
+        for (const auto& offset : faceOffsets)
+          for (bool sky : { false, true })
+            addQueue[sky].push_back({ edit.x + offset[0], edit.y + offset[1], edit.z + offset[2], 0 });
+    }
+    editStats.applied += applied;
+
+    // 2. removal floods first, they hand the cells that still have light to
+    // the add floods
+    removeLight(false);
+    removeLight(true);
+
+    // 3. new lamps, then spread everything back out
+    for (size_t i = 0; i < applied; i++)
+    {
+      const Edit& edit = edits[i];
+      const int emission = blockInfo(edit.block).lightEmission;
+      ChunkRef ref;
+      int index;
+      if (emission > 0 && cellAt(edit.x, edit.y, edit.z, ref, index))
+      {
+        setLight(ref, index, edit.x, edit.y, edit.z, false, emission);
+        addQueue[0].push_back({ edit.x, edit.y, edit.z, 0 });
+      }
+    }
+    addLight(false);
+    addLight(true);
+
+    edits.clear();
+    editIndex.clear();
+    for (const auto& [coord, region] : dirtyRegions)
+      dirty.push_back(region);
+    editStats.dirtyChunks += dirty.size();
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "world/chunk_builder.h"
+#include "world/chunk_storage.h"
+#include "world/light.h"
+#include "world/world_save.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace zm
+{
+  // Blocks of one chunk whose block or light changed in an apply(), local
+  // coordinates, inclusive
+  struct DirtyRegion
+  {
+    ChunkCoord coord;
+    int min[3];
+    int max[3];
+  };
+
+  struct EditStats
+  {
+    uint64_t queued = 0;      // setBlock calls
+    uint64_t coalesced = 0;   // overwritten by a later edit of the same block in the frame
+    uint64_t applied = 0;     // actually changed a block
+    uint64_t rejected = 0;    // chunk missing or still being generated/lit
+    uint64_t lightCells = 0;  // cells whose light changed
+    uint64_t dirtyChunks = 0;
+  };
+
+  // Block edits with incremental relighting. Edits are queued during the
+  // frame and applied together, the last edit of a block wins. Light is
+  // updated with breadth-first flood fills from the edited blocks only:
+  // a removal pass darkens everything that was lit through them and collects
+  // the brighter cells around that area, then an add pass spreads light back
+  // out from those and from new lamps. Sunlight at full strength falls
+  // straight down without fading, everything else fades by one per block.
+  //
+  // apply() reports per chunk which blocks changed, including neighbours
+  // whose border faces look at a changed block, so only those get remeshed.
+  // Render thread only, it holds the storage's access mutex while it writes
+  class WorldEditor
+  {
+  public:
+    WorldEditor(ChunkStorage& world, LightStorage& light, const ChunkBuilder& builder, WorldSave* save = nullptr);
+
+    void setBlock(int wx, int wy, int wz, BlockId id);
+    void breakBlock(int wx, int wy, int wz) { setBlock(wx, wy, wz, BLOCK_AIR); }
+    size_t pendingEdits() const { return edits.size(); }
+
+    // Applies the queued edits and relights around them. dirty is cleared
+    // and gets one region per chunk that needs a new mesh
+    void apply(std::vector<DirtyRegion>& dirty);
+
+    const EditStats& stats() const { return editStats; }
+
+  private:
+    struct Edit
+    {
+      int x, y, z;
+      BlockId block;
+    };
+
+    // a chunk the flood fills may touch, cached for the length of an apply
+    struct ChunkRef
+    {
+      Chunk* chunk = nullptr;
+      ChunkLight* light = nullptr;
+    };
+
+    struct LightNode
+    {
+      int x, y, z;
+      uint8_t level;
+    };
+
+    const ChunkRef& chunkAt(ChunkCoord coord);
+    bool cellAt(int wx, int wy, int wz, ChunkRef& ref, int& index);
+    void markDirty(int wx, int wy, int wz);
+    void setLight(const ChunkRef& ref, int index, int wx, int wy, int wz, bool sky, int level);
+    void removeLight(bool sky);
+    void addLight(bool sky);
+
+    ChunkStorage& world;
+    LightStorage& light;
+    const ChunkBuilder& builder;
+    WorldSave* save;
+
+    std::vector<Edit> edits;
+    std::unordered_map<BlockPos, size_t, BlockPosHash> editIndex; // -> edits index
+
+    std::unordered_map<ChunkCoord, ChunkRef, ChunkCoordHash> refs;
+    std::unordered_map<ChunkCoord, DirtyRegion, ChunkCoordHash> dirtyRegions;
+    std::vector<LightNode> removeQueue[2];  // block light, sunlight
+    std::vector<LightNode> addQueue[2];
+
+    EditStats editStats;
+  };
+}
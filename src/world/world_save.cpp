@@ -0,0 +1,201 @@
+#include "world/world_save.h"
+
+#include "core/profiler.h"
+
+#include <cstdio>
+#include <string>
+#include <system_error>
+
+namespace zm
+{
+  WorldSave::WorldSave(std::filesystem::path directory, unsigned ioThreads, size_t maxLoadsInFlight)
+    : directory(std::move(directory)), loaded(maxLoadsInFlight), io(ioThreads ? ioThreads : 1, "io")
+  {
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+  }
+
+  WorldSave::~WorldSave()
+  {
+    io.waitIdle();
+  }
+
+  std::filesystem::path WorldSave::regionPath(RegionCoord coord) const
+  {
+    return directory / ("r." + std::to_string(coord.x) + "." + std::to_string(coord.y) + "." + std::to_string(coord.z) + ".zmr");
+  }
+
+  RegionFile* WorldSave::region(RegionCoord coord)
+  {
+    std::lock_guard<std::mutex> lock(regionMutex);
+    auto it = regions.find(coord);
+    if (it == regions.end())
+    {
+      auto file = std::make_unique<RegionFile>();
+      // a corrupt file is left alone rather than overwritten
+      if (!file->open(regionPath(coord)))
+        file.reset();
+      it = regions.emplace(coord, std::move(file)).first;
+    }
+    return it->second.get();
+  }
+
+  bool WorldSave::loadChunk(ChunkCoord coord, Chunk& out)
+  {
+    RegionFile* file = region(regionOf(coord));
+    if (!file || !file->readChunk(regionSlot(coord), out))
+      return false;
+    chunksLoaded.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool WorldSave::contains(ChunkCoord coord)
+  {
+    RegionFile* file = region(regionOf(coord));
+    return file && file->contains(regionSlot(coord));
+  }
+
+  bool WorldSave::requestLoad(ChunkCoord coord, float priority)
+  {
+    if (loadsPending.load(std::memory_order_relaxed) >= loaded.capacity())
+      return false;
+    loadsPending.fetch_add(1, std::memory_order_relaxed);
+
+    io.submit([this, coord] {
+      ZM_PROFILE_SCOPE("load chunk");
+      LoadedChunk result;
+      result.coord = coord;
+      result.chunk = std::make_unique<Chunk>();
+      if (!loadChunk(coord, *result.chunk))
+        result.chunk.reset();
+      // can't fail, the queue is as big as the number of loads allowed in flight
+      loaded.tryPush(std::move(result));
+    }, priority);
+    return true;
+  }
+
+  size_t WorldSave::drainLoaded(std::vector<LoadedChunk>& out, size_t maxChunks)
+  {
+    const size_t count = loaded.drain(out, maxChunks);
+    loadsPending.fetch_sub(count, std::memory_order_relaxed);
+    return count;
+  }
+
+  void WorldSave::markDirty(ChunkCoord coord)
+  {
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    dirty.insert(coord);
+  }
+
+  size_t WorldSave::dirtyCount() const
+  {
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    return dirty.size();
+  }
+
+  size_t WorldSave::flush(const ChunkStorage& world, size_t maxChunks)
+  {
+    return flushDirty(world, nullptr, maxChunks);
+  }
+
+  size_t WorldSave::flush(const ChunkStorage& world, const std::vector<ChunkCoord>& coords)
+  {
+    return flushDirty(world, &coords, SIZE_MAX);
+  }
+
+  size_t WorldSave::flushDirty(const ChunkStorage& world, const std::vector<ChunkCoord>* coords, size_t maxChunks)
+  {
+    ZM_PROFILE_SCOPE("save flush");
+
+    struct Snapshot
+    {
+      int slot;
+      Chunk chunk;
+    };
+    std::unordered_map<RegionCoord, std::vector<Snapshot>, RegionCoordHash> batches;
+    size_t queued = 0;
+
+    // copying a chunk is a couple of small vectors, much cheaper than
+    // holding the world still while the pool compresses
+    {
+      std::lock_guard<std::mutex> lock(dirtyMutex);
+      if (coords)
+      {
+        for (const ChunkCoord& coord : *coords)
+        {
+          if (!dirty.erase(coord))
+            continue;
+          if (const Chunk* chunk = world.getChunk(coord))
+          {
+            batches[regionOf(coord)].push_back({ regionSlot(coord), *chunk });
+            queued++;
+          }
+        }
+      }
+      else
+        for (auto it = dirty.begin(); it != dirty.end() && queued < maxChunks;)
+        {
+          if (const Chunk* chunk = world.getChunk(*it))
+          {
+            batches[regionOf(*it)].push_back({ regionSlot(*it), *chunk });
+            queued++;
+          }
+          it = dirty.erase(it);
+        }
+    }
+
+    for (auto& [regionCoord, batch] : batches)
+    {
+      RegionFile* file = region(regionCoord);
+      if (!file)
+      {
+        failedWrites.fetch_add(batch.size(), std::memory_order_relaxed);
+        continue;
+      }
+
+      auto chunks = std::make_shared<std::vector<Snapshot>>(std::move(batch));
+      JobHandle& previous = lastWrite[regionCoord];
+      previous = io.submit([this, file, chunks] {
+        ZM_PROFILE_SCOPE("save region");
+        std::vector<RegionFile::Write> writes(chunks->size());
+        size_t bytes = 0;
+        for (size_t i = 0; i < writes.size(); i++)
+        {
+          writes[i].slot = (*chunks)[i].slot;
+          RegionFile::compressChunk((*chunks)[i].chunk, writes[i].payload);
+          bytes += writes[i].payload.size();
+        }
+
+        if (file->writeChunks(writes))
+        {
+          chunksSaved.fetch_add(writes.size(), std::memory_order_relaxed);
+          bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        else
+          failedWrites.fetch_add(writes.size(), std::memory_order_relaxed);
+      }, 0.0f, { previous });
+    }
+
+    // finished chains don't need remembering
+    for (auto it = lastWrite.begin(); it != lastWrite.end();)
+      it = it->second->isFinished() ? lastWrite.erase(it) : std::next(it);
+
+    return queued;
+  }
+
+  WorldSaveStats WorldSave::stats() const
+  {
+    WorldSaveStats stats;
+    stats.dirtyChunks = dirtyCount();
+    stats.pendingJobs = io.pendingJobs();
+    {
+      std::lock_guard<std::mutex> lock(regionMutex);
+      stats.regionsOpen = regions.size();
+    }
+    stats.chunksSaved = chunksSaved.load(std::memory_order_relaxed);
+    stats.chunksLoaded = chunksLoaded.load(std::memory_order_relaxed);
+    stats.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    stats.failedWrites = failedWrites.load(std::memory_order_relaxed);
+    return stats;
+  }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core/bounded_queue.h"
+#include "core/job_system.h"
+#include "world/chunk_storage.h"
+#include "world/region_file.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace zm
+{
+  struct LoadedChunk
+  {
+    ChunkCoord coord;
+    std::unique_ptr<Chunk> chunk; // null when the chunk was never saved
+  };
+
+  struct WorldSaveStats
+  {
+    size_t dirtyChunks = 0;
+    size_t pendingJobs = 0;
+    size_t regionsOpen = 0;
+    uint64_t chunksSaved = 0;
+    uint64_t chunksLoaded = 0;
+    uint64_t bytesWritten = 0; // compressed payload bytes
+    uint64_t failedWrites = 0;
+  };
+
+  // A world on disk as a directory of region files. Owns a small I/O pool:
+  //  - markDirty() + flush() batch changed chunks, one job per region that
+  //    compresses and writes them with a single table update. Jobs for the
+  //    same region run in submission order
+  //  - requestLoad() decodes on the pool into a queue drained like meshes,
+  //    loadChunk() is the same thing synchronously and is safe on any thread
+  class WorldSave
+  {
+  public:
+    explicit WorldSave(std::filesystem::path directory, unsigned ioThreads = 2, size_t maxLoadsInFlight = 256);
+    // finishes every queued write
+    ~WorldSave();
+
+    WorldSave(const WorldSave&) = delete;
+    WorldSave& operator=(const WorldSave&) = delete;
+
+    // false when coord was never saved or its data is unreadable
+    bool loadChunk(ChunkCoord coord, Chunk& out);
+    bool contains(ChunkCoord coord);
+
+    // false when maxLoadsInFlight loads are already pending
+    bool requestLoad(ChunkCoord coord, float priority = 0.0f);
+    size_t drainLoaded(std::vector<LoadedChunk>& out, size_t maxChunks);
+
+    // Safe from any thread
+    void markDirty(ChunkCoord coord);
+    size_t dirtyCount() const;
+
+    // Snapshots up to maxChunks dirty chunks out of world on the calling
+    // thread and hands them to the pool. Chunks missing from world are
+    // dropped from the dirty set. Returns how many were queued
+    size_t flush(const ChunkStorage& world, size_t maxChunks = SIZE_MAX);
+    // The same for just the dirty ones among coords, e.g. before they are
+    // dropped from world
+    size_t flush(const ChunkStorage& world, const std::vector<ChunkCoord>& coords);
+
+    // Blocks until every queued load and write is done
+    void waitIdle() { io.waitIdle(); }
+
+    WorldSaveStats stats() const;
+
+  private:
+    size_t flushDirty(const ChunkStorage& world, const std::vector<ChunkCoord>* coords, size_t maxChunks);
+
+    // null for regions that exist but could not be opened
+    RegionFile* region(RegionCoord coord);
+    std::filesystem::path regionPath(RegionCoord coord) const;
+
+    std::filesystem::path directory;
+
+    mutable std::mutex regionMutex;
+    std::unordered_map<RegionCoord, std::unique_ptr<RegionFile>, RegionCoordHash> regions;
+
+    mutable std::mutex dirtyMutex;
+    std::unordered_set<ChunkCoord, ChunkCoordHash> dirty;
+
+    // last write job per region, the next one waits for it. Only touched by
+    // the thread calling flush()
+    std::unordered_map<RegionCoord, JobHandle, RegionCoordHash> lastWrite;
+
+    BoundedQueue<LoadedChunk> loaded;
+    std::atomic<size_t> loadsPending{ 0 };
+
+    std::atomic<uint64_t> chunksSaved{ 0 };
+    std::atomic<uint64_t> chunksLoaded{ 0 };
+    std::atomic<uint64_t> bytesWritten{ 0 };
+    std::atomic<uint64_t> failedWrites{ 0 };
+
+    // declared last so its workers stop before anything they use goes away
+    JobSystem io;
+  };
+}